@@ -0,0 +1,100 @@
+/*
+ * Compares walking a filled notebook through the C API and through the C++
+ * binding of spnotes.hpp, which should cost the same.
+ *
+ * Usage: bench-cpp <notes path> [rounds]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+
+#include "../spnotes.hpp"
+
+/* keeps the compiler from dropping the loops being timed */
+static volatile std::size_t sink;
+
+template <typename F>
+static double
+ns_per_note(F walk, int rounds, std::size_t notes_c)
+{
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++)
+		sink = walk();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() /
+	       rounds / notes_c;
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <notes path> [rounds]\n";
+		return EXIT_FAILURE;
+	}
+	int rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+
+	std::optional<spnotes::Notebook> nb_holder;
+	try {
+		nb_holder.emplace(argv[1]);
+		nb_holder->fill();
+	} catch (const spnotes::Error &e) {
+		std::cerr << "ERROR: " << e.what() << " (" << e.code() << ")\n";
+		return EXIT_FAILURE;
+	}
+	spnotes::Notebook &nb       = *nb_holder;
+	const spnotes_t   *instance = nb.c_ptr();
+	std::size_t      notes_c  = std::ranges::distance(nb.notes());
+	if (notes_c == 0) {
+		std::cerr << "ERROR: No notes found.\n";
+		return EXIT_FAILURE;
+	}
+
+	/* the same work both ways: the length of the titles and descriptions */
+	double c_ns = ns_per_note(
+		[&] {
+			std::size_t len = 0;
+			for (std::size_t i = 0; i < instance->categs_c; i++) {
+				const spnotes_categ *categ = &instance->categs[i];
+				for (std::size_t j = 0; j < categ->notes_c; j++) {
+					len += strlen(categ->notes[j].title);
+					if (categ->notes[j].has_description)
+						len += strlen(
+							categ->notes[j].description);
+				}
+			}
+			return len;
+		},
+		rounds, notes_c);
+
+	double loop_ns = ns_per_note(
+		[&] {
+			std::size_t len = 0;
+			for (spnotes::Category categ : nb.categories())
+				for (spnotes::Note note : categ.notes())
+					len += note.title().size() +
+					       note.description().size();
+			return len;
+		},
+		rounds, notes_c);
+
+	double ranges_ns = ns_per_note(
+		[&] {
+			std::size_t len = 0;
+			std::ranges::for_each(nb.notes(), [&](spnotes::Note note) {
+				len += note.title().size() +
+				       note.description().size();
+			});
+			return len;
+		},
+		rounds, notes_c);
+
+	std::cout << notes_c << " notes, " << rounds << " rounds\n"
+	          << "C API:         " << c_ns << " ns/note\n"
+	          << "C++ for loops: " << loop_ns << " ns/note\n"
+	          << "C++ ranges:    " << ranges_ns << " ns/note\n";
+	return EXIT_SUCCESS;
+}
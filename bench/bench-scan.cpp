@@ -0,0 +1,139 @@
+/*
+ * Compares filling a notebook with a cold page cache in the order of the
+ * directory entries, by inode number and by offset on the disk (see the
+ * 'scan_order' of spnotes_t). A notebook is generated at the path first if
+ * there's nothing there.
+ *
+ * The caches are dropped through /proc/sys/vm/drop_caches when run as root,
+ * else only the pages of the note files are evicted, leaving the inodes
+ * cached (which mostly hides what inode ordering saves).
+ *
+ * Usage: bench-scan <notes path> [rounds] [categories] [notes per category]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>  /* posix_fadvise() */
+#include <unistd.h> /* sync() */
+
+#include "../spnotes.hpp"
+
+namespace fs = std::filesystem;
+
+/* writes `categs_c` categories of `notes_c` notes under `root` */
+static void
+generate(const fs::path &root, int categs_c, int notes_c)
+{
+	std::mt19937                       rng(42);
+	std::uniform_int_distribution<int> body_len(512, 8192);
+	std::vector<int>                   order(notes_c);
+
+	for (int i = 0; i < categs_c; i++) {
+		fs::path categ = root / ("categ" + std::to_string(i));
+		fs::create_directories(categ);
+
+		/* created out of the order of their names */
+		for (int j = 0; j < notes_c; j++)
+			order[j] = j;
+		std::shuffle(order.begin(), order.end(), rng);
+		for (int j : order) {
+			std::ofstream out(categ /
+			                  (std::to_string(1648000000 + j) + ".md"));
+			out << "---\ntitle: Note " << j << " of " << i
+			    << "\ndescription: Generated by bench-scan\n---\n\n"
+			    << std::string(body_len(rng), 'x') << '\n';
+		}
+	}
+}
+
+/* Returns whether the inodes were dropped too. */
+static bool
+drop_caches(const fs::path &root)
+{
+	sync();
+	std::ofstream drop("/proc/sys/vm/drop_caches");
+	if (drop << "3\n" << std::flush)
+		return true;
+
+	for (const fs::directory_entry &entry :
+	     fs::recursive_directory_iterator(root)) {
+		if (!entry.is_regular_file())
+			continue;
+		int fd = open(entry.path().c_str(), O_RDONLY);
+		if (fd < 0)
+			continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+	return false;
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0]
+		          << " <notes path> [rounds] [categories] [notes per "
+		             "category]\n";
+		return EXIT_FAILURE;
+	}
+	fs::path root     = argv[1];
+	int      rounds   = argc > 2 ? std::atoi(argv[2]) : 3;
+	int      categs_c = argc > 3 ? std::atoi(argv[3]) : 20;
+	int      notes_c  = argc > 4 ? std::atoi(argv[4]) : 1000;
+
+	if (!fs::exists(root)) {
+		std::cout << "Generating " << categs_c << " x " << notes_c
+		          << " notes in " << root << "\n";
+		generate(root, categs_c, notes_c);
+	}
+
+	static const struct {
+		const char *name;
+		int         order;
+	} orders[] = {
+		{ "dirent", SPNOTES_SCAN_DIRENT },
+		{ "inode", SPNOTES_SCAN_INODE },
+		{ "extent", SPNOTES_SCAN_EXTENT },
+	};
+
+	bool        cold_inodes = true;
+	std::size_t found_c     = 0;
+	for (const auto &order : orders) {
+		std::vector<double> ms;
+		for (int i = 0; i < rounds; i++) {
+			cold_inodes = drop_caches(root) && cold_inodes;
+			try {
+				spnotes::Notebook nb(root.c_str());
+				nb.c_ptr()->scan_order = order.order;
+
+				auto begin = std::chrono::steady_clock::now();
+				nb.fill();
+				auto end = std::chrono::steady_clock::now();
+				ms.push_back(std::chrono::duration<double, std::milli>(
+						     end - begin)
+				                     .count());
+				found_c = std::ranges::distance(nb.notes());
+			} catch (const spnotes::Error &e) {
+				std::cerr << "ERROR: " << e.what() << " (" << e.code()
+				          << ")\n";
+				return EXIT_FAILURE;
+			}
+		}
+		std::sort(ms.begin(), ms.end());
+		std::cout << order.name << ":\tmedian " << ms[ms.size() / 2]
+		          << " ms, min " << ms.front() << " ms\n";
+	}
+
+	std::cout << found_c << " notes, " << rounds << " cold rounds"
+	          << (cold_inodes ? "" : " (file pages only, not root)")
+	          << "\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,6 @@
+/* The implementation of spnotes.h for the C++ benchmarks. */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#define SPNOTES_IMPL
+#include "../spnotes.h"
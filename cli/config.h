@@ -1,4 +1,5 @@
 /* Defalt notes location - Will get overridden if  */
+/* Several locations can be given separated by ':' */
 static char *notes_root_loc = "/home/safal/docs/notes/";
 
 /* Template to add when new note is created (simple printf macro) */
@@ -1,7 +1,6 @@
 #ifndef __OpenBSD__
 #define _POSIX_C_SOURCE 200809L /* strdup() and strndup() */
 #define _DEFAULT_SOURCE         /* d_type macro constants */
-#define _XOPEN_SOURCE   500     /* nftw() */
 #endif
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,8 +24,9 @@
  */
 
 #define USAGE_STR                                                                                                                     \
-	"Usage: %s [(a)dd/(r)emove/(l)ist/(p)ath/(i)nfo] [(c)ategory/(n)ote] [categ_title] [note_title]\n\nAvailable options are:\n", \
-		argv[0]
+	"Usage: %s [(a)dd/(r)emove/(l)ist/(p)ath/(i)nfo] [(c)ategory/(n)ote/(t)ag] [categ_title/tag_query] [note_title]\n       %s (g)rep [pattern]\n       %s (f)ind [substring]\n       %s import [md_dir/jsonl_file] [categ_title]\n       %s trash/undelete [id]/purge [id]\n       %s recent [count]\n       %s dupes [exact]\n       %s links/backlinks [categ_title] [note_title]\n       %s set [(t)itle/(d)escription] [categ_title] [note_title] [value]\n       %s mv [(c)ategory/(n)ote] [categ_title] [new_title/note_title] [to_categ_title]\n       %s merge [categ_title] [into_categ_title]\n       %s complete [bash/zsh/fish]\n\nAvailable options are:\n", \
+		argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0],                                                        \
+		argv[0], argv[0], argv[0], argv[0], argv[0]
 
 #define ERR_MORE_INFO(msg) splu_die("ERROR: " msg " Use --help for more info.");
 #define ERR_ERRNO(msg)     splu_die("ERROR: " msg ": %s.", strerror(errno));
@@ -53,7 +53,105 @@ static splf_info f_info;
 static spnotes_t spn_instance;
 static char     *delimiter = " --- ";
 
-int to_sort_alphabet = 0;
+int   to_sort_alphabet = 0;
+int   to_sort_created  = 0;
+char *sort_order       = NULL;
+int   grep_regex       = 0;
+int   ignore_case      = 0;
+int   search_flags     = 0;
+int   grep_context     = 0;
+int   use_shm          = 0;
+int   nested           = 0;
+char *trace_path       = NULL;
+int   print_traced     = 0;
+int   max_memory_mib   = 0;
+int   page_limit       = 0;
+char *page_after       = NULL;
+char *scan_order       = NULL;
+
+/*
+ * scripts of 'complete', asking for the completions with '__complete' and
+ * skipping the value of every option taking one
+ */
+static const char completion_bash[] =
+	"# bash completion of spnotes-cli: eval \"$(spnotes-cli complete bash)\"\n"
+	"_spnotes_cli()\n"
+	"{\n"
+	"\tlocal args=() flags=() bs='\\ ' i word\n"
+	"\tfor ((i = 1; i < COMP_CWORD; i++)); do\n"
+	"\t\tword=${COMP_WORDS[i]//\"$bs\"/ }\n"
+	"\t\tcase $word in\n"
+	"\t\t-p | --path) flags+=(\"$word\" \"${COMP_WORDS[i + 1]}\"); ((i++)) ;;\n"
+	"\t\t-n | --nested | -i | --ignore-case) flags+=(\"$word\") ;;\n"
+	"\t\t-C | --context | -d | --delimiter | --sort | --limit) ((i++)) ;;\n"
+	"\t\t--after | --scan | --max-memory | --trace) ((i++)) ;;\n"
+	"\t\t-*) ;;\n"
+	"\t\t*) args+=(\"$word\") ;;\n"
+	"\t\tesac\n"
+	"\tdone\n"
+	"\tword=${COMP_WORDS[COMP_CWORD]//\"$bs\"/ }\n"
+	"\tlocal IFS=$'\\n'\n"
+	"\tCOMPREPLY=($(spnotes-cli \"${flags[@]}\" __complete -- \"${args[@]}\" \\\n"
+	"\t\t\"$word\" 2>/dev/null | while read -r word; do\n"
+	"\t\tprintf '%q\\n' \"$word\"\n"
+	"\tdone))\n"
+	"}\n"
+	"complete -F _spnotes_cli spnotes-cli\n";
+
+static const char completion_zsh[] =
+	"#compdef spnotes-cli\n"
+	"# zsh completion of spnotes-cli: eval \"$(spnotes-cli complete zsh)\"\n"
+	"_spnotes_cli()\n"
+	"{\n"
+	"\tlocal -a args flags\n"
+	"\tlocal i\n"
+	"\tfor ((i = 2; i < CURRENT; i++)); do\n"
+	"\t\tcase $words[i] in\n"
+	"\t\t-p | --path) flags+=($words[i] ${(Q)words[i + 1]}); ((i++)) ;;\n"
+	"\t\t-n | --nested | -i | --ignore-case) flags+=($words[i]) ;;\n"
+	"\t\t-C | --context | -d | --delimiter | --sort | --limit) ((i++)) ;;\n"
+	"\t\t--after | --scan | --max-memory | --trace) ((i++)) ;;\n"
+	"\t\t-*) ;;\n"
+	"\t\t*) args+=(\"${(Q)words[i]}\") ;;\n"
+	"\t\tesac\n"
+	"\tdone\n"
+	"\tcompadd -- ${(f)\"$(spnotes-cli $flags __complete -- \"${args[@]}\" \\\n"
+	"\t\t\"${(Q)words[CURRENT]}\" 2>/dev/null)\"}\n"
+	"}\n"
+	"compdef _spnotes_cli spnotes-cli\n";
+
+static const char completion_fish[] =
+	"# fish completion of spnotes-cli: spnotes-cli complete fish | source\n"
+	"function __spnotes_cli_complete\n"
+	"\tset -l tokens (commandline -opc)\n"
+	"\tset -l flags\n"
+	"\tset -l args\n"
+	"\tset -l i 2\n"
+	"\twhile test $i -le (count $tokens)\n"
+	"\t\tswitch $tokens[$i]\n"
+	"\t\t\tcase -p --path\n"
+	"\t\t\t\tset -a flags $tokens[$i]\n"
+	"\t\t\t\tset i (math $i + 1)\n"
+	"\t\t\t\tset -a flags $tokens[$i]\n"
+	"\t\t\tcase -n --nested -i --ignore-case\n"
+	"\t\t\t\tset -a flags $tokens[$i]\n"
+	"\t\t\tcase -C --context -d --delimiter --sort --limit --after \\\n"
+	"\t\t\t\t--scan --max-memory --trace\n"
+	"\t\t\t\tset i (math $i + 1)\n"
+	"\t\t\tcase '-*'\n"
+	"\t\t\tcase '*'\n"
+	"\t\t\t\tset -a args $tokens[$i]\n"
+	"\t\tend\n"
+	"\t\tset i (math $i + 1)\n"
+	"\tend\n"
+	"\tspnotes-cli $flags __complete -- $args (commandline -ct) 2>/dev/null\n"
+	"end\n"
+	"complete -c spnotes-cli -f -a '(__spnotes_cli_complete)'\n";
+
+#ifdef SPNOTES_STATS
+static uint64_t       print_begin_ns;
+static spnotes_memory filled_memory; /* taken before the instance is freed */
+#endif
 
 /*
  ===============================================================================
@@ -65,6 +163,10 @@ int to_sort_alphabet = 0;
 static void
 fill_categs_notes(void);
 
+/* Fill only the categories, the notes being read on demand. */
+static void
+fill_categs(void);
+
 /* Print all the categories and notes in a tree view. */
 static void
 print_notes_tree(void);
@@ -77,49 +179,159 @@ print_categs_list(void);
 static void
 print_notes_list(spnotes_categ *categ);
 
+/* Print a page of the notes of a category (--limit/--after) in a list. */
+static void
+print_notes_page(spnotes_categ *categ);
+
+/*
+ * Print the tree view (`what` being NULL), the categories or the notes of the
+ * given category in a list straight from the catalog published by a --shm
+ * run. Returns 0 without printing anything if it's missing or stale.
+ */
+static int
+print_shm(const char *what, const char *categ_title);
+
+/* Print all the tags or the notes matching the given tag query in a list. */
+static void
+print_tags_list(const char *query);
+
+/* Print the lines of notes matching the given pattern. */
+static void
+print_grep(const char *pattern);
+
+/* Print the notes whose title or description contains the given substring. */
+static void
+print_find(const char *substr);
+
+/* Print the given number of most recently modified notes. */
+static void
+print_recent(const char *count);
+
+/* Print the groups of duplicate notes, the near ones too unless `exact`. */
+static void
+print_dupes(int exact);
+
+/*
+ * Print the notes the given note links to and its URLs, or the notes linking
+ * to it if `is_back`.
+ */
+static void
+print_links(const char *categ_title, const char *note_title, int is_back);
+
+/* Print the categories and notes in the trash. */
+static void
+print_trash_list(void);
+
+/*
+ * Print the completions of the last of the given positional words for the
+ * completion scripts, or nothing if there's none.
+ */
+static void
+print_completions(char **words, size_t words_c);
+
+/* Finish the trace file of --trace (registered with 'atexit()'). */
+static void
+finish_trace(void);
+
+#ifdef SPNOTES_STATS
+/* Print the performance counters to stderr (registered with 'atexit()'). */
+static void
+print_stats(void);
+#endif
+
 /*
  ===============================================================================
  |                          Function Implementations                           |
  ===============================================================================
  */
 
+static void
+sort_categs(void)
+{
+	if (to_sort_alphabet)
+		spnotes_categs_sort_alphabetically(&spn_instance);
+	else
+		spnotes_categs_sort_last_modified(&spn_instance);
+	if (nested)
+		spnotes_categs_sort_tree(&spn_instance);
+}
+
 static void
 fill_categs_notes(void)
 {
+	/* attach to the catalog published by an earlier run */
+	if (use_shm && spnotes_shm_load(&spn_instance, NULL))
+		goto sort;
+
+	/* read categs and their notes at any depth */
+	if (nested) {
+		if (spnotes_categs_fill_nested(&spn_instance,
+		                               SPNOTES_FILL_NOTES) < 0)
+			splu_die("ERROR: Couldn't get the categories: %s.",
+			         spnotes_errorstr());
+		goto publish;
+	}
+
 	/* read categs */
 	if (spnotes_categs_fill(&spn_instance) < 0)
 		splu_die("ERROR: Couldn't get the categories: %s.",
 		         spnotes_errorstr());
 
-	/* sort categories */
-	if (to_sort_alphabet)
-		spnotes_categs_sort_alphabetically(&spn_instance);
-	else
-		spnotes_categs_sort_last_modified(&spn_instance);
-
 	/* read notes */
 	for (size_t i = 0; i < spn_instance.categs_c; i++)
 		if (spnotes_notes_fill(spn_instance.categs + i) < 0)
 			splu_die("ERROR: Couldn't get the notes: %s.",
 			         spnotes_errorstr());
 
+publish:
+	/* publish it for the next runs, not being able to is no error */
+	if (use_shm)
+		spnotes_shm_publish(&spn_instance, NULL);
+
+sort:
+	sort_categs();
+
 	/* sort notes */
 	for (size_t i = 0; i < spn_instance.categs_c; i++)
 		if (to_sort_alphabet)
 			spnotes_notes_sort_alphabetically(spn_instance.categs +
 			                                  i);
+		else if (to_sort_created)
+			spnotes_notes_sort_created(spn_instance.categs + i);
 		else
 			spnotes_notes_sort_last_modified(spn_instance.categs +
 			                                 i);
 }
 
+static void
+fill_categs(void)
+{
+	/* the catalog published by an earlier run has the notes already */
+	if (use_shm && spnotes_shm_load(&spn_instance, NULL))
+		return;
+
+	if ((nested ? spnotes_categs_fill_nested(&spn_instance, 0) :
+	              spnotes_categs_fill(&spn_instance)) < 0)
+		splu_die("ERROR: Couldn't get the categories: %s.",
+		         spnotes_errorstr());
+}
+
 static void
 print_notes_tree(void)
 {
 	for (size_t i = 0; i < spn_instance.categs_c; i++) {
-		printf("%s\n", spn_instance.categs[i].title);
+		/* nested categories are indented under their parents */
+		char *title = spn_instance.categs[i].title, *name = title;
+		int   depth = 0;
+		for (char *c = title; *c; c++)
+			if (*c == '/') {
+				name = c + 1;
+				depth++;
+			}
+
+		printf("%*s%s\n", depth * 4, "", name);
 		for (size_t j = 0; j < spn_instance.categs[i].notes_c; j++) {
-			printf("%s %s",
+			printf("%*s%s %s", depth * 4, "",
 			       j == spn_instance.categs[i].notes_c - 1 ? "└──" :
 			                                                 "├──",
 			       spn_instance.categs[i].notes[j].title);
@@ -151,6 +363,560 @@ print_notes_list(spnotes_categ *categ)
 	}
 }
 
+static void
+print_notes_page(spnotes_categ *categ)
+{
+	spnotes_note *notes;
+	size_t        notes_c;
+	char          next[SPNOTES_CURSOR_MAX];
+	int           flags = to_sort_alphabet ? SPNOTES_PAGE_ALPHABET :
+	                      to_sort_created  ? SPNOTES_PAGE_CREATED :
+	                                         0;
+	if (spnotes_notes_page(categ, flags, page_after,
+	                       page_limit > 0 ? page_limit : 0,
+	                       &notes, &notes_c, next) < 0)
+		splu_die("ERROR: Couldn't get the notes: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < notes_c; i++) {
+		printf("%s", notes[i].title);
+		if (notes[i].has_description)
+			printf("%s%s", delimiter, notes[i].description);
+		printf("\n");
+	}
+	/* on stderr to keep stdout the same as a full list */
+	if (next[0])
+		fprintf(stderr, "--after %s\n", next);
+
+	spnotes_notes_recent_free(notes, notes_c);
+}
+
+/* a category or note of the catalog and the time it's listed by */
+typedef struct {
+	int64_t  sec, nsec;
+	uint32_t i;
+} shm_entry;
+
+static int
+compare_shm_entries(const void *a, const void *b)
+{
+	const shm_entry *e1 = a, *e2 = b;
+
+	/* last modified first */
+	if (e1->sec != e2->sec)
+		return e1->sec > e2->sec ? -1 : 1;
+	if (e1->nsec != e2->nsec)
+		return e1->nsec > e2->nsec ? -1 : 1;
+	return (e1->i > e2->i) - (e1->i < e2->i);
+}
+
+/*
+ * Fill `entries` with the `count` categories (notes if `is_notes`) of the
+ * catalog from the `first` one in the order to list them in. Returns 0 on a
+ * torn read.
+ */
+static int
+sort_shm_entries(const spnotes_shm_view *view, int is_notes, size_t first,
+                 size_t count, shm_entry *entries)
+{
+	const uint32_t *order =
+		view->order + (is_notes ? view->categs_c : 0) + first;
+
+	for (size_t j = 0; j < count; j++) {
+		/* the catalog has the titles in order already */
+		if (to_sort_alphabet) {
+			uint32_t i = order[j];
+			if (i < first || i >= first + count)
+				return 0;
+			entries[j].i = i;
+			continue;
+		}
+
+		entries[j].i    = first + j;
+		entries[j].sec  = is_notes ? view->notes[first + j].mtime_sec :
+		                             view->categs[first + j].mtime_sec;
+		entries[j].nsec = is_notes ? view->notes[first + j].mtime_nsec :
+		                             view->categs[first + j].mtime_nsec;
+	}
+	if (!to_sort_alphabet)
+		qsort(entries, count, sizeof(shm_entry), compare_shm_entries);
+	return 1;
+}
+
+static int
+print_shm(const char *what, const char *categ_title)
+{
+	int is_tree = what == NULL;
+	int is_categs =
+		what && (!strcmp(what, "category") || !strcmp(what, "c"));
+	if (!is_tree && !is_categs &&
+	    (!categ_title || (strcmp(what, "note") && strcmp(what, "n"))))
+		return 0;
+
+	spnotes_shm_view view;
+	if (!spnotes_shm_attach(&spn_instance, NULL, &view))
+		return 0;
+
+	/* printed once the catalog is known not to be rewritten meanwhile */
+	char      *buf    = NULL;
+	size_t     len    = 0;
+	FILE      *out    = open_memstream(&buf, &len);
+	shm_entry *categs = malloc((view.categs_c + 1) * sizeof(shm_entry));
+	shm_entry *notes  = malloc((view.notes_c + 1) * sizeof(shm_entry));
+	int        is_ok  = out && categs && notes &&
+	                   sort_shm_entries(&view, 0, 0, view.categs_c, categs);
+
+	int is_found = is_tree || is_categs;
+
+	for (size_t c = 0; is_ok && c < view.categs_c; c++) {
+		const spnotes_shm_categ *sc    = &view.categs[categs[c].i];
+		const char              *title =
+			spnotes_shm_str(&view, sc->title_off);
+		if (is_categs || (!is_tree && strcmp(title, categ_title))) {
+			if (is_categs)
+				fprintf(out, "%s\n", title);
+			continue;
+		}
+
+		uint64_t first = sc->notes_first, notes_c = sc->notes_c;
+		if (first > view.notes_c || notes_c > view.notes_c - first ||
+		    !sort_shm_entries(&view, 1, first, notes_c, notes)) {
+			is_ok = 0;
+			break;
+		}
+		if (is_tree)
+			fprintf(out, "%s\n", title);
+		for (size_t j = 0; j < notes_c; j++) {
+			const spnotes_shm_note *sn = &view.notes[notes[j].i];
+			if (is_tree)
+				fprintf(out, "%s ",
+				        j == notes_c - 1 ? "└──" : "├──");
+			fprintf(out, "%s",
+			        spnotes_shm_str(&view, sn->title_off));
+			if (sn->desc_off)
+				fprintf(out, "%s%s", delimiter,
+				        spnotes_shm_str(&view, sn->desc_off));
+			fprintf(out, "\n");
+		}
+		if (!is_tree) {
+			is_found = 1;
+			break;
+		}
+	}
+	if (out)
+		fclose(out);
+
+	/* a missing category is left to the usual error */
+	is_ok = is_ok && is_found && spnotes_shm_validate(&view);
+	if (is_ok) {
+		if (!is_tree)
+			splf_warn_ignored_args(f_info, stderr,
+			                       is_categs ? 2 : 3);
+		fwrite(buf, 1, len, stdout);
+	}
+
+	free(buf);
+	free(categs);
+	free(notes);
+	spnotes_shm_detach(&view);
+	return is_ok;
+}
+
+static void
+print_tags_list(const char *query)
+{
+	if (spnotes_tags_index_build(&spn_instance) < 0)
+		splu_die("ERROR: Couldn't index the tags: %s.",
+		         spnotes_errorstr());
+
+	if (!query) {
+		for (size_t i = 0; i < spn_instance.tags->tags_c; i++)
+			printf("%s\n", spn_instance.tags->names[i]);
+		return;
+	}
+
+	spnotes_note **notes;
+	size_t         notes_c;
+	if (spnotes_tags_query(&spn_instance, query, &notes, &notes_c) < 0)
+		splu_die("ERROR: Couldn't query the tags: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < notes_c; i++) {
+		printf("%s/%s", notes[i]->categ->title, notes[i]->title);
+		if (notes[i]->has_description)
+			printf("%s%s", delimiter, notes[i]->description);
+		printf("\n");
+	}
+
+	free(notes);
+}
+
+/* the order of the notes in a list, for the ones parsed by the grep */
+static int
+compare_grep_lines(const void *a, const void *b)
+{
+	const spnotes_grep_line *la = a, *lb = b;
+
+	if (la->note == lb->note)
+		return la->line_no < lb->line_no ? -1 : 1;
+	if (la->note->categ != lb->note->categ)
+		return la->note->categ < lb->note->categ ? -1 : 1;
+
+	int cmp = 0;
+	if (to_sort_alphabet) {
+		cmp = strcmp(la->note->title, lb->note->title);
+	} else {
+		const struct timespec *ta = to_sort_created ?
+		                                    &la->note->created :
+		                                    &la->note->last_modified;
+		const struct timespec *tb = to_sort_created ?
+		                                    &lb->note->created :
+		                                    &lb->note->last_modified;
+		if (ta->tv_sec != tb->tv_sec)
+			cmp = ta->tv_sec > tb->tv_sec ? -1 : 1;
+		else if (ta->tv_nsec != tb->tv_nsec)
+			cmp = ta->tv_nsec > tb->tv_nsec ? -1 : 1;
+	}
+	if (cmp)
+		return cmp;
+	return la->note < lb->note ? -1 : 1;
+}
+
+static void
+print_grep(const char *pattern)
+{
+	int flags = 0;
+	if (grep_regex)
+		flags |= SPNOTES_GREP_REGEX;
+	if (ignore_case)
+		flags |= SPNOTES_GREP_ICASE;
+
+	spnotes_grep_line *lines;
+	size_t             lines_c;
+	if (spnotes_grep(&spn_instance, pattern, flags,
+	                 grep_context > 0 ? grep_context : 0, &lines,
+	                 &lines_c) < 0)
+		splu_die("ERROR: Couldn't search the notes: %s.",
+		         spnotes_errorstr());
+	qsort(lines, lines_c, sizeof(spnotes_grep_line), compare_grep_lines);
+
+	for (size_t i = 0; i < lines_c; i++) {
+		/* separate the non-contiguous group of lines like grep does */
+		if (grep_context > 0 && i > 0 &&
+		    (lines[i].note != lines[i - 1].note ||
+		     lines[i].line_no != lines[i - 1].line_no + 1))
+			printf("--\n");
+
+		char sep = lines[i].is_match ? ':' : '-';
+		printf("%s/%s%c%zu%c%s\n", lines[i].note->categ->title,
+		       lines[i].note->title, sep, lines[i].line_no, sep,
+		       lines[i].text);
+	}
+
+	spnotes_grep_free(lines, lines_c);
+}
+
+static void
+print_find(const char *substr)
+{
+	spnotes_note **notes;
+	size_t         notes_c;
+	if (spnotes_trigrams_query(&spn_instance, substr, search_flags, &notes,
+	                           &notes_c) < 0)
+		splu_die("ERROR: Couldn't find the notes: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < notes_c; i++) {
+		printf("%s/%s", notes[i]->categ->title, notes[i]->title);
+		if (notes[i]->has_description)
+			printf("%s%s", delimiter, notes[i]->description);
+		printf("\n");
+	}
+
+	free(notes);
+}
+
+static void
+print_recent(const char *count)
+{
+	char *end;
+	long  k = count ? strtol(count, &end, 10) : 10;
+	if (k < 0 || (count && (*count == '\0' || *end != '\0')))
+		ERR_MORE_INFO("Invalid count of notes.");
+
+	spnotes_note *notes;
+	size_t        notes_c;
+	if (spnotes_notes_recent(&spn_instance, k, &notes, &notes_c) < 0)
+		splu_die("ERROR: Couldn't get the recent notes: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < notes_c; i++) {
+		printf("%s/%s", notes[i].categ->title, notes[i].title);
+		if (notes[i].has_description)
+			printf("%s%s", delimiter, notes[i].description);
+		printf("\n");
+	}
+
+	spnotes_notes_recent_free(notes, notes_c);
+}
+
+static void
+print_dupes(int exact)
+{
+	static const char *const kinds[] = {
+		"exact", "same body", "same body but for whitespace"
+	};
+
+	spnotes_dupes_group *groups;
+	size_t               groups_c;
+	if (spnotes_notes_dupes(&spn_instance, exact ? 0 : SPNOTES_DUPES_NEAR,
+	                        &groups, &groups_c) < 0)
+		splu_die("ERROR: Couldn't find the duplicates: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < groups_c; i++) {
+		printf("%s%s\n", i ? "\n" : "", kinds[groups[i].kind]);
+		for (size_t j = 0; j < groups[i].notes_c; j++)
+			printf("    %s/%s\n", groups[i].notes[j]->categ->title,
+			       groups[i].notes[j]->title);
+	}
+
+	spnotes_dupes_free(groups, groups_c);
+}
+
+static void
+print_links(const char *categ_title, const char *note_title, int is_back)
+{
+	spnotes_categ *found_categ = spnotes_categs_search_ex(
+		&spn_instance, categ_title, search_flags);
+	if (!found_categ)
+		splu_die("ERROR: Category with title '%s' doesn't exist.",
+		         categ_title);
+	spnotes_note *found_note =
+		spnotes_notes_search_ex(found_categ, note_title, search_flags);
+	if (!found_note)
+		splu_die(
+			"ERROR: Note with title '%s' in the category '%s' doesn't exist.",
+			note_title, categ_title);
+
+	spnotes_note **notes;
+	size_t         notes_c;
+	if ((is_back ? spnotes_note_backlinks(&spn_instance, found_note,
+	                                      &notes, &notes_c) :
+	               spnotes_note_links(&spn_instance, found_note, &notes,
+	                                  &notes_c)) < 0)
+		splu_die("ERROR: Couldn't get the links: %s.",
+		         spnotes_errorstr());
+	for (size_t i = 0; i < notes_c; i++)
+		printf("%s/%s\n", notes[i]->categ->title, notes[i]->title);
+	free(notes);
+	if (is_back)
+		return;
+
+	char *const *urls;
+	size_t       urls_c;
+	if (spnotes_note_urls(&spn_instance, found_note, &urls, &urls_c) < 0)
+		splu_die("ERROR: Couldn't get the links: %s.",
+		         spnotes_errorstr());
+	for (size_t i = 0; i < urls_c; i++)
+		printf("%s\n", urls[i]);
+}
+
+static void
+print_trash_list(void)
+{
+	spnotes_trash_entry *entries;
+	size_t               entries_c;
+	if (spnotes_trash_list(&spn_instance, &entries, &entries_c) < 0)
+		splu_die("ERROR: Couldn't read the trash: %s.",
+		         spnotes_errorstr());
+
+	for (size_t i = 0; i < entries_c; i++)
+		if (entries[i].note[0])
+			printf("%s%s%s/%s\n", entries[i].id, delimiter,
+			       entries[i].categ, entries[i].note);
+		else
+			printf("%s%s%s/\n", entries[i].id, delimiter,
+			       entries[i].categ);
+	free(entries);
+}
+
+/* whether `word` is the command `full` or its one letter short form */
+static int
+is_command(const char *word, const char *full)
+{
+	return !strcmp(word, full) || (word[0] == full[0] && word[1] == '\0');
+}
+
+static void
+print_matching(const char *const *words, size_t words_c, const char *prefix)
+{
+	for (size_t i = 0; i < words_c; i++)
+		if (!strncmp(words[i], prefix, strlen(prefix)))
+			printf("%s\n", words[i]);
+}
+
+/* the titles of the categories, or of the notes of `categ`, with `prefix` */
+static void
+print_titles(const char *categ, const char *prefix)
+{
+	/* straight from the catalog published by a --shm run, if still fresh */
+	char **titles;
+	int    titles_c = spnotes_shm_complete(&spn_instance, NULL, categ,
+	                                       prefix, 0, &titles);
+	if (titles_c >= 0) {
+		for (int i = 0; i < titles_c; i++)
+			printf("%s\n", titles[i]);
+		spnotes_shm_complete_free(titles, titles_c);
+		return;
+	}
+
+	/* else read the directories, failing silently */
+	if ((nested ? spnotes_categs_fill_nested(&spn_instance, 0) :
+	              spnotes_categs_fill(&spn_instance)) < 0)
+		return;
+	size_t prefix_len = strlen(prefix);
+	if (!categ) {
+		spnotes_categs_sort_alphabetically(&spn_instance);
+		for (size_t i = 0; i < spn_instance.categs_c; i++)
+			if (!strncmp(spn_instance.categs[i].title, prefix,
+			             prefix_len))
+				printf("%s\n", spn_instance.categs[i].title);
+		return;
+	}
+
+	spnotes_categ *found_categ =
+		spnotes_categs_search_ex(&spn_instance, categ, search_flags);
+	if (!found_categ || spnotes_notes_fill(found_categ) < 0)
+		return;
+	spnotes_notes_sort_alphabetically(found_categ);
+	for (size_t i = 0; i < found_categ->notes_c; i++)
+		if (!strncmp(found_categ->notes[i].title, prefix, prefix_len))
+			printf("%s\n", found_categ->notes[i].title);
+}
+
+static void
+print_completions(char **words, size_t words_c)
+{
+	static const char *const commands[] = {
+		"add", "remove", "list", "path", "info", "grep", "find",
+		"import", "trash", "undelete", "purge", "recent", "dupes",
+		"links", "backlinks", "set", "mv", "merge", "complete",
+	};
+	static const char *const kinds[]  = { "category", "note", "tag" };
+	static const char *const fields[] = { "title", "description" };
+	static const char *const shells[] = { "bash", "zsh", "fish" };
+	static const char *const dupes[]  = { "exact" };
+
+	if (words_c == 0)
+		return;
+	size_t      pos = words_c - 1; /* of the word being completed */
+	const char *cur = words[pos];
+	if (pos == 0) {
+		print_matching(commands, sizeof(commands) / sizeof(*commands),
+		               cur);
+		return;
+	}
+
+	const char *cmd = words[0], *sub = words[1];
+	if (is_command(cmd, "add") || is_command(cmd, "remove") ||
+	    is_command(cmd, "list") || is_command(cmd, "path") ||
+	    is_command(cmd, "info")) {
+		int is_note  = pos > 1 && is_command(sub, "note");
+		int is_categ = pos > 1 && is_command(sub, "category");
+		if (pos == 1)
+			print_matching(kinds, 3, cur);
+		else if (pos == 2 &&
+		         (is_note || (is_categ && !is_command(cmd, "add"))))
+			print_titles(NULL, cur);
+		else if (pos == 3 && is_note && !is_command(cmd, "add"))
+			print_titles(words[2], cur);
+	} else if (!strcmp(cmd, "set")) {
+		if (pos == 1)
+			print_matching(fields, 2, cur);
+		else if (pos == 2)
+			print_titles(NULL, cur);
+		else if (pos == 3)
+			print_titles(words[2], cur);
+	} else if (!strcmp(cmd, "mv")) {
+		int is_note = pos > 1 && is_command(sub, "note");
+		if (pos == 1)
+			print_matching(kinds, 2, cur);
+		else if (pos == 2 || (pos == 4 && is_note))
+			print_titles(NULL, cur);
+		else if (pos == 3 && is_note)
+			print_titles(words[2], cur);
+	} else if (!strcmp(cmd, "merge")) {
+		if (pos <= 2)
+			print_titles(NULL, cur);
+	} else if (!strcmp(cmd, "links") || !strcmp(cmd, "backlinks")) {
+		if (pos == 1)
+			print_titles(NULL, cur);
+		else if (pos == 2)
+			print_titles(sub, cur);
+	} else if (!strcmp(cmd, "dupes")) {
+		if (pos == 1)
+			print_matching(dupes, 1, cur);
+	} else if (!strcmp(cmd, "complete")) {
+		if (pos == 1)
+			print_matching(shells, 3, cur);
+	}
+}
+
+static void
+finish_trace(void)
+{
+	/* everything after filling the notes goes to the output */
+	if (print_traced) {
+		fflush(stdout);
+		spnotes_trace_emit(SPNOTES_TRACE_END, "print", NULL);
+	}
+	spnotes_trace_json_close();
+}
+
+#ifdef SPNOTES_STATS
+static uint64_t
+clock_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static void
+print_stats(void)
+{
+	spnotes_stats *stats = &spn_instance.stats;
+
+	/* everything after filling the notes goes to the output */
+	fflush(stdout);
+	stats->print_ns += clock_ns() - print_begin_ns;
+
+	fprintf(stderr,
+	        "dirs scanned:   %zu\n"
+	        "files opened:   %zu\n"
+	        "bytes read:     %zu\n"
+	        "stat calls:     %zu\n"
+	        "parse failures: %zu\n"
+	        "allocations:    %zu\n"
+	        "scan:  %10.3f ms\n"
+	        "parse: %10.3f ms\n"
+	        "sort:  %10.3f ms\n"
+	        "print: %10.3f ms\n",
+	        stats->dirs_scanned, stats->files_opened, stats->bytes_read,
+	        stats->stat_calls, stats->parse_failures, stats->allocs,
+	        stats->scan_ns / 1e6, stats->parse_ns / 1e6,
+	        stats->sort_ns / 1e6, stats->print_ns / 1e6);
+
+	spnotes_memory *mem = &filled_memory;
+	fprintf(stderr,
+	        "memory: %zu bytes (categories %zu, notes %zu, strings %zu, "
+	        "slack %zu, indexes %zu)\n",
+	        mem->total, mem->categs, mem->notes, mem->strings, mem->slack,
+	        mem->indexes);
+}
+#endif
+
 int
 main(int argc, char **argv)
 {
@@ -158,15 +924,46 @@ main(int argc, char **argv)
 	int to_print_help     = 0;
 	int to_print_version  = 0;
 	int to_output_verbose = 0;
+#ifdef SPNOTES_STATS
+	int to_print_stats = 0;
+#endif
 
 	splf_toggle(&to_print_help, 'h', "help", "Print help message");
 	splf_toggle(&to_print_version, 'v', "version", "Print version");
 	splf_toggle(&to_output_verbose, ' ', "verbose", "Verbose output");
-	splf_str(&notes_root_loc, 'p', "path", "Path to the notes");
+	splf_str(&notes_root_loc, 'p', "path",
+	         "Path to the notes, several ones separated by ':'");
 	splf_str(&delimiter, 'd', "delimiter", "Delimiter");
 	splf_toggle(
 		&to_sort_alphabet, 'a', "alphabet",
 		"Sort the category and notes in ascending alphabetical order (Default is to sort by last modified)");
+	splf_str(&sort_order, ' ', "sort",
+	         "Order to list in: modified, alphabet or created (by the "
+	         "time in the file names, without a stat of each note)");
+	splf_toggle(&grep_regex, 'E', "regex",
+	            "Treat the grep pattern as an extended regex");
+	splf_toggle(&ignore_case, 'i', "ignore-case",
+	            "Ignore case while grepping, finding and looking up titles");
+	splf_int(&grep_context, 'C', "context",
+	         "Lines of context to print around grep matches");
+	splf_toggle(&use_shm, 's', "shm",
+	            "Reuse the notes catalog shared by an earlier run");
+	splf_toggle(&nested, 'n', "nested",
+	            "Read nested categories such as 'lang/c' at any depth");
+	splf_int(&max_memory_mib, ' ', "max-memory",
+	         "Stop loading the notes beyond the given MiB of memory");
+	splf_int(&page_limit, ' ', "limit",
+	         "List at most the given number of notes of a category");
+	splf_str(&page_after, ' ', "after",
+	         "List the notes of a category after the given page cursor");
+	splf_str(&scan_order, ' ', "scan",
+	         "Order to read the notes in: dirent, inode or extent");
+	splf_str(&trace_path, ' ', "trace",
+	         "Write a Chrome trace of the run to the given JSON file");
+#ifdef SPNOTES_STATS
+	splf_toggle(&to_print_stats, ' ', "stats",
+	            "Print performance counters to stderr");
+#endif
 
 	f_info = splf_parse(argc, argv);
 
@@ -186,12 +983,70 @@ main(int argc, char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	/* shell completion, before anything that could print an error */
+	char *command = *(f_info.non_flag_arguments);
+	if (command && !strcmp(command, "complete")) {
+		char *shell = *(f_info.non_flag_arguments + 1);
+		if (!shell)
+			ERR_MORE_INFO("Missing the shell to complete for.");
+		if (!strcmp(shell, "bash"))
+			fputs(completion_bash, stdout);
+		else if (!strcmp(shell, "zsh"))
+			fputs(completion_zsh, stdout);
+		else if (!strcmp(shell, "fish"))
+			fputs(completion_fish, stdout);
+		else
+			splu_die("ERROR: Can't complete for the shell '%s'.",
+			         shell);
+		exit(EXIT_SUCCESS);
+	}
+	if (command && !strcmp(command, "__complete")) {
+		if (notes_root_loc &&
+		    spnotes_init_roots(&spn_instance, notes_root_loc)) {
+			if (ignore_case)
+				search_flags |= SPNOTES_SEARCH_ICASE;
+			print_completions(f_info.non_flag_arguments + 1,
+			                  f_info.non_flag_arguments_c - 1);
+		}
+		exit(EXIT_SUCCESS);
+	}
+
 	/* spnotes */
 	if (!notes_root_loc)
 		splu_die(
 			"Path to the notes isn't provided. Pass one using --path.");
-	spnotes_init(&spn_instance, notes_root_loc);
-	fill_categs_notes();
+	if (!spnotes_init_roots(&spn_instance, notes_root_loc))
+		splu_die("ERROR: Couldn't use the notes path: %s.",
+		         spnotes_errorstr());
+	if (max_memory_mib > 0)
+		spn_instance.memory_cap = (size_t)max_memory_mib << 20;
+	if (scan_order) {
+		if (!strcmp(scan_order, "inode"))
+			spn_instance.scan_order = SPNOTES_SCAN_INODE;
+		else if (!strcmp(scan_order, "extent"))
+			spn_instance.scan_order = SPNOTES_SCAN_EXTENT;
+		else if (strcmp(scan_order, "dirent"))
+			ERR_MORE_INFO("Unknown order to read the notes in.");
+	}
+	if (sort_order) {
+		if (!strcmp(sort_order, "alphabet"))
+			to_sort_alphabet = 1;
+		else if (!strcmp(sort_order, "created"))
+			to_sort_created = 1;
+		else if (strcmp(sort_order, "modified"))
+			ERR_MORE_INFO("Unknown order to list in.");
+	}
+	if (ignore_case)
+		search_flags |= SPNOTES_SEARCH_ICASE;
+	if (trace_path) {
+		if (!spnotes_trace_json_open(trace_path))
+			ERR_ERRNO("Couldn't open the trace file");
+		atexit(finish_trace);
+	}
+#ifdef SPNOTES_STATS
+	if (to_print_stats)
+		atexit(print_stats);
+#endif
 
 	/* parse options */
 	char *option       = *(f_info.non_flag_arguments);
@@ -200,6 +1055,49 @@ main(int argc, char **argv)
 	char *option_note  = *(f_info.non_flag_arguments + 3);
 	char *option_desc  = *(f_info.non_flag_arguments + 4);
 
+	/* a list by the time in the file names needs no stat of the notes */
+	if (to_sort_created && !to_sort_alphabet &&
+	    (!option || !strcmp(option, "list") || !strcmp(option, "l")))
+		spn_instance.no_stat = 1;
+
+	/*
+	 * 'recent' and the pages of a list stat the files themselves and parse
+	 * only the ones they print.
+	 */
+	int is_paged = (page_limit > 0 || page_after) && option &&
+	               (!strcmp(option, "list") || !strcmp(option, "l")) &&
+	               option_sub &&
+	               (!strcmp(option_sub, "note") || !strcmp(option_sub, "n"));
+	int is_grep =
+		option && (!strcmp(option, "grep") || !strcmp(option, "g"));
+	int is_list =
+		option && (!strcmp(option, "list") || !strcmp(option, "l"));
+
+	/* a tree or a list straight from the catalog of an earlier --shm run */
+	if (use_shm && !nested && !is_paged && !to_sort_created &&
+	    !search_flags && (!option || (is_list && option_sub)) &&
+	    print_shm(option ? option_sub : NULL, option_categ)) {
+		exit(EXIT_SUCCESS);
+	}
+
+	if (option && (!strcmp(option, "recent") || is_paged)) {
+		fill_categs();
+	} else if (is_grep) {
+		/* the grep reads the notes whole, their headers with them */
+		fill_categs();
+		sort_categs();
+	} else {
+		fill_categs_notes();
+	}
+#ifdef SPNOTES_STATS
+	spnotes_memory_usage(&spn_instance, &filled_memory);
+	print_begin_ns = clock_ns();
+#endif
+	if (trace_path) {
+		spnotes_trace_emit(SPNOTES_TRACE_BEGIN, "print", NULL);
+		print_traced = 1;
+	}
+
 	/* simply print the notes in tree view if no option is provided */
 	if (!option) {
 		print_notes_tree();
@@ -250,31 +1148,41 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 5);
 
 			/* actual adding of note */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"ERROR: Category with title '%s' doesn't exist.",
 					option_categ);
-			if (spnotes_notes_search(*found_categ, option_note))
+			if (spnotes_notes_search_ex(found_categ, option_note,
+			                            search_flags))
 				splu_die(
 					"ERROR: Note with title '%s' in the category '%s' already exists.",
 					option_note, option_categ);
 
-			char new_loc[PATH_MAX];
-			if (!spnotes_notes_add(*found_categ, new_loc))
-				ERR_ERRNO(
-					"Couldn't create a file for new note");
-
 			/* note template */
-			FILE *fp = fopen(new_loc, "w");
-			if (!fp)
-				ERR_ERRNO("Couldn't open note file");
+			char *content;
+			int   content_len =
+				option_desc ?
+					snprintf(NULL, 0, NEW_NOTE_TEMPLATE) :
+					snprintf(NULL, 0,
+				                 NEW_NOTE_TEMPLATE_TITLE_ONLY);
+			if (!(content = malloc(content_len + 1)))
+				ERR("Couldn't allocate memory for the note");
 			if (option_desc)
-				fprintf(fp, NEW_NOTE_TEMPLATE);
+				snprintf(content, content_len + 1,
+				         NEW_NOTE_TEMPLATE);
 			else
-				fprintf(fp, NEW_NOTE_TEMPLATE_TITLE_ONLY);
-			fclose(fp);
+				snprintf(content, content_len + 1,
+				         NEW_NOTE_TEMPLATE_TITLE_ONLY);
+
+			char new_loc[PATH_MAX];
+			int  added = spnotes_notes_add_content(
+                                *found_categ, content, content_len, new_loc);
+			free(content);
+			if (!added)
+				ERR_ERRNO(
+					"Couldn't create a file for new note");
 
 			if (to_output_verbose)
 				printf("Note titled '%s' added to the category '%s' at '%s'.\n",
@@ -300,8 +1208,8 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 3);
 
 			/* actual removing of category */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"Category with title '%s' doesn't exist.",
@@ -318,7 +1226,7 @@ main(int argc, char **argv)
 					       i == found_categ->notes_c - 1 ?
 					               '.' :
 					               ' ');
-				printf("\nRemoving the category will remove all the above notes too! Do you want to continue? (y/n): ");
+				printf("\nRemoving the category will move all the above notes to the trash too! Do you want to continue? (y/n): ");
 				if (getchar() != 'y') {
 					exit(EXIT_SUCCESS);
 				}
@@ -328,7 +1236,8 @@ main(int argc, char **argv)
 				ERR_ERRNO(
 					"Category directory couldn't be deleted");
 
-			printf("Category '%s' removed.\n", option_categ);
+			printf("Category '%s' moved to the trash.\n",
+			       option_categ);
 
 			exit(EXIT_SUCCESS);
 		}
@@ -340,14 +1249,14 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 4);
 
 			/* actual removing of note */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"ERROR: Category with title '%s' doesn't exist.",
 					option_categ);
-			spnotes_note *found_note =
-				spnotes_notes_search(*found_categ, option_note);
+			spnotes_note *found_note = spnotes_notes_search_ex(
+				found_categ, option_note, search_flags);
 			if (!found_note)
 				splu_die(
 					"ERROR: Note with title '%s' in the category '%s' already exists.",
@@ -356,7 +1265,7 @@ main(int argc, char **argv)
 			if (!spnotes_notes_remove(*found_note))
 				ERR_ERRNO("Couldn't delete the note file");
 
-			printf("Note titled '%s' of the category '%s' removed.\n",
+			printf("Note titled '%s' of the category '%s' moved to the trash.\n",
 			       option_note, option_categ);
 
 			exit(EXIT_SUCCESS);
@@ -386,18 +1295,31 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 3);
 
 			/* list notes */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"ERROR: Category with title '%s' doesn't exist.",
 					option_categ);
-			print_notes_list(found_categ);
+			if (is_paged)
+				print_notes_page(found_categ);
+			else
+				print_notes_list(found_categ);
+
+			exit(EXIT_SUCCESS);
+		}
+
+		if (!strcmp(option_sub, "tag") || !strcmp(option_sub, "t")) {
+			splf_warn_ignored_args(f_info, stderr, 3);
+
+			/* list tags or the notes matching a tag query */
+			print_tags_list(option_categ);
 
 			exit(EXIT_SUCCESS);
 		}
 
-		ERR_MORE_INFO("You can list either categories or notes only.");
+		ERR_MORE_INFO(
+			"You can list either categories, notes or tags only.");
 	}
 
 	/* path */
@@ -412,8 +1334,8 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 3);
 
 			/* path of category */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"Category with title '%s' doesn't exist.",
@@ -435,14 +1357,14 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 4);
 
 			/* path of note */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"ERROR: Category with title '%s' doesn't exist.",
 					option_categ);
-			spnotes_note *found_note =
-				spnotes_notes_search(*found_categ, option_note);
+			spnotes_note *found_note = spnotes_notes_search_ex(
+				found_categ, option_note, search_flags);
 			if (!found_note)
 				splu_die(
 					"ERROR: Note with title '%s' in the category '%s' doesn't exist.",
@@ -474,8 +1396,8 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 3);
 
 			/* path of category */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"Category with title '%s' doesn't exist.",
@@ -506,14 +1428,14 @@ main(int argc, char **argv)
 			splf_warn_ignored_args(f_info, stderr, 4);
 
 			/* path of note */
-			spnotes_categ *found_categ = spnotes_categs_search(
-				spn_instance, option_categ);
+			spnotes_categ *found_categ = spnotes_categs_search_ex(
+				&spn_instance, option_categ, search_flags);
 			if (!found_categ)
 				splu_die(
 					"ERROR: Category with title '%s' doesn't exist.",
 					option_categ);
-			spnotes_note *found_note =
-				spnotes_notes_search(*found_categ, option_note);
+			spnotes_note *found_note = spnotes_notes_search_ex(
+				found_categ, option_note, search_flags);
 			if (!found_note)
 				splu_die(
 					"ERROR: Note with title '%s' in the category '%s' does exist.",
@@ -535,6 +1457,272 @@ main(int argc, char **argv)
 			"You can get info of either a category or a note only.");
 	}
 
+	/* set */
+	if (!strcmp(option, "set")) {
+		if (!option_sub)
+			ERR_MORE_INFO("What do you want to set?");
+		int is_title = !strcmp(option_sub, "title") ||
+		               !strcmp(option_sub, "t");
+		if (!is_title && strcmp(option_sub, "description") &&
+		    strcmp(option_sub, "d"))
+			ERR_MORE_INFO(
+				"You can set either the title or the description only.");
+		if (!option_categ)
+			ERR_MORE_INFO("Missing title of the category.");
+		if (!option_note)
+			ERR_MORE_INFO("Missing title of the note.");
+		if (is_title && !option_desc)
+			ERR_MORE_INFO("Missing the new title.");
+		splf_warn_ignored_args(f_info, stderr, 5);
+
+		spnotes_categ *found_categ = spnotes_categs_search_ex(
+			&spn_instance, option_categ, search_flags);
+		if (!found_categ)
+			splu_die("ERROR: Category with title '%s' doesn't exist.",
+			         option_categ);
+		spnotes_note *found_note = spnotes_notes_search_ex(
+			found_categ, option_note, search_flags);
+		if (!found_note)
+			splu_die(
+				"ERROR: Note with title '%s' in the category '%s' doesn't exist.",
+				option_note, option_categ);
+
+		/* an empty or no description removes it */
+		if (!(is_title ?
+		              spnotes_note_set_title(found_note, option_desc) :
+		              spnotes_note_set_description(found_note,
+		                                           option_desc)))
+			splu_die("ERROR: Couldn't edit the note: %s.",
+			         spnotes_errorstr());
+
+		/* the catalog is updated in memory, no need of a rescan */
+		if (use_shm)
+			spnotes_shm_publish(&spn_instance, NULL);
+		if (to_output_verbose)
+			printf("Edited '%s'.\n", found_note->path);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* mv */
+	if (!strcmp(option, "mv")) {
+		if (!option_sub)
+			ERR_MORE_INFO("What do you want to move?");
+		if (!option_categ)
+			ERR_MORE_INFO("Missing title of the category.");
+
+		spnotes_categ *found_categ = spnotes_categs_search_ex(
+			&spn_instance, option_categ, search_flags);
+		if (!found_categ)
+			splu_die("ERROR: Category with title '%s' doesn't exist.",
+			         option_categ);
+
+		if (!strcmp(option_sub, "category") ||
+		    !strcmp(option_sub, "c")) {
+			if (!option_note)
+				ERR_MORE_INFO("Missing the new title.");
+			splf_warn_ignored_args(f_info, stderr, 4);
+
+			if (!spnotes_categs_rename(found_categ, option_note))
+				splu_die("ERROR: Couldn't rename '%s': %s.",
+				         option_categ, spnotes_errorstr());
+			if (to_output_verbose)
+				printf("Renamed '%s' to '%s'.\n", option_categ,
+				       option_note);
+			exit(EXIT_SUCCESS);
+		}
+
+		if (!strcmp(option_sub, "note") || !strcmp(option_sub, "n")) {
+			if (!option_note)
+				ERR_MORE_INFO("Missing title of the note.");
+			if (!option_desc)
+				ERR_MORE_INFO(
+					"Missing title of the category to move to.");
+			splf_warn_ignored_args(f_info, stderr, 5);
+
+			spnotes_note *found_note = spnotes_notes_search_ex(
+				found_categ, option_note, search_flags);
+			if (!found_note)
+				splu_die(
+					"ERROR: Note with title '%s' in the category '%s' doesn't exist.",
+					option_note, option_categ);
+			spnotes_categ *to_categ = spnotes_categs_search_ex(
+				&spn_instance, option_desc, search_flags);
+			if (!to_categ)
+				splu_die(
+					"ERROR: Category with title '%s' doesn't exist.",
+					option_desc);
+
+			char new_loc[PATH_MAX];
+			if (!spnotes_notes_move(found_note, to_categ, new_loc))
+				splu_die("ERROR: Couldn't move the note: %s.",
+				         spnotes_errorstr());
+			if (to_output_verbose)
+				printf("Moved to '%s'.\n", new_loc);
+			exit(EXIT_SUCCESS);
+		}
+
+		ERR_MORE_INFO("You can move either a category or a note only.");
+	}
+
+	/* merge */
+	if (!strcmp(option, "merge")) {
+		if (!option_sub)
+			ERR_MORE_INFO("Missing title of the category to merge.");
+		if (!option_categ)
+			ERR_MORE_INFO(
+				"Missing title of the category to merge into.");
+		splf_warn_ignored_args(f_info, stderr, 3);
+
+		spnotes_categ *from_categ = spnotes_categs_search_ex(
+			&spn_instance, option_sub, search_flags);
+		if (!from_categ)
+			splu_die("ERROR: Category with title '%s' doesn't exist.",
+			         option_sub);
+		spnotes_categ *into_categ = spnotes_categs_search_ex(
+			&spn_instance, option_categ, search_flags);
+		if (!into_categ)
+			splu_die("ERROR: Category with title '%s' doesn't exist.",
+			         option_categ);
+
+		if (!spnotes_categs_merge(from_categ, into_categ))
+			splu_die("ERROR: Couldn't merge '%s': %s.", option_sub,
+			         spnotes_errorstr());
+		if (to_output_verbose)
+			printf("Merged '%s' into '%s'.\n", option_sub,
+			       option_categ);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* grep */
+	if (!strcmp(option, "grep") || !strcmp(option, "g")) {
+		if (!option_sub)
+			ERR_MORE_INFO("What do you want to search for?");
+		splf_warn_ignored_args(f_info, stderr, 2);
+
+		print_grep(option_sub);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* find */
+	if (!strcmp(option, "find") || !strcmp(option, "f")) {
+		if (!option_sub)
+			ERR_MORE_INFO("What do you want to find?");
+		splf_warn_ignored_args(f_info, stderr, 2);
+
+		print_find(option_sub);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* import */
+	if (!strcmp(option, "import")) {
+		splf_warn_ignored_args(f_info, stderr, 3);
+
+		/* directory of markdown files or a JSON Lines stream (stdin if
+		 * nothing is given) */
+		struct stat src_stat;
+		int         imported_c;
+		if (!option_sub || !strcmp(option_sub, "-")) {
+			imported_c = spnotes_import_jsonl(&spn_instance, stdin, 0);
+		} else if (stat(option_sub, &src_stat) == 0 &&
+		           S_ISDIR(src_stat.st_mode)) {
+			imported_c = spnotes_import_md_dir(&spn_instance, option_sub,
+			                                   option_categ, 0);
+		} else {
+			FILE *fp = fopen(option_sub, "r");
+			if (!fp)
+				ERR_ERRNO("Couldn't open the file to import");
+			imported_c = spnotes_import_jsonl(&spn_instance, fp, 0);
+			fclose(fp);
+		}
+		if (imported_c < 0)
+			splu_die("ERROR: Couldn't import the notes: %s.",
+			         spnotes_errorstr());
+
+		if (to_output_verbose)
+			printf("Imported %d note(s).\n", imported_c);
+		else
+			printf("%d\n", imported_c);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* recent */
+	if (!strcmp(option, "recent")) {
+		splf_warn_ignored_args(f_info, stderr, 2);
+
+		print_recent(option_sub);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* dupes */
+	if (!strcmp(option, "dupes")) {
+		splf_warn_ignored_args(f_info, stderr, 2);
+		if (option_sub && strcmp(option_sub, "exact"))
+			ERR_MORE_INFO("Unknown kind of duplicates.");
+
+		print_dupes(option_sub != NULL);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* links and backlinks */
+	if (!strcmp(option, "links") || !strcmp(option, "backlinks")) {
+		if (!option_sub)
+			ERR_MORE_INFO("Missing title of the category.");
+		if (!option_categ)
+			ERR_MORE_INFO("Missing title of the note.");
+		splf_warn_ignored_args(f_info, stderr, 3);
+
+		print_links(option_sub, option_categ,
+		            !strcmp(option, "backlinks"));
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* trash */
+	if (!strcmp(option, "trash")) {
+		splf_warn_ignored_args(f_info, stderr, 1);
+
+		print_trash_list();
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* undelete */
+	if (!strcmp(option, "undelete")) {
+		if (!option_sub)
+			ERR_MORE_INFO(
+				"Missing id of the trash entry (see 'trash').");
+		splf_warn_ignored_args(f_info, stderr, 2);
+
+		if (!spnotes_trash_restore(&spn_instance, option_sub))
+			splu_die("ERROR: Couldn't restore '%s': %s.", option_sub,
+			         spnotes_errorstr());
+		printf("Restored '%s'.\n", option_sub);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	/* purge */
+	if (!strcmp(option, "purge")) {
+		splf_warn_ignored_args(f_info, stderr, 2);
+
+		int purged_c = spnotes_trash_purge(&spn_instance, option_sub);
+		if (purged_c < 0)
+			splu_die("ERROR: Couldn't purge the trash: %s.",
+			         spnotes_errorstr());
+
+		if (to_output_verbose)
+			printf("Deleted %d file(s) for good.\n", purged_c);
+
+		exit(EXIT_SUCCESS);
+	}
+
 	ERR_MORE_INFO("Invalid option provided.");
 
 	return EXIT_SUCCESS;
@@ -19,11 +19,28 @@
 /* = SPNOTES = */
 
 static spnotes_t spn_instance;
-static char     *notes_root_loc = "/home/safal/docs/notes/";
+static char     *notes_root_loc = "/home/safal/docs/notes/"; /* ':' separated */
+static int       use_shm        = 0; /* reuse a 'spnotes-cli --shm' catalog */
 
 static spnotes_categ *categ_sel = NULL;
 static spnotes_note  *note_sel  = NULL;
 
+/* = PREVIEW = */
+
+#define PREVIEW_CHUNK (64 * 1024)       /* bytes read per timer tick */
+#define PREVIEW_CAP   (4 * 1024 * 1024) /* bytes streamed until 'Load more' */
+
+/*
+ * The note being streamed into the multitext a chunk at a time, so that only
+ * the first chunk is read before the note shows up.
+ */
+static struct {
+	int   fd;     /* -1 = Nothing left to stream */
+	off_t offset; /* bytes shown so far */
+	off_t size;
+	off_t cap; /* streaming stops here until 'Load more' */
+} preview = { -1, 0, 0, 0 };
+
 /* = ELEMENTS = */
 
 static Ihandle *elem_multitext = NULL;
@@ -31,6 +48,10 @@ static Ihandle *elem_multitext = NULL;
 static Ihandle *elem_flatlist_categ = NULL;
 static Ihandle *elem_flatlist_note  = NULL;
 
+static Ihandle *elem_label_preview = NULL;
+static Ihandle *elem_button_more   = NULL;
+static Ihandle *elem_timer_preview = NULL;
+
 /*
  ===============================================================================
  |                            Function Declarations                            |
@@ -54,10 +75,28 @@ cb_list_categ_changed(Ihandle *self, char *text, int item, int state);
 int
 cb_list_note_changed(Ihandle *self, char *text, int item, int state);
 
-/* = FILE HANDLING = */
+int
+cb_preview_timer(Ihandle *self);
+
+int
+cb_preview_more(Ihandle *self);
+
+/* = PREVIEW = */
+
+void
+preview_open(const char *filename);
+
+int
+preview_chunk(void);
+
+void
+preview_status(void);
+
+void
+preview_close(void);
 
-char *
-file_read(const char *filename);
+size_t
+utf8_complete_len(const char *buf, size_t len);
 
 /*
  ===============================================================================
@@ -139,44 +178,150 @@ cb_list_note_changed(Ihandle *self, char *text, int item, int state)
 		return IUP_DEFAULT;
 
 	note_sel = &(categ_sel->notes[item - 1]);
+	preview_open(note_sel->path);
 
-	char *str = file_read(note_sel->path);
-	if (str) {
-		IupSetStrAttribute(elem_multitext, "VALUE", str);
-		free(str);
-	}
+	return IUP_DEFAULT;
+}
+
+int
+cb_preview_timer(Ihandle *self)
+{
+	if (!preview_chunk())
+		IupSetAttribute(self, "RUN", "NO");
+	preview_status();
+
+	return IUP_DEFAULT;
+}
+
+int
+cb_preview_more(Ihandle *self)
+{
+	(void)self;
+
+	if (preview.fd == -1)
+		return IUP_DEFAULT;
+
+	preview.cap += PREVIEW_CAP;
+	IupSetAttribute(elem_timer_preview, "RUN", "YES");
+	preview_status();
 
 	return IUP_DEFAULT;
 }
 
-/* = FILE HANDLING = */
+/* = PREVIEW = */
 
-char *
-file_read(const char *filename)
+/*
+ * Shows the first chunk of the file at once and streams the rest of it, up to
+ * 'PREVIEW_CAP' bytes, on the ticks of the preview timer.
+ */
+void
+preview_open(const char *filename)
 {
-	FILE *fp = fopen(filename, "rb");
-	if (!fp) {
+	preview_close();
+	IupSetAttribute(elem_multitext, "VALUE", "");
+
+	preview.fd = open(filename, O_RDONLY);
+	if (preview.fd == -1) {
 		IupMessagef("Error", "Can't open file: %s", filename);
-		return NULL;
+		preview_status();
+		return;
+	}
+	struct stat st;
+	preview.size   = fstat(preview.fd, &st) == 0 ? st.st_size : 0;
+	preview.offset = 0;
+	preview.cap    = PREVIEW_CAP;
+
+	if (preview_chunk())
+		IupSetAttribute(elem_timer_preview, "RUN", "YES");
+	preview_status();
+}
+
+/*
+ * Appends the next chunk of the preview to the multitext, cut at the last
+ * whole UTF-8 character.
+ *
+ * Returns 1 if there's more to stream before the cap, else 0.
+ */
+int
+preview_chunk(void)
+{
+	static char buf[PREVIEW_CHUNK + 1];
+
+	if (preview.fd == -1 || preview.offset >= preview.cap)
+		return 0;
+
+	size_t want = PREVIEW_CHUNK;
+	if ((off_t)want > preview.cap - preview.offset)
+		want = preview.cap - preview.offset;
+	ssize_t got = pread(preview.fd, buf, want, preview.offset);
+	if (got < 0) {
+		IupMessagef("Error", "Couldn't read the file: %s",
+		            note_sel ? note_sel->path : "");
+		preview_close();
+		return 0;
+	}
+	if (got == 0) { /* the whole file is shown */
+		preview_close();
+		return 0;
 	}
 
-	/* calculate file size */
-	fseek(fp, 0, SEEK_END);
-	size_t size = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
+	/* the rest of a split character comes with the next chunk */
+	size_t len = got;
+	if ((size_t)got == want)
+		len = utf8_complete_len(buf, len);
+	if (len == 0) { /* a character split by the cap */
+		preview.cap = preview.offset;
+		return 0;
+	}
+	buf[len] = '\0';
+	IupSetStrAttribute(elem_multitext, "APPEND", buf);
+	preview.offset += len;
 
-	/* allocate memory for the file contents + NULL terminator */
-	char *str = malloc(size + 1);
-	/* read all data at once */
-	fread(str, size, 1, fp);
-	/* set the NULL terminator */
-	str[size] = 0;
+	return preview.offset < preview.cap;
+}
 
-	if (ferror(fp))
-		IupMessagef("Error", "Couldn't read the file: %s", filename);
+/* tells how much of the note is shown, offering to load more when capped */
+void
+preview_status(void)
+{
+	if (preview.fd == -1 || preview.offset >= preview.size) {
+		IupSetAttribute(elem_label_preview, "TITLE", "");
+		IupSetAttribute(elem_button_more, "ACTIVE", "NO");
+		return;
+	}
 
-	fclose(fp);
-	return str;
+	IupSetfAttribute(elem_label_preview, "TITLE", "%lld of %lld KiB shown",
+	                 (long long)preview.offset / 1024,
+	                 (long long)preview.size / 1024);
+	IupSetAttribute(elem_button_more, "ACTIVE",
+	                preview.offset >= preview.cap ? "YES" : "NO");
+}
+
+void
+preview_close(void)
+{
+	IupSetAttribute(elem_timer_preview, "RUN", "NO");
+	if (preview.fd != -1)
+		close(preview.fd);
+	preview.fd = -1;
+}
+
+/* Returns `len` less the bytes of an incomplete last character of `buf`. */
+size_t
+utf8_complete_len(const char *buf, size_t len)
+{
+	/* the lead byte of the last character, at most 3 bytes back */
+	size_t lead = len;
+	while (lead > 0 && len - lead < 4 &&
+	       ((unsigned char)buf[lead - 1] & 0xC0) == 0x80)
+		lead--;
+	if (lead == 0 || len - lead == 4)
+		return len; /* not UTF-8, left as is */
+	lead--;
+
+	unsigned char c    = buf[lead];
+	size_t        need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+	return len - lead >= need ? len : lead;
 }
 
 int
@@ -214,8 +359,9 @@ main(int argc, char **argv)
 	               cb_list_categ_changed);
 
 	/* fill category list */
-	spnotes_init(&spn_instance, notes_root_loc);
-	spnotes_categs_fill(&spn_instance);
+	spnotes_init_roots(&spn_instance, notes_root_loc);
+	if (!use_shm || !spnotes_shm_load(&spn_instance, NULL))
+		spnotes_categs_fill(&spn_instance);
 
 	for (size_t i = 0; i < spn_instance.categs_c; i++) {
 		IupSetAttributeId(elem_flatlist_categ, "", i + 1,
@@ -234,10 +380,24 @@ main(int argc, char **argv)
 	IupSetAttribute(elem_multitext, "MULTILINE", "YES");
 	IupSetAttribute(elem_multitext, "EXPAND", "YES");
 	IupSetAttribute(elem_multitext, "READONLY", "YES");
+	IupSetAttribute(elem_multitext, "APPENDNEWLINE", "NO");
+
+	/* preview of large notes */
+	elem_label_preview = IupLabel("");
+	IupSetAttribute(elem_label_preview, "EXPAND", "HORIZONTAL");
+	elem_button_more = IupButton("Load more", NULL);
+	IupSetAttribute(elem_button_more, "ACTIVE", "NO");
+	IupSetCallback(elem_button_more, "ACTION", (Icallback)cb_preview_more);
+	elem_timer_preview = IupTimer();
+	IupSetAttribute(elem_timer_preview, "TIME", "10");
+	IupSetCallback(elem_timer_preview, "ACTION_CB",
+	               (Icallback)cb_preview_timer);
 
 	/* layout */
 	Ihandle *hbox = IupHbox(elem_flatlist_categ, elem_flatlist_note, NULL);
-	Ihandle *vbox = IupVbox(hbox, elem_multitext, NULL);
+	Ihandle *hbox_preview =
+		IupHbox(elem_label_preview, elem_button_more, NULL);
+	Ihandle *vbox = IupVbox(hbox, elem_multitext, hbox_preview, NULL);
 
 	Ihandle *dlg_main = IupDialog(vbox);
 	IupSetAttributeHandle(dlg_main, "MENU", menu);
@@ -252,6 +412,8 @@ main(int argc, char **argv)
 
 	/* = EXIT = */
 
+	preview_close();
+	IupDestroy(elem_timer_preview);
 	spnotes_free(&spn_instance);
 	IupClose();
 	return EXIT_SUCCESS;
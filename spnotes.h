@@ -73,6 +73,13 @@ Ref: https://youtu.be/sJuA5OPvABM
  * Note the first line of the file starting with '---' following a title,
  * description and ending with '---'. The description is optional but other
  * components has to be present in the file to be regarded as a note.
+ *
+ * Notes can optionally be tagged by adding a 'tags:' line to the header with
+ * the tags separated by commas and/or spaces, e.g. 'tags: c, draft' or
+ * 'tags: [c, draft]'.
+ *
+ * The body can link to other notes by their title with '[[Pipes]]' (or
+ * '[[c/Pipes]]' for the one of a given category), see 'spnotes_links_build()'.
  */
 
 /*
@@ -93,8 +100,10 @@ Ref: https://youtu.be/sJuA5OPvABM
  *
  *         #define SPNOTES_IMPL
  *
- * before you include this file in *one* C or C++ file to create the
- * implementation.
+ * before you include this file in *one* C file to create the implementation.
+ *
+ * The declarations can be included from C++ as well, where 'spnotes.hpp'
+ * wraps them in classes.
  */
 
 /*
@@ -106,7 +115,10 @@ Ref: https://youtu.be/sJuA5OPvABM
  * - Linux requires following #define's:
  *     - #define _POSIX_C_SOURCE 200809L (for strdup() and strndup())
  *     - #define _DEFAULT_SOURCE         (for d_type macro constants)
- *     - #define _XOPEN_SOURCE   500     (for nftw())
+ * - POSIX threads (link with `-lpthread`). Define `SPNOTES_NO_THREADS` before
+ *   including this file to run everything on the calling thread instead.
+ * - POSIX shared memory for the `spnotes_shm_*()` functions (link with `-lrt`
+ *   on glibc older than 2.34).
  */
 
 /*
@@ -129,15 +141,29 @@ Ref: https://youtu.be/sJuA5OPvABM
 #define DT_DIR 4
 #endif
 #include <errno.h>
+#include <stdint.h>
+#include <stdio.h> /* FILE */
 #include <stdlib.h>
 #include <sys/stat.h> /* stat(), DEFFILEMODE */
 #ifndef DEFFILEMODE   /* TODO: Learn more about this */
 #define DEFFILEMODE 0666
 #endif
-#include <fcntl.h>  /* open() */
-#include <unistd.h> /* close() */
-#include <time.h>   /* time() */
-#include <ftw.h>    /* nftw() */
+#include <fcntl.h>   /* open() */
+#include <unistd.h>  /* close() */
+#include <time.h>    /* clock_gettime() */
+#include <sys/uio.h> /* writev() */
+#include <regex.h>  /* regcomp(), regexec() */
+#include <sys/mman.h> /* shm_open(), mmap() */
+#ifdef __linux__
+#include <sys/syscall.h> /* SYS_renameat2 */
+#include <sys/ioctl.h>    /* ioctl() */
+#include <linux/fs.h>     /* FS_IOC_FIEMAP */
+#include <linux/fiemap.h> /* struct fiemap */
+#endif
+#include <sched.h>    /* sched_yield() */
+#ifndef SPNOTES_NO_THREADS
+#include <pthread.h>
+#endif
 
 /*
  ===============================================================================
@@ -150,47 +176,333 @@ Ref: https://youtu.be/sJuA5OPvABM
 #define SPNOTES_DEF /* You may want `static` or `static inline` here */
 #endif
 
+/* = STATS = */
+/*
+ * Define `SPNOTES_STATS` before including this file to keep performance
+ * counters in the 'stats' of every instance. Without it they cost nothing.
+ */
+
+/* = THREADS = */
+#ifndef SPNOTES_MAX_THREADS
+#define SPNOTES_MAX_THREADS 32 /* Upper limit of workers on parallel scans */
+#endif
+
+/* = SCAN = */
+#ifndef SPNOTES_SCAN_AHEAD
+#define SPNOTES_SCAN_AHEAD 16 /* Files opened ahead on sorted scans */
+#endif
+#ifndef SPNOTES_SCAN_HINT
+#define SPNOTES_SCAN_HINT 4096 /* Bytes of their headers asked to be read */
+#endif
+
+/* = GREP = */
+#ifndef SPNOTES_GREP_SCRATCH
+#define SPNOTES_GREP_SCRATCH 16384 /* Notes up to it are read on the stack */
+#endif
+
 /*
  ===============================================================================
  |                                    Data                                     |
  ===============================================================================
  */
 
-typedef struct spnotes_t     spnotes_t;
-typedef struct spnotes_categ spnotes_categ;
-typedef struct spnotes_note  spnotes_note;
+typedef struct spnotes_t        spnotes_t;
+typedef struct spnotes_categ    spnotes_categ;
+typedef struct spnotes_note     spnotes_note;
+typedef struct spnotes_bitmap   spnotes_bitmap;
+typedef struct spnotes_tags     spnotes_tags;
+typedef struct spnotes_trigrams spnotes_trigrams;
+typedef struct spnotes_links    spnotes_links;
+typedef struct spnotes_snapshot spnotes_snapshot;
+typedef struct spnotes_catalog  spnotes_catalog;
+
+/* 'scan_order' of an instance */
+#define SPNOTES_SCAN_DIRENT 0 /* in the order of the directory entries */
+#define SPNOTES_SCAN_INODE  1 /* by inode number, the headers read ahead */
+#define SPNOTES_SCAN_EXTENT 2 /* by offset on the disk, else by inode */
+
+#ifdef SPNOTES_STATS
+/*
+ * Performance counters of an instance, updated by the fill and sort functions.
+ * Times are in nanoseconds of the monotonic clock. 'print_ns' is left for the
+ * application to account its output in.
+ */
+typedef struct {
+	size_t   dirs_scanned, files_opened, bytes_read, stat_calls;
+	size_t   parse_failures; /* md files without a valid header */
+	size_t   allocs;
+	uint64_t scan_ns, parse_ns, sort_ns, print_ns;
+} spnotes_stats;
+#endif
 
 struct spnotes_t {
-	char          *root_location;
-	spnotes_categ *categs; /* NULL = Not filled yet */
-	size_t         categs_c;
+	char             *root_location;
+	char            **roots; /* 'root_location' first, see 'spnotes_roots_add()' */
+	size_t            roots_c;
+	spnotes_categ    *categs; /* NULL = Not filled yet */
+	size_t            categs_c, mcategs_c;
+	spnotes_note    **notes_by_id; /* NULL = Not indexed yet */
+	size_t            notes_by_id_c;
+	spnotes_tags     *tags;     /* NULL = Not indexed yet */
+	spnotes_trigrams *trigrams; /* NULL = Not indexed yet */
+	spnotes_links    *links;    /* NULL = Not indexed yet */
+	size_t memory_cap;     /* 0 = No cap, see 'spnotes_memory_usage()' */
+	size_t memory_charged; /* bytes accounted against 'memory_cap' */
+	int    scan_order;     /* 'SPNOTES_SCAN_*' of the note fills */
+	int    no_stat;        /* notes named by time aren't stat'ed if set */
+#ifdef SPNOTES_STATS
+	spnotes_stats stats;
+#endif
 };
 
 struct spnotes_categ {
 	spnotes_t      *spnotes_instance;
+	const char     *root; /* one of the roots of the instance */
 	char            path[PATH_MAX];
 	char            title[NAME_MAX];
+	char            title_folded[NAME_MAX]; /* for case-insensitive lookups */
 	struct timespec last_modified;
 	spnotes_note   *notes; /* NULL = Not filled yet */
-	size_t          notes_c;
+	size_t          notes_c, mnotes_c;
 };
 
 struct spnotes_note {
 	char            path[PATH_MAX];
 	char            title[NAME_MAX];
+	char            title_folded[NAME_MAX]; /* for case-insensitive lookups */
 	char           *description; /* dynamically allocated */
 	int             has_description;
-	struct timespec last_modified;
+	char           *tags; /* comma separated, dynamically allocated or NULL */
+	size_t          id;   /* index on 'notes_by_id' of the instance */
+	struct timespec last_modified; /* 0 if not stat'ed, see 'no_stat' */
+	struct timespec created;       /* from the file name, else 0 */
 	spnotes_categ  *categ;
 };
 
+/*
+ * Compressed bitmap of note ids in the style of Roaring bitmaps: ids are split
+ * into containers by their high 16 bits, each storing the low 16 bits either
+ * as a sorted array (up to 4096 ids) or as a 65536 bit bitmap.
+ */
+typedef struct {
+	uint16_t  key;
+	uint32_t  card;   /* number of ids in the container */
+	uint16_t *array;  /* NULL if `bitmap` is used instead */
+	uint64_t *bitmap; /* 1024 words */
+} spnotes_container;
+
+struct spnotes_bitmap {
+	spnotes_container *conts;
+	size_t             conts_c, mconts_c;
+};
+
+/* Interned tags of all the notes with a bitmap of notes having each of them. */
+struct spnotes_tags {
+	char          **names;   /* dynamically allocated */
+	spnotes_bitmap *bitmaps; /* `bitmaps[i]` are the notes tagged `names[i]` */
+	size_t          tags_c, mtags_c;
+	size_t         *table; /* open addressing table of `tag id + 1` */
+	size_t          table_c;
+};
+
+/*
+ * Trigram index of the case folded titles and descriptions of the notes: the
+ * ids of the notes having each distinct 3 byte sequence, in ascending order.
+ */
+struct spnotes_trigrams {
+	uint32_t *grams;    /* the 3 bytes in the low 24 bits */
+	uint32_t *offsets;  /* postings of `grams[i]` start at `offsets[i]` */
+	uint32_t *postings; /* note ids */
+	uint32_t *table;    /* open addressing table of `gram index + 1` */
+	size_t    grams_c, postings_c, table_c;
+};
+
+/*
+ * Links of the notes by their ids: the notes each note links to, the notes
+ * linking to it (its backlinks) and the URLs it links to. The links of the
+ * note `i` are 'out[out_offsets[i]]' up to 'out[out_offsets[i + 1]]' in
+ * ascending order, and so are its backlinks and URLs.
+ */
+struct spnotes_links {
+	uint32_t *out_offsets, *out;
+	uint32_t *in_offsets, *in;
+	uint32_t *url_offsets;
+	char    **urls;    /* pointing into 'strings' */
+	char     *strings; /* the URLs one after the other */
+	size_t    notes_c, out_c, urls_c, strings_size;
+};
+
+
+/*
+ * Immutable catalog of the categories and their notes, see
+ * 'spnotes_catalog_pin()'. The categories are sorted as asked for by the
+ * catalog and shared with the other snapshots they're unchanged in, so neither
+ * they nor their notes are to be modified.
+ */
+struct spnotes_snapshot {
+	spnotes_categ **categs;
+	size_t          categs_c;
+	uint64_t        version; /* 'spnotes_catalog_refresh()'es before it */
+	size_t          refs;    /* the catalog's and the pins' */
+};
+
+/*
+ * Catalog of the categories and notes under some roots refreshed by a writer
+ * while readers look them up in the snapshots of it. Initialize it with
+ * 'spnotes_catalog_init()'.
+ */
+struct spnotes_catalog {
+	spnotes_t         instance; /* the writer's, read into the snapshots */
+	spnotes_snapshot *current;
+	size_t            pinning[2]; /* readers about to pin, by epoch */
+	size_t            epoch;
+	int               flags; /* 'SPNOTES_CATALOG_*' */
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_t writer;
+#endif
+};
+
+typedef struct spnotes_grep_line spnotes_grep_line;
+
+struct spnotes_grep_line {
+	spnotes_note *note;
+	size_t        line_no;  /* starting from 1, counted from top of the file */
+	char         *text;     /* dynamically allocated, without the newline */
+	int           is_match; /* 0 = context line around a match */
+	int           owns_note; /* `note` is a copy, freed with the line */
+};
+
+/* kinds of 'spnotes_dupes_group' */
+#define SPNOTES_DUPE_EXACT 0 /* byte for byte the same files */
+#define SPNOTES_DUPE_BODY  1 /* the same body, the headers differing */
+#define SPNOTES_DUPE_SPACE 2 /* the same body but for whitespace */
+
+/* A group of notes with the same content, see 'spnotes_notes_dupes()'. */
+typedef struct {
+	int            kind;  /* one of 'SPNOTES_DUPE_*' */
+	spnotes_note **notes; /* dynamically allocated */
+	size_t         notes_c;
+} spnotes_dupes_group;
+
+#define SPNOTES_TRASH_ID_MAX 32
+
+/* A category or note in the trash (see 'spnotes_categs_remove()'). */
+typedef struct {
+	char            id[SPNOTES_TRASH_ID_MAX]; /* name in `.trash/` */
+	char            categ[NAME_MAX];          /* title of the category */
+	char            note[NAME_MAX]; /* title of the note, "" = the category */
+	struct timespec deleted;
+	size_t          root; /* index on the roots of the instance */
+} spnotes_trash_entry;
+
+/*
+ * Layout of a catalog published with 'spnotes_shm_publish()'. Only offsets
+ * from the start of the segment are stored so that every process can map it
+ * anywhere. All the strings are NUL terminated and an offset of 0 means there
+ * is no such string.
+ *
+ * The trigram index of the notes follows the notes array: the 'grams',
+ * 'offsets', 'table' and 'postings' of a 'spnotes_trigrams' one after the
+ * other, the note ids being the indexes on the notes array. Then comes the
+ * order of the titles: the indexes of the categories sorted by title,
+ * followed by the indexes of the notes of every category sorted by title (in
+ * the slice of the category).
+ */
+#define SPNOTES_SHM_MAGIC   0x53504e43 /* "SPNC" */
+#define SPNOTES_SHM_VERSION 3
+
+typedef struct {
+	uint32_t magic, version;
+	uint32_t seq;        /* seqlock: odd while the catalog is being written */
+	uint32_t pad;
+	uint64_t generation; /* bumped on every publish */
+	uint64_t size;       /* bytes in use, the segment may be larger */
+	uint64_t root_off;
+	int64_t  root_mtime_sec, root_mtime_nsec;
+	uint64_t categs_off, categs_c;
+	uint64_t notes_off, notes_c;
+	uint64_t trigrams_off; /* 0 = no trigram index */
+	uint64_t grams_c, postings_c, table_c;
+	uint64_t order_off; /* categs_c + notes_c uint32_t */
+	uint64_t strings_off;
+} spnotes_shm_header;
+
+typedef struct {
+	uint64_t title_off, path_off;
+	int64_t  mtime_sec, mtime_nsec;
+	uint64_t notes_first, notes_c; /* slice of the notes array */
+} spnotes_shm_categ;
+
+typedef struct {
+	uint64_t title_off, path_off, desc_off, tags_off;
+	int64_t  mtime_sec, mtime_nsec;
+	uint64_t categ; /* index on the categories array */
+} spnotes_shm_note;
+
+/*
+ * Read only view of a catalog attached with 'spnotes_shm_attach()'. The
+ * arrays point straight into the segment, the strings being read from it
+ * with 'spnotes_shm_str()'.
+ */
+typedef struct {
+	const unsigned char      *base;
+	size_t                    size; /* bytes mapped */
+	const spnotes_shm_categ  *categs;
+	size_t                    categs_c;
+	const spnotes_shm_note   *notes;
+	size_t                    notes_c;
+	const uint32_t           *order; /* the order of the titles */
+	const spnotes_shm_header *header;
+	uint32_t                  seq; /* of the seqlock when attached */
+} spnotes_shm_view;
+
+/* Bytes held by an instance, see 'spnotes_memory_usage()'. */
+typedef struct {
+	size_t categs;  /* used part of the category array */
+	size_t notes;   /* used part of the note arrays */
+	size_t strings; /* root location, descriptions and tags */
+	size_t slack;   /* unused capacity of the category and note arrays */
+	size_t indexes; /* 'notes_by_id', the tag, trigram and link indexes */
+	size_t total;
+} spnotes_memory;
+
+/*
+ * Receives the trace events set up with 'spnotes_trace_set()': `phase` is
+ * 'SPNOTES_TRACE_BEGIN' or 'SPNOTES_TRACE_END' of the operation `name` and
+ * `arg` (may be NULL) tells what it operated on, e.g. the path of the note.
+ */
+typedef void (*spnotes_trace_func)(int phase, const char *name,
+                                   const char *arg, void *user);
+
+#define SPNOTES_TRACE_BEGIN 'B'
+#define SPNOTES_TRACE_END   'E'
+
+/* flags for `spnotes_import_md_dir()` and `spnotes_import_jsonl()` */
+#define SPNOTES_IMPORT_NO_SYNC 1 /* don't sync the notes to the disk */
+
+/* flags for `spnotes_grep()` */
+#define SPNOTES_GREP_REGEX 1 /* POSIX extended regex instead of a literal */
+#define SPNOTES_GREP_ICASE 2 /* ignore case */
+
+/* flags for `spnotes_notes_dupes()` */
+#define SPNOTES_DUPES_NEAR     1 /* also the near duplicates */
+#define SPNOTES_DUPES_NO_CACHE 2 /* neither read nor write the hash cache */
+
+/* flags for `spnotes_links_build()` */
+#define SPNOTES_LINKS_NO_CACHE 1 /* neither read nor write the links cache */
+
+/* flags for `spnotes_catalog_init()` */
+#define SPNOTES_CATALOG_ALPHABETICAL 1 /* sort alphabetically, not by time */
+
 /*
  ===============================================================================
  |                              Global Variables                               |
  ===============================================================================
  */
 
+#ifndef __cplusplus /* see 'spnotes_error()' */
 static int spnotes_err;
+#endif
 
 /* error values */
 #define SPNOTES_ERR_NONE        0
@@ -206,6 +518,18 @@ static int spnotes_err;
 #define SPNOTES_ERR_MKDIR       10 /* errno is set */
 #define SPNOTES_ERR_OPEN        11 /* errno is set */
 #define SPNOTES_ERR_DELETE      12 /* errno is set */
+#define SPNOTES_ERR_REGEX       13
+#define SPNOTES_ERR_QUERY       14
+#define SPNOTES_ERR_WRITE       15 /* errno is set */
+#define SPNOTES_ERR_PARSE       16
+#define SPNOTES_ERR_SHM         17 /* errno is set */
+#define SPNOTES_ERR_STALE       18
+#define SPNOTES_ERR_EXISTS      19 /* errno is set */
+#define SPNOTES_ERR_MEMORY_CAP  20
+#define SPNOTES_ERR_MULTI_ROOT  21
+#define SPNOTES_ERR_CURSOR      22
+#define SPNOTES_ERR_VALUE       23
+#define SPNOTES_ERR_RENAME      24 /* errno is set */
 
 /*
  ===============================================================================
@@ -213,6 +537,10 @@ static int spnotes_err;
  ===============================================================================
  */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* = spnotes_t = */
 
 /*
@@ -222,10 +550,49 @@ static int spnotes_err;
  * Returns 0 on error and sets the `spnotes_err` with the error.
  * The error can be:
  * 'SPNOTES_ERR_NULL_PTR' - NULL is passed on `root_location`.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
  */
 SPNOTES_DEF int
 spnotes_init(spnotes_t *instance, const char *root_location);
 
+/*
+ * Adds another root location to the instance, so that the categories of all
+ * the roots get filled as one note system. Has to be called before filling
+ * the categories.
+ *
+ * Roots on different devices are read in parallel. The categories of the root
+ * given to 'spnotes_init()' come first, then those of the added roots in the
+ * order these were added. A category with the same title as one of an earlier
+ * root gets "@" and the name of the directory of its root appended to its
+ * title, as in "c@archive" for the "c" category of "/mnt/archive/", the
+ * categories nested in it following it ("c@archive/posix").
+ *
+ * New categories (see 'spnotes_categs_add()') are always created on the root
+ * given to 'spnotes_init()'.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - NULL is passed on `instance` or `root_location`.
+ * 'SPNOTES_ERR_REDECLARE' - The root was already added.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_roots_add(spnotes_t *instance, const char *root_location);
+
+/*
+ * Initialize the given 'spnotes_t' struct pointer instance with a ':'
+ * separated list of root locations, as in "/home/me/notes:/mnt/archive". The
+ * first one is the root given to 'spnotes_init()' and the rest are added with
+ * 'spnotes_roots_add()', repeated and empty ones being skipped.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - NULL is passed on `roots` or it has no root.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_init_roots(spnotes_t *instance, const char *roots);
+
 /*
  * Destructor for the 'spnotes_t' instance.
  *
@@ -303,6 +670,49 @@ spnotes_categs_sort_last_modified(spnotes_t *instance);
 SPNOTES_DEF void
 spnotes_categs_sort_alphabetically(spnotes_t *instance);
 
+#define SPNOTES_FILL_NOTES 1 /* Also fill the notes of every category */
+
+/*
+ * Fills the categories of the note system like 'spnotes_categs_fill()' but
+ * walking the whole tree under the root, so that every non hidden directory
+ * at any depth is a category titled by its path relative to the root, as in
+ * "lang/c" for "<root>/lang/c/". Symbolic links are not followed.
+ *
+ * The subtrees are walked in parallel by a pool of workers sharing a queue of
+ * directories to read. If `flags` has 'SPNOTES_FILL_NOTES', the notes of every
+ * category are also filled in parallel afterwards.
+ *
+ * Categories whose relative path doesn't fit in `NAME_MAX` are skipped along
+ * with their subtrees.
+ *
+ * Returns the number of categories found OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - The instance is a NULL pointer.
+ * 'SPNOTES_ERR_INVALID_LOC' - Invalid location to the root notes.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_REALLOC' - Couldn't reallocate required memory.
+ * 'SPNOTES_ERR_MEMORY_CAP' - The memory cap of the instance was reached.
+ * 'SPNOTES_ERR_FILE_STAT' - Couldn't get the required info of file.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the files on directory.
+ * Any of the errors of 'spnotes_notes_fill()' if `flags` has
+ * 'SPNOTES_FILL_NOTES'.
+ */
+SPNOTES_DEF int
+spnotes_categs_fill_nested(spnotes_t *instance, int flags);
+
+/*
+ * Sorts the nested categories as a tree: every category comes right before
+ * its subcategories, and siblings keep the order they had, so sorting first
+ * with any of the other sort functions picks the order within each level.
+ *
+ * Completely safe to pass a NULL pointer or a spnotes instance whose categories
+ * hasn't been filled yet. The order is left untouched and the `spnotes_err` set
+ * to 'SPNOTES_ERR_MALLOC' if the memory needed cannot be allocated.
+ */
+SPNOTES_DEF void
+spnotes_categs_sort_tree(spnotes_t *instance);
+
 /*
  * Search for a given category in the note system.
  *
@@ -312,6 +722,25 @@ spnotes_categs_sort_alphabetically(spnotes_t *instance);
 SPNOTES_DEF spnotes_categ *
 spnotes_categs_search(spnotes_t instance, const char *title);
 
+#define SPNOTES_SEARCH_ICASE  1 /* ignore case, see below */
+#define SPNOTES_SEARCH_PREFIX 2 /* titles starting with the given one */
+#define SPNOTES_SEARCH_SUBSTR 4 /* titles containing the given one */
+
+/*
+ * Same as 'spnotes_categs_search()' with the given `flags`.
+ *
+ * With 'SPNOTES_SEARCH_ICASE' the given title is case folded and compared with
+ * the titles folded once when they were filled, so it costs the same as an
+ * exact search. The folding covers ASCII, the Latin-1, Latin Extended-A, Greek
+ * and Cyrillic letters, 'ß' and the 'f' ligatures and the full width forms of
+ * ASCII; it isn't a full Unicode case folding or normalization.
+ *
+ * Returns the first matching category OR NULL if none is found or the
+ * categories aren't filled yet ('SPNOTES_ERR_NOT_FILLED').
+ */
+SPNOTES_DEF spnotes_categ *
+spnotes_categs_search_ex(spnotes_t *instance, const char *title, int flags);
+
 /*
  * Creates a new category in the note system.
  *
@@ -327,15 +756,62 @@ SPNOTES_DEF int
 spnotes_categs_add(spnotes_t instance, const char *title, char *new_loc);
 
 /*
- * Delete the given category in the note system.
+ * Delete the given category in the note system by moving it to the trash
+ * (`.trash/` under the root) in a single rename. Restore it with
+ * 'spnotes_trash_restore()' or delete it for good with 'spnotes_trash_purge()'.
  *
  * Returns 0 on error and sets the `spnotes_err` with the error.
  * The error can be:
- * 'SPNOTES_ERR_DELETE' - The category directory couldn't be deleted.
+ * 'SPNOTES_ERR_NULL_PTR' - The category isn't of any instance.
+ * 'SPNOTES_ERR_DELETE' - The category directory couldn't be moved.
  */
 SPNOTES_DEF int
 spnotes_categs_remove(spnotes_categ categ);
 
+/*
+ * Renames the directory of the given category to `title` under its root in a
+ * single 'renameat2(RENAME_NOREPLACE)', creating the parent directories of a
+ * nested title such as "lang/c".
+ *
+ * The category, the categories nested in it and the paths of their notes are
+ * patched in memory rather than refilled.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_VALUE' - `title` isn't a valid directory path.
+ * 'SPNOTES_ERR_REDECLARE' - A category of the given title already exists.
+ * 'SPNOTES_ERR_OPEN' - Couldn't open the root of the category.
+ * 'SPNOTES_ERR_EXISTS' - A directory of the given title already exists.
+ * 'SPNOTES_ERR_RENAME' - Couldn't rename the directory.
+ */
+SPNOTES_DEF int
+spnotes_categs_rename(spnotes_categ *categ, const char *title);
+
+/*
+ * Moves all the files of the category `from` into the category `into`, a note
+ * whose file name is taken being given a new one, and removes `from` once it
+ * is empty (it is kept if there are categories nested in it).
+ *
+ * The notes of a filled `from` are moved in memory to a filled `into`. A
+ * removed category is taken out of the categories of the instance, so the
+ * pointers to the categories after it are moved back by one.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error. The files
+ * moved before the error stay moved.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_VALUE' - Both the categories are the same.
+ * 'SPNOTES_ERR_OPEN' - Couldn't open the directory of a category.
+ * 'SPNOTES_ERR_EXISTS' - A file other than a note has a taken name.
+ * 'SPNOTES_ERR_RENAME' - Couldn't move one of the files.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the files of `from`.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_REALLOC' - Couldn't reallocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_categs_merge(spnotes_categ *from, spnotes_categ *into);
+
 /* = Note = */
 
 /*
@@ -366,6 +842,20 @@ spnotes_notes_fill(spnotes_categ *categ);
  * Passing NULL to `filter` or `filter_func` is equivalent to calling
  * 'spnotes_categs_fill()'.
  *
+ * The headers are parsed in the order the directory lists the files, unless
+ * the 'scan_order' of the instance says otherwise: 'SPNOTES_SCAN_INODE' lists
+ * all of them first and parses them by inode number, and 'SPNOTES_SCAN_EXTENT'
+ * by where their data is on the disk (found with 'FIEMAP' on Linux, else by
+ * inode number). Sorted scans keep the next 'SPNOTES_SCAN_AHEAD' files open
+ * with their headers asked to be read ahead, so that cold scans of rotational
+ * disks seek forward instead of back and forth.
+ *
+ * The 'created' time of a note is taken from its file name when it's named
+ * '<epoch>.<nanoseconds>.md' (or '<epoch>.md') as by 'spnotes_notes_add()'.
+ * With 'no_stat' set on the instance such notes aren't stat'ed at all, their
+ * 'last_modified' being left 0, so that a listing by 'created' costs just the
+ * read of the directory and of the headers.
+ *
  * Returns the number of notes found OR -1 on error and sets the `spnotes_err`
  * with the error.
  * The error can be:
@@ -396,6 +886,16 @@ spnotes_notes_compare_last_modified(const void *note1, const void *note2);
 SPNOTES_DEF int
 spnotes_notes_compare_alphabetically(const void *note1, const void *note2);
 
+/*
+ * Compare function to sort the notes found in descending order of created,
+ * the notes whose file names have no time coming last in ascending
+ * alphabetical order.
+ *
+ * To be passed to a 'qsort()' function.
+ */
+SPNOTES_DEF int
+spnotes_notes_compare_created(const void *note1, const void *note2);
+
 /*
  * Sorts the notes found in descending order of last modified.
  *
@@ -414,6 +914,16 @@ spnotes_notes_sort_last_modified(spnotes_categ *categ);
 SPNOTES_DEF void
 spnotes_notes_sort_alphabetically(spnotes_categ *categ);
 
+/*
+ * Sorts the notes found in descending order of created, see
+ * 'spnotes_notes_compare_created()'.
+ *
+ * Completely safe to pass a NULL pointer or a spnotes category whose notes
+ * hasn't been filled yet.
+ */
+SPNOTES_DEF void
+spnotes_notes_sort_created(spnotes_categ *categ);
+
 /*
  * Search for a note of given title in the given category in the note system.
  *
@@ -423,6 +933,13 @@ spnotes_notes_sort_alphabetically(spnotes_categ *categ);
 SPNOTES_DEF spnotes_note *
 spnotes_notes_search(spnotes_categ categ, const char *title);
 
+/*
+ * Same as 'spnotes_notes_search()' with the given `flags`, see
+ * 'spnotes_categs_search_ex()'.
+ */
+SPNOTES_DEF spnotes_note *
+spnotes_notes_search_ex(spnotes_categ *categ, const char *title, int flags);
+
 /*
  * Creates a new note in the note system.
  *
@@ -430,6 +947,10 @@ spnotes_notes_search(spnotes_categ categ, const char *title);
  * file are expected to be added. See the layout section of spnotes for more
  * info on which parts are compulsory to be added.
  *
+ * The file is named '<epoch>.<nanoseconds>.md' after the time of creation,
+ * bumped by a nanosecond whenever needed so that no two notes ever share a
+ * name, and is created exclusively so an existing note is never truncated.
+ *
  * Fills up `new_loc` with the path on disk where the note was added. NULL can
  * be passed to ignore it. But idk why would you want to ever ignore it.
  * Without the proper layout on the file, the note won't be shown on the
@@ -443,560 +964,11341 @@ SPNOTES_DEF int
 spnotes_notes_add(spnotes_categ categ, char *new_loc);
 
 /*
- * Delete the given note in the note system.
+ * Same as 'spnotes_notes_add()' but the new file is created with the given
+ * `content` of `content_len` bytes written in the same go.
  *
  * Returns 0 on error and sets the `spnotes_err` with the error.
  * The error can be:
- * 'SPNOTES_ERR_DELETE' - The note file couldn't be deleted.
+ * 'SPNOTES_ERR_OPEN' - Couldn't create a file in the required location.
+ * 'SPNOTES_ERR_WRITE' - Couldn't write the content (the file is removed).
  */
 SPNOTES_DEF int
-spnotes_notes_remove(spnotes_note note);
-
-/* = Errors = */
-
-/* Returns the string representation of the error in 'splnotes_err'. */
-SPNOTES_DEF char *
-spnotes_errorstr(void);
+spnotes_notes_add_content(spnotes_categ categ, const char *content,
+                          size_t content_len, char *new_loc);
 
-#endif /* SPNOTES_H */
+/*
+ * Same as 'spnotes_notes_add()' but the new file is created with a yaml-header
+ * of the given `title` and `description` (NULL to leave it out) written with a
+ * single 'writev()'. Neither of them should contain a newline.
+ *
+ * See the comments on `spnotes_notes_add_content()` to know about the return
+ * values.
+ */
+SPNOTES_DEF int
+spnotes_notes_add_header(spnotes_categ categ, const char *title,
+                         const char *description, char *new_loc);
 
 /*
- ===============================================================================
- |                             IMPLEMENTATION MODE                             |
- ===============================================================================
+ * Creates `notes_c` new notes in the given category as
+ * 'spnotes_notes_add_header()' would with `titles[i]` and `descriptions[i]`.
+ * `descriptions` or any of its elements can be NULL.
+ *
+ * Fills up `new_locs` (if not NULL) with the paths of the notes created.
+ *
+ * Returns the number of notes created OR -1 on error and sets the
+ * `spnotes_err` with the error. Notes created before the error are kept.
+ * The error can be:
+ * 'SPNOTES_ERR_INVALID_LOC' - Invalid location to the category.
+ * 'SPNOTES_ERR_OPEN' - Couldn't create a file in the required location.
+ * 'SPNOTES_ERR_WRITE' - Couldn't write the content of a note.
  */
+SPNOTES_DEF int
+spnotes_notes_add_many(spnotes_categ categ, const char **titles,
+                       const char **descriptions, size_t notes_c,
+                       char (*new_locs)[PATH_MAX]);
 
-#ifdef SPNOTES_IMPL
+/*
+ * Delete the given note in the note system by moving it to the trash. See
+ * 'spnotes_categs_remove()'.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - The note isn't of any category.
+ * 'SPNOTES_ERR_DELETE' - The note file couldn't be moved.
+ */
+SPNOTES_DEF int
+spnotes_notes_remove(spnotes_note note);
 
 /*
- ===============================================================================
- |                          Function Implementations                           |
- ===============================================================================
+ * Sets the title of the given note in its yaml-header and in memory, without
+ * rewriting the body.
+ *
+ * If the new header isn't longer than the old one, it is patched in place
+ * with a single 'pwrite()', the bytes left over kept as a padding comment line
+ * for later edits to grow into. Else the new header and the body (with
+ * 'copy_file_range()' where available) are written to a temporary file which
+ * is renamed over the note.
+ *
+ * The trigram index of the instance, if built, has the postings of the note
+ * patched (freed to be rebuilt if that fails), and the link index is freed
+ * to be rebuilt on the next query, wiki links resolving by title.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_VALUE' - The title is empty, too long or has a newline.
+ * 'SPNOTES_ERR_OPEN' - Couldn't open the note or create the temporary file.
+ * 'SPNOTES_ERR_FILE_READ' - Couldn't read the note.
+ * 'SPNOTES_ERR_PARSE' - The note doesn't start with a yaml-header.
+ * 'SPNOTES_ERR_WRITE' - Couldn't write the note (it is left as it was).
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
  */
+SPNOTES_DEF int
+spnotes_note_set_title(spnotes_note *note, const char *title);
 
-/* = spnotes_t = */
+/*
+ * Same as 'spnotes_note_set_title()' for the description of the note, removed
+ * if `description` is NULL or empty.
+ */
+SPNOTES_DEF int
+spnotes_note_set_description(spnotes_note *note, const char *description);
 
+/*
+ * Moves the given note to the category `to` with a single
+ * 'renameat2(RENAME_NOREPLACE)', keeping its file name unless it is taken
+ * there (then it gets a new one). Fills up `new_loc` (if not NULL) with its
+ * new path.
+ *
+ * If its category is filled, the note is taken out of it in memory (the last
+ * note taking its place) and added at the end of the notes of `to` if that is
+ * filled, so `note` may no longer point to it. Sort again if needed.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_OPEN' - Couldn't open the directory of a category.
+ * 'SPNOTES_ERR_RENAME' - Couldn't move the file (e.g. across file systems).
+ * 'SPNOTES_ERR_MEMORY_CAP' - Moved, but `to` would exceed the memory cap.
+ * 'SPNOTES_ERR_REALLOC' - Moved, but couldn't grow the notes of `to`.
+ */
 SPNOTES_DEF int
-spnotes_init(spnotes_t *instance, const char *root_location)
-{
-	if (root_location == NULL) {
-		spnotes_err = SPNOTES_ERR_NULL_PTR;
-		return 0;
-	}
+spnotes_notes_move(spnotes_note *note, spnotes_categ *to, char *new_loc);
 
-	instance->root_location = strdup(root_location);
-	if (instance->root_location[strlen(instance->root_location) - 1] != '/')
-		strcat(instance->root_location, "/");
-	instance->categs = NULL;
-	instance->categs_c = 0;
+/* = Trash = */
 
-	spnotes_err = SPNOTES_ERR_NONE;
+/*
+ * Fills up `entries` with a dynamically allocated array of the categories and
+ * notes in the trash of the given `instance`, most recently deleted first.
+ * Free it with 'free()'.
+ *
+ * Returns the number of entries found OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the arguments is NULL.
+ * 'SPNOTES_ERR_DIR_READ' - The trash couldn't be read.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_trash_list(const spnotes_t *instance, spnotes_trash_entry **entries,
+                   size_t *entries_c);
 
-	return 1;
-}
+/*
+ * Moves the trash entry `id` back to where it was deleted from. A note whose
+ * category was deleted meanwhile gets the category created again.
+ *
+ * Refill the instance to see the restored category or note.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the arguments is NULL.
+ * 'SPNOTES_ERR_INVALID_LOC' - No such entry in the trash.
+ * 'SPNOTES_ERR_EXISTS' - A category or note of the same name exists again.
+ * 'SPNOTES_ERR_DELETE' - The entry couldn't be moved back.
+ */
+SPNOTES_DEF int
+spnotes_trash_restore(const spnotes_t *instance, const char *id);
 
-SPNOTES_DEF void
-spnotes_free(spnotes_t *instance)
-{
-	if (instance == NULL)
-		return;
+/*
+ * Deletes the trash entry `id` for good, or the whole trash if `id` is NULL.
+ * Files are unlinked in parallel relative to their directory fds.
+ *
+ * Returns the number of files deleted OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` is NULL.
+ * 'SPNOTES_ERR_INVALID_LOC' - No such entry in the trash.
+ * 'SPNOTES_ERR_DIR_READ' - The trash couldn't be read.
+ * 'SPNOTES_ERR_DELETE' - Some of the files couldn't be deleted.
+ */
+SPNOTES_DEF int
+spnotes_trash_purge(const spnotes_t *instance, const char *id);
 
-	for (size_t i = 0; i < instance->categs_c; i++) {
-		for (size_t j = 0; j < instance->categs[i].notes_c; j++)
-			if (instance->categs[i].notes[j].has_description)
-				free(instance->categs[i].notes[j].description);
-		free(instance->categs[i].notes);
-	}
-	free(instance->categs);
+/* = Import = */
 
-	free(instance->root_location);
-}
+/*
+ * Imports the markdown files ('*.md') in the directory `src_dir` as notes. The
+ * files directly inside `src_dir` go to the category `default_categ` (the name
+ * of `src_dir` if NULL) and the files inside its subdirectories go to the
+ * categories named after them. Categories are created as needed.
+ *
+ * Files already having a yaml-header with a title are imported as is. Others
+ * get a header titled after their first '# heading' (or their file name).
+ *
+ * The notes are written in parallel, each synced to the disk by the worker
+ * writing it and the directories holding them at the end, unless
+ * 'SPNOTES_IMPORT_NO_SYNC' is passed in `flags`. The categories of `instance`
+ * have to be refilled to see the new notes.
+ *
+ * Returns the number of notes imported OR -1 on error and sets the
+ * `spnotes_err` with the error. Notes written before an error are kept.
+ * The error can be:
+ * 'SPNOTES_ERR_INVALID_LOC' - Invalid location to the directory.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the files on directory.
+ * 'SPNOTES_ERR_MKDIR' - Couldn't create a category.
+ * 'SPNOTES_ERR_FILE_READ' - Couldn't read one of the files.
+ * 'SPNOTES_ERR_WRITE' - Couldn't write or sync one of the notes.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_import_md_dir(spnotes_t *instance, const char *src_dir,
+                      const char *default_categ, int flags);
+
+/*
+ * Imports the notes from the JSON Lines `stream` where every line is an object
+ * like {"category": "c", "title": "Pipes", "description": "About pipes",
+ * "tags": ["c"], "body": "# Pipes\n..."}. Every field is optional; notes
+ * without a category go to 'uncategorized'.
+ *
+ * The whole stream is parsed before anything is written. See the comments on
+ * `spnotes_import_md_dir()` for the rest.
+ *
+ * Returns the number of notes imported OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can additionally be:
+ * 'SPNOTES_ERR_PARSE' - A line isn't a valid JSON object.
+ */
+SPNOTES_DEF int
+spnotes_import_jsonl(spnotes_t *instance, FILE *stream, int flags);
+
+/* = Search = */
+
+/*
+ * Searches the body (i.e. everything after the yaml-header) of every note in
+ * the categories filled in the given `instance` for the given `pattern`.
+ *
+ * The files of the categories whose notes aren't filled are read just once for
+ * both their header and their body, in the order of the directory. Those
+ * categories are left unfilled: the lines found in one of these notes point at
+ * a copy of it owned by the first of them (see 'owns_note').
+ *
+ * By default `pattern` is searched literally. Pass 'SPNOTES_GREP_REGEX' in
+ * `flags` to treat it as a POSIX extended regex and/or 'SPNOTES_GREP_ICASE' to
+ * ignore case. The pattern is compiled once and the notes are scanned in
+ * parallel.
+ *
+ * Fills up `lines` with a dynamically allocated array of matching lines (and
+ * `context` number of lines before and after each of them) ordered the same
+ * way as the notes in `instance`. Free it with 'spnotes_grep_free()'.
+ *
+ * Returns the number of matching lines OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_REGEX' - The given regex couldn't be compiled.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_REALLOC' - Couldn't grow the list of the files.
+ * 'SPNOTES_ERR_FILE_READ' - Couldn't read one of the note files.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the files of a category.
+ */
+SPNOTES_DEF int
+spnotes_grep(spnotes_t *instance, const char *pattern, int flags,
+             size_t context, spnotes_grep_line **lines, size_t *lines_c);
+
+/*
+ * Destructor for the lines found by 'spnotes_grep()'.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_grep_free(spnotes_grep_line *lines, size_t lines_c);
+
+/* = Recent = */
+
+/*
+ * Finds the `k` most recently modified notes of all the categories filled in
+ * the given `instance`, newest first.
+ *
+ * The notes of filled categories are taken from memory. The others are only
+ * read by a stat of each file, a bounded heap keeping the newest ones, and
+ * just the headers of those are parsed.
+ *
+ * Fills up `notes` with a dynamically allocated array of copies of the notes
+ * (`id` isn't set). Free it with 'spnotes_notes_recent_free()'.
+ *
+ * Returns the number of notes found (less than `k` if there aren't as many)
+ * OR -1 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the directory of a category.
+ * 'SPNOTES_ERR_FILE_STAT' - Couldn't stat one of the note files.
+ */
+SPNOTES_DEF int
+spnotes_notes_recent(spnotes_t *instance, size_t k, spnotes_note **notes,
+                     size_t *notes_c);
+
+/*
+ * Destructor for the notes found by 'spnotes_notes_recent()'.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_notes_recent_free(spnotes_note *notes, size_t notes_c);
+
+/* = Pages = */
+
+#define SPNOTES_PAGE_ALPHABET 1 /* else newest first */
+#define SPNOTES_PAGE_CREATED  2 /* newest created first */
+#define SPNOTES_CURSOR_MAX    (4 * NAME_MAX + 32)
+
+/*
+ * Gets a page of at most `limit` notes (all of them if 0) of the given `categ`
+ * coming after the cursor `after` (from the start if NULL), in descending
+ * order of last modified, ascending alphabetical order with
+ * 'SPNOTES_PAGE_ALPHABET' in `flags` or descending order of created with
+ * 'SPNOTES_PAGE_CREATED' (see 'spnotes_notes_compare_created()').
+ *
+ * The page is picked by a partial selection, only the notes of it being
+ * ordered. The notes of a filled category are taken from memory. On an
+ * unfilled one each file is only stat'ed and just the headers of the page are
+ * parsed, except that the alphabetical order fills the category first. The
+ * order of created stats none of the files but the notes of the page, for
+ * their 'last_modified', and with 'no_stat' only those not named by time.
+ *
+ * If there may be more notes, `next` (of 'SPNOTES_CURSOR_MAX' bytes, can be
+ * NULL) is filled with the cursor of the next page, else it is made empty.
+ * Cursors are opaque strings standing for a place in the order rather than an
+ * index, so that pages don't shift when notes are added or removed meanwhile.
+ *
+ * Fills up `notes` with a dynamically allocated array of copies of the notes
+ * (`id` isn't set). Free it with 'spnotes_notes_recent_free()'.
+ *
+ * Returns the number of notes on the page OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_CURSOR' - `after` isn't a cursor of the same order.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_REALLOC' - Couldn't reallocate required memory.
+ * 'SPNOTES_ERR_DIR_READ' - Couldn't read the directory of the category.
+ * 'SPNOTES_ERR_FILE_STAT' - Couldn't stat one of the note files.
+ * The error can additionally be any of 'spnotes_notes_fill()'.
+ */
+SPNOTES_DEF int
+spnotes_notes_page(spnotes_categ *categ, int flags, const char *after,
+                   size_t limit, spnotes_note **notes, size_t *notes_c,
+                   char *next);
+
+/* = Tags = */
+
+/*
+ * Assigns an id to every note filled in the given `instance` (filling up
+ * 'notes_by_id') and builds the 'tags' index with the 'tags:' of the notes.
+ *
+ * Any previously built tag index is freed first. The note ids are kept if they
+ * are still those of the filled notes. The 'spnotes_notes_sort_*()' functions
+ * keep 'notes_by_id' pointing at the notes they move, but notes sorted by the
+ * application itself (e.g. a 'qsort()' with a 'spnotes_notes_compare_*()')
+ * need the index to be built again.
+ *
+ * Returns the number of distinct tags found OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_tags_index_build(spnotes_t *instance);
+
+/*
+ * Evaluates the boolean tag `query` over the index of the given `instance`.
+ * Tags can be combined with '&' (and), '|' (or), '!' (not) and grouped with
+ * parentheses, e.g. "c & !draft" or "(c | cpp) & pipes". An unknown tag
+ * matches no note.
+ *
+ * The index is built with 'spnotes_tags_index_build()' if it isn't already.
+ *
+ * Fills up `notes` with a dynamically allocated array of the matching notes in
+ * the order of their ids. Free it with 'free()'.
+ *
+ * Returns the number of notes found OR -1 on error and sets the `spnotes_err`
+ * with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_QUERY' - The query has a syntax error.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_tags_query(spnotes_t *instance, const char *query,
+                   spnotes_note ***notes, size_t *notes_c);
+
+/* = Trigrams = */
+
+/*
+ * Builds the 'trigrams' index of the given `instance`: the ids of the notes
+ * (see 'spnotes_tags_index_build()') having each 3 byte sequence of their case
+ * folded title or description, so that the notes containing a substring can
+ * be looked up without comparing it with every one of them.
+ *
+ * Any previously built trigram index is freed first. The note ids are kept if
+ * they are still those of the filled notes.
+ *
+ * Returns the number of distinct trigrams found OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_trigrams_build(spnotes_t *instance);
+
+/*
+ * Finds the notes of the given `instance` whose title or description contains
+ * `substr`, ignoring case (folded as in 'spnotes_categs_search_ex()') if
+ * `flags` has 'SPNOTES_SEARCH_ICASE'.
+ *
+ * Only the notes having every trigram of `substr` in the index are compared
+ * with it. The index is built with 'spnotes_trigrams_build()' if it isn't
+ * already (or loaded by 'spnotes_shm_load()'). A `substr` shorter than 3
+ * bytes has no trigram and is compared with every note.
+ *
+ * Fills up `notes` with a dynamically allocated array of the matching notes in
+ * the order of their ids. Free it with 'free()'.
+ *
+ * Returns the number of notes found OR -1 on error and sets the `spnotes_err`
+ * with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` or `substr` is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_trigrams_query(spnotes_t *instance, const char *substr, int flags,
+                       spnotes_note ***notes, size_t *notes_c);
+
+/* = Duplicates = */
+
+/*
+ * Finds the notes of the given `instance` having the same content, in groups
+ * of 'SPNOTES_DUPE_EXACT' notes (byte for byte the same files). With
+ * 'SPNOTES_DUPES_NEAR' in `flags` it also finds the near duplicates:
+ * 'SPNOTES_DUPE_BODY' notes having the same body but different headers and
+ * 'SPNOTES_DUPE_SPACE' notes whose bodies differ only in whitespace. A group
+ * of near duplicates is only reported if its notes aren't all duplicates of a
+ * stronger kind already. Notes with an empty body are no near duplicates.
+ *
+ * The files are hashed in parallel with XXH64. Only the files sharing their
+ * size with another one are read to find the exact duplicates, while every
+ * file is read to find the near ones. The hashes are cached by the size and
+ * the modification time of the files in `.spnotes-hashcache` at the root
+ * location of the instance, so that only the files changed since are read
+ * again, unless 'SPNOTES_DUPES_NO_CACHE' is in `flags`. Not being able to
+ * write the cache is no error.
+ *
+ * Fills up `groups` with a dynamically allocated array of the groups ordered
+ * by their kind, the notes of each being in the order of the notes in
+ * `instance`. Free it with 'spnotes_dupes_free()'.
+ *
+ * Returns the number of groups found OR -1 on error and sets the
+ * `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_FILE_STAT' - Couldn't stat one of the note files.
+ * 'SPNOTES_ERR_FILE_READ' - Couldn't read one of the note files.
+ */
+SPNOTES_DEF int
+spnotes_notes_dupes(spnotes_t *instance, int flags,
+                    spnotes_dupes_group **groups, size_t *groups_c);
+
+/*
+ * Destructor for the groups found by 'spnotes_notes_dupes()'.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_dupes_free(spnotes_dupes_group *groups, size_t groups_c);
+
+/* = Links = */
+
+/*
+ * Builds the 'links' index of the given `instance` from the bodies of the
+ * notes: the links to other notes, either wiki links by title such as
+ * '[[Pipes]]' or '[[c/Pipes]]' (case-insensitively, preferring the category
+ * of the linking note) or Markdown links to their files such as
+ * '[pipes](../c/1648362649.md)', and the URLs of Markdown links, '<...>'
+ * autolinks and bare 'http(s)://' URLs (e.g. of 'src:' lines). Fenced and
+ * inline code is skipped.
+ *
+ * The notes are read in parallel. The links found in them are cached by the
+ * modification time of the files in `.spnotes-links` at the root location of
+ * the instance, so that only the notes changed since are read again, unless
+ * 'SPNOTES_LINKS_NO_CACHE' is in `flags`. Not being able to write the cache
+ * is no error.
+ *
+ * Any previously built link index is freed first. The note ids are kept if
+ * they are still those of the filled notes.
+ *
+ * Returns the number of links between the notes found OR -1 on error and sets
+ * the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories aren't filled yet.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * 'SPNOTES_ERR_FILE_READ' - Couldn't read one of the note files.
+ */
+SPNOTES_DEF int
+spnotes_links_build(spnotes_t *instance, int flags);
+
+/*
+ * Gets the notes the given `note` of `instance` links to, or with
+ * 'spnotes_note_backlinks()' the notes linking to it, straight from the
+ * 'links' index. The index is built with 'spnotes_links_build()' if it isn't
+ * already.
+ *
+ * Fills up `notes` with a dynamically allocated array of the notes in the
+ * order of their ids. Free it with 'free()'.
+ *
+ * Returns the number of notes found OR -1 on error and sets the `spnotes_err`
+ * with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - One of the given pointers is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - `note` isn't one of the filled notes.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * The error can additionally be any of 'spnotes_links_build()'.
+ */
+SPNOTES_DEF int
+spnotes_note_links(spnotes_t *instance, const spnotes_note *note,
+                   spnotes_note ***notes, size_t *notes_c);
+
+SPNOTES_DEF int
+spnotes_note_backlinks(spnotes_t *instance, const spnotes_note *note,
+                       spnotes_note ***notes, size_t *notes_c);
+
+/*
+ * Gets the URLs the given `note` of `instance` links to in ascending order,
+ * like 'spnotes_note_links()'. `urls` is pointed to the URLs in the index, to
+ * be neither modified nor freed.
+ */
+SPNOTES_DEF int
+spnotes_note_urls(spnotes_t *instance, const spnotes_note *note,
+                  char *const **urls, size_t *urls_c);
+
+
+/* = Snapshots = */
+
+/*
+ * Initializes the given `catalog` for the ':' separated `roots` as in
+ * 'spnotes_init_roots()', with an empty snapshot until the first
+ * 'spnotes_catalog_refresh()'. `flags` tells how the snapshots are sorted:
+ * by last modified unless 'SPNOTES_CATALOG_ALPHABETICAL' is in them.
+ *
+ * Returns 1 on success OR 0 on error and sets the `spnotes_err` with the
+ * error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `catalog` or `roots` is NULL.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_catalog_init(spnotes_catalog *catalog, const char *roots, int flags);
+
+/*
+ * Reads the categories and notes of the given `catalog` again into a new
+ * snapshot, published for the readers once complete. Categories whose
+ * directory and notes have the same modification times as in the previous
+ * snapshot are shared with it rather than read again, costing just a 'stat()'
+ * of every note.
+ *
+ * Refreshes of the same catalog are serialized. A refresh never waits for the
+ * readers to unpin their snapshots, only for those in the middle of
+ * 'spnotes_catalog_pin()' to get through it.
+ *
+ * Returns the number of categories read again OR -1 on error and sets the
+ * `spnotes_err` with the error, the previous snapshot staying current then.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `catalog` is NULL.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ * Any of the errors of 'spnotes_categs_fill()' and 'spnotes_notes_fill()'.
+ */
+SPNOTES_DEF int
+spnotes_catalog_refresh(spnotes_catalog *catalog);
+
+/*
+ * Gets the current snapshot of the given `catalog`, which stays valid however
+ * many times the catalog is refreshed until it's unpinned with
+ * 'spnotes_snapshot_unpin()'. Safe to call from any number of threads along
+ * with a refresh: it's lock-free and never waits for the writer.
+ *
+ * Returns the snapshot, never NULL.
+ */
+SPNOTES_DEF spnotes_snapshot *
+spnotes_catalog_pin(spnotes_catalog *catalog);
+
+/*
+ * Unpins the given `snapshot` got with 'spnotes_catalog_pin()', freeing it if
+ * it's no longer the current one nor pinned by any other reader.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_snapshot_unpin(spnotes_snapshot *snapshot);
+
+/*
+ * Frees the given `catalog`, whose snapshots must all have been unpinned.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_catalog_free(spnotes_catalog *catalog);
+
+/* = Shared memory = */
+
+/*
+ * Writes the default segment name of the given `instance` (derived from its
+ * root location) into `name` of `name_size` bytes.
+ */
+SPNOTES_DEF void
+spnotes_shm_name(const spnotes_t *instance, char *name, size_t name_size);
+
+/*
+ * Publishes the filled categories and notes of the given `instance` into the
+ * POSIX shared memory segment `name` (the default one if NULL) so that other
+ * processes can attach to it with 'spnotes_shm_load()' instead of scanning the
+ * notes again.
+ *
+ * Publishers are serialized with a lock on the segment and readers are kept
+ * consistent with a seqlock. The generation number of the segment is bumped
+ * on every publish.
+ *
+ * Returns 1 on success OR 0 on error and sets the `spnotes_err` with the
+ * error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` is NULL.
+ * 'SPNOTES_ERR_NOT_FILLED' - The categories or the notes aren't filled yet.
+ * 'SPNOTES_ERR_MULTI_ROOT' - The instance has several roots.
+ * 'SPNOTES_ERR_SHM' - Couldn't create, resize or map the segment.
+ */
+SPNOTES_DEF int
+spnotes_shm_publish(const spnotes_t *instance, const char *name);
+
+/*
+ * Fills up the categories and the notes of the given `instance` from the
+ * segment `name` (the default one if NULL) published by
+ * 'spnotes_shm_publish()'. Everything is copied, use 'spnotes_shm_attach()'
+ * to only read the catalog.
+ *
+ * The catalog is used only if it was published for the same root location and
+ * neither the root directory nor the directories of the categories changed on
+ * the disk since (compared by their modification times). Notes edited in
+ * place with 'spnotes_note_set_title()' or 'spnotes_note_set_description()'
+ * outdate the default segment, the ones edited in place by other programs are
+ * seen on the next publish. Scan the notes as usual if this fails.
+ *
+ * Returns 1 on success OR 0 on error and sets the `spnotes_err` with the
+ * error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` is NULL.
+ * 'SPNOTES_ERR_REDECLARE' - The categories were already filled.
+ * 'SPNOTES_ERR_MULTI_ROOT' - The instance has several roots.
+ * 'SPNOTES_ERR_STALE' - The segment is missing, stale or being rewritten.
+ * 'SPNOTES_ERR_SHM' - Couldn't map the segment.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_shm_load(spnotes_t *instance, const char *name);
+
+/*
+ * Attaches `view` to the segment `name` (the default one if NULL) published by
+ * 'spnotes_shm_publish()' for the root location of the given `instance`,
+ * mapping it read only. Nothing is copied.
+ *
+ * The catalog is checked for freshness as by 'spnotes_shm_load()'. A publisher
+ * may rewrite it while it's being read: check whatever was read with
+ * 'spnotes_shm_validate()' before using it, and bound check the indexes read
+ * from the arrays against `categs_c` and `notes_c`.
+ *
+ * Returns 1 on success OR 0 on error and sets the `spnotes_err` with the
+ * error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance` or `view` is NULL.
+ * 'SPNOTES_ERR_MULTI_ROOT' - The instance has several roots.
+ * 'SPNOTES_ERR_STALE' - The segment is missing, stale or being rewritten.
+ * 'SPNOTES_ERR_SHM' - Couldn't map the segment.
+ */
+SPNOTES_DEF int
+spnotes_shm_attach(const spnotes_t *instance, const char *name,
+                   spnotes_shm_view *view);
+
+/*
+ * Returns the string at the offset `off` of the attached `view`, "" if there
+ * is no such string (`off` being 0 or out of the segment).
+ */
+SPNOTES_DEF const char *
+spnotes_shm_str(const spnotes_shm_view *view, uint64_t off);
+
+/*
+ * Returns 1 if the catalog of the attached `view` wasn't rewritten since
+ * 'spnotes_shm_attach()', everything read from it until now being consistent,
+ * OR 0 if it was (attach again).
+ */
+SPNOTES_DEF int
+spnotes_shm_validate(const spnotes_shm_view *view);
+
+/*
+ * Unmaps the segment of the attached `view`.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_shm_detach(spnotes_shm_view *view);
+
+/*
+ * Completes `prefix` with the titles of the categories, or of the notes of the
+ * category titled `categ` if it isn't NULL, straight from the segment `name`
+ * (the default one if NULL) published by 'spnotes_shm_publish()' for the root
+ * location of the given `instance`. Nothing but the titles found is copied:
+ * the catalog keeps the titles sorted, so they are found by binary search.
+ *
+ * The catalog is used if neither the root directory nor the directory of
+ * `categ` changed since it was published. Titles edited in place with
+ * 'spnotes_note_set_title()' outdate the default segment, the ones edited in
+ * place by other programs are seen on the next publish.
+ *
+ * Fills up `titles` with a dynamically allocated array of at most `max` (0 =
+ * no limit) dynamically allocated titles in ascending order. Free it with
+ * 'spnotes_shm_complete_free()'.
+ *
+ * Returns the number of titles found (0 if there is no category `categ`) OR
+ * -1 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_NULL_PTR' - `instance`, `prefix` or `titles` is NULL.
+ * 'SPNOTES_ERR_MULTI_ROOT' - The instance has several roots.
+ * 'SPNOTES_ERR_STALE' - The segment is missing, stale or being rewritten.
+ * 'SPNOTES_ERR_SHM' - Couldn't map the segment.
+ * 'SPNOTES_ERR_MALLOC' - Couldn't allocate required memory.
+ */
+SPNOTES_DEF int
+spnotes_shm_complete(const spnotes_t *instance, const char *name,
+                     const char *categ, const char *prefix, size_t max,
+                     char ***titles);
+
+/*
+ * Destructor for the titles found by 'spnotes_shm_complete()'.
+ *
+ * Completely safe to pass a NULL pointer.
+ */
+SPNOTES_DEF void
+spnotes_shm_complete_free(char **titles, size_t titles_c);
+
+/* = Memory = */
+
+/*
+ * Fills up `usage` with the bytes held by the given `instance`, per component.
+ * These are the bytes requested from the allocator, not counting its own
+ * overhead.
+ *
+ * To cap the memory of the fills set the 'memory_cap' of the instance to the
+ * maximum bytes its categories, notes and their strings may take (0 = no cap).
+ * A fill that would exceed it stops early, keeping what was filled, with the
+ * error 'SPNOTES_ERR_MEMORY_CAP'.
+ */
+SPNOTES_DEF void
+spnotes_memory_usage(const spnotes_t *instance, spnotes_memory *usage);
+
+/* = Trace = */
+
+/*
+ * Calls `func` with `user` around every fill of categories and notes, parse of
+ * a note header and sort. Pass NULL to stop tracing.
+ *
+ * The hook is process wide and may be called from several threads at once.
+ */
+SPNOTES_DEF void
+spnotes_trace_set(spnotes_trace_func func, void *user);
+
+/*
+ * Sends an event of the application itself (e.g. printing the notes) to the
+ * hook set with 'spnotes_trace_set()', if any.
+ */
+SPNOTES_DEF void
+spnotes_trace_emit(int phase, const char *name, const char *arg);
+
+/*
+ * Sets up a hook writing the trace events into the file `path` in the Chrome
+ * trace event format, viewable in Perfetto or chrome://tracing. Call
+ * 'spnotes_trace_json_close()' to finish the file.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ * The error can be:
+ * 'SPNOTES_ERR_OPEN' - The file couldn't be opened for writing.
+ */
+SPNOTES_DEF int
+spnotes_trace_json_open(const char *path);
+
+/* Finishes the file of 'spnotes_trace_json_open()' and stops tracing. */
+SPNOTES_DEF void
+spnotes_trace_json_close(void);
+
+/* = Errors = */
+
+/* Returns the string representation of the error in 'splnotes_err'. */
+SPNOTES_DEF char *
+spnotes_errorstr(void);
+
+/*
+ * Returns the error in 'spnotes_err' of the implementation, for the files
+ * other than the one with `SPNOTES_IMPL` (each file has its own copy).
+ */
+SPNOTES_DEF int
+spnotes_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPNOTES_H */
+
+/*
+ ===============================================================================
+ |                             IMPLEMENTATION MODE                             |
+ ===============================================================================
+ */
+
+#ifdef SPNOTES_IMPL
+
+/*
+ ===============================================================================
+ |                          Function Implementations                           |
+ ===============================================================================
+ */
+
+/* = Internal = */
+
+static void
+spnotes_indexes_free(spnotes_t *instance);
+
+static void
+spnotes_links_destroy(spnotes_links *links);
+
+static void
+spnotes_shm_outdate(const spnotes_t *instance);
+
+static int
+spnotes_notes_fill_err(spnotes_categ *categ, int *err);
+
+static uint32_t *
+spnotes_note_grams_set(const spnotes_note *note, size_t *grams_c);
+
+static void
+spnotes_note_reindex(spnotes_note *note, const uint32_t *old_grams,
+                     size_t old_grams_c, int is_title);
+
+/* nanoseconds on the monotonic clock */
+static uint64_t
+spnotes_clock_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/*
+ * Accounts `bytes` more to be held by `instance` (may be NULL).
+ *
+ * Returns 0 (accounting nothing) if that would exceed its 'memory_cap'.
+ */
+static int
+spnotes_memory_charge(spnotes_t *instance, size_t bytes)
+{
+	if (instance == NULL)
+		return 1;
+
+#ifdef SPNOTES_NO_THREADS
+	size_t charged = instance->memory_charged += bytes;
+#else
+	size_t charged = __atomic_add_fetch(&instance->memory_charged, bytes,
+	                                    __ATOMIC_RELAXED);
+#endif
+	if (instance->memory_cap == 0 || charged <= instance->memory_cap)
+		return 1;
+
+#ifdef SPNOTES_NO_THREADS
+	instance->memory_charged -= bytes;
+#else
+	__atomic_sub_fetch(&instance->memory_charged, bytes, __ATOMIC_RELAXED);
+#endif
+	return 0;
+}
+
+/* gives back `bytes` charged with 'spnotes_memory_charge()' */
+static void
+spnotes_memory_uncharge(spnotes_t *instance, size_t bytes)
+{
+	if (instance == NULL)
+		return;
+
+#ifdef SPNOTES_NO_THREADS
+	instance->memory_charged -= bytes;
+#else
+	__atomic_sub_fetch(&instance->memory_charged, bytes, __ATOMIC_RELAXED);
+#endif
+}
+
+/* FNV-1a */
+static uint64_t
+spnotes_hash_str(const char *str, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)str[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+#define SPNOTES_SWAR_ONES  0x0101010101010101ULL
+#define SPNOTES_SWAR_HIGHS 0x8080808080808080ULL
+
+/* lowercase of the 8 ASCII bytes of `w`, a SIMD within a register */
+static uint64_t
+spnotes_fold_ascii8(uint64_t w)
+{
+	uint64_t ge_a = w + SPNOTES_SWAR_ONES * (0x80 - 'A');
+	uint64_t gt_z = w + SPNOTES_SWAR_ONES * (0x7f - 'Z');
+	return w | ((ge_a & ~gt_z & SPNOTES_SWAR_HIGHS) >> 2);
+}
+
+/*
+ * Simple case folding of the Latin-1, Latin Extended-A, Greek and Cyrillic
+ * letters, and the full width ASCII forms of NFKC.
+ */
+static uint32_t
+spnotes_fold_cp(uint32_t cp)
+{
+	if (cp >= 0xc0 && cp <= 0xde && cp != 0xd7)
+		return cp + 0x20;
+	if (cp == 0x130) /* İ */
+		return 'i';
+	if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14a && cp <= 0x177))
+		return cp | 1;
+	if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17e))
+		return cp + (cp & 1);
+	if (cp == 0x178) /* Ÿ */
+		return 0xff;
+	if (cp == 0x17f) /* long s */
+		return 's';
+	if (cp >= 0x391 && cp <= 0x3ab && cp != 0x3a2)
+		return cp + 0x20;
+	if (cp == 0x3c2) /* final sigma */
+		return 0x3c3;
+	if (cp >= 0x400 && cp <= 0x40f)
+		return cp + 0x50;
+	if (cp >= 0x410 && cp <= 0x42f)
+		return cp + 0x20;
+	if (cp >= 0xff21 && cp <= 0xff3a)
+		return cp - 0xff21 + 'a';
+	if (cp >= 0xff01 && cp <= 0xff5e)
+		return cp - 0xff01 + '!';
+	return cp;
+}
+
+/* the folding to several characters (NFKC of the ligatures), if any */
+static const char *
+spnotes_fold_expand(uint32_t cp)
+{
+	switch (cp) {
+	case 0xdf: /* ß */
+	case 0x1e9e:
+		return "ss";
+	case 0xfb00:
+		return "ff";
+	case 0xfb01:
+		return "fi";
+	case 0xfb02:
+		return "fl";
+	case 0xfb03:
+		return "ffi";
+	case 0xfb04:
+		return "ffl";
+	}
+	return NULL;
+}
+
+/*
+ * Writes the case folded `src` into `dst` of `dst_size` bytes, so that titles
+ * differing only in case (or in the forms above) fold to the same string.
+ * Invalid UTF-8 is copied as is. The folding never makes a string longer.
+ */
+static void
+spnotes_fold_n(char *dst, size_t dst_size, const char *src)
+{
+	size_t      n   = 0;
+	const char *end = src + strlen(src);
+
+	while (src < end) {
+		/* ASCII fast path, 8 bytes at a time */
+		uint64_t w;
+		if (end - src >= 8 && n + 8 < dst_size) {
+			memcpy(&w, src, 8);
+			if ((w & SPNOTES_SWAR_HIGHS) == 0) {
+				w = spnotes_fold_ascii8(w);
+				memcpy(dst + n, &w, 8);
+				src += 8;
+				n += 8;
+				continue;
+			}
+		}
+
+		unsigned char c = *src;
+		if (c < 0x80) {
+			if (n + 1 >= dst_size)
+				break;
+			dst[n++] = c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+			src++;
+			continue;
+		}
+
+		/* decode a UTF-8 sequence */
+		int      len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+		uint32_t cp  = len == 1 ? c : c & (0x7f >> len);
+		for (int i = 1; i < len; i++) {
+			if ((src[i] & 0xc0) != 0x80) {
+				len = 1;
+				cp  = c;
+				break;
+			}
+			cp = cp << 6 | (src[i] & 0x3f);
+		}
+		src += len;
+		if (len == 1) { /* invalid */
+			if (n + 1 >= dst_size)
+				break;
+			dst[n++] = c;
+			continue;
+		}
+
+		const char *expand = spnotes_fold_expand(cp);
+		char        buf[4];
+		size_t      out_len;
+		if (expand) {
+			out_len = strlen(expand);
+		} else {
+			cp = spnotes_fold_cp(cp);
+			if (cp < 0x80) {
+				buf[0]  = cp;
+				out_len = 1;
+			} else if (cp < 0x800) {
+				buf[0]  = 0xc0 | cp >> 6;
+				buf[1]  = 0x80 | (cp & 0x3f);
+				out_len = 2;
+			} else if (cp < 0x10000) {
+				buf[0]  = 0xe0 | cp >> 12;
+				buf[1]  = 0x80 | (cp >> 6 & 0x3f);
+				buf[2]  = 0x80 | (cp & 0x3f);
+				out_len = 3;
+			} else {
+				buf[0]  = 0xf0 | cp >> 18;
+				buf[1]  = 0x80 | (cp >> 12 & 0x3f);
+				buf[2]  = 0x80 | (cp >> 6 & 0x3f);
+				buf[3]  = 0x80 | (cp & 0x3f);
+				out_len = 4;
+			}
+			expand = buf;
+		}
+		if (n + out_len >= dst_size)
+			break;
+		memcpy(dst + n, expand, out_len);
+		n += out_len;
+	}
+	dst[n] = '\0';
+}
+
+/* 'spnotes_fold_n()' into `dst` of NAME_MAX bytes, as for the titles */
+static void
+spnotes_fold(char *dst, const char *src)
+{
+	spnotes_fold_n(dst, NAME_MAX, src);
+}
+
+/* bytes of the dynamically allocated strings of `note` */
+static size_t
+spnotes_note_strings_size(const spnotes_note *note)
+{
+	size_t size = 0;
+
+	if (note->description)
+		size += strlen(note->description) + 1;
+	if (note->tags)
+		size += strlen(note->tags) + 1;
+	return size;
+}
+
+static spnotes_trace_func spnotes_trace_hook;
+static void              *spnotes_trace_user;
+
+#define SPNOTES_TRACE(phase, name, arg)                                 \
+	do {                                                            \
+		if (spnotes_trace_hook)                                 \
+			spnotes_trace_hook(phase, name, arg,            \
+			                   spnotes_trace_user);         \
+	} while (0)
+
+#ifdef SPNOTES_STATS
+#ifdef SPNOTES_NO_THREADS
+#define SPNOTES_STATS_ADD(instance, counter, n)       \
+	do {                                          \
+		if (instance)                         \
+			(instance)->stats.counter += (n); \
+	} while (0)
+#else
+#define SPNOTES_STATS_ADD(instance, counter, n)                      \
+	do {                                                         \
+		if (instance)                                        \
+			__atomic_fetch_add(&(instance)->stats.counter, \
+			                   (n), __ATOMIC_RELAXED);    \
+	} while (0)
+#endif
+#define SPNOTES_STATS_BEGIN(t) uint64_t t = spnotes_clock_ns()
+#define SPNOTES_STATS_END(instance, phase, t) \
+	SPNOTES_STATS_ADD(instance, phase, spnotes_clock_ns() - (t))
+#else
+#define SPNOTES_STATS_ADD(instance, counter, n) ((void)(instance))
+#define SPNOTES_STATS_BEGIN(t)
+#define SPNOTES_STATS_END(instance, phase, t) ((void)0)
+#endif
+
+#ifndef SPNOTES_NO_THREADS
+/* number of workers to use on parallel scans of `jobs_c` jobs */
+static size_t
+spnotes_threads_c(size_t jobs_c)
+{
+	long cpus = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (cpus < 1)
+		cpus = 1;
+	if (cpus > SPNOTES_MAX_THREADS)
+		cpus = SPNOTES_MAX_THREADS;
+	if ((size_t)cpus > jobs_c)
+		cpus = jobs_c;
+	return cpus < 1 ? 1 : (size_t)cpus;
+}
+#endif
+
+typedef struct {
+	size_t jobs_c;
+	size_t next; /* next job to be picked (atomic) */
+	void (*job_func)(size_t, void *);
+	void *arg;
+} spnotes_pfor;
+
+static void *
+spnotes_pfor_worker(void *pfor_ptr)
+{
+	spnotes_pfor *pfor = pfor_ptr;
+	size_t        i;
+
+#ifdef SPNOTES_NO_THREADS
+	while ((i = pfor->next++) < pfor->jobs_c)
+#else
+	while ((i = __atomic_fetch_add(&pfor->next, 1, __ATOMIC_RELAXED)) <
+	       pfor->jobs_c)
+#endif
+		pfor->job_func(i, pfor->arg);
+	return NULL;
+}
+
+/*
+ * Calls `job_func(i, arg)` for every `i` in [0, jobs_c) on a pool of workers
+ * (the calling thread being one of them) and returns when all are done.
+ *
+ * Falls back to fewer workers (down to just the calling thread) if threads
+ * cannot be created.
+ */
+static void
+spnotes_parallel_for(size_t jobs_c, void (*job_func)(size_t, void *),
+                     void *arg)
+{
+	spnotes_pfor pfor = { jobs_c, 0, job_func, arg };
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_t threads[SPNOTES_MAX_THREADS];
+	size_t    threads_c = 0, workers_c = spnotes_threads_c(jobs_c);
+
+	for (; threads_c < workers_c - 1; threads_c++)
+		if (pthread_create(&threads[threads_c], NULL,
+		                   spnotes_pfor_worker, &pfor) != 0)
+			break;
+	spnotes_pfor_worker(&pfor);
+	for (size_t i = 0; i < threads_c; i++)
+		pthread_join(threads[i], NULL);
+#else
+	spnotes_pfor_worker(&pfor);
+#endif
+}
+
+/*
+ * Reads the whole file at `path` (relative to the directory `dir_fd`, can be
+ * 'AT_FDCWD') into a NULL terminated buffer and fills `len` with its length.
+ *
+ * The buffer is `scratch` (of `scratch_c` bytes, can be NULL) if the file
+ * fits in it, which spares its stat, else dynamically allocated.
+ *
+ * Returns NULL on error with errno set.
+ */
+static char *
+spnotes_file_read_at(int dir_fd, const char *path, char *scratch,
+                     size_t scratch_c, size_t *len)
+{
+	int fd = openat(dir_fd, path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	size_t  cap = scratch ? scratch_c - 1 : 0, size = 0;
+	char   *buf = scratch;
+	ssize_t n;
+	do {
+		if (size == cap) {
+			/* room to see the end of the file without growing */
+			struct stat st;
+			size_t      more = cap * 2 + 4096;
+			if (buf == scratch && fstat(fd, &st) == 0 &&
+			    (size_t)st.st_size + 1 > more)
+				more = st.st_size + 1;
+
+			char *tmp = buf == scratch ? malloc(more + 1) :
+			                             realloc(buf, more + 1);
+			if (tmp == NULL)
+				goto fail;
+			if (buf == scratch && size > 0)
+				memcpy(tmp, scratch, size);
+			buf = tmp;
+			cap = more;
+		}
+		n = read(fd, buf + size, cap - size);
+		if (n == -1 && errno != EINTR)
+			goto fail;
+		if (n > 0)
+			size += n;
+	} while (n != 0);
+	close(fd);
+
+	buf[size] = '\0';
+	*len      = size;
+	return buf;
+
+fail:
+	if (buf != scratch)
+		free(buf);
+	close(fd);
+	return NULL;
+}
+
+static char *
+spnotes_file_read(const char *path, size_t *len)
+{
+	return spnotes_file_read_at(AT_FDCWD, path, NULL, 0, len);
+}
+
+/* memmem() replacement; memchr() is vectorized on most libc's */
+static const char *
+spnotes_memfind(const char *hay, size_t hay_len, const char *needle,
+                size_t needle_len)
+{
+	if (needle_len == 0)
+		return hay;
+
+	while (hay_len >= needle_len) {
+		const char *p = memchr(hay, needle[0], hay_len - needle_len + 1);
+		if (p == NULL)
+			return NULL;
+		if (!memcmp(p + 1, needle + 1, needle_len - 1))
+			return p;
+		hay_len -= p + 1 - hay;
+		hay = p + 1;
+	}
+	return NULL;
+}
+
+/*
+ * Returns the offset of the body (i.e. the line after the closing '---') of
+ * the note in `buf` and fills `line_no` with its line number. Returns 0 if the
+ * note doesn't start with a yaml-header.
+ */
+static size_t
+spnotes_body_offset(const char *buf, size_t len, size_t *line_no)
+{
+	*line_no = 1;
+	if (len < 4 || memcmp(buf, "---\n", 4))
+		return 0;
+
+	size_t pos = 4, line = 2;
+	while (pos < len) {
+		const char *eol = memchr(buf + pos, '\n', len - pos);
+		size_t      end = eol ? (size_t)(eol - buf) : len;
+
+		if (end - pos == 3 && !memcmp(buf + pos, "---", 3)) {
+			*line_no = line + 1;
+			return eol ? end + 1 : len;
+		}
+		pos = end + 1;
+		line++;
+	}
+	return 0;
+}
+
+/* open addressing table of the paths of note files, for the caches of them */
+typedef struct {
+	const char **paths;
+	size_t       paths_c;
+	size_t      *table; /* `path index + 1` */
+	size_t       table_c;
+} spnotes_path_table;
+
+/* Returns 0 if it couldn't allocate the memory for `max_c` paths. */
+static int
+spnotes_path_table_init(spnotes_path_table *pt, size_t max_c)
+{
+	pt->paths_c = 0;
+	pt->table_c = 16;
+	while (pt->table_c < max_c * 2)
+		pt->table_c *= 2;
+	pt->paths = malloc((max_c + 1) * sizeof(char *));
+	pt->table = calloc(pt->table_c, sizeof(size_t));
+	if (pt->paths == NULL || pt->table == NULL) {
+		free(pt->paths);
+		free(pt->table);
+		memset(pt, 0, sizeof(*pt));
+		return 0;
+	}
+	return 1;
+}
+
+static void
+spnotes_path_table_free(spnotes_path_table *pt)
+{
+	free(pt->paths);
+	free(pt->table);
+}
+
+/* adds `path` (kept, not copied) as the next index */
+static void
+spnotes_path_table_add(spnotes_path_table *pt, const char *path)
+{
+	size_t mask = pt->table_c - 1;
+	size_t slot = spnotes_hash_str(path, strlen(path)) & mask;
+	while (pt->table[slot])
+		slot = (slot + 1) & mask;
+	pt->table[slot]          = pt->paths_c + 1;
+	pt->paths[pt->paths_c++] = path;
+}
+
+/* Returns the index of `path` OR -1 if it isn't in the table. */
+static long
+spnotes_path_table_find(const spnotes_path_table *pt, const char *path)
+{
+	if (pt->paths_c == 0)
+		return -1;
+
+	size_t mask = pt->table_c - 1;
+	size_t slot = spnotes_hash_str(path, strlen(path)) & mask;
+	for (; pt->table[slot]; slot = (slot + 1) & mask)
+		if (!strcmp(pt->paths[pt->table[slot] - 1], path))
+			return pt->table[slot] - 1;
+	return -1;
+}
+
+/*
+ * Opens a temporary file next to the cache at `path` (its name written to
+ * `tmp_path` of 'PATH_MAX' bytes) to be renamed over it by
+ * 'spnotes_cache_commit()'.
+ *
+ * Returns NULL on error.
+ */
+static FILE *
+spnotes_cache_open(const char *path, char *tmp_path)
+{
+	if (snprintf(tmp_path, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX)
+		return NULL;
+
+	int   tmp_fd = mkstemp(tmp_path);
+	FILE *fp     = tmp_fd == -1 ? NULL : fdopen(tmp_fd, "w");
+	if (fp == NULL && tmp_fd != -1) {
+		close(tmp_fd);
+		unlink(tmp_path);
+	}
+	return fp;
+}
+
+/* closes `fp` of 'spnotes_cache_open()' and renames it over `path` */
+static void
+spnotes_cache_commit(FILE *fp, const char *tmp_path, const char *path)
+{
+	if (fclose(fp) != 0 || rename(tmp_path, path) != 0)
+		unlink(tmp_path);
+}
+
+/* = spnotes_t = */
+
+/* `root_location` ending with a '/', dynamically allocated */
+static char *
+spnotes_root_dup(const char *root_location)
+{
+	size_t len  = strlen(root_location);
+	char  *root = malloc(len + 2);
+	if (root == NULL)
+		return NULL;
+
+	memcpy(root, root_location, len + 1);
+	if (len == 0 || root[len - 1] != '/')
+		strcpy(root + len, "/");
+	return root;
+}
+
+SPNOTES_DEF int
+spnotes_init(spnotes_t *instance, const char *root_location)
+{
+	if (root_location == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	instance->root_location  = spnotes_root_dup(root_location);
+	instance->roots          = malloc(sizeof(char *));
+	instance->roots_c        = 1;
+	instance->categs         = NULL;
+	instance->categs_c       = 0;
+	instance->mcategs_c      = 0;
+	instance->notes_by_id    = NULL;
+	instance->notes_by_id_c  = 0;
+	instance->tags           = NULL;
+	instance->trigrams       = NULL;
+	instance->links          = NULL;
+	instance->memory_cap     = 0;
+	instance->memory_charged = 0;
+	instance->scan_order     = SPNOTES_SCAN_DIRENT;
+	instance->no_stat        = 0;
+#ifdef SPNOTES_STATS
+	memset(&instance->stats, 0, sizeof(instance->stats));
+#endif
+
+	/* safe to be passed to 'spnotes_free()' even then */
+	if (instance->root_location == NULL || instance->roots == NULL) {
+		free(instance->root_location);
+		free(instance->roots);
+		instance->root_location = NULL;
+		instance->roots         = NULL;
+		instance->roots_c       = 0;
+
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	instance->roots[0] = instance->root_location;
+
+	spnotes_err = SPNOTES_ERR_NONE;
+
+	return 1;
+}
+
+/* frees the categories and the notes, leaving the `instance` unfilled */
+static void
+spnotes_free_categs(spnotes_t *instance)
+{
+	for (size_t i = 0; i < instance->categs_c; i++) {
+		for (size_t j = 0; j < instance->categs[i].notes_c; j++) {
+			if (instance->categs[i].notes[j].has_description)
+				free(instance->categs[i].notes[j].description);
+			free(instance->categs[i].notes[j].tags);
+		}
+		free(instance->categs[i].notes);
+	}
+	free(instance->categs);
+	instance->categs         = NULL;
+	instance->categs_c       = 0;
+	instance->mcategs_c      = 0;
+	instance->memory_charged = 0;
+
+	spnotes_indexes_free(instance);
+}
+
+SPNOTES_DEF void
+spnotes_free(spnotes_t *instance)
+{
+	if (instance == NULL)
+		return;
+
+	spnotes_free_categs(instance);
+
+	for (size_t i = 1; i < instance->roots_c; i++)
+		free(instance->roots[i]);
+	free(instance->roots);
+	free(instance->root_location);
+}
+
+SPNOTES_DEF int
+spnotes_roots_add(spnotes_t *instance, const char *root_location)
+{
+	if (instance == NULL || root_location == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	char *root = spnotes_root_dup(root_location);
+	if (root == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	for (size_t i = 0; i < instance->roots_c; i++)
+		if (!strcmp(instance->roots[i], root)) {
+			free(root);
+			spnotes_err = SPNOTES_ERR_REDECLARE;
+			return 0;
+		}
+
+	char **roots = realloc(instance->roots,
+	                       (instance->roots_c + 1) * sizeof(char *));
+	if (roots == NULL) {
+		free(root);
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	roots[instance->roots_c++] = root;
+	instance->roots            = roots;
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_init_roots(spnotes_t *instance, const char *roots)
+{
+	if (roots == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	char *list = strdup(roots);
+	if (list == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+
+	int   ret = 1, inited = 0;
+	char *save_ptr;
+	for (char *root = strtok_r(list, ":", &save_ptr); ret && root;
+	     root       = strtok_r(NULL, ":", &save_ptr)) {
+		if (!inited) {
+			ret    = spnotes_init(instance, root);
+			inited = 1;
+		} else if (!spnotes_roots_add(instance, root) &&
+		           spnotes_err != SPNOTES_ERR_REDECLARE) {
+			ret = 0;
+		}
+	}
+	free(list);
+
+	if (!inited) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (ret)
+		spnotes_err = SPNOTES_ERR_NONE;
+	return ret;
+}
 
 /* = Category = */
 
-SPNOTES_DEF int
-spnotes_categs_fill(spnotes_t *instance)
+SPNOTES_DEF int
+spnotes_categs_fill(spnotes_t *instance)
+{
+	return spnotes_categs_fill_filter(instance, NULL, NULL);
+}
+
+/* categories found under one of the roots of the instance */
+typedef struct {
+	const char    *root;
+	spnotes_categ *categs;
+	size_t         categs_c, mcategs_c;
+	int            err; /* SPNOTES_ERR_NONE if the scan succeeded */
+} spnotes_root_scan;
+
+/* 'spnotes_categs_fill_filter()' of the root of `scan` */
+static void
+spnotes_categs_scan(spnotes_t *instance, spnotes_root_scan *scan,
+                    char *filter,
+                    int (*filter_func)(const char *, const char *))
+{
+	DIR *dir = opendir(scan->root);
+	if (dir == NULL) {
+		scan->err = SPNOTES_ERR_INVALID_LOC;
+		return;
+	}
+	SPNOTES_STATS_ADD(instance, dirs_scanned, 1);
+
+	size_t         categs_c = 0, mcategs_c = 128;
+	spnotes_categ *categs = NULL;
+	if (!spnotes_memory_charge(instance,
+	                           mcategs_c * sizeof(spnotes_categ))) {
+		scan->err = SPNOTES_ERR_MEMORY_CAP;
+		closedir(dir);
+		return;
+	}
+	categs = malloc(mcategs_c * sizeof(spnotes_categ));
+	SPNOTES_STATS_ADD(instance, allocs, 1);
+	if (categs == NULL) {
+		scan->err = SPNOTES_ERR_MALLOC;
+		closedir(dir);
+		return;
+	}
+
+	/* start reading the directory */
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		/* filter out files starting with "." */
+		if (dirent->d_name[0] == '.')
+			continue;
+		/* filter out non-dir */
+		if (dirent->d_type != DT_DIR)
+			continue;
+		/* filter with the `filter_func()` (if eligible) */
+		if (filter != NULL && filter_func != NULL &&
+		    filter_func(dirent->d_name, filter) <= 0)
+			continue;
+
+		/* check if the size of dynamic array has to be increased */
+		if (categs_c == mcategs_c - 1) {
+			if (!spnotes_memory_charge(
+				    instance, mcategs_c * sizeof(spnotes_categ))) {
+				scan->err = SPNOTES_ERR_MEMORY_CAP;
+				break;
+			}
+			spnotes_categ *temp_categs = realloc(
+				categs, mcategs_c * 2 * sizeof(spnotes_categ));
+			SPNOTES_STATS_ADD(instance, allocs, 1);
+			if (temp_categs == NULL) {
+				scan->err = SPNOTES_ERR_REALLOC;
+				break;
+			}
+			categs = temp_categs;
+			mcategs_c *= 2;
+		}
+		strcpy(categs[categs_c].title, dirent->d_name);
+		spnotes_fold(categs[categs_c].title_folded, dirent->d_name);
+		categs[categs_c].root             = scan->root;
+		categs[categs_c].notes            = NULL;
+		categs[categs_c].notes_c          = 0;
+		categs[categs_c].mnotes_c         = 0;
+		categs[categs_c].spnotes_instance = instance;
+
+		char path[PATH_MAX];
+		snprintf(path, PATH_MAX, "%s%s/", scan->root, dirent->d_name);
+		strcpy(categs[categs_c].path, path);
+
+		/* get the last modified date */
+		struct stat categ_stat;
+		SPNOTES_STATS_ADD(instance, stat_calls, 1);
+		if (stat(path, &categ_stat) != 0) {
+			scan->err = SPNOTES_ERR_FILE_STAT;
+			break;
+		}
+		categs[categs_c].last_modified = categ_stat.st_mtim;
+
+		categs_c++;
+	}
+	if (scan->err == SPNOTES_ERR_NONE && errno != 0)
+		scan->err = SPNOTES_ERR_DIR_READ;
+
+	closedir(dir);
+
+	scan->categs    = categs;
+	scan->categs_c  = categs_c;
+	scan->mcategs_c = mcategs_c;
+}
+
+/* = Roots = */
+
+typedef struct {
+	spnotes_t         *instance;
+	spnotes_root_scan *scans;   /* one per root */
+	dev_t             *devs;    /* device of each root */
+	size_t            *dev_ids; /* distinct devices, as an index on roots */
+	void (*scan_func)(spnotes_t *, spnotes_root_scan *, void *);
+	void *arg;
+} spnotes_roots_job;
+
+/* scans in order all the roots on the `i`th device */
+static void
+spnotes_roots_job_func(size_t i, void *arg)
+{
+	spnotes_roots_job *job = arg;
+	dev_t              dev = job->devs[job->dev_ids[i]];
+
+	for (size_t r = job->dev_ids[i]; r < job->instance->roots_c; r++)
+		if (job->devs[r] == dev)
+			job->scan_func(job->instance, &job->scans[r],
+			               job->arg);
+}
+
+/* frees the categories of `scans`, these not having notes yet */
+static void
+spnotes_roots_scans_free(spnotes_t *instance, spnotes_root_scan *scans)
+{
+	for (size_t r = 0; r < instance->roots_c; r++) {
+		if (scans[r].categs)
+			spnotes_memory_uncharge(instance, scans[r].mcategs_c *
+			                                          sizeof(spnotes_categ));
+		free(scans[r].categs);
+	}
+	free(scans);
+}
+
+/* root directory name of `root`, as in "archive" for "/mnt/archive/" */
+static void
+spnotes_root_basename(const char *root, char *name, size_t name_size)
+{
+	size_t len = strlen(root);
+	while (len > 1 && root[len - 1] == '/')
+		len--;
+	size_t begin = len;
+	while (begin > 0 && root[begin - 1] != '/')
+		begin--;
+	snprintf(name, name_size, "%.*s", (int)(len - begin), root + begin);
+}
+
+/* slot of `table` with the category titled `title` OR the free one for it */
+static size_t *
+spnotes_roots_slot(const spnotes_categ *categs, size_t *table, size_t mask,
+                   const char *title)
+{
+	size_t slot = spnotes_hash_str(title, strlen(title)) & mask;
+	while (table[slot] != SIZE_MAX &&
+	       strcmp(categs[table[slot]].title, title))
+		slot = (slot + 1) & mask;
+	return &table[slot];
+}
+
+/*
+ * Titles the merged category `c` with `title` and puts it in the `table` of the
+ * titles, appending "@" and `root_name` to its title, then "~2", "~3", ... as
+ * long as it's taken. Returns 1 if it had to be renamed.
+ */
+static int
+spnotes_roots_place(spnotes_categ *categs, size_t *table, size_t mask,
+                    size_t c, const char *title, const char *root_name)
+{
+	snprintf(categs[c].title, NAME_MAX, "%s", title);
+	spnotes_fold(categs[c].title_folded, categs[c].title);
+
+	size_t *slot = spnotes_roots_slot(categs, table, mask, title);
+	int     n    = 2;
+	for (; *slot != SIZE_MAX; n++) {
+		/* the suffix is kept whole on long titles */
+		char suffix[96];
+		if (n == 2)
+			snprintf(suffix, sizeof(suffix), "@%s", root_name);
+		else
+			snprintf(suffix, sizeof(suffix), "@%s~%d", root_name,
+			         n - 1);
+		snprintf(categs[c].title, NAME_MAX, "%.*s%s",
+		         (int)(NAME_MAX - 1 - strlen(suffix)), title, suffix);
+		spnotes_fold(categs[c].title_folded, categs[c].title);
+		slot = spnotes_roots_slot(categs, table, mask, categs[c].title);
+	}
+	*slot = c;
+	return n > 2;
+}
+
+/* a top category renamed on merging, see 'spnotes_roots_merge()' */
+typedef struct {
+	const char *title; /* in its root */
+	size_t      categ; /* index on the merged categories */
+} spnotes_root_rename;
+
+static int
+spnotes_root_rename_compare(const void *a, const void *b)
+{
+	return strcmp(((const spnotes_root_rename *)a)->title,
+	              ((const spnotes_root_rename *)b)->title);
+}
+
+/*
+ * Merges the categories of `scans` into the instance in the order of the
+ * roots. A top category titled like one of an earlier root gets "@" and the
+ * name of its root appended to its title ("c@archive"), and "~2", "~3", ...
+ * after that if it's still taken. The categories nested in it are renamed with
+ * it ("c@archive/posix"), so that they stay under it in the tree.
+ */
+static int
+spnotes_roots_merge(spnotes_t *instance, spnotes_root_scan *scans)
+{
+	size_t categs_c = 0;
+	for (size_t r = 0; r < instance->roots_c; r++)
+		categs_c += scans[r].categs_c;
+
+	size_t mask = 15;
+	while (mask < categs_c * 2)
+		mask = mask * 2 + 1;
+	size_t              *table   = malloc((mask + 1) * sizeof(size_t));
+	spnotes_root_rename *renames = malloc((categs_c + 1) *
+	                                      sizeof(spnotes_root_rename));
+	spnotes_categ       *categs  = NULL;
+	if (!spnotes_memory_charge(instance,
+	                           (categs_c + 1) * sizeof(spnotes_categ))) {
+		free(table);
+		free(renames);
+		spnotes_err = SPNOTES_ERR_MEMORY_CAP;
+		return -1;
+	}
+	categs = malloc((categs_c + 1) * sizeof(spnotes_categ));
+	SPNOTES_STATS_ADD(instance, allocs, 1);
+	if (table == NULL || renames == NULL || categs == NULL) {
+		spnotes_memory_uncharge(instance,
+		                        (categs_c + 1) * sizeof(spnotes_categ));
+		free(table);
+		free(renames);
+		free(categs);
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	for (size_t i = 0; i <= mask; i++)
+		table[i] = SIZE_MAX;
+
+	size_t c = 0;
+	for (size_t r = 0; r < instance->roots_c; r++) {
+		spnotes_root_scan *scan = &scans[r];
+		char               root_name[64];
+		spnotes_root_basename(scan->root, root_name, sizeof(root_name));
+
+		/* the top categories first, for the nested ones to follow */
+		size_t renames_c = 0;
+		for (size_t i = 0; i < scan->categs_c; i++) {
+			const char *title = scan->categs[i].title;
+			if (strchr(title, '/'))
+				continue;
+			categs[c] = scan->categs[i];
+			if (spnotes_roots_place(categs, table, mask, c, title,
+			                        root_name)) {
+				renames[renames_c].title   = title;
+				renames[renames_c++].categ = c;
+			}
+			c++;
+		}
+		qsort(renames, renames_c, sizeof(spnotes_root_rename),
+		      spnotes_root_rename_compare);
+
+		for (size_t i = 0; i < scan->categs_c; i++) {
+			const char *title = scan->categs[i].title;
+			const char *slash = strchr(title, '/');
+			if (slash == NULL)
+				continue;
+			categs[c] = scan->categs[i];
+
+			/* under the new title of its top category */
+			char top[NAME_MAX], renamed[NAME_MAX];
+			snprintf(top, NAME_MAX, "%.*s", (int)(slash - title),
+			         title);
+			spnotes_root_rename  key = { top, 0 };
+			spnotes_root_rename *found =
+				bsearch(&key, renames, renames_c,
+			                sizeof(spnotes_root_rename),
+			                spnotes_root_rename_compare);
+			if (found) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+				snprintf(renamed, NAME_MAX, "%s%s",
+				         categs[found->categ].title, slash);
+#pragma GCC diagnostic pop
+				title = renamed;
+			}
+			spnotes_roots_place(categs, table, mask, c++, title,
+			                    root_name);
+		}
+	}
+	free(table);
+	free(renames);
+
+	instance->categs    = categs;
+	instance->categs_c  = categs_c;
+	instance->mcategs_c = categs_c + 1;
+	return categs_c;
+}
+
+/*
+ * Fills the categories of the instance calling `scan_func` on each of its
+ * roots. The roots on different devices are scanned in parallel, the ones
+ * sharing a device one after the other so as not to make a disk seek back and
+ * forth between them.
+ */
+static int
+spnotes_roots_fill(spnotes_t *instance,
+                   void (*scan_func)(spnotes_t *, spnotes_root_scan *, void *),
+                   void *arg)
+{
+	if (instance->roots_c == 1) {
+		spnotes_root_scan scan = { instance->root_location, NULL, 0, 0,
+			                   SPNOTES_ERR_NONE };
+		scan_func(instance, &scan, arg);
+
+		/* even on error so that these get freed */
+		instance->categs    = scan.categs;
+		instance->categs_c  = scan.categs_c;
+		instance->mcategs_c = scan.mcategs_c;
+		if (scan.err != SPNOTES_ERR_NONE) {
+			spnotes_err = scan.err;
+			return -1;
+		}
+		return scan.categs_c;
+	}
+
+	spnotes_roots_job job = { instance, NULL, NULL, NULL, scan_func, arg };
+	job.scans   = calloc(instance->roots_c, sizeof(spnotes_root_scan));
+	job.devs    = malloc(instance->roots_c * sizeof(dev_t));
+	job.dev_ids = malloc(instance->roots_c * sizeof(size_t));
+	if (job.scans == NULL || job.devs == NULL || job.dev_ids == NULL) {
+		free(job.scans);
+		free(job.devs);
+		free(job.dev_ids);
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+
+	size_t devs_c = 0;
+	int    ret    = 0;
+	for (size_t r = 0; r < instance->roots_c; r++) {
+		struct stat st;
+		SPNOTES_STATS_ADD(instance, stat_calls, 1);
+		if (stat(instance->roots[r], &st) != 0) {
+			spnotes_err = SPNOTES_ERR_INVALID_LOC;
+			ret         = -1;
+			break;
+		}
+		job.scans[r].root = instance->roots[r];
+		job.scans[r].err  = SPNOTES_ERR_NONE;
+		job.devs[r]       = st.st_dev;
+
+		size_t d = 0;
+		while (d < devs_c && job.devs[job.dev_ids[d]] != st.st_dev)
+			d++;
+		if (d == devs_c)
+			job.dev_ids[devs_c++] = r;
+	}
+	if (ret == 0)
+		spnotes_parallel_for(devs_c, spnotes_roots_job_func, &job);
+
+	/* the error of the first root failing */
+	for (size_t r = 0; ret == 0 && r < instance->roots_c; r++)
+		if (job.scans[r].err != SPNOTES_ERR_NONE) {
+			spnotes_err = job.scans[r].err;
+			ret         = -1;
+		}
+	if (ret == 0)
+		ret = spnotes_roots_merge(instance, job.scans);
+
+	spnotes_roots_scans_free(instance, job.scans);
+	free(job.devs);
+	free(job.dev_ids);
+	return ret;
+}
+
+/* filter of 'spnotes_categs_fill_filter()' passed to the scans of the roots */
+typedef struct {
+	char *filter;
+	int (*filter_func)(const char *, const char *);
+} spnotes_categs_scan_filter;
+
+static void
+spnotes_categs_scan_root(spnotes_t *instance, spnotes_root_scan *scan,
+                         void *arg)
+{
+	spnotes_categs_scan_filter *filter = arg;
+
+	spnotes_categs_scan(instance, scan, filter->filter,
+	                    filter->filter_func);
+}
+
+SPNOTES_DEF int
+spnotes_categs_fill_filter(spnotes_t *instance, char *filter,
+                           int (*filter_func)(const char *, const char *))
+{
+	spnotes_categs_scan_filter scan_filter = { filter, filter_func };
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "categs_fill",
+	              instance->root_location);
+	SPNOTES_STATS_BEGIN(scan_begin);
+	int ret = spnotes_roots_fill(instance, spnotes_categs_scan_root,
+	                             &scan_filter);
+	SPNOTES_STATS_END(instance, scan_ns, scan_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "categs_fill", instance->root_location);
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_categs_compare_last_modified(const void *categ1, const void *categ2)
+{
+	struct timespec *tm1_ts = &(((spnotes_categ *)categ1)->last_modified);
+	struct timespec *tm2_ts = &(((spnotes_categ *)categ2)->last_modified);
+
+	if (tm1_ts->tv_sec == tm2_ts->tv_sec) {
+		if (tm1_ts->tv_nsec > tm2_ts->tv_nsec)
+			return -1;
+		else
+			return 1;
+	}
+
+	if (tm1_ts->tv_sec > tm2_ts->tv_sec)
+		return -1;
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_categs_compare_alphabetically(const void *categ1, const void *categ2)
+{
+	char *categ1_title = ((spnotes_categ *)categ1)->title;
+	char *categ2_title = ((spnotes_categ *)categ2)->title;
+
+	return strcmp(categ1_title, categ2_title);
+}
+
+/* points the notes back to their categories after these were moved around */
+static void
+spnotes_categs_relink(spnotes_t *instance)
+{
+	for (size_t i = 0; i < instance->categs_c; i++)
+		for (size_t j = 0; j < instance->categs[i].notes_c; j++)
+			instance->categs[i].notes[j].categ = instance->categs + i;
+}
+
+SPNOTES_DEF void
+spnotes_categs_sort_last_modified(spnotes_t *instance)
+{
+	if (instance == NULL || instance->categs == NULL)
+		return;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "categs_sort", NULL);
+	SPNOTES_STATS_BEGIN(sort_begin);
+	qsort(instance->categs, instance->categs_c, sizeof(spnotes_categ),
+	      spnotes_categs_compare_last_modified);
+	spnotes_categs_relink(instance);
+	SPNOTES_STATS_END(instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "categs_sort", NULL);
+}
+
+SPNOTES_DEF void
+spnotes_categs_sort_alphabetically(spnotes_t *instance)
+{
+	if (instance == NULL || instance->categs == NULL)
+		return;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "categs_sort", NULL);
+	SPNOTES_STATS_BEGIN(sort_begin);
+	qsort(instance->categs, instance->categs_c, sizeof(spnotes_categ),
+	      spnotes_categs_compare_alphabetically);
+	spnotes_categs_relink(instance);
+	SPNOTES_STATS_END(instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "categs_sort", NULL);
+}
+
+/* = Nested categories = */
+
+typedef struct {
+	spnotes_t  *instance;
+	const char *root;
+	char      **queue; /* paths relative to the root of directories to read */
+	size_t     queue_c, mqueue_c;
+	size_t     busy_c; /* workers reading a directory */
+	spnotes_categ *categs;
+	size_t         categs_c, mcategs_c;
+	int            err; /* first error, SPNOTES_ERR_NONE if none */
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+#endif
+} spnotes_walk;
+
+static void
+spnotes_walk_lock(spnotes_walk *walk)
+{
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_lock(&walk->lock);
+#else
+	(void)walk;
+#endif
+}
+
+static void
+spnotes_walk_unlock(spnotes_walk *walk)
+{
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_unlock(&walk->lock);
+#else
+	(void)walk;
+#endif
+}
+
+/* records the first error of the walk (`walk` locked) */
+static void
+spnotes_walk_fail(spnotes_walk *walk, int err)
+{
+	if (walk->err == SPNOTES_ERR_NONE)
+		walk->err = err;
+}
+
+/* queues the directory `rel` (taking its ownership) with `walk` locked */
+static int
+spnotes_walk_push(spnotes_walk *walk, char *rel)
+{
+	if (walk->queue_c == walk->mqueue_c) {
+		size_t mqueue_c = walk->mqueue_c ? walk->mqueue_c * 2 : 64;
+		char **queue    = realloc(walk->queue, mqueue_c * sizeof(char *));
+		if (queue == NULL) {
+			free(rel);
+			spnotes_walk_fail(walk, SPNOTES_ERR_REALLOC);
+			return 0;
+		}
+		walk->queue    = queue;
+		walk->mqueue_c = mqueue_c;
+	}
+	walk->queue[walk->queue_c++] = rel;
+	return 1;
+}
+
+/* adds the category of the directory `rel` with `walk` locked */
+static int
+spnotes_walk_add(spnotes_walk *walk, const char *rel,
+                 const struct timespec *last_modified)
+{
+	if (walk->categs_c == walk->mcategs_c) {
+		size_t mcategs_c = walk->mcategs_c * 2;
+		if (!spnotes_memory_charge(walk->instance,
+		                           walk->mcategs_c *
+		                                   sizeof(spnotes_categ))) {
+			spnotes_walk_fail(walk, SPNOTES_ERR_MEMORY_CAP);
+			return 0;
+		}
+		spnotes_categ *categs =
+			realloc(walk->categs, mcategs_c * sizeof(spnotes_categ));
+		SPNOTES_STATS_ADD(walk->instance, allocs, 1);
+		if (categs == NULL) {
+			spnotes_walk_fail(walk, SPNOTES_ERR_REALLOC);
+			return 0;
+		}
+		walk->categs    = categs;
+		walk->mcategs_c = mcategs_c;
+	}
+
+	spnotes_categ *categ = &walk->categs[walk->categs_c++];
+	strcpy(categ->title, rel);
+	spnotes_fold(categ->title_folded, rel);
+	snprintf(categ->path, PATH_MAX, "%s%s/", walk->root, rel);
+	categ->last_modified    = *last_modified;
+	categ->root             = walk->root;
+	categ->notes            = NULL;
+	categ->notes_c          = 0;
+	categ->mnotes_c         = 0;
+	categ->spnotes_instance = walk->instance;
+	return 1;
+}
+
+/* reads the directory `rel` ("" = the root) queueing its subdirectories */
+static void
+spnotes_walk_dir(spnotes_walk *walk, const char *rel)
+{
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s%s", walk->root, rel);
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		spnotes_walk_lock(walk);
+		spnotes_walk_fail(walk, rel[0] ? SPNOTES_ERR_DIR_READ :
+		                                 SPNOTES_ERR_INVALID_LOC);
+		spnotes_walk_unlock(walk);
+		return;
+	}
+	SPNOTES_STATS_ADD(walk->instance, dirs_scanned, 1);
+
+	/* subdirectories are collected first to take the lock only once */
+	size_t          subdirs_c = 0, msubdirs_c = 0;
+	char          **subdirs = NULL;
+	struct timespec *mtimes = NULL;
+	int             err     = SPNOTES_ERR_NONE;
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		/* filter out files starting with "." */
+		if (dirent->d_name[0] == '.')
+			continue;
+		if (dirent->d_type != DT_DIR && dirent->d_type != DT_UNKNOWN)
+			continue;
+
+		char child[PATH_MAX];
+		int  len = snprintf(child, PATH_MAX, "%s%s%s", rel,
+		                    rel[0] ? "/" : "", dirent->d_name);
+		/* has to fit in the title of the category */
+		if (len < 0 || len >= NAME_MAX)
+			continue;
+
+		struct stat st;
+		SPNOTES_STATS_ADD(walk->instance, stat_calls, 1);
+		if (fstatat(dirfd(dir), dirent->d_name, &st,
+		            AT_SYMLINK_NOFOLLOW) != 0) {
+			err = SPNOTES_ERR_FILE_STAT;
+			break;
+		}
+		if (!S_ISDIR(st.st_mode))
+			continue;
+
+		if (subdirs_c == msubdirs_c) {
+			msubdirs_c = msubdirs_c ? msubdirs_c * 2 : 16;
+			char           **tmp_subdirs =
+				realloc(subdirs, msubdirs_c * sizeof(char *));
+			if (tmp_subdirs)
+				subdirs = tmp_subdirs;
+			struct timespec *tmp_mtimes = realloc(
+				mtimes, msubdirs_c * sizeof(struct timespec));
+			if (tmp_mtimes)
+				mtimes = tmp_mtimes;
+			if (tmp_subdirs == NULL || tmp_mtimes == NULL) {
+				err = SPNOTES_ERR_REALLOC;
+				break;
+			}
+		}
+		subdirs[subdirs_c] = strdup(child);
+		if (subdirs[subdirs_c] == NULL) {
+			err = SPNOTES_ERR_MALLOC;
+			break;
+		}
+		mtimes[subdirs_c++] = st.st_mtim;
+	}
+	if (err == SPNOTES_ERR_NONE && errno != 0)
+		err = SPNOTES_ERR_DIR_READ;
+	closedir(dir);
+
+	spnotes_walk_lock(walk);
+	if (err != SPNOTES_ERR_NONE)
+		spnotes_walk_fail(walk, err);
+	size_t i = 0;
+	for (; i < subdirs_c && walk->err == SPNOTES_ERR_NONE; i++)
+		if (spnotes_walk_add(walk, subdirs[i], &mtimes[i]))
+			spnotes_walk_push(walk, subdirs[i]);
+		else
+			free(subdirs[i]);
+	for (; i < subdirs_c; i++)
+		free(subdirs[i]);
+	spnotes_walk_unlock(walk);
+
+	free(subdirs);
+	free(mtimes);
+}
+
+static void *
+spnotes_walk_worker(void *walk_ptr)
+{
+	spnotes_walk *walk = walk_ptr;
+
+	spnotes_walk_lock(walk);
+	for (;;) {
+		/* wait for directories while others may still find some */
+#ifndef SPNOTES_NO_THREADS
+		while (walk->queue_c == 0 && walk->busy_c > 0 &&
+		       walk->err == SPNOTES_ERR_NONE)
+			pthread_cond_wait(&walk->cond, &walk->lock);
+#endif
+		if (walk->queue_c == 0 || walk->err != SPNOTES_ERR_NONE)
+			break;
+
+		char *rel = walk->queue[--walk->queue_c];
+		walk->busy_c++;
+		spnotes_walk_unlock(walk);
+
+		spnotes_walk_dir(walk, rel);
+		free(rel);
+
+		spnotes_walk_lock(walk);
+		walk->busy_c--;
+#ifndef SPNOTES_NO_THREADS
+		pthread_cond_broadcast(&walk->cond);
+#endif
+	}
+#ifndef SPNOTES_NO_THREADS
+	pthread_cond_broadcast(&walk->cond);
+#endif
+	spnotes_walk_unlock(walk);
+	return NULL;
+}
+
+typedef struct {
+	spnotes_categ *categs;
+	int           *errs; /* error of each failed category, not shared */
+} spnotes_walk_notes;
+
+static void
+spnotes_walk_notes_job(size_t i, void *arg)
+{
+	spnotes_walk_notes *job = arg;
+
+	spnotes_notes_fill_err(&job->categs[i], &job->errs[i]);
+}
+
+/* walks the tree under the root of `scan` */
+static void
+spnotes_walk_root(spnotes_t *instance, spnotes_root_scan *scan, void *arg)
+{
+	(void)arg;
+
+	spnotes_walk walk = { 0 };
+	walk.instance     = instance;
+	walk.root         = scan->root;
+	walk.err          = SPNOTES_ERR_NONE;
+	walk.mcategs_c    = 128;
+	if (!spnotes_memory_charge(instance,
+	                           walk.mcategs_c * sizeof(spnotes_categ))) {
+		scan->err = SPNOTES_ERR_MEMORY_CAP;
+		return;
+	}
+	walk.categs = malloc(walk.mcategs_c * sizeof(spnotes_categ));
+	SPNOTES_STATS_ADD(instance, allocs, 1);
+	char *root = strdup("");
+	if (walk.categs == NULL || root == NULL ||
+	    !spnotes_walk_push(&walk, root)) {
+		spnotes_memory_uncharge(instance,
+		                        walk.mcategs_c * sizeof(spnotes_categ));
+		free(walk.categs);
+		free(walk.queue);
+		scan->err = SPNOTES_ERR_MALLOC;
+		return;
+	}
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_init(&walk.lock, NULL);
+	pthread_cond_init(&walk.cond, NULL);
+
+	pthread_t threads[SPNOTES_MAX_THREADS];
+	size_t    threads_c = 0, workers_c = spnotes_threads_c(SIZE_MAX);
+	for (; threads_c < workers_c - 1; threads_c++)
+		if (pthread_create(&threads[threads_c], NULL,
+		                   spnotes_walk_worker, &walk) != 0)
+			break;
+	spnotes_walk_worker(&walk);
+	for (size_t i = 0; i < threads_c; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&walk.cond);
+	pthread_mutex_destroy(&walk.lock);
+#else
+	spnotes_walk_worker(&walk);
+#endif
+	for (size_t i = 0; i < walk.queue_c; i++) /* left by an error */
+		free(walk.queue[i]);
+	free(walk.queue);
+
+	scan->categs    = walk.categs;
+	scan->categs_c  = walk.categs_c;
+	scan->mcategs_c = walk.mcategs_c;
+	scan->err       = walk.err;
+}
+
+SPNOTES_DEF int
+spnotes_categs_fill_nested(spnotes_t *instance, int flags)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "categs_fill",
+	              instance->root_location);
+	SPNOTES_STATS_BEGIN(scan_begin);
+	int categs_c = spnotes_roots_fill(instance, spnotes_walk_root, NULL);
+	SPNOTES_STATS_END(instance, scan_ns, scan_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "categs_fill",
+	              instance->root_location);
+	if (categs_c < 0)
+		return -1;
+
+	/* the notes of all the categories, now that these don't move */
+	if (flags & SPNOTES_FILL_NOTES) {
+		spnotes_walk_notes job = {
+			instance->categs,
+			calloc(instance->categs_c + 1, sizeof(int))
+		};
+		if (job.errs == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			return -1;
+		}
+		spnotes_parallel_for(instance->categs_c,
+		                     spnotes_walk_notes_job, &job);
+		for (size_t i = 0; i < instance->categs_c; i++)
+			if (job.errs[i] != SPNOTES_ERR_NONE) {
+				spnotes_err = job.errs[i];
+				free(job.errs);
+				return -1;
+			}
+		free(job.errs);
+	}
+
+	return categs_c;
+}
+
+/* a category keyed by its title, to look the parents up */
+typedef struct {
+	const char *title;
+	size_t      categ; /* index on the categories */
+} spnotes_tree_title;
+
+/*
+ * A category keyed by its path in the tree: the positions before sorting of
+ * its ancestors from the top one down, then its own.
+ */
+typedef struct {
+	const size_t *ranks;
+	size_t        ranks_c;
+	size_t        categ; /* index on the categories */
+} spnotes_tree_key;
+
+static int
+spnotes_tree_title_compare(const void *a, const void *b)
+{
+	return strcmp(((const spnotes_tree_title *)a)->title,
+	              ((const spnotes_tree_title *)b)->title);
+}
+
+/* parents first, siblings in the order they had */
+static int
+spnotes_tree_key_compare(const void *a, const void *b)
+{
+	const spnotes_tree_key *x = a, *y = b;
+
+	for (size_t i = 0; i < x->ranks_c && i < y->ranks_c; i++)
+		if (x->ranks[i] != y->ranks[i])
+			return x->ranks[i] < y->ranks[i] ? -1 : 1;
+	return (x->ranks_c > y->ranks_c) - (x->ranks_c < y->ranks_c);
+}
+
+/*
+ * Index of the parent category of the one titled `title` in the `categs_c`
+ * categories sorted `by_title` OR SIZE_MAX if it's a top one.
+ */
+static size_t
+spnotes_categs_parent(const spnotes_tree_title *by_title, size_t categs_c,
+                      const char *title)
+{
+	const char *slash = strrchr(title, '/');
+	if (slash == NULL)
+		return SIZE_MAX;
+
+	size_t len = slash - title, low = 0, high = categs_c;
+	while (low < high) {
+		size_t      mid = low + (high - low) / 2;
+		const char *t   = by_title[mid].title;
+		int         cmp = strncmp(t, title, len);
+		if (cmp == 0)
+			cmp = t[len] == '\0' ? 0 : 1;
+		if (cmp == 0)
+			return by_title[mid].categ;
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return SIZE_MAX;
+}
+
+SPNOTES_DEF void
+spnotes_categs_sort_tree(spnotes_t *instance)
+{
+	if (instance == NULL || instance->categs == NULL)
+		return;
+
+	size_t              categs_c = instance->categs_c;
+	spnotes_tree_title *by_title =
+		malloc((categs_c + 1) * sizeof(spnotes_tree_title));
+	spnotes_tree_key   *keys    = malloc((categs_c + 1) * sizeof(*keys));
+	size_t             *parents = malloc((categs_c + 1) * sizeof(size_t));
+	size_t             *ranks   = NULL;
+	spnotes_categ      *sorted =
+		malloc((categs_c + 1) * sizeof(spnotes_categ));
+	if (by_title == NULL || keys == NULL || parents == NULL ||
+	    sorted == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "categs_sort", NULL);
+	SPNOTES_STATS_BEGIN(sort_begin);
+
+	/* parents are looked up by title */
+	for (size_t i = 0; i < categs_c; i++) {
+		by_title[i].title = instance->categs[i].title;
+		by_title[i].categ = i;
+	}
+	qsort(by_title, categs_c, sizeof(spnotes_tree_title),
+	      spnotes_tree_title_compare);
+	size_t ranks_c = 0;
+	for (size_t i = 0; i < categs_c; i++)
+		parents[i] = spnotes_categs_parent(by_title, categs_c,
+		                                   instance->categs[i].title);
+	for (size_t i = 0; i < categs_c; i++) {
+		keys[i].ranks_c = 1;
+		for (size_t p = parents[i]; p != SIZE_MAX; p = parents[p])
+			keys[i].ranks_c++;
+		ranks_c += keys[i].ranks_c;
+	}
+
+	ranks = malloc((ranks_c + 1) * sizeof(size_t));
+	if (ranks == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto end_sort;
+	}
+	for (size_t i = 0, k = 0; i < categs_c; i++) {
+		size_t j = keys[i].ranks_c;
+		for (size_t p = i; p != SIZE_MAX; p = parents[p])
+			ranks[k + --j] = p;
+		keys[i].ranks = ranks + k;
+		keys[i].categ = i;
+		k += keys[i].ranks_c;
+	}
+	qsort(keys, categs_c, sizeof(spnotes_tree_key),
+	      spnotes_tree_key_compare);
+
+	for (size_t i = 0; i < categs_c; i++)
+		sorted[i] = instance->categs[keys[i].categ];
+	memcpy(instance->categs, sorted, categs_c * sizeof(spnotes_categ));
+	spnotes_categs_relink(instance);
+
+end_sort:
+	SPNOTES_STATS_END(instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "categs_sort", NULL);
+end:
+	free(by_title);
+	free(keys);
+	free(parents);
+	free(ranks);
+	free(sorted);
+}
+
+SPNOTES_DEF spnotes_categ *
+spnotes_categs_search(spnotes_t instance, const char *title)
+{
+	if (!(instance.categs)) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return NULL;
+	}
+
+	for (size_t i = 0; i < instance.categs_c; i++) {
+		if (!strcmp(instance.categs[i].title, title))
+			return (instance.categs + i);
+	}
+	return NULL;
+}
+
+/* whether `title` (folded if `flags` has 'SPNOTES_SEARCH_ICASE') matches */
+static int
+spnotes_title_matches(const char *title, const char *query, size_t query_len,
+                      int flags)
+{
+	if (flags & SPNOTES_SEARCH_SUBSTR)
+		return strstr(title, query) != NULL;
+	if (flags & SPNOTES_SEARCH_PREFIX)
+		return !strncmp(title, query, query_len);
+	return !strcmp(title, query);
+}
+
+SPNOTES_DEF spnotes_categ *
+spnotes_categs_search_ex(spnotes_t *instance, const char *title, int flags)
+{
+	if (instance == NULL || title == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return NULL;
+	}
+	if (!(instance->categs)) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return NULL;
+	}
+
+	char query[NAME_MAX];
+	if (flags & SPNOTES_SEARCH_ICASE)
+		spnotes_fold(query, title);
+	else
+		snprintf(query, NAME_MAX, "%s", title);
+	size_t query_len = strlen(query);
+
+	for (size_t i = 0; i < instance->categs_c; i++) {
+		spnotes_categ *categ = &instance->categs[i];
+		if (spnotes_title_matches(flags & SPNOTES_SEARCH_ICASE ?
+		                                  categ->title_folded :
+		                                  categ->title,
+		                          query, query_len, flags))
+			return categ;
+	}
+	return NULL;
+}
+
+SPNOTES_DEF int
+spnotes_categs_add(spnotes_t instance, const char *title, char *new_loc)
+{
+	if (spnotes_categs_search(instance, title)) {
+		spnotes_err = SPNOTES_ERR_REDECLARE;
+		return 0;
+	}
+
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s%s", instance.root_location, title);
+
+	if (mkdir(path, 0777) != 0) {
+		spnotes_err = SPNOTES_ERR_MKDIR;
+		return 0;
+	}
+
+	if (new_loc)
+		strcpy(new_loc, path);
+
+	return 1;
+}
+
+/* = Note = */
+
+/* normalizes the value of 'tags:' ("[a, b]", "a b", ...) to "a,b" */
+static char *
+spnotes_tags_normalize(const char *value)
+{
+	char *tags = malloc(strlen(value) + 1), *p = tags;
+	if (tags == NULL)
+		return NULL;
+
+	while (*value) {
+		size_t len = strcspn(value, ", \t\r\n[]\"'");
+		if (len == 0) {
+			value++;
+			continue;
+		}
+		if (p != tags)
+			*p++ = ',';
+		memcpy(p, value, len);
+		p += len;
+		value += len;
+	}
+	*p = '\0';
+
+	if (p == tags) {
+		free(tags);
+		return NULL;
+	}
+	return tags;
+}
+
+/*
+ * Parses the header `line` (as given by 'fgets()') into `note`, `found` being
+ * 1 once a title is found and 2 with a description too.
+ */
+static void
+spnotes_note_parse_line(spnotes_note *note, char *line, int *found,
+                        spnotes_t *instance)
+{
+	char *tmp_ptr;
+	(void)instance; /* only for the stats */
+
+	/* parse title */
+	if ((strstr(line, "title:")) == line) { /* if ^title: */
+		tmp_ptr = strchr(line, ':') + 1;
+
+		while (*tmp_ptr == ' ') /* point to the 1st nonspace */
+			tmp_ptr++;
+
+		size_t len = strcspn(tmp_ptr, "\n");
+		if (len > 0) {
+			if (len >= NAME_MAX)
+				len = NAME_MAX - 1;
+			memcpy(note->title, tmp_ptr, len);
+			note->title[len] = '\0';
+			*found           = 1;
+		}
+		return;
+	}
+
+	/* parse tags */
+	if ((strstr(line, "tags:")) == line) {
+		free(note->tags);
+		note->tags = spnotes_tags_normalize(strchr(line, ':') + 1);
+		SPNOTES_STATS_ADD(instance, allocs, 1);
+		return;
+	}
+
+	/* parse description (only if title was found before) */
+	if (*found != 1)
+		return;
+
+	if ((strstr(line, "description:")) == line) {
+		tmp_ptr = strchr(line, ':') + 1;
+
+		while (*tmp_ptr == ' ') /* point to the 1st nonspace */
+			tmp_ptr++;
+
+		if (strcmp(tmp_ptr, "\n")) {
+			note->description =
+				strndup(tmp_ptr, strcspn(tmp_ptr, "\n"));
+			SPNOTES_STATS_ADD(instance, allocs, 1);
+			*found = 2;
+		}
+	}
+}
+
+/* finishes `note` once its whole header is parsed, returning `found` */
+static int
+spnotes_note_parse_end(spnotes_note *note, int found)
+{
+	note->has_description = (found == 2);
+	if (found < 1) {
+		free(note->tags);
+		note->tags = NULL;
+	} else {
+		spnotes_fold(note->title_folded, note->title);
+	}
+	return found;
+}
+
+/* 'spnotes_note_parse_fd()' without the trace events */
+static int
+spnotes_note_parse_header(spnotes_note *note, char *md_loc, int fd,
+                          spnotes_t *instance)
+{
+	int ret = 0;
+
+	note->description     = NULL;
+	note->has_description = 0;
+	note->tags            = NULL;
+
+	FILE *fp = fd >= 0 ? fdopen(fd, "r") : fopen(md_loc, "r");
+	if (fp == NULL) {
+		if (fd >= 0)
+			close(fd);
+		return ret;
+	}
+	SPNOTES_STATS_ADD(instance, files_opened, fd < 0);
+
+	errno = 0;
+
+	/* main logic */
+	char buffer[4098];
+	if (fgets(buffer, sizeof(buffer), fp) == NULL)
+		buffer[0] = '\0';
+	SPNOTES_STATS_ADD(instance, bytes_read, strlen(buffer));
+
+	/* continue only if the first line is a starting yaml header */
+	if (strcmp(buffer, "---\n")) {
+		fclose(fp);
+		return ret;
+	}
+
+	while ((fgets(buffer, sizeof(buffer), fp)) != NULL) {
+		SPNOTES_STATS_ADD(instance, bytes_read, strlen(buffer));
+
+		/* stop when we encounter the ending yaml header */
+		if (!strcmp(buffer, "---\n"))
+			break;
+		spnotes_note_parse_line(note, buffer, &ret, instance);
+	}
+	if (errno != 0) { /* fgets return NULL on error too */
+		free(note->description);
+		free(note->tags);
+		fclose(fp);
+		return -1;
+	}
+
+	fclose(fp);
+	return spnotes_note_parse_end(note, ret);
+}
+
+/*
+ * 'spnotes_note_parse_header()' of a note file already read whole into `buf`
+ * of `len` bytes, the lines being cut as 'fgets()' would.
+ */
+static int
+spnotes_note_parse_buf(spnotes_note *note, const char *buf, size_t len,
+                       spnotes_t *instance)
+{
+	int    ret = 0;
+	char   line[4098];
+	size_t pos = 0;
+
+	note->description     = NULL;
+	note->has_description = 0;
+	note->tags            = NULL;
+
+	for (int first = 1; pos < len; first = 0) {
+		size_t n = len - pos;
+		if (n > sizeof(line) - 1)
+			n = sizeof(line) - 1;
+		const char *eol = memchr(buf + pos, '\n', n);
+		if (eol)
+			n = eol - (buf + pos) + 1;
+		memcpy(line, buf + pos, n);
+		line[n] = '\0';
+		pos += n;
+
+		/* between the starting and the ending yaml header */
+		if (first && strcmp(line, "---\n"))
+			return ret;
+		if (first)
+			continue;
+		if (!strcmp(line, "---\n"))
+			break;
+		spnotes_note_parse_line(note, line, &ret, instance);
+	}
+	return spnotes_note_parse_end(note, ret);
+}
+
+/*
+ * 'spnotes_note_parse()' of the file at `md_loc` already opened as `fd`, which
+ * is closed. A negative `fd` opens `md_loc`.
+ */
+static int
+spnotes_note_parse_fd(spnotes_note *note, char *md_loc, int fd,
+                      spnotes_t *instance)
+{
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "note_parse", md_loc);
+	int ret = spnotes_note_parse_header(note, md_loc, fd, instance);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "note_parse", md_loc);
+	return ret;
+}
+
+/* 'spnotes_note_fill_title_desc()' accounting into the stats of `instance` */
+static int
+spnotes_note_parse(spnotes_note *note, char *md_loc, spnotes_t *instance)
+{
+	return spnotes_note_parse_fd(note, md_loc, -1, instance);
+}
+
+SPNOTES_DEF int
+spnotes_note_fill_title_desc(spnotes_note *note, char *md_loc)
+{
+	int ret = spnotes_note_parse(note, md_loc, NULL);
+	if (ret < 0)
+		spnotes_err = SPNOTES_ERR_FILE_READ;
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_notes_fill(spnotes_categ *categ)
+{
+	return spnotes_notes_fill_filter(categ, NULL, NULL);
+}
+
+/* a note file of a directory, see 'spnotes_scan_collect()' */
+typedef struct {
+	uint64_t key;  /* inode number or physical offset */
+	size_t   name; /* offset on 'names' */
+} spnotes_scan_entry;
+
+/* the note files of a directory in the 'scan_order' of the instance */
+typedef struct {
+	DIR                *dir;
+	spnotes_t          *instance;
+	spnotes_scan_entry *entries; /* NULL = In the order of 'readdir()' */
+	size_t              entries_c, next, ahead;
+	char               *names;
+	size_t              names_len;
+	int                 fds[SPNOTES_SCAN_AHEAD]; /* of the entries ahead */
+	int                 fd; /* of the last entry, -1 if taken */
+} spnotes_scan;
+
+/* whether `dirent` is to be parsed as a note */
+static int
+spnotes_scan_is_note(const struct dirent *dirent)
+{
+	/* filter out files starting with ".", directories and non-md files */
+	if (dirent->d_name[0] == '.' || dirent->d_type == DT_DIR)
+		return 0;
+	return strstr(dirent->d_name, ".md") || strstr(dirent->d_name, ".MD");
+}
+
+static int
+spnotes_scan_entry_compare(const void *a, const void *b)
+{
+	const spnotes_scan_entry *x = a, *y = b;
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	return (x->name > y->name) - (x->name < y->name);
+}
+
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+/*
+ * Keys the entries of `scan`, sorted by inode number, by the physical offset
+ * of the first extent of their files.
+ *
+ * Returns 0 (leaving the keys) if the filesystem doesn't tell the offsets.
+ */
+static int
+spnotes_scan_extents(spnotes_scan *scan)
+{
+	uint64_t buf[(sizeof(struct fiemap) + sizeof(struct fiemap_extent)) /
+	                     sizeof(uint64_t) +
+	             1];
+	struct fiemap *map = (struct fiemap *)buf;
+	uint64_t      *offsets =
+		malloc((scan->entries_c + 1) * sizeof(uint64_t));
+	if (offsets == NULL)
+		return 0;
+
+	for (size_t i = 0; i < scan->entries_c; i++) {
+		int fd = openat(dirfd(scan->dir),
+		                scan->names + scan->entries[i].name, O_RDONLY);
+		if (fd < 0) {
+			free(offsets);
+			return 0;
+		}
+		SPNOTES_STATS_ADD(scan->instance, files_opened, 1);
+
+		memset(buf, 0, sizeof(buf));
+		map->fm_length       = FIEMAP_MAX_OFFSET;
+		map->fm_extent_count = 1;
+		int ret              = ioctl(fd, FS_IOC_FIEMAP, map);
+		close(fd);
+		if (ret != 0) {
+			free(offsets);
+			return 0;
+		}
+		/* empty files have no extents */
+		offsets[i] = map->fm_mapped_extents ?
+		                     map->fm_extents[0].fe_physical :
+		                     0;
+	}
+
+	for (size_t i = 0; i < scan->entries_c; i++)
+		scan->entries[i].key = offsets[i];
+	free(offsets);
+	return 1;
+}
+#endif
+
+/*
+ * Reads the note files of the directory of `scan` up front and sorts them by
+ * `order`.
+ *
+ * Returns 'SPNOTES_ERR_NONE' OR the error.
+ */
+static int
+spnotes_scan_collect(spnotes_scan *scan, int order)
+{
+	size_t mentries_c = 128, mnames_len = 4096;
+	scan->entries     = malloc(mentries_c * sizeof(spnotes_scan_entry));
+	scan->names       = malloc(mnames_len);
+	if (scan->entries == NULL || scan->names == NULL)
+		return SPNOTES_ERR_MALLOC;
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(scan->dir))) {
+		if (!spnotes_scan_is_note(dirent))
+			continue;
+
+		size_t len = strlen(dirent->d_name) + 1;
+		if (scan->entries_c == mentries_c) {
+			spnotes_scan_entry *tmp = realloc(
+				scan->entries,
+				mentries_c * 2 * sizeof(spnotes_scan_entry));
+			if (tmp == NULL)
+				return SPNOTES_ERR_REALLOC;
+			scan->entries = tmp;
+			mentries_c *= 2;
+		}
+		if (scan->names_len + len > mnames_len) {
+			while (scan->names_len + len > mnames_len)
+				mnames_len *= 2;
+			char *tmp = realloc(scan->names, mnames_len);
+			if (tmp == NULL)
+				return SPNOTES_ERR_REALLOC;
+			scan->names = tmp;
+		}
+
+		scan->entries[scan->entries_c].key  = dirent->d_ino;
+		scan->entries[scan->entries_c].name = scan->names_len;
+		scan->entries_c++;
+		memcpy(scan->names + scan->names_len, dirent->d_name, len);
+		scan->names_len += len;
+	}
+	if (errno != 0)
+		return SPNOTES_ERR_DIR_READ;
+
+	qsort(scan->entries, scan->entries_c, sizeof(spnotes_scan_entry),
+	      spnotes_scan_entry_compare);
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+	if (order == SPNOTES_SCAN_EXTENT && spnotes_scan_extents(scan))
+		qsort(scan->entries, scan->entries_c,
+		      sizeof(spnotes_scan_entry), spnotes_scan_entry_compare);
+#else
+	(void)order;
+#endif
+	return SPNOTES_ERR_NONE;
+}
+
+/* frees `scan` and closes its directory and the files it opened */
+static void
+spnotes_scan_close(spnotes_scan *scan)
+{
+	for (size_t i = scan->next; i < scan->ahead; i++)
+		if (scan->fds[i % SPNOTES_SCAN_AHEAD] >= 0)
+			close(scan->fds[i % SPNOTES_SCAN_AHEAD]);
+	if (scan->fd >= 0)
+		close(scan->fd);
+	free(scan->entries);
+	free(scan->names);
+	closedir(scan->dir);
+}
+
+/*
+ * Starts a scan of the note files of `dir` in the 'scan_order' of `instance`
+ * (may be NULL), taking it over.
+ *
+ * Returns 'SPNOTES_ERR_NONE' OR the error, `dir` being closed then.
+ */
+static int
+spnotes_scan_open(spnotes_scan *scan, DIR *dir, spnotes_t *instance)
+{
+	int order = instance ? instance->scan_order : SPNOTES_SCAN_DIRENT;
+
+	memset(scan, 0, sizeof(*scan));
+	scan->dir      = dir;
+	scan->instance = instance;
+	scan->fd       = -1;
+	if (order == SPNOTES_SCAN_DIRENT)
+		return SPNOTES_ERR_NONE;
+
+	int err = spnotes_scan_collect(scan, order);
+	if (err != SPNOTES_ERR_NONE)
+		spnotes_scan_close(scan);
+	return err;
+}
+
+/*
+ * Returns the name of the next note file of `scan` OR NULL at the end (with
+ * `errno` set if the directory couldn't be read). The file is opened as 'fd'
+ * of `scan` if it's sorted, the next ones having been hinted to be read.
+ */
+static const char *
+spnotes_scan_next(spnotes_scan *scan)
+{
+	if (scan->fd >= 0) {
+		close(scan->fd);
+		scan->fd = -1;
+	}
+
+	if (scan->entries == NULL) {
+		struct dirent *dirent;
+		while ((dirent = readdir(scan->dir)))
+			if (spnotes_scan_is_note(dirent))
+				return dirent->d_name;
+		return NULL;
+	}
+
+	if (scan->next == scan->entries_c) {
+		errno = 0;
+		return NULL;
+	}
+	/* ask for the headers of the next files while this one is parsed */
+	while (scan->ahead < scan->entries_c &&
+	       scan->ahead < scan->next + SPNOTES_SCAN_AHEAD) {
+		const char *name =
+			scan->names + scan->entries[scan->ahead].name;
+		int fd = openat(dirfd(scan->dir), name, O_RDONLY);
+		SPNOTES_STATS_ADD(scan->instance, files_opened, fd >= 0);
+#ifdef POSIX_FADV_WILLNEED
+		if (fd >= 0)
+			posix_fadvise(fd, 0, SPNOTES_SCAN_HINT,
+			              POSIX_FADV_WILLNEED);
+#endif
+		scan->fds[scan->ahead++ % SPNOTES_SCAN_AHEAD] = fd;
+	}
+
+	scan->fd = scan->fds[scan->next % SPNOTES_SCAN_AHEAD];
+	return scan->names + scan->entries[scan->next++].name;
+}
+
+/*
+ * Parses the time out of the note file `name` if it's named
+ * '<epoch>.<nanoseconds>.md' or '<epoch>.md' as by 'spnotes_notes_add()'.
+ *
+ * Returns 0 if it isn't (`created` is made 0 then).
+ */
+static int
+spnotes_note_name_time(const char *name, struct timespec *created)
+{
+	long long   sec  = 0;
+	long        nsec = 0;
+	const char *p    = name;
+
+	created->tv_sec  = 0;
+	created->tv_nsec = 0;
+	for (; *p >= '0' && *p <= '9'; p++)
+		if (p - name < 18) /* not to overflow */
+			sec = sec * 10 + (*p - '0');
+	if (p == name || p - name > 18)
+		return 0;
+	if (p[0] == '.' && p[1] >= '0' && p[1] <= '9') {
+		const char *digits = ++p;
+		for (; *p >= '0' && *p <= '9'; p++)
+			if (p - digits < 9)
+				nsec = nsec * 10 + (*p - '0');
+		if (p - digits != 9)
+			return 0;
+	}
+	if (strcmp(p, ".md") && strcmp(p, ".MD"))
+		return 0;
+	created->tv_sec  = (time_t)sec;
+	created->tv_nsec = nsec;
+	return 1;
+}
+
+/*
+ * Gets the last modified time of the note file `path` into `mtime`, left 0
+ * without a stat if the note is `named` by time and `instance` has 'no_stat'.
+ *
+ * Returns 0 if it couldn't be stat'ed.
+ */
+static int
+spnotes_note_mtime(spnotes_t *instance, const char *path, int named,
+                   struct timespec *mtime)
+{
+	mtime->tv_sec  = 0;
+	mtime->tv_nsec = 0;
+	if (named && instance && instance->no_stat)
+		return 1;
+
+	struct stat st;
+	SPNOTES_STATS_ADD(instance, stat_calls, 1);
+	if (stat(path, &st) != 0)
+		return 0;
+	*mtime = st.st_mtim;
+	return 1;
+}
+
+/*
+ * 'spnotes_notes_fill_filter()' without the trace events, setting `err` on
+ * error instead of the `spnotes_err`, so that categories can be scanned in
+ * parallel.
+ */
+static int
+spnotes_notes_scan(spnotes_categ *categ, char *filter,
+                   int (*filter_func)(const char *, const char *),
+                   int *err)
+{
+	spnotes_t *instance = categ->spnotes_instance;
+#ifdef SPNOTES_STATS
+	uint64_t parsing_ns = 0;
+#endif
+	SPNOTES_STATS_BEGIN(scan_begin);
+
+	DIR *dir = opendir(categ->path);
+	if (dir == NULL) {
+		*err = SPNOTES_ERR_INVALID_LOC;
+		return -1;
+	}
+	SPNOTES_STATS_ADD(instance, dirs_scanned, 1);
+
+	spnotes_scan scan;
+	if ((*err = spnotes_scan_open(&scan, dir, instance)) !=
+	    SPNOTES_ERR_NONE)
+		return -1;
+
+	int           notes_c = 0, mnotes_c = 128;
+	spnotes_note *notes = NULL;
+	if (!spnotes_memory_charge(instance, mnotes_c * sizeof(spnotes_note))) {
+		*err = SPNOTES_ERR_MEMORY_CAP;
+		spnotes_scan_close(&scan);
+		return -1;
+	}
+	notes = malloc(mnotes_c * sizeof(spnotes_note));
+	SPNOTES_STATS_ADD(instance, allocs, 1);
+	if (notes == NULL) {
+		*err = SPNOTES_ERR_MALLOC;
+		spnotes_scan_close(&scan);
+		return -1;
+	}
+
+	/* start reading the directory */
+	errno = 0;
+	const char *name;
+	while ((name = spnotes_scan_next(&scan))) {
+
+		/* check if the size of dynamic array has to be increased */
+		if (notes_c == mnotes_c - 1) {
+			if (!spnotes_memory_charge(
+				    instance, mnotes_c * sizeof(spnotes_note))) {
+				categ->notes    = notes;
+				categ->notes_c  = notes_c;
+				categ->mnotes_c = mnotes_c;
+
+				*err = SPNOTES_ERR_MEMORY_CAP;
+				spnotes_scan_close(&scan);
+				return -1;
+			}
+			spnotes_note *temp_notes = realloc(
+				notes, mnotes_c * 2 * sizeof(spnotes_note));
+			SPNOTES_STATS_ADD(instance, allocs, 1);
+			if (temp_notes == NULL) {
+				categ->notes    = notes;
+				categ->notes_c  = notes_c;
+				categ->mnotes_c = mnotes_c;
+
+				*err = SPNOTES_ERR_REALLOC;
+				spnotes_scan_close(&scan);
+				return -1;
+			}
+			notes = temp_notes;
+			mnotes_c *= 2;
+		}
+
+		/* fill title and description */
+		char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(path, PATH_MAX, "%s%s", categ->path, name);
+#pragma GCC diagnostic pop
+		/* filter out md files not having title */
+		SPNOTES_STATS_BEGIN(parse_begin);
+		int parsed = spnotes_note_parse_fd(&notes[notes_c], path,
+		                                   scan.fd, instance);
+		scan.fd    = -1; /* closed by the parse */
+#ifdef SPNOTES_STATS
+		parsing_ns += spnotes_clock_ns() - parse_begin;
+#endif
+		if (parsed < 1) {
+			SPNOTES_STATS_ADD(instance, parse_failures, 1);
+			continue;
+		}
+
+		/* filter with the `filter_func()` (if eligible) */
+		if (filter != NULL && filter_func != NULL &&
+		    filter_func(notes[notes_c].title, filter) <= 0) {
+			free(notes[notes_c].description);
+			free(notes[notes_c].tags);
+			continue;
+		}
+
+		/* stop before the strings of the note exceed the cap */
+		if (!spnotes_memory_charge(
+			    instance, spnotes_note_strings_size(&notes[notes_c]))) {
+			free(notes[notes_c].description);
+			free(notes[notes_c].tags);
+			categ->notes    = notes;
+			categ->notes_c  = notes_c;
+			categ->mnotes_c = mnotes_c;
+
+			*err = SPNOTES_ERR_MEMORY_CAP;
+			spnotes_scan_close(&scan);
+			return -1;
+		}
+
+		strcpy(notes[notes_c].path, path);
+		notes[notes_c].categ = categ;
+
+		/* get the created and last modified dates */
+		int named = spnotes_note_name_time(name,
+		                                   &notes[notes_c].created);
+		if (!spnotes_note_mtime(instance, path, named,
+		                        &notes[notes_c].last_modified)) {
+			categ->notes    = notes;
+			categ->notes_c  = notes_c;
+			categ->mnotes_c = mnotes_c;
+
+			*err = SPNOTES_ERR_FILE_STAT;
+			spnotes_scan_close(&scan);
+			return -1;
+		}
+
+		notes_c++;
+	}
+	if (errno != 0) {
+		categ->notes    = notes;
+		categ->notes_c  = notes_c;
+		categ->mnotes_c = mnotes_c;
+
+		*err = SPNOTES_ERR_DIR_READ;
+		spnotes_scan_close(&scan);
+		return -1;
+	}
+
+	spnotes_scan_close(&scan);
+
+	categ->notes    = notes;
+	categ->notes_c  = notes_c;
+	categ->mnotes_c = mnotes_c;
+#ifdef SPNOTES_STATS
+	/* the time spent parsing is accounted separately from the scan */
+	SPNOTES_STATS_ADD(instance, parse_ns, parsing_ns);
+	SPNOTES_STATS_ADD(instance, scan_ns,
+	                  spnotes_clock_ns() - scan_begin - parsing_ns);
+#endif
+	return notes_c;
+}
+
+/* 'spnotes_notes_fill()' setting `err` instead of the `spnotes_err` */
+static int
+spnotes_notes_fill_err(spnotes_categ *categ, int *err)
+{
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_fill", categ->path);
+	int ret = spnotes_notes_scan(categ, NULL, NULL, err);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_fill", categ->path);
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_notes_fill_filter(spnotes_categ *categ, char *filter,
+                          int (*filter_func)(const char *, const char *))
+{
+	int err = SPNOTES_ERR_NONE;
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_fill", categ->path);
+	int ret = spnotes_notes_scan(categ, filter, filter_func, &err);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_fill", categ->path);
+	if (ret < 0)
+		spnotes_err = err;
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_notes_compare_last_modified(const void *note1, const void *note2)
+{
+	struct timespec *tm1_ts = &(((spnotes_note *)note1)->last_modified);
+	struct timespec *tm2_ts = &(((spnotes_note *)note2)->last_modified);
+
+	if (tm1_ts->tv_sec == tm2_ts->tv_sec) {
+		if (tm1_ts->tv_nsec > tm2_ts->tv_nsec)
+			return -1;
+		else
+			return 1;
+	}
+
+	if (tm1_ts->tv_sec > tm2_ts->tv_sec)
+		return -1;
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_notes_compare_alphabetically(const void *note1, const void *note2)
+{
+	char *note1_title = ((spnotes_note *)note1)->title;
+	char *note2_title = ((spnotes_note *)note2)->title;
+
+	return strcmp(note1_title, note2_title);
+}
+
+SPNOTES_DEF int
+spnotes_notes_compare_created(const void *note1, const void *note2)
+{
+	const spnotes_note *n1 = note1, *n2 = note2;
+
+	if (n1->created.tv_sec != n2->created.tv_sec)
+		return n1->created.tv_sec > n2->created.tv_sec ? -1 : 1;
+	if (n1->created.tv_nsec != n2->created.tv_nsec)
+		return n1->created.tv_nsec > n2->created.tv_nsec ? -1 : 1;
+	return strcmp(n1->title, n2->title);
+}
+
+/* points 'notes_by_id' of the instance back at the sorted notes of `categ` */
+static void
+spnotes_notes_relink_ids(spnotes_categ *categ)
+{
+	spnotes_t *instance = categ->spnotes_instance;
+
+	if (instance == NULL || instance->notes_by_id == NULL)
+		return;
+	for (size_t j = 0; j < categ->notes_c; j++) {
+		size_t id = categ->notes[j].id;
+		/* only the ids that were of the notes of `categ` */
+		if (id < instance->notes_by_id_c &&
+		    instance->notes_by_id[id] >= categ->notes &&
+		    instance->notes_by_id[id] < categ->notes + categ->notes_c)
+			instance->notes_by_id[id] = &categ->notes[j];
+	}
+}
+
+SPNOTES_DEF void
+spnotes_notes_sort_last_modified(spnotes_categ *categ)
+{
+	if (categ == NULL || categ->notes == NULL)
+		return;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_sort", categ->path);
+	SPNOTES_STATS_BEGIN(sort_begin);
+	qsort(categ->notes, categ->notes_c, sizeof(spnotes_note),
+	      spnotes_notes_compare_last_modified);
+	spnotes_notes_relink_ids(categ);
+	SPNOTES_STATS_END(categ->spnotes_instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_sort", categ->path);
+}
+
+SPNOTES_DEF void
+spnotes_notes_sort_alphabetically(spnotes_categ *categ)
+{
+	if (categ == NULL || categ->notes == NULL)
+		return;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_sort", categ->path);
+	SPNOTES_STATS_BEGIN(sort_begin);
+	qsort(categ->notes, categ->notes_c, sizeof(spnotes_note),
+	      spnotes_notes_compare_alphabetically);
+	spnotes_notes_relink_ids(categ);
+	SPNOTES_STATS_END(categ->spnotes_instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_sort", categ->path);
+}
+
+SPNOTES_DEF void
+spnotes_notes_sort_created(spnotes_categ *categ)
+{
+	if (categ == NULL || categ->notes == NULL)
+		return;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_sort", categ->path);
+	SPNOTES_STATS_BEGIN(sort_begin);
+	qsort(categ->notes, categ->notes_c, sizeof(spnotes_note),
+	      spnotes_notes_compare_created);
+	spnotes_notes_relink_ids(categ);
+	SPNOTES_STATS_END(categ->spnotes_instance, sort_ns, sort_begin);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_sort", categ->path);
+}
+
+SPNOTES_DEF spnotes_note *
+spnotes_notes_search(spnotes_categ categ, const char *title)
+{
+	if (!(categ.notes)) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return NULL;
+	}
+
+	for (size_t i = 0; i < categ.notes_c; i++) {
+		if (!strcmp(categ.notes[i].title, title))
+			return (categ.notes + i);
+	}
+	return NULL;
+}
+
+SPNOTES_DEF spnotes_note *
+spnotes_notes_search_ex(spnotes_categ *categ, const char *title, int flags)
+{
+	if (categ == NULL || title == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return NULL;
+	}
+	if (!(categ->notes)) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return NULL;
+	}
+
+	char query[NAME_MAX];
+	if (flags & SPNOTES_SEARCH_ICASE)
+		spnotes_fold(query, title);
+	else
+		snprintf(query, NAME_MAX, "%s", title);
+	size_t query_len = strlen(query);
+
+	for (size_t i = 0; i < categ->notes_c; i++) {
+		spnotes_note *note = &categ->notes[i];
+		if (spnotes_title_matches(flags & SPNOTES_SEARCH_ICASE ?
+		                                  note->title_folded :
+		                                  note->title,
+		                          query, query_len, flags))
+			return note;
+	}
+	return NULL;
+}
+
+/* time of the last note created by this process */
+static struct timespec spnotes_note_last_created;
+#ifndef SPNOTES_NO_THREADS
+static pthread_mutex_t spnotes_note_last_created_lock =
+	PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* current time but always later than that of the note created before */
+static struct timespec
+spnotes_note_time_next(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_lock(&spnotes_note_last_created_lock);
+#endif
+	struct timespec *last = &spnotes_note_last_created;
+	if (now.tv_sec < last->tv_sec ||
+	    (now.tv_sec == last->tv_sec && now.tv_nsec <= last->tv_nsec)) {
+		now = *last;
+		if (++now.tv_nsec == 1000000000L) {
+			now.tv_sec++;
+			now.tv_nsec = 0;
+		}
+	}
+	*last = now;
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_unlock(&spnotes_note_last_created_lock);
+#endif
+
+	return now;
+}
+
+/* writes all of `iov` handling short writes, 16 of them at a time */
+static int
+spnotes_writev_all(int fd, const struct iovec *iov, int iovcnt)
+{
+	struct iovec left[16];
+
+	while (iovcnt > 0) {
+		int batch_c = iovcnt < 16 ? iovcnt : 16;
+		memcpy(left, iov, batch_c * sizeof(struct iovec));
+		iov += batch_c;
+		iovcnt -= batch_c;
+
+		struct iovec *cur = left;
+		while (batch_c > 0) {
+			ssize_t n = writev(fd, cur, batch_c);
+			if (n == -1) {
+				if (errno == EINTR)
+					continue;
+				return 0;
+			}
+			while (batch_c > 0 && (size_t)n >= cur->iov_len) {
+				n -= cur->iov_len;
+				cur++;
+				batch_c--;
+			}
+			if (batch_c > 0) {
+				cur->iov_base = (char *)cur->iov_base + n;
+				cur->iov_len -= n;
+			}
+		}
+	}
+	return 1;
+}
+
+/*
+ * Exclusively creates a new uniquely named note in the directory `dir_fd`
+ * (which is at `dir_path`) with the content in `iov`, synced to the disk if
+ * `to_sync` is set.
+ */
+static int
+spnotes_note_create(int dir_fd, const char *dir_path, const struct iovec *iov,
+                    int iovcnt, int to_sync, char *new_loc)
+{
+	char name[64];
+	int  fd;
+
+	do {
+		struct timespec created = spnotes_note_time_next();
+		snprintf(name, sizeof(name), "%ld.%09ld.md",
+		         (long)created.tv_sec, (long)created.tv_nsec);
+
+		fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_EXCL,
+		            DEFFILEMODE);
+	} while (fd == -1 && errno == EEXIST); /* taken by another process */
+	if (fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+
+	if ((iovcnt > 0 && !spnotes_writev_all(fd, iov, iovcnt)) ||
+	    (to_sync && fsync(fd) == -1)) {
+		int err = errno;
+		close(fd);
+		unlinkat(dir_fd, name, 0);
+		errno       = err;
+		spnotes_err = SPNOTES_ERR_WRITE;
+		return 0;
+	}
+	if (close(fd) == -1) {
+		spnotes_err = SPNOTES_ERR_WRITE;
+		return 0;
+	}
+
+	if (new_loc)
+		snprintf(new_loc, PATH_MAX, "%s%s", dir_path, name);
+
+	return 1;
+}
+
+/* fills `iov` with the yaml-header of the given title and description */
+static int
+spnotes_header_iov(struct iovec *iov, const char *title,
+                   const char *description)
+{
+	int c = 0;
+
+#define SPNOTES_IOV(str, len)                          \
+	(iov[c].iov_base = (void *)(str), iov[c].iov_len = (len), c++)
+	SPNOTES_IOV("---\ntitle: ", 11);
+	SPNOTES_IOV(title, strlen(title));
+	if (description) {
+		SPNOTES_IOV("\ndescription: ", 14);
+		SPNOTES_IOV(description, strlen(description));
+	}
+	SPNOTES_IOV("\n---\n", 5);
+#undef SPNOTES_IOV
+
+	return c;
+}
+
+/* 'spnotes_note_create()' in the directory of `categ` */
+static int
+spnotes_note_create_in(spnotes_categ *categ, const struct iovec *iov,
+                       int iovcnt, char *new_loc)
+{
+	int dir_fd = open(categ->path, O_RDONLY | O_DIRECTORY);
+	if (dir_fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+
+	int ret = spnotes_note_create(dir_fd, categ->path, iov, iovcnt, 0,
+	                              new_loc);
+	close(dir_fd);
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_notes_add(spnotes_categ categ, char *new_loc)
+{
+	return spnotes_note_create_in(&categ, NULL, 0, new_loc);
+}
+
+SPNOTES_DEF int
+spnotes_notes_add_content(spnotes_categ categ, const char *content,
+                          size_t content_len, char *new_loc)
+{
+	struct iovec iov = { (void *)content, content_len };
+
+	return spnotes_note_create_in(&categ, &iov, 1, new_loc);
+}
+
+SPNOTES_DEF int
+spnotes_notes_add_header(spnotes_categ categ, const char *title,
+                         const char *description, char *new_loc)
+{
+	struct iovec iov[4];
+	int          iovcnt = spnotes_header_iov(iov, title, description);
+
+	return spnotes_note_create_in(&categ, iov, iovcnt, new_loc);
+}
+
+SPNOTES_DEF int
+spnotes_notes_add_many(spnotes_categ categ, const char **titles,
+                       const char **descriptions, size_t notes_c,
+                       char (*new_locs)[PATH_MAX])
+{
+	int dir_fd = open(categ.path, O_RDONLY | O_DIRECTORY);
+	if (dir_fd == -1) {
+		spnotes_err = SPNOTES_ERR_INVALID_LOC;
+		return -1;
+	}
+
+	for (size_t i = 0; i < notes_c; i++) {
+		struct iovec iov[4];
+		int          iovcnt = spnotes_header_iov(
+                        iov, titles[i], descriptions ? descriptions[i] : NULL);
+
+		if (!spnotes_note_create(dir_fd, categ.path, iov, iovcnt, 0,
+		                         new_locs ? new_locs[i] : NULL)) {
+			close(dir_fd);
+			return -1;
+		}
+	}
+
+	close(dir_fd);
+	return notes_c;
+}
+
+/* = Frontmatter = */
+
+#define SPNOTES_HEADER_MAX 65536 /* longest yaml-header edited */
+
+/*
+ * Reads the yaml-header at the start of `fd` into `header` (allocated here)
+ * up to and including its closing "---\n". A closing "---" ending the file,
+ * as written by the cli, gets its newline added in `header`: writing the
+ * header back at the start of the file then appends it.
+ *
+ * Returns its length OR 0 on error.
+ */
+static size_t
+spnotes_header_read(int fd, char **header)
+{
+	size_t len = 0, mlen = 4096;
+	char  *buf = malloc(mlen);
+	if (buf == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+
+	/* a byte is kept spare for the newline of a closing "---" at the end */
+	for (;;) {
+		ssize_t n = pread(fd, buf + len, mlen - len - 1, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1) {
+			spnotes_err = SPNOTES_ERR_FILE_READ;
+			break;
+		}
+		len += n;
+
+		/* only a header as parsed by 'spnotes_note_fill_title_desc()' */
+		if (len >= 4 && memcmp(buf, "---\n", 4)) {
+			spnotes_err = SPNOTES_ERR_PARSE;
+			break;
+		}
+		const char *end = len > 4 ? spnotes_memfind(buf + 3, len - 3,
+		                                      "\n---\n", 5) :
+		                      NULL;
+		if (end) {
+			*header = buf;
+			return end + 5 - buf;
+		}
+		if (n == 0 && len >= 7 && !memcmp(buf + len - 4, "\n---", 4)) {
+			buf[len] = '\n';
+			*header  = buf;
+			return len + 1;
+		}
+		if (n == 0 || mlen == SPNOTES_HEADER_MAX) {
+			spnotes_err = SPNOTES_ERR_PARSE;
+			break;
+		}
+
+		if (len == mlen - 1) {
+			mlen *= 2;
+			char *temp_buf = realloc(buf, mlen);
+			if (temp_buf == NULL) {
+				spnotes_err = SPNOTES_ERR_REALLOC;
+				break;
+			}
+			buf = temp_buf;
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
+/* whether the line is padding left by an earlier edit (or just empty) */
+static int
+spnotes_header_is_padding(const char *line, size_t len)
+{
+	if (len == 0)
+		return 1;
+	if (line[0] != '#')
+		return 0;
+	for (size_t i = 1; i < len; i++)
+		if (line[i] != ' ')
+			return 0;
+	return 1;
+}
+
+/*
+ * Writes into `out` the yaml-header `header` of `len` bytes with the `key`
+ * ("title" or "description") set to `value` (left out if NULL) and without
+ * the padding lines.
+ *
+ * Returns the length written.
+ */
+static size_t
+spnotes_header_set(char *out, const char *header, size_t len,
+                   const char *key, const char *value)
+{
+	size_t key_len = strlen(key), c = 0;
+	int    is_title = !strcmp(key, "title"), is_set = (value == NULL);
+	const char *line, *next, *end = header + len - 4; /* the "---\n" */
+
+#define SPNOTES_OUT(str, n) (memcpy(out + c, (str), (n)), c += (n))
+#define SPNOTES_OUT_KEY()                                         \
+	(SPNOTES_OUT(key, key_len), SPNOTES_OUT(": ", 2),         \
+	 SPNOTES_OUT(value, strlen(value)), SPNOTES_OUT("\n", 1), \
+	 is_set = 1)
+	SPNOTES_OUT("---\n", 4);
+	/* a title has to come first, a description after it */
+	if (is_title && !spnotes_memfind(header, len, "\ntitle:", 7))
+		SPNOTES_OUT_KEY();
+
+	for (line = header + 4; line < end; line = next) {
+		next            = (const char *)memchr(line, '\n', end - line) + 1;
+		size_t line_len = next - line - 1;
+
+		if (spnotes_header_is_padding(line, line_len))
+			continue;
+		if (line_len > key_len && !memcmp(line, key, key_len) &&
+		    line[key_len] == ':') {
+			if (!is_set)
+				SPNOTES_OUT_KEY();
+			continue;
+		}
+		SPNOTES_OUT(line, line_len + 1);
+		if (!is_set && !memcmp(line, "title:", 6))
+			SPNOTES_OUT_KEY();
+	}
+	if (!is_set)
+		SPNOTES_OUT_KEY();
+	SPNOTES_OUT("---\n", 4);
+#undef SPNOTES_OUT_KEY
+#undef SPNOTES_OUT
+
+	return c;
+}
+
+/* copies `fd` from `off` to its end to `out_fd` */
+static int
+spnotes_copy_rest(int fd, off_t off, int out_fd)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+	for (;;) {
+		ssize_t n = syscall(SYS_copy_file_range, fd, &off, out_fd, NULL,
+		                    (size_t)1 << 30, 0);
+		if (n == 0)
+			return 1;
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			break;
+	}
+	if (errno != ENOSYS && errno != EXDEV && errno != EINVAL &&
+	    errno != EOPNOTSUPP)
+		return 0;
+#endif
+	/* fallback for kernels and file systems without copy_file_range() */
+	char buf[65536];
+	for (;;) {
+		ssize_t n = pread(fd, buf, sizeof(buf), off);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return n == 0;
+
+		struct iovec iov = { buf, n };
+		if (!spnotes_writev_all(out_fd, &iov, 1))
+			return 0;
+		off += n;
+	}
+}
+
+/*
+ * Writes `header` and the body of `fd` after its header of `old_len` bytes
+ * to a temporary file next to `path` and renames it over it.
+ */
+static int
+spnotes_note_rewrite(const char *path, int fd, size_t old_len,
+                     const char *header, size_t len)
+{
+	char        tmp_path[PATH_MAX];
+	const char *name = strrchr(path, '/');
+	name             = name ? name + 1 : path;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	/* hidden so that it's never taken for a note */
+	snprintf(tmp_path, PATH_MAX, "%.*s.%s.XXXXXX", (int)(name - path), path,
+	         name);
+#pragma GCC diagnostic pop
+
+	int tmp_fd = mkstemp(tmp_path);
+	if (tmp_fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+
+	struct stat  st;
+	struct iovec iov = { (void *)header, len };
+	int          ret = fstat(fd, &st) == 0 &&
+	          fchmod(tmp_fd, st.st_mode & 07777) == 0 &&
+	          spnotes_writev_all(tmp_fd, &iov, 1) &&
+	          spnotes_copy_rest(fd, old_len, tmp_fd);
+	if (close(tmp_fd) == -1)
+		ret = 0;
+	if (ret && rename(tmp_path, path) == 0)
+		return 1;
+
+	int err = errno;
+	unlink(tmp_path);
+	errno       = err;
+	spnotes_err = SPNOTES_ERR_WRITE;
+	return 0;
+}
+
+/* sets the `key` of the yaml-header of `note` to `value` (NULL to remove) */
+static int
+spnotes_note_set(spnotes_note *note, const char *key, const char *value)
+{
+	if (value && strchr(value, '\n')) {
+		spnotes_err = SPNOTES_ERR_VALUE;
+		return 0;
+	}
+
+	int fd = open(note->path, O_RDWR);
+	if (fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "note_set", note->path);
+
+	/* the new header is at most the old one with the new line */
+	char  *header = NULL, *new_header = NULL;
+	size_t spare   = strlen(key) + (value ? strlen(value) : 0) + 8;
+	size_t old_len = spnotes_header_read(fd, &header);
+	int    ret     = 0;
+	/* the trigrams to patch out of the index */
+	uint32_t *old_grams   = NULL;
+	size_t    old_grams_c = 0;
+	if (old_len == 0)
+		goto end;
+	if ((new_header = malloc(old_len + spare)) == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+
+	size_t len = spnotes_header_set(new_header, header, old_len, key, value);
+	if (len <= old_len) {
+		/* patched in place, the difference left as padding */
+		size_t pad = old_len - len;
+		memmove(new_header + len - 4 + pad, new_header + len - 4, 4);
+		if (pad == 1) {
+			new_header[len - 4] = '\n';
+		} else if (pad > 1) {
+			new_header[len - 4] = '#';
+			memset(new_header + len - 3, ' ', pad - 2);
+			new_header[len - 4 + pad - 1] = '\n';
+		}
+		ret = pwrite(fd, new_header, old_len, 0) == (ssize_t)old_len;
+		if (!ret)
+			spnotes_err = SPNOTES_ERR_WRITE;
+	} else {
+		ret = spnotes_note_rewrite(note->path, fd, old_len, new_header,
+		                           len);
+	}
+	if (!ret)
+		goto end;
+
+	/* the catalog in memory as a rescan would see it */
+	spnotes_t  *instance = note->categ ? note->categ->spnotes_instance :
+	                                     NULL;
+	struct stat st;
+	if (stat(note->path, &st) == 0)
+		note->last_modified = st.st_mtim;
+	if (note->categ && stat(note->categ->path, &st) == 0)
+		note->categ->last_modified = st.st_mtim;
+	/* the directory didn't change, the shared catalog can't tell */
+	spnotes_shm_outdate(instance);
+	if (instance && instance->trigrams)
+		old_grams = spnotes_note_grams_set(note, &old_grams_c);
+	if (!strcmp(key, "title")) {
+		snprintf(note->title, NAME_MAX, "%s", value);
+		spnotes_fold(note->title_folded, note->title);
+	} else {
+		char *description = value ? strdup(value) : NULL;
+		if (value && description == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			ret         = 0;
+			goto end;
+		}
+		spnotes_memory_uncharge(instance,
+		                        spnotes_note_strings_size(note));
+		free(note->description);
+		note->description     = description;
+		note->has_description = description != NULL;
+		spnotes_memory_charge(instance, spnotes_note_strings_size(note));
+	}
+	spnotes_note_reindex(note, old_grams, old_grams_c,
+	                     !strcmp(key, "title"));
+
+end:
+	free(old_grams);
+	free(new_header);
+	free(header);
+	close(fd);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "note_set", note->path);
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_note_set_title(spnotes_note *note, const char *title)
+{
+	if (note == NULL || title == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (title[0] == '\0' || strlen(title) >= NAME_MAX) {
+		spnotes_err = SPNOTES_ERR_VALUE;
+		return 0;
+	}
+
+	return spnotes_note_set(note, "title", title);
+}
+
+SPNOTES_DEF int
+spnotes_note_set_description(spnotes_note *note, const char *description)
+{
+	if (note == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (description && description[0] == '\0')
+		description = NULL;
+
+	return spnotes_note_set(note, "description", description);
+}
+
+/* = Trash = */
+
+#define SPNOTES_TRASH_DIR ".trash"
+#define SPNOTES_TRASH_PATH ".path" /* directory of a nested category */
+
+/* renameat() failing with EEXIST instead of replacing `new_path` */
+static int
+spnotes_rename_noreplace(int old_dir_fd, const char *old_path, int new_dir_fd,
+                         const char *new_path)
+{
+#if defined(__linux__) && defined(SYS_renameat2)
+	if (syscall(SYS_renameat2, old_dir_fd, old_path, new_dir_fd, new_path,
+	            1 /* RENAME_NOREPLACE */) == 0)
+		return 0;
+	if (errno != ENOSYS && errno != EINVAL)
+		return -1;
+#endif
+	/* racy fallback for kernels and file systems without renameat2() */
+	struct stat st;
+	if (fstatat(new_dir_fd, new_path, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+		errno = EEXIST;
+		return -1;
+	}
+	return renameat(old_dir_fd, old_path, new_dir_fd, new_path);
+}
+
+/* opens the trash directory of `root`, creating it if `to_create` */
+static int
+spnotes_trash_open(const char *root, int to_create)
+{
+	int root_fd = open(root, O_RDONLY | O_DIRECTORY);
+	if (root_fd == -1)
+		return -1;
+
+	if (to_create && mkdirat(root_fd, SPNOTES_TRASH_DIR, 0777) != 0 &&
+	    errno != EEXIST) {
+		close(root_fd);
+		return -1;
+	}
+	int trash_fd = openat(root_fd, SPNOTES_TRASH_DIR, O_RDONLY | O_DIRECTORY);
+	close(root_fd);
+	return trash_fd;
+}
+
+/*
+ * Creates a new entry `<id>-<kind>` in the trash of `root`, `kind` being 'c'
+ * for a category and 'n' for a note, and fills `id` with its name.
+ *
+ * Returns the fd of the trash directory with `entry_fd` filled OR -1 on error
+ * with errno set.
+ */
+static int
+spnotes_trash_entry_create(const char *root, char kind, char *id,
+                           int *entry_fd)
+{
+	int trash_fd = spnotes_trash_open(root, 1);
+	if (trash_fd == -1)
+		return -1;
+
+	for (;;) {
+		struct timespec deleted = spnotes_note_time_next();
+		snprintf(id, SPNOTES_TRASH_ID_MAX, "%ld.%09ld-%c",
+		         (long)deleted.tv_sec, deleted.tv_nsec, kind);
+		if (mkdirat(trash_fd, id, 0777) == 0)
+			break;
+		if (errno != EEXIST) {
+			close(trash_fd);
+			return -1;
+		}
+	}
+
+	*entry_fd = openat(trash_fd, id, O_RDONLY | O_DIRECTORY);
+	if (*entry_fd == -1) {
+		int err = errno;
+		unlinkat(trash_fd, id, AT_REMOVEDIR);
+		close(trash_fd);
+		errno = err;
+		return -1;
+	}
+	return trash_fd;
+}
+
+/* fills `dir` with the directory of `categ` relative to its root ("lang/c") */
+static void
+spnotes_categ_dir(const spnotes_categ *categ, char *dir)
+{
+	const char *root = categ->root ? categ->root :
+	                                 categ->spnotes_instance->root_location;
+	size_t      root_len = strlen(root);
+	const char *rel      = strncmp(categ->path, root, root_len) ?
+	                               categ->title :
+	                               categ->path + root_len;
+
+	size_t len = strlen(rel);
+	while (len > 0 && rel[len - 1] == '/')
+		len--;
+	snprintf(dir, NAME_MAX, "%.*s", (int)len, rel);
+}
+
+/* last component of the category directory `dir` */
+static const char *
+spnotes_categ_dir_name(const char *dir)
+{
+	const char *slash = strrchr(dir, '/');
+	return slash ? slash + 1 : dir;
+}
+
+/*
+ * Records the directory `dir` of a nested category in the trash entry, the
+ * category itself being kept there under its last component only.
+ */
+static int
+spnotes_trash_path_write(int entry_fd, const char *dir)
+{
+	if (strchr(dir, '/') == NULL)
+		return 1;
+
+	int fd = openat(entry_fd, SPNOTES_TRASH_PATH,
+	                O_WRONLY | O_CREAT | O_EXCL, 0666);
+	if (fd == -1)
+		return 0;
+	ssize_t len = strlen(dir);
+	int     ret = write(fd, dir, len) == len;
+	close(fd);
+	if (!ret)
+		unlinkat(entry_fd, SPNOTES_TRASH_PATH, 0);
+	return ret;
+}
+
+/* creates the directory `dir` relative to `dir_fd` along with its parents */
+static int
+spnotes_mkdirs_at(int dir_fd, const char *dir)
+{
+	char path[NAME_MAX];
+	snprintf(path, NAME_MAX, "%s", dir);
+
+	for (char *c = path;; c++) {
+		if (*c != '/' && *c != '\0')
+			continue;
+		char end = *c;
+		*c       = '\0';
+		if (mkdirat(dir_fd, path, 0777) != 0 && errno != EEXIST)
+			return 0;
+		if (end == '\0')
+			return 1;
+		*c = end;
+	}
+}
+
+SPNOTES_DEF int
+spnotes_categs_remove(spnotes_categ categ)
+{
+	if (categ.spnotes_instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	char id[SPNOTES_TRASH_ID_MAX], dir[NAME_MAX];
+	spnotes_categ_dir(&categ, dir);
+	int entry_fd, trash_fd = spnotes_trash_entry_create(
+			      categ.root ? categ.root :
+			                   categ.spnotes_instance->root_location,
+			      'c', id, &entry_fd);
+	if (trash_fd == -1) {
+		spnotes_err = SPNOTES_ERR_DELETE;
+		return 0;
+	}
+
+	int ret = spnotes_trash_path_write(entry_fd, dir) &&
+	          spnotes_rename_noreplace(AT_FDCWD, categ.path, entry_fd,
+	                                   spnotes_categ_dir_name(dir)) == 0;
+	int err = errno;
+	if (!ret) {
+		unlinkat(entry_fd, SPNOTES_TRASH_PATH, 0);
+		unlinkat(trash_fd, id, AT_REMOVEDIR);
+	}
+	close(entry_fd);
+	close(trash_fd);
+
+	if (!ret) {
+		errno       = err;
+		spnotes_err = SPNOTES_ERR_DELETE;
+	}
+	return ret;
+}
+
+SPNOTES_DEF int
+spnotes_notes_remove(spnotes_note note)
+{
+	if (note.categ == NULL || note.categ->spnotes_instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	char id[SPNOTES_TRASH_ID_MAX], dir[NAME_MAX];
+	spnotes_categ_dir(note.categ, dir);
+	int entry_fd, trash_fd = spnotes_trash_entry_create(
+			      note.categ->root ?
+			              note.categ->root :
+			              note.categ->spnotes_instance->root_location,
+			      'n', id, &entry_fd);
+	if (trash_fd == -1) {
+		spnotes_err = SPNOTES_ERR_DELETE;
+		return 0;
+	}
+
+	/* `<id>-n/<categ>/<file>` so that it knows where to be restored */
+	const char *name       = strrchr(note.path, '/');
+	const char *categ_name = spnotes_categ_dir_name(dir);
+	int         ret        = 0, categ_fd;
+	name                   = name ? name + 1 : note.path;
+	if (spnotes_trash_path_write(entry_fd, dir) &&
+	    mkdirat(entry_fd, categ_name, 0777) == 0) {
+		categ_fd = openat(entry_fd, categ_name, O_RDONLY | O_DIRECTORY);
+		if (categ_fd != -1) {
+			ret = spnotes_rename_noreplace(AT_FDCWD, note.path,
+			                               categ_fd, name) == 0;
+			close(categ_fd);
+		}
+		if (!ret)
+			unlinkat(entry_fd, categ_name, AT_REMOVEDIR);
+	}
+	int err = errno;
+	if (!ret) {
+		unlinkat(entry_fd, SPNOTES_TRASH_PATH, 0);
+		unlinkat(trash_fd, id, AT_REMOVEDIR);
+	}
+	close(entry_fd);
+	close(trash_fd);
+
+	if (!ret) {
+		errno       = err;
+		spnotes_err = SPNOTES_ERR_DELETE;
+	}
+	return ret;
+}
+
+/* fills `name` with the first entry of the directory `path` not being hidden */
+static int
+spnotes_dir_first(int dir_fd, const char *path, char *name)
+{
+	int fd = openat(dir_fd, path, O_RDONLY | O_DIRECTORY);
+	if (fd == -1)
+		return 0;
+	DIR *dir = fdopendir(fd);
+	if (dir == NULL) {
+		close(fd);
+		return 0;
+	}
+
+	struct dirent *dirent;
+	int            found = 0;
+	while (!found && (dirent = readdir(dir)))
+		if (dirent->d_name[0] != '.') {
+			snprintf(name, NAME_MAX, "%.*s", NAME_MAX - 1,
+			         dirent->d_name);
+			found = 1;
+		}
+	closedir(dir);
+	return found;
+}
+
+/* fills `entry` from the trash entry `id` of the `root`th root, 0 if none */
+static int
+spnotes_trash_entry_read(const spnotes_t *instance, size_t root, int trash_fd,
+                         const char *id, spnotes_trash_entry *entry)
+{
+	long sec, nsec;
+	char kind;
+	int  len;
+
+	if (sscanf(id, "%ld.%ld-%c%n", &sec, &nsec, &kind, &len) != 3 ||
+	    id[len] != '\0' || (kind != 'c' && kind != 'n') ||
+	    strlen(id) >= SPNOTES_TRASH_ID_MAX)
+		return 0;
+	char categ_name[NAME_MAX], path[PATH_MAX];
+	if (!spnotes_dir_first(trash_fd, id, categ_name))
+		return 0;
+
+	/* the whole directory of a nested category */
+	snprintf(entry->categ, NAME_MAX, "%s", categ_name);
+	snprintf(path, PATH_MAX, "%s/" SPNOTES_TRASH_PATH, id);
+	int path_fd = openat(trash_fd, path, O_RDONLY);
+	if (path_fd != -1) {
+		ssize_t len = read(path_fd, entry->categ, NAME_MAX - 1);
+		close(path_fd);
+		if (len <= 0)
+			return 0;
+		entry->categ[len] = '\0';
+		if (strcmp(spnotes_categ_dir_name(entry->categ), categ_name))
+			return 0;
+	}
+
+	strcpy(entry->id, id);
+	entry->deleted.tv_sec  = sec;
+	entry->deleted.tv_nsec = nsec;
+	entry->root            = root;
+	entry->note[0]         = '\0';
+	if (kind == 'c')
+		return 1;
+
+	/* the title of the note from its header */
+	char file[NAME_MAX];
+	snprintf(path, PATH_MAX, "%s/%s", id, categ_name);
+	if (!spnotes_dir_first(trash_fd, path, file))
+		return 0;
+	snprintf(path, PATH_MAX, "%s" SPNOTES_TRASH_DIR "/%s/%s/%s",
+	         instance->roots[root], id, categ_name, file);
+
+	spnotes_note note;
+	if (spnotes_note_fill_title_desc(&note, path) > 0)
+		snprintf(entry->note, NAME_MAX, "%s", note.title);
+	else
+		snprintf(entry->note, NAME_MAX, "%s", file);
+	free(note.description);
+	free(note.tags);
+	return 1;
+}
+
+static int
+spnotes_trash_entry_compare(const void *a, const void *b)
+{
+	const spnotes_trash_entry *x = a, *y = b;
+
+	/* most recently deleted first */
+	if (x->deleted.tv_sec != y->deleted.tv_sec)
+		return x->deleted.tv_sec < y->deleted.tv_sec ? 1 : -1;
+	if (x->deleted.tv_nsec != y->deleted.tv_nsec)
+		return x->deleted.tv_nsec < y->deleted.tv_nsec ? 1 : -1;
+	return 0;
+}
+
+/* appends the entries in the trash of the `root`th root to `list` */
+static int
+spnotes_trash_list_root(const spnotes_t *instance, size_t root,
+                        spnotes_trash_entry **list, size_t *list_c,
+                        size_t *mlist_c)
+{
+	int trash_fd = spnotes_trash_open(instance->roots[root], 0);
+	if (trash_fd == -1) {
+		if (errno == ENOENT)
+			return 1; /* nothing was ever deleted */
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		return 0;
+	}
+	DIR *dir = fdopendir(dup(trash_fd));
+	if (dir == NULL) {
+		close(trash_fd);
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		return 0;
+	}
+
+	int            ret = 1;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		if (*list_c == *mlist_c) {
+			spnotes_trash_entry *tmp =
+				realloc(*list, *mlist_c * 2 * sizeof(**list));
+			if (tmp == NULL) {
+				spnotes_err = SPNOTES_ERR_MALLOC;
+				ret         = 0;
+				break;
+			}
+			*list = tmp;
+			*mlist_c *= 2;
+		}
+		if (spnotes_trash_entry_read(instance, root, trash_fd,
+		                             dirent->d_name, &(*list)[*list_c]))
+			(*list_c)++;
+	}
+	closedir(dir);
+	close(trash_fd);
+	return ret;
+}
+
+/* opens the trash of the root having the entry `id` with `entry` filled */
+static int
+spnotes_trash_find(const spnotes_t *instance, const char *id,
+                   spnotes_trash_entry *entry)
+{
+	if (strchr(id, '/') || id[0] == '.')
+		return -1;
+
+	for (size_t r = 0; r < instance->roots_c; r++) {
+		int trash_fd = spnotes_trash_open(instance->roots[r], 0);
+		if (trash_fd == -1)
+			continue;
+		if (spnotes_trash_entry_read(instance, r, trash_fd, id, entry))
+			return trash_fd;
+		close(trash_fd);
+	}
+	return -1;
+}
+
+SPNOTES_DEF int
+spnotes_trash_list(const spnotes_t *instance, spnotes_trash_entry **entries,
+                   size_t *entries_c)
+{
+	if (instance == NULL || entries == NULL || entries_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	*entries   = NULL;
+	*entries_c = 0;
+
+	size_t               list_c = 0, mlist_c = 16;
+	spnotes_trash_entry *list = malloc(mlist_c * sizeof(*list));
+	if (list == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	for (size_t r = 0; r < instance->roots_c; r++)
+		if (!spnotes_trash_list_root(instance, r, &list, &list_c,
+		                             &mlist_c)) {
+			free(list);
+			return -1;
+		}
+
+	qsort(list, list_c, sizeof(*list), spnotes_trash_entry_compare);
+	*entries   = list;
+	*entries_c = list_c;
+	return list_c;
+}
+
+SPNOTES_DEF int
+spnotes_trash_restore(const spnotes_t *instance, const char *id)
+{
+	if (instance == NULL || id == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	spnotes_trash_entry entry;
+	int trash_fd = spnotes_trash_find(instance, id, &entry);
+	if (trash_fd == -1) {
+		spnotes_err = SPNOTES_ERR_INVALID_LOC;
+		return 0;
+	}
+	int root_fd  = open(instance->roots[entry.root], O_RDONLY | O_DIRECTORY);
+	int entry_fd = openat(trash_fd, id, O_RDONLY | O_DIRECTORY);
+	int ret      = 0;
+	if (root_fd == -1 || entry_fd == -1)
+		goto end;
+
+	/* kept in the trash under the last component of its directory */
+	const char *categ_name = spnotes_categ_dir_name(entry.categ);
+	if (entry.note[0] == '\0') { /* whole category */
+		char parent[NAME_MAX];
+		snprintf(parent, NAME_MAX, "%.*s",
+		         (int)(categ_name - entry.categ), entry.categ);
+		if (parent[0] == '\0' || spnotes_mkdirs_at(root_fd, parent))
+			ret = spnotes_rename_noreplace(entry_fd, categ_name,
+			                               root_fd,
+			                               entry.categ) == 0;
+	} else {
+		char file[NAME_MAX];
+		int  categ_fd = openat(entry_fd, categ_name,
+		                       O_RDONLY | O_DIRECTORY);
+		int  dest_fd  = -1;
+
+		/* the category might have been deleted since */
+		if (spnotes_mkdirs_at(root_fd, entry.categ))
+			dest_fd = openat(root_fd, entry.categ,
+			                 O_RDONLY | O_DIRECTORY);
+		if (categ_fd != -1 && dest_fd != -1 &&
+		    spnotes_dir_first(categ_fd, ".", file))
+			ret = spnotes_rename_noreplace(categ_fd, file, dest_fd,
+			                               file) == 0;
+		if (ret)
+			unlinkat(entry_fd, categ_name, AT_REMOVEDIR);
+		if (categ_fd != -1)
+			close(categ_fd);
+		if (dest_fd != -1)
+			close(dest_fd);
+	}
+	if (ret) {
+		unlinkat(entry_fd, SPNOTES_TRASH_PATH, 0);
+		unlinkat(trash_fd, id, AT_REMOVEDIR);
+	}
+
+end:;
+	int err = errno;
+	if (entry_fd != -1)
+		close(entry_fd);
+	if (root_fd != -1)
+		close(root_fd);
+	close(trash_fd);
+	if (!ret) {
+		errno       = err;
+		spnotes_err = err == EEXIST ? SPNOTES_ERR_EXISTS :
+		                              SPNOTES_ERR_DELETE;
+	}
+	return ret;
+}
+
+/* = Move = */
+
+/* points the tag index entry of `note` at it, if it was at `old` */
+static void
+spnotes_notes_by_id_move(spnotes_t *instance, uintptr_t old,
+                         spnotes_note *note)
+{
+	if (instance->notes_by_id && note->id < instance->notes_by_id_c &&
+	    (uintptr_t)instance->notes_by_id[note->id] == old)
+		instance->notes_by_id[note->id] = note;
+}
+
+/*
+ * Moves the file `name` from the directory `from_fd` to `into_fd` without
+ * replacing any file, a note being given a new name (into `to` of NAME_MAX
+ * bytes) if its name is taken.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ */
+static int
+spnotes_file_move(int from_fd, const char *name, int into_fd, char *to)
+{
+	snprintf(to, NAME_MAX, "%s", name);
+	int moved = spnotes_rename_noreplace(from_fd, name, into_fd, to) == 0;
+	while (!moved && errno == EEXIST &&
+	       (strstr(name, ".md") || strstr(name, ".MD"))) {
+		struct timespec created = spnotes_note_time_next();
+		snprintf(to, NAME_MAX, "%ld.%09ld.md", (long)created.tv_sec,
+		         (long)created.tv_nsec);
+		moved = spnotes_rename_noreplace(from_fd, name, into_fd, to) == 0;
+	}
+	if (!moved)
+		spnotes_err = errno == EEXIST ? SPNOTES_ERR_EXISTS :
+		                                SPNOTES_ERR_RENAME;
+	return moved;
+}
+
+/* the modification time of the directory of `categ` after a move */
+static void
+spnotes_categ_touch(spnotes_categ *categ)
+{
+	struct stat st;
+	if (stat(categ->path, &st) == 0)
+		categ->last_modified = st.st_mtim;
+}
+
+/* the note of the filled `categ` stored at `path`, if any */
+static spnotes_note *
+spnotes_notes_find_path(spnotes_categ *categ, const char *path)
+{
+	for (size_t i = 0; i < categ->notes_c; i++)
+		if (!strcmp(categ->notes[i].path, path))
+			return &categ->notes[i];
+	return NULL;
+}
+
+/*
+ * Makes room for one more note in the filled `categ`, keeping the tag index
+ * pointing at its notes.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_notes_reserve(spnotes_categ *categ, size_t more)
+{
+	spnotes_t *instance = categ->spnotes_instance;
+	if (categ->notes_c + more < categ->mnotes_c)
+		return 1;
+
+	size_t mnotes_c = (categ->notes_c + more) * 2;
+	if (!spnotes_memory_charge(instance, (mnotes_c - categ->mnotes_c) *
+	                                             sizeof(spnotes_note))) {
+		spnotes_err = SPNOTES_ERR_MEMORY_CAP;
+		return 0;
+	}
+	uintptr_t     old   = (uintptr_t)categ->notes;
+	spnotes_note *notes = realloc(categ->notes,
+	                              mnotes_c * sizeof(spnotes_note));
+	if (notes == NULL) {
+		spnotes_memory_uncharge(instance, (mnotes_c - categ->mnotes_c) *
+		                                          sizeof(spnotes_note));
+		spnotes_err = SPNOTES_ERR_REALLOC;
+		return 0;
+	}
+	categ->notes    = notes;
+	categ->mnotes_c = mnotes_c;
+	for (size_t i = 0; i < categ->notes_c; i++)
+		spnotes_notes_by_id_move(instance,
+		                         old + i * sizeof(spnotes_note),
+		                         &notes[i]);
+	return 1;
+}
+
+/*
+ * Moves `note`, one of the notes of its filled category, to the end of the
+ * notes of `to` in memory as `path`, the last note of its category taking its
+ * place. If `to` isn't filled the note is just dropped, to be read when it is.
+ *
+ * Returns 0 if it couldn't allocate the memory (the note is dropped then).
+ */
+static int
+spnotes_note_relocate(spnotes_note *note, spnotes_categ *to,
+                      const char *path)
+{
+	spnotes_categ *from     = note->categ;
+	spnotes_t     *instance = from->spnotes_instance;
+	spnotes_note   moved    = *note;
+	uintptr_t      old      = (uintptr_t)note;
+
+	/* out of `from` in O(1) */
+	spnotes_note *last = &from->notes[--from->notes_c];
+	if (note != last) {
+		*note = *last;
+		spnotes_notes_by_id_move(instance, (uintptr_t)last, note);
+	}
+
+	strcpy(moved.path, path);
+	spnotes_note_name_time(strrchr(path, '/') + 1, &moved.created);
+	moved.categ = to;
+	if (to->notes && spnotes_notes_reserve(to, 1)) {
+		to->notes[to->notes_c] = moved;
+		spnotes_notes_by_id_move(instance, old, &to->notes[to->notes_c]);
+		to->notes_c++;
+		return 1;
+	}
+
+	/* its id is no more of any note */
+	spnotes_memory_uncharge(instance, spnotes_note_strings_size(&moved));
+	free(moved.description);
+	free(moved.tags);
+	spnotes_indexes_free(instance);
+	return to->notes == NULL;
+}
+
+SPNOTES_DEF int
+spnotes_notes_move(spnotes_note *note, spnotes_categ *to, char *new_loc)
+{
+	if (note == NULL || to == NULL || note->categ == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	spnotes_categ *from = note->categ;
+
+	const char *name = strrchr(note->path, '/');
+	name             = name ? name + 1 : note->path;
+	if (from == to) {
+		if (new_loc)
+			strcpy(new_loc, note->path);
+		return 1;
+	}
+
+	int from_fd = open(from->path, O_RDONLY | O_DIRECTORY);
+	int to_fd   = open(to->path, O_RDONLY | O_DIRECTORY);
+	char to_name[NAME_MAX];
+	int  ret = from_fd != -1 && to_fd != -1 &&
+	          spnotes_file_move(from_fd, name, to_fd, to_name);
+	if (from_fd == -1 || to_fd == -1)
+		spnotes_err = SPNOTES_ERR_OPEN;
+	if (from_fd != -1)
+		close(from_fd);
+	if (to_fd != -1)
+		close(to_fd);
+	if (!ret)
+		return 0;
+
+	char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	snprintf(path, PATH_MAX, "%s%s", to->path, to_name);
+#pragma GCC diagnostic pop
+	if (new_loc)
+		strcpy(new_loc, path);
+	spnotes_categ_touch(from);
+	spnotes_categ_touch(to);
+
+	/* `note` may be a copy (e.g. of 'spnotes_notes_recent()') */
+	spnotes_note *filled = from->notes ?
+	                               spnotes_notes_find_path(from, note->path) :
+	                               NULL;
+	if (filled == NULL) {
+		strcpy(note->path, path);
+		spnotes_note_name_time(to_name, &note->created);
+		note->categ = to;
+		return 1;
+	}
+	return spnotes_note_relocate(filled, to, path);
+}
+
+SPNOTES_DEF int
+spnotes_categs_rename(spnotes_categ *categ, const char *title)
+{
+	if (categ == NULL || title == NULL ||
+	    categ->spnotes_instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	spnotes_t  *instance = categ->spnotes_instance;
+	const char *root     = categ->root ? categ->root :
+	                                     instance->root_location;
+
+	/* a path under the root, without "." or ".." components */
+	size_t title_len = strlen(title);
+	if (title_len == 0 || title_len >= NAME_MAX || title[0] == '/' ||
+	    title[title_len - 1] == '/' || strstr(title, "//") ||
+	    title[0] == '.' || strstr(title, "/.") ||
+	    strlen(root) + title_len + 1 >= PATH_MAX - NAME_MAX) {
+		spnotes_err = SPNOTES_ERR_VALUE;
+		return 0;
+	}
+	if (instance->categs && spnotes_categs_search(*instance, title)) {
+		spnotes_err = SPNOTES_ERR_REDECLARE;
+		return 0;
+	}
+
+	int root_fd = open(root, O_RDONLY | O_DIRECTORY);
+	if (root_fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+	char dir[NAME_MAX], parent[NAME_MAX];
+	spnotes_categ_dir(categ, dir);
+	snprintf(parent, NAME_MAX, "%s", title);
+	char *slash = strrchr(parent, '/');
+	if (slash)
+		*slash = '\0';
+	int ret = (slash == NULL || spnotes_mkdirs_at(root_fd, parent)) &&
+	          spnotes_rename_noreplace(root_fd, dir, root_fd, title) == 0;
+	int err = errno;
+	close(root_fd);
+	if (!ret) {
+		errno       = err;
+		spnotes_err = err == EEXIST ? SPNOTES_ERR_EXISTS :
+		                              SPNOTES_ERR_RENAME;
+		return 0;
+	}
+
+	/* the category and the ones nested in it, with all of their notes */
+	char   old_path[PATH_MAX], new_path[PATH_MAX];
+	size_t old_len = snprintf(old_path, PATH_MAX, "%s", categ->path);
+	snprintf(new_path, PATH_MAX, "%s%s/", root, title);
+	spnotes_categ *categs   = instance->categs ? instance->categs : categ;
+	size_t         categs_c = instance->categs ? instance->categs_c : 1;
+	for (size_t i = 0; i < categs_c; i++) {
+		spnotes_categ *c = &categs[i];
+		if (strncmp(c->path, old_path, old_len))
+			continue;
+
+		const char *rest = c->path + old_len; /* "" or "nested/" */
+		size_t      rest_len = strlen(rest);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		if (rest_len)
+			snprintf(c->title, NAME_MAX, "%s/%.*s", title,
+			         (int)rest_len - 1, rest);
+		else
+			snprintf(c->title, NAME_MAX, "%s", title);
+		spnotes_fold(c->title_folded, c->title);
+		for (size_t j = 0; j < c->notes_c; j++) {
+			const char *name = c->notes[j].path + strlen(c->path);
+			char        note_path[PATH_MAX];
+			snprintf(note_path, PATH_MAX, "%s%s%s", new_path, rest,
+			         name);
+			strcpy(c->notes[j].path, note_path);
+		}
+		char categ_path[PATH_MAX];
+		snprintf(categ_path, PATH_MAX, "%s%s", new_path, rest);
+		strcpy(c->path, categ_path);
+#pragma GCC diagnostic pop
+	}
+	spnotes_categ_touch(categ);
+
+	return 1;
+}
+
+/* file names of a merge, before and after (renamed if taken) */
+typedef struct {
+	char *from, *to;
+} spnotes_merge_name;
+
+static int
+spnotes_merge_name_compare(const void *a, const void *b)
+{
+	return strcmp(((const spnotes_merge_name *)a)->from,
+	              ((const spnotes_merge_name *)b)->from);
+}
+
+/*
+ * Moves the notes of the filled `from` named in `names` to `into` in memory.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_merge_relocate(spnotes_categ *from, spnotes_categ *into,
+                       spnotes_merge_name *names, size_t names_c)
+{
+	int ret = 1;
+
+	qsort(names, names_c, sizeof(spnotes_merge_name),
+	      spnotes_merge_name_compare);
+	if (into->notes && !spnotes_notes_reserve(into, from->notes_c))
+		ret = 0; /* the notes are dropped one by one then */
+
+	/* backwards, as the last note takes the place of a relocated one */
+	for (size_t i = from->notes_c; i-- > 0;) {
+		spnotes_note      *note = &from->notes[i];
+		spnotes_merge_name key  = { strrchr(note->path, '/') + 1, NULL };
+		spnotes_merge_name *name =
+			bsearch(&key, names, names_c, sizeof(spnotes_merge_name),
+		                spnotes_merge_name_compare);
+		if (name == NULL) /* failed to be moved */
+			continue;
+
+		char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(path, PATH_MAX, "%s%s", into->path, name->to);
+#pragma GCC diagnostic pop
+		if (!spnotes_note_relocate(note, into, path))
+			ret = 0;
+	}
+	return ret;
+}
+
+/* takes the empty `categ` out of the categories of its instance */
+static void
+spnotes_categs_drop(spnotes_categ *categ)
+{
+	spnotes_t *instance = categ->spnotes_instance;
+	size_t     i        = categ - instance->categs;
+
+	free(categ->notes);
+	spnotes_memory_uncharge(instance,
+	                        categ->mnotes_c * sizeof(spnotes_note));
+	memmove(categ, categ + 1,
+	        (instance->categs_c - i - 1) * sizeof(spnotes_categ));
+	instance->categs_c--;
+	spnotes_categs_relink(instance);
+}
+
+SPNOTES_DEF int
+spnotes_categs_merge(spnotes_categ *from, spnotes_categ *into)
+{
+	if (from == NULL || into == NULL || from->spnotes_instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (from == into) {
+		spnotes_err = SPNOTES_ERR_VALUE;
+		return 0;
+	}
+	spnotes_t *instance = from->spnotes_instance;
+
+	int from_fd = open(from->path, O_RDONLY | O_DIRECTORY);
+	if (from_fd == -1) {
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+	int into_fd = open(into->path, O_RDONLY | O_DIRECTORY);
+	DIR *dir    = into_fd == -1 ? NULL : fdopendir(from_fd);
+	if (dir == NULL) {
+		if (into_fd != -1)
+			close(into_fd);
+		close(from_fd);
+		spnotes_err = SPNOTES_ERR_OPEN;
+		return 0;
+	}
+
+	spnotes_merge_name *names   = NULL;
+	size_t              names_c = 0, mnames_c = 0;
+	int                 ret = 1, left = 0;
+
+	/* every file, a note being renamed as a new one if its name is taken */
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (dirent->d_name[0] == '.' || dirent->d_type == DT_DIR) {
+			left |= strcmp(dirent->d_name, ".") &&
+			        strcmp(dirent->d_name, "..");
+			continue;
+		}
+
+		if (names_c == mnames_c) {
+			mnames_c                   = mnames_c ? mnames_c * 2 : 64;
+			spnotes_merge_name *temp_names = realloc(
+				names, mnames_c * sizeof(spnotes_merge_name));
+			if (temp_names == NULL) {
+				spnotes_err = SPNOTES_ERR_REALLOC;
+				ret         = 0;
+				break;
+			}
+			names = temp_names;
+		}
+
+		char to[NAME_MAX];
+		if (!spnotes_file_move(from_fd, dirent->d_name, into_fd, to)) {
+			ret = 0;
+			break;
+		}
+
+		names[names_c].from = strdup(dirent->d_name);
+		names[names_c].to   = strdup(to);
+		if (names[names_c].from == NULL || names[names_c].to == NULL) {
+			free(names[names_c].from);
+			free(names[names_c].to);
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			ret         = 0;
+			break;
+		}
+		names_c++;
+		errno = 0; /* of the renames, for the end of 'readdir()' */
+	}
+	if (ret && errno != 0) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		ret         = 0;
+	}
+	closedir(dir);
+	close(into_fd);
+	spnotes_categ_touch(into);
+	spnotes_categ_touch(from);
+
+	/* the catalog in memory as a rescan would see it */
+	if (from->notes && !spnotes_merge_relocate(from, into, names, names_c))
+		ret = 0;
+	for (size_t i = 0; i < names_c; i++) {
+		free(names[i].from);
+		free(names[i].to);
+	}
+	free(names);
+
+	/* gone for good once empty, unless nested categories are left in it */
+	if (ret && !left && rmdir(from->path) == 0 && instance->categs &&
+	    from >= instance->categs &&
+	    from < instance->categs + instance->categs_c)
+		spnotes_categs_drop(from);
+	return ret;
+}
+
+/* = Purge = */
+
+#define SPNOTES_PURGE_MAX_DIRS 256 /* directories kept open at once */
+
+typedef struct {
+	size_t parent; /* index on `dir_fds` OR SIZE_MAX for the trash */
+	char  *name;
+} spnotes_purge_dir;
+
+typedef struct {
+	int               trash_fd;
+	int              *dir_fds; /* `dir_fds[i]` is the fd of `dirs[i]` */
+	spnotes_purge_dir *dirs;   /* children before their parents */
+	size_t            dirs_c, mdirs_c;
+	size_t           *file_dirs; /* index on `dir_fds` of each file */
+	char            **files;
+	size_t            files_c, mfiles_c;
+	size_t            failed_c; /* atomic */
+} spnotes_purge_job;
+
+/* collects everything under the directory `name` of `parent` in `job` */
+static int
+spnotes_purge_scan(spnotes_purge_job *job, size_t parent, const char *name)
+{
+	int parent_fd = parent == SIZE_MAX ? job->trash_fd :
+	                                     job->dir_fds[parent];
+	int fd = openat(parent_fd, name,
+	                O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+	if (fd == -1)
+		return 0;
+	int dup_fd = dup(fd);
+	DIR *dir   = dup_fd == -1 ? NULL : fdopendir(dup_fd);
+	if (dir == NULL) {
+		if (dup_fd != -1)
+			close(dup_fd);
+		close(fd);
+		return 0;
+	}
+
+	char *dir_name = strdup(name);
+	if (dir_name == NULL)
+		goto err;
+
+	size_t self = job->dirs_c;
+	if (job->dirs_c == job->mdirs_c) {
+		size_t             mdirs_c = job->mdirs_c ? job->mdirs_c * 2 : 16;
+		int               *fds = realloc(job->dir_fds, mdirs_c * sizeof(int));
+		if (fds)
+			job->dir_fds = fds;
+		spnotes_purge_dir *dirs =
+			realloc(job->dirs, mdirs_c * sizeof(*dirs));
+		if (dirs)
+			job->dirs = dirs;
+		if (fds == NULL || dirs == NULL) {
+			free(dir_name);
+			goto err;
+		}
+		job->mdirs_c = mdirs_c;
+	}
+	job->dir_fds[self]     = fd;
+	job->dirs[self].parent = parent;
+	job->dirs[self].name   = dir_name;
+	job->dirs_c++;
+
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, ".."))
+			continue;
+
+		int is_dir = dirent->d_type == DT_DIR;
+		if (dirent->d_type == DT_UNKNOWN) {
+			struct stat st;
+			is_dir = fstatat(fd, dirent->d_name, &st,
+			                 AT_SYMLINK_NOFOLLOW) == 0 &&
+			         S_ISDIR(st.st_mode);
+		}
+		if (is_dir) {
+			if (!spnotes_purge_scan(job, self, dirent->d_name))
+				goto err_closed;
+			continue;
+		}
+
+		if (job->files_c == job->mfiles_c) {
+			size_t mfiles_c = job->mfiles_c ? job->mfiles_c * 2 : 64;
+			size_t *file_dirs =
+				realloc(job->file_dirs, mfiles_c * sizeof(size_t));
+			if (file_dirs)
+				job->file_dirs = file_dirs;
+			char **files = realloc(job->files, mfiles_c * sizeof(char *));
+			if (files)
+				job->files = files;
+			if (file_dirs == NULL || files == NULL)
+				goto err_closed;
+			job->mfiles_c = mfiles_c;
+		}
+		job->files[job->files_c] = strdup(dirent->d_name);
+		if (job->files[job->files_c] == NULL)
+			goto err_closed;
+		job->file_dirs[job->files_c++] = self;
+	}
+	closedir(dir);
+	return 1;
+
+err:
+	close(fd);
+err_closed:
+	closedir(dir);
+	return 0;
+}
+
+static void
+spnotes_purge_one(size_t i, void *arg)
+{
+	spnotes_purge_job *job = arg;
+
+	if (unlinkat(job->dir_fds[job->file_dirs[i]], job->files[i], 0) != 0)
+#ifdef SPNOTES_NO_THREADS
+		job->failed_c++;
+#else
+		__atomic_fetch_add(&job->failed_c, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/* removes everything collected in `job`, returning the files removed */
+static size_t
+spnotes_purge_flush(spnotes_purge_job *job)
+{
+	size_t failed_c = job->failed_c;
+	spnotes_parallel_for(job->files_c, spnotes_purge_one, job);
+	size_t removed_c = job->files_c - (job->failed_c - failed_c);
+
+	/* directories after their children: in the reverse order of the scan */
+	for (size_t i = job->dirs_c; i-- > 0;) {
+		size_t parent   = job->dirs[i].parent;
+		int    parent_fd = parent == SIZE_MAX ? job->trash_fd :
+		                                        job->dir_fds[parent];
+		close(job->dir_fds[i]);
+		if (unlinkat(parent_fd, job->dirs[i].name, AT_REMOVEDIR) != 0)
+			job->failed_c++;
+		free(job->dirs[i].name);
+	}
+	for (size_t i = 0; i < job->files_c; i++)
+		free(job->files[i]);
+	job->dirs_c = job->files_c = 0;
+	return removed_c;
+}
+
+/* 'spnotes_trash_purge()' of the trash of `root` */
+static int
+spnotes_trash_purge_root(const char *root, const char *id)
+{
+	spnotes_purge_job job = { 0 };
+	job.trash_fd = spnotes_trash_open(root, 0);
+	if (job.trash_fd == -1) {
+		if (errno == ENOENT && id == NULL)
+			return 0; /* nothing was ever deleted */
+		spnotes_err = SPNOTES_ERR_INVALID_LOC;
+		return -1;
+	}
+
+	size_t removed_c = 0;
+	int    ret       = 1;
+	if (id != NULL) {
+		struct stat st;
+		if (strchr(id, '/') || id[0] == '.' ||
+		    fstatat(job.trash_fd, id, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+			close(job.trash_fd);
+			spnotes_err = SPNOTES_ERR_INVALID_LOC;
+			return -1;
+		}
+		ret       = spnotes_purge_scan(&job, SIZE_MAX, id);
+		removed_c = spnotes_purge_flush(&job);
+	} else {
+		DIR *dir = fdopendir(dup(job.trash_fd));
+		if (dir == NULL) {
+			close(job.trash_fd);
+			spnotes_err = SPNOTES_ERR_DIR_READ;
+			return -1;
+		}
+		struct dirent *dirent;
+		while (ret && (dirent = readdir(dir))) {
+			if (dirent->d_name[0] == '.')
+				continue;
+			ret = spnotes_purge_scan(&job, SIZE_MAX, dirent->d_name);
+			/* don't run out of fds on a large trash */
+			if (job.dirs_c >= SPNOTES_PURGE_MAX_DIRS)
+				removed_c += spnotes_purge_flush(&job);
+		}
+		removed_c += spnotes_purge_flush(&job);
+		closedir(dir);
+	}
+
+	free(job.dir_fds);
+	free(job.dirs);
+	free(job.file_dirs);
+	free(job.files);
+	close(job.trash_fd);
+
+	if (!ret || job.failed_c) {
+		spnotes_err = SPNOTES_ERR_DELETE;
+		return -1;
+	}
+	return removed_c;
+}
+
+SPNOTES_DEF int
+spnotes_trash_purge(const spnotes_t *instance, const char *id)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+
+	/* an entry is only in the trash of one of the roots */
+	if (id != NULL) {
+		for (size_t r = 0; r < instance->roots_c; r++) {
+			int removed_c =
+				spnotes_trash_purge_root(instance->roots[r], id);
+			if (removed_c >= 0 ||
+			    spnotes_err != SPNOTES_ERR_INVALID_LOC)
+				return removed_c;
+		}
+		return -1;
+	}
+
+	int removed_c = 0;
+	for (size_t r = 0; r < instance->roots_c; r++) {
+		int root_removed_c =
+			spnotes_trash_purge_root(instance->roots[r], NULL);
+		if (root_removed_c < 0)
+			return -1;
+		removed_c += root_removed_c;
+	}
+	return removed_c;
+}
+
+/* = Import = */
+
+typedef struct {
+	size_t categ;                  /* index on the job's `categs` */
+	char  *src_path;               /* markdown file to import OR */
+	char  *title, *desc, *tags;    /* fields of a JSON Lines record */
+	char  *body;
+	size_t body_len;
+} spnotes_import_rec;
+
+typedef struct {
+	spnotes_import_rec *recs;
+	size_t              recs_c, mrecs_c;
+	char              **categs; /* titles of the target categories */
+	char              (*categ_paths)[PATH_MAX];
+	int                *categ_fds;
+	size_t              categs_c, mcategs_c;
+	size_t              last_categ;
+	int                *errs;   /* per record */
+	int                 to_sync; /* each note before it's closed */
+} spnotes_import_job;
+
+static void
+spnotes_import_job_free(spnotes_import_job *job)
+{
+	for (size_t i = 0; i < job->recs_c; i++) {
+		free(job->recs[i].src_path);
+		free(job->recs[i].title);
+		free(job->recs[i].desc);
+		free(job->recs[i].tags);
+		free(job->recs[i].body);
+	}
+	for (size_t i = 0; i < job->categs_c; i++) {
+		free(job->categs[i]);
+		if (job->categ_fds && job->categ_fds[i] != -1)
+			close(job->categ_fds[i]);
+	}
+	free(job->recs);
+	free(job->categs);
+	free(job->categ_paths);
+	free(job->categ_fds);
+	free(job->errs);
+}
+
+/* returns the index of the category `title` in `job`, adding it if needed */
+static long
+spnotes_import_categ(spnotes_import_job *job, const char *title)
+{
+	char *dup = strdup(title);
+	if (dup == NULL)
+		return -1;
+	/* category titles are directory names, looked up as such */
+	for (char *p = dup; *p; p++)
+		if (*p == '/')
+			*p = '-';
+	if (dup[0] == '.')
+		dup[0] = '_';
+
+	long found = -1;
+	if (job->categs_c > 0 && !strcmp(job->categs[job->last_categ], dup))
+		found = job->last_categ;
+	for (size_t i = 0; found < 0 && i < job->categs_c; i++)
+		if (!strcmp(job->categs[i], dup))
+			found = job->last_categ = i;
+	if (found >= 0) {
+		free(dup);
+		return found;
+	}
+
+	if (job->categs_c == job->mcategs_c) {
+		size_t mcategs_c = job->mcategs_c ? job->mcategs_c * 2 : 16;
+		char **categs =
+			realloc(job->categs, mcategs_c * sizeof(char *));
+		if (categs == NULL) {
+			free(dup);
+			return -1;
+		}
+		job->categs    = categs;
+		job->mcategs_c = mcategs_c;
+	}
+
+	job->categs[job->categs_c] = dup;
+	return job->last_categ = job->categs_c++;
+}
+
+static spnotes_import_rec *
+spnotes_import_rec_new(spnotes_import_job *job)
+{
+	if (job->recs_c == job->mrecs_c) {
+		size_t              mrecs_c = job->mrecs_c ? job->mrecs_c * 2 : 128;
+		spnotes_import_rec *recs =
+			realloc(job->recs, mrecs_c * sizeof(spnotes_import_rec));
+		if (recs == NULL)
+			return NULL;
+		job->recs    = recs;
+		job->mrecs_c = mrecs_c;
+	}
+
+	spnotes_import_rec *rec = &job->recs[job->recs_c++];
+	memset(rec, 0, sizeof(spnotes_import_rec));
+	return rec;
+}
+
+/* returns non-zero if `buf` starts with a yaml-header having a title */
+static int
+spnotes_header_has_title(const char *buf, size_t len)
+{
+	size_t line_no, body = spnotes_body_offset(buf, len, &line_no);
+
+	for (size_t pos = 4; pos < body;) {
+		const char *eol = memchr(buf + pos, '\n', body - pos);
+		size_t      end = eol ? (size_t)(eol - buf) : body;
+
+		if (end - pos > 6 && !memcmp(buf + pos, "title:", 6)) {
+			for (size_t i = pos + 6; i < end; i++)
+				if (buf[i] != ' ')
+					return 1;
+		}
+		pos = end + 1;
+	}
+	return 0;
+}
+
+/* newlines in header fields would break the header */
+static void
+spnotes_oneline(char *str)
+{
+	for (; str && *str; str++)
+		if (*str == '\n' || *str == '\r')
+			*str = ' ';
+}
+
+static void
+spnotes_import_one(size_t i, void *job_ptr)
+{
+	spnotes_import_job *job = job_ptr;
+	spnotes_import_rec *rec = &job->recs[i];
+
+	struct iovec iov[12];
+	int          c = 0;
+	char        *buf = NULL, *title = NULL;
+	size_t       len = 0;
+
+#define SPNOTES_IOV(str, l) \
+	(iov[c].iov_base = (void *)(str), iov[c].iov_len = (l), c++)
+	if (rec->src_path) {
+		buf = spnotes_file_read(rec->src_path, &len);
+		if (buf == NULL) {
+			job->errs[i] = SPNOTES_ERR_FILE_READ;
+			return;
+		}
+
+		if (!spnotes_header_has_title(buf, len)) {
+			/* title from the first '# heading' or the file name */
+			const char *h = buf;
+			while (h && strncmp(h, "# ", 2))
+				h = (h = strchr(h, '\n')) ? h + 1 : NULL;
+			if (h) {
+				title = strndup(h + 2, strcspn(h + 2, "\n"));
+			} else {
+				const char *base = strrchr(rec->src_path, '/');
+				base             = base ? base + 1 : rec->src_path;
+				title = strndup(base, strcspn(base, "."));
+			}
+			if (title == NULL) {
+				free(buf);
+				job->errs[i] = SPNOTES_ERR_MALLOC;
+				return;
+			}
+			spnotes_oneline(title);
+			SPNOTES_IOV("---\ntitle: ", 11);
+			SPNOTES_IOV(title, strlen(title));
+			SPNOTES_IOV("\n---\n\n", 6);
+		}
+		SPNOTES_IOV(buf, len);
+	} else {
+		spnotes_oneline(rec->title);
+		spnotes_oneline(rec->desc);
+		spnotes_oneline(rec->tags);
+
+		SPNOTES_IOV("---\ntitle: ", 11);
+		SPNOTES_IOV(rec->title, strlen(rec->title));
+		if (rec->desc && rec->desc[0]) {
+			SPNOTES_IOV("\ndescription: ", 14);
+			SPNOTES_IOV(rec->desc, strlen(rec->desc));
+		}
+		if (rec->tags && rec->tags[0]) {
+			SPNOTES_IOV("\ntags: ", 7);
+			SPNOTES_IOV(rec->tags, strlen(rec->tags));
+		}
+		SPNOTES_IOV("\n---\n\n", 6);
+		if (rec->body)
+			SPNOTES_IOV(rec->body, rec->body_len);
+	}
+#undef SPNOTES_IOV
+
+	if (!spnotes_note_create(job->categ_fds[rec->categ],
+	                         job->categ_paths[rec->categ], iov, c,
+	                         job->to_sync, NULL))
+		job->errs[i] = SPNOTES_ERR_WRITE;
+
+	free(title);
+	free(buf);
+}
+
+/* creates the categories and writes all the records of `job` in parallel */
+static int
+spnotes_import_run(spnotes_t *instance, spnotes_import_job *job, int flags)
+{
+	job->categ_paths = malloc((job->categs_c + 1) * PATH_MAX);
+	job->categ_fds   = malloc((job->categs_c + 1) * sizeof(int));
+	job->errs        = calloc(job->recs_c + 1, sizeof(int));
+	if (job->categ_paths == NULL || job->categ_fds == NULL ||
+	    job->errs == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	for (size_t i = 0; i < job->categs_c; i++)
+		job->categ_fds[i] = -1;
+
+	for (size_t i = 0; i < job->categs_c; i++) {
+		snprintf(job->categ_paths[i], PATH_MAX, "%s%s/",
+		         instance->root_location, job->categs[i]);
+		if (mkdir(job->categ_paths[i], 0777) != 0 && errno != EEXIST) {
+			spnotes_err = SPNOTES_ERR_MKDIR;
+			return -1;
+		}
+		job->categ_fds[i] =
+			open(job->categ_paths[i], O_RDONLY | O_DIRECTORY);
+		if (job->categ_fds[i] == -1) {
+			spnotes_err = SPNOTES_ERR_INVALID_LOC;
+			return -1;
+		}
+	}
+
+	/* the notes are synced by the workers, in parallel */
+	job->to_sync = !(flags & SPNOTES_IMPORT_NO_SYNC);
+	spnotes_parallel_for(job->recs_c, spnotes_import_one, job);
+
+	size_t imported_c = 0;
+	for (size_t i = 0; i < job->recs_c; i++) {
+		if (job->errs[i] == SPNOTES_ERR_NONE)
+			imported_c++;
+		else
+			spnotes_err = job->errs[i];
+	}
+
+	/* then their entries, and the ones of the new categories */
+	int synced = 1;
+	if (job->to_sync) {
+		for (size_t i = 0; i < job->categs_c; i++)
+			synced &= fsync(job->categ_fds[i]) == 0;
+		int root_fd = open(instance->root_location,
+		                   O_RDONLY | O_DIRECTORY);
+		synced &= root_fd != -1 && fsync(root_fd) == 0;
+		if (root_fd != -1)
+			close(root_fd);
+	}
+	if (!synced)
+		spnotes_err = SPNOTES_ERR_WRITE;
+	if (imported_c != job->recs_c || !synced)
+		return -1;
+	return imported_c;
+}
+
+/* adds the markdown files in `dir_path` to be imported to `categ` */
+static int
+spnotes_import_md_scan(spnotes_import_job *job, const char *dir_path,
+                       const char *categ, int recurse)
+{
+	DIR *dir = opendir(dir_path);
+	if (dir == NULL) {
+		spnotes_err = SPNOTES_ERR_INVALID_LOC;
+		return 0;
+	}
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (dirent->d_name[0] == '.')
+			continue;
+
+		char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(path, PATH_MAX, "%s/%s", dir_path, dirent->d_name);
+#pragma GCC diagnostic pop
+
+		if (dirent->d_type == DT_DIR) {
+			if (recurse &&
+			    !spnotes_import_md_scan(job, path, dirent->d_name, 0)) {
+				closedir(dir);
+				return 0;
+			}
+			continue;
+		}
+		if (!strstr(dirent->d_name, ".md") &&
+		    !strstr(dirent->d_name, ".MD"))
+			continue;
+
+		long                categ_i = spnotes_import_categ(job, categ);
+		spnotes_import_rec *rec =
+			categ_i < 0 ? NULL : spnotes_import_rec_new(job);
+		if (rec == NULL || (rec->src_path = strdup(path)) == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			closedir(dir);
+			return 0;
+		}
+		rec->categ = categ_i;
+	}
+	if (errno != 0) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		closedir(dir);
+		return 0;
+	}
+
+	closedir(dir);
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_import_md_dir(spnotes_t *instance, const char *src_dir,
+                      const char *default_categ, int flags)
+{
+	spnotes_import_job job;
+	memset(&job, 0, sizeof(job));
+
+	if (default_categ == NULL) {
+		const char *base = src_dir + strlen(src_dir);
+		while (base > src_dir && base[-1] == '/')
+			base--;
+		const char *end = base;
+		while (base > src_dir && base[-1] != '/')
+			base--;
+
+		char categ[NAME_MAX];
+		snprintf(categ, sizeof(categ), "%.*s", (int)(end - base), base);
+		if (!spnotes_import_md_scan(&job, src_dir,
+		                            categ[0] ? categ : "imported", 1)) {
+			spnotes_import_job_free(&job);
+			return -1;
+		}
+	} else if (!spnotes_import_md_scan(&job, src_dir, default_categ, 1)) {
+		spnotes_import_job_free(&job);
+		return -1;
+	}
+
+	int ret = spnotes_import_run(instance, &job, flags);
+	spnotes_import_job_free(&job);
+	return ret;
+}
+
+/* = JSON Lines = */
+
+static void
+spnotes_json_skip_space(const char **p)
+{
+	while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n')
+		(*p)++;
+}
+
+/* appends `cp` as UTF-8 to `out` */
+static char *
+spnotes_utf8_put(char *out, unsigned long cp)
+{
+	if (cp < 0x80) {
+		*out++ = cp;
+	} else if (cp < 0x800) {
+		*out++ = 0xC0 | (cp >> 6);
+		*out++ = 0x80 | (cp & 0x3F);
+	} else if (cp < 0x10000) {
+		*out++ = 0xE0 | (cp >> 12);
+		*out++ = 0x80 | ((cp >> 6) & 0x3F);
+		*out++ = 0x80 | (cp & 0x3F);
+	} else {
+		*out++ = 0xF0 | (cp >> 18);
+		*out++ = 0x80 | ((cp >> 12) & 0x3F);
+		*out++ = 0x80 | ((cp >> 6) & 0x3F);
+		*out++ = 0x80 | (cp & 0x3F);
+	}
+	return out;
+}
+
+static int
+spnotes_json_hex4(const char *p, unsigned long *cp)
+{
+	*cp = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = p[i];
+		*cp <<= 4;
+		if (c >= '0' && c <= '9')
+			*cp |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			*cp |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			*cp |= c - 'A' + 10;
+		else
+			return 0;
+	}
+	return 1;
+}
+
+/* parses a JSON string at `*p` into a dynamically allocated string */
+static char *
+spnotes_json_string(const char **p, size_t *len)
+{
+	if (**p != '"')
+		return NULL;
+	(*p)++;
+
+	/* unescaped strings are never longer than the escaped ones */
+	const char *end = *p;
+	while (*end && *end != '"')
+		end += (*end == '\\' && end[1]) ? 2 : 1;
+	if (*end != '"')
+		return NULL;
+
+	char *str = malloc(end - *p + 1), *out = str;
+	if (str == NULL)
+		return NULL;
+
+	while (*p < end) {
+		char c = *(*p)++;
+		if (c != '\\') {
+			*out++ = c;
+			continue;
+		}
+
+		unsigned long cp, lo;
+		switch (c = *(*p)++) {
+		case 'b': *out++ = '\b'; break;
+		case 'f': *out++ = '\f'; break;
+		case 'n': *out++ = '\n'; break;
+		case 'r': *out++ = '\r'; break;
+		case 't': *out++ = '\t'; break;
+		case 'u':
+			if (end - *p < 4 || !spnotes_json_hex4(*p, &cp))
+				goto err;
+			*p += 4;
+			/* surrogate pairs */
+			if (cp >= 0xD800 && cp <= 0xDBFF && end - *p >= 6 &&
+			    (*p)[0] == '\\' && (*p)[1] == 'u' &&
+			    spnotes_json_hex4(*p + 2, &lo) && lo >= 0xDC00 &&
+			    lo <= 0xDFFF) {
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+				*p += 6;
+			}
+			out = spnotes_utf8_put(out, cp);
+			break;
+		default: *out++ = c; break; /* '"', '\\' and '/' */
+		}
+	}
+	(*p)++; /* closing quote */
+
+	*out = '\0';
+	if (len)
+		*len = out - str;
+	return str;
+
+err:
+	free(str);
+	return NULL;
+}
+
+/* parses a JSON string or an array of strings (joined with ", ") */
+static char *
+spnotes_json_strings(const char **p, size_t *len)
+{
+	if (**p != '[')
+		return spnotes_json_string(p, len);
+	(*p)++;
+
+	char  *joined = NULL;
+	size_t joined_len = 0;
+	for (;;) {
+		spnotes_json_skip_space(p);
+		if (**p == ']') {
+			(*p)++;
+			break;
+		}
+
+		size_t item_len;
+		char  *item = spnotes_json_string(p, &item_len);
+		char  *tmp  = item ? realloc(joined, joined_len + item_len + 3) :
+		                     NULL;
+		if (tmp == NULL) {
+			free(item);
+			free(joined);
+			return NULL;
+		}
+		joined = tmp;
+		if (joined_len > 0) {
+			memcpy(joined + joined_len, ", ", 2);
+			joined_len += 2;
+		}
+		memcpy(joined + joined_len, item, item_len + 1);
+		joined_len += item_len;
+		free(item);
+
+		spnotes_json_skip_space(p);
+		if (**p == ',')
+			(*p)++;
+		else if (**p != ']') {
+			free(joined);
+			return NULL;
+		}
+	}
+
+	if (joined == NULL)
+		joined = strdup("");
+	if (len && joined)
+		*len = joined_len;
+	return joined;
+}
+
+/* parses one JSON Lines record of {category, title, description, body} */
+static int
+spnotes_import_jsonl_line(spnotes_import_job *job, const char *p)
+{
+	char  *categ = NULL, *title = NULL, *desc = NULL, *tags = NULL;
+	char  *body = NULL;
+	size_t body_len = 0;
+
+	spnotes_json_skip_space(&p);
+	if (*p == '\0')
+		return 1; /* blank line */
+	if (*p++ != '{')
+		goto err;
+
+	for (;;) {
+		spnotes_json_skip_space(&p);
+		if (*p == '}')
+			break;
+
+		char *key = spnotes_json_string(&p, NULL);
+		if (key == NULL)
+			goto err;
+		spnotes_json_skip_space(&p);
+		if (*p++ != ':') {
+			free(key);
+			goto err;
+		}
+		spnotes_json_skip_space(&p);
+
+		char **field = !strcmp(key, "category")    ? &categ :
+		               !strcmp(key, "title")       ? &title :
+		               !strcmp(key, "description") ? &desc :
+		               !strcmp(key, "tags")        ? &tags :
+		               !strcmp(key, "body")        ? &body :
+		                                             NULL;
+		free(key);
+
+		if (*p == '"' || *p == '[') {
+			char *value = spnotes_json_strings(
+				&p, field == &body ? &body_len : NULL);
+			if (value == NULL)
+				goto err;
+			if (field) {
+				free(*field);
+				*field = value;
+			} else {
+				free(value);
+			}
+		} else { /* numbers, true, false and null are ignored */
+			while (*p && *p != ',' && *p != '}')
+				p++;
+		}
+
+		spnotes_json_skip_space(&p);
+		if (*p == ',')
+			p++;
+		else if (*p != '}')
+			goto err;
+	}
+
+	if (title == NULL || title[0] == '\0') {
+		free(title);
+		if ((title = strdup("untitled")) == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			goto err_keep;
+		}
+	}
+	long                categ_i = spnotes_import_categ(
+                job, categ && categ[0] ? categ : "uncategorized");
+	spnotes_import_rec *rec = categ_i < 0 ? NULL : spnotes_import_rec_new(job);
+	if (rec == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto err_keep;
+	}
+	rec->categ    = categ_i;
+	rec->title    = title;
+	rec->desc     = desc;
+	rec->tags     = tags;
+	rec->body     = body;
+	rec->body_len = body_len;
+	free(categ);
+	return 1;
+
+err:
+	spnotes_err = SPNOTES_ERR_PARSE;
+err_keep:
+	free(categ);
+	free(title);
+	free(desc);
+	free(tags);
+	free(body);
+	return 0;
+}
+
+SPNOTES_DEF int
+spnotes_import_jsonl(spnotes_t *instance, FILE *stream, int flags)
+{
+	spnotes_import_job job;
+	memset(&job, 0, sizeof(job));
+
+	char  *line = NULL;
+	size_t mline_c = 0;
+	while (getline(&line, &mline_c, stream) != -1) {
+		if (!spnotes_import_jsonl_line(&job, line)) {
+			free(line);
+			spnotes_import_job_free(&job);
+			return -1;
+		}
+	}
+	free(line);
+	if (ferror(stream)) {
+		spnotes_import_job_free(&job);
+		spnotes_err = SPNOTES_ERR_FILE_READ;
+		return -1;
+	}
+
+	int ret = spnotes_import_run(instance, &job, flags);
+	spnotes_import_job_free(&job);
+	return ret;
+}
+
+/* = Search = */
+
+typedef struct {
+	spnotes_grep_line *lines;
+	size_t             lines_c, mlines_c, matches_c;
+	int                err;
+} spnotes_grep_result;
+
+/* a file to be searched by 'spnotes_grep()' */
+typedef struct {
+	spnotes_note *note;  /* NULL = not filled, to be parsed by the search */
+	size_t        categ; /* index of its category on the instance */
+	size_t        name;  /* offset of its file name on 'names' of the job */
+} spnotes_grep_file;
+
+typedef struct {
+	spnotes_t           *instance;
+	const char          *pattern;
+	size_t               pattern_len;
+	int                  is_regex;
+	regex_t              regex;
+	size_t               context;
+	spnotes_grep_file   *files;
+	size_t               files_c, mfiles_c;
+	char                *names; /* of the files of unfilled categories */
+	size_t               names_len, mnames_len;
+	int                 *dir_fds; /* of the categories, -1 if filled */
+	spnotes_grep_result *results;
+} spnotes_grep_job;
+
+static int
+spnotes_grep_push(spnotes_grep_result *res, spnotes_note *note,
+                  size_t line_no, const char *text, size_t text_len,
+                  int is_match)
+{
+	if (res->lines_c == res->mlines_c) {
+		size_t             mlines_c = res->mlines_c ? res->mlines_c * 2 : 16;
+		spnotes_grep_line *tmp =
+			realloc(res->lines, mlines_c * sizeof(spnotes_grep_line));
+		if (tmp == NULL)
+			return 0;
+		res->lines    = tmp;
+		res->mlines_c = mlines_c;
+	}
+
+	char *dup = malloc(text_len + 1);
+	if (dup == NULL)
+		return 0;
+	memcpy(dup, text, text_len);
+	dup[text_len] = '\0';
+
+	res->lines[res->lines_c].note      = note;
+	res->lines[res->lines_c].line_no   = line_no;
+	res->lines[res->lines_c].text      = dup;
+	res->lines[res->lines_c].is_match  = is_match;
+	res->lines[res->lines_c].owns_note = 0;
+	res->lines_c++;
+	res->matches_c += is_match;
+	return 1;
+}
+
+/* find the first matching line at or after `from` (a line start) */
+static int
+spnotes_grep_next(spnotes_grep_job *job, char *buf, size_t from, size_t len,
+                  size_t *ls, size_t *le)
+{
+	if (!job->is_regex) {
+		const char *p = spnotes_memfind(buf + from, len - from,
+		                                job->pattern, job->pattern_len);
+		if (p == NULL)
+			return 0;
+
+		size_t start = p - buf;
+		while (start > from && buf[start - 1] != '\n')
+			start--;
+		const char *eol = memchr(p, '\n', len - (p - buf));
+
+		*ls = start;
+		*le = eol ? (size_t)(eol - buf) : len;
+		return 1;
+	}
+
+	while (from < len) {
+		const char *eol = memchr(buf + from, '\n', len - from);
+		size_t      end = eol ? (size_t)(eol - buf) : len;
+
+		/* temporarily terminate the line for regexec() */
+		char c   = buf[end];
+		buf[end] = '\0';
+		int rc   = regexec(&job->regex, buf + from, 0, NULL, 0);
+		buf[end] = c;
+
+		if (rc == 0) {
+			*ls = from;
+			*le = end;
+			return 1;
+		}
+		from = end + 1;
+	}
+	return 0;
+}
+
+/* counts the lines in `buf` from `from` up to `to` */
+static size_t
+spnotes_lines_count(const char *buf, size_t from, size_t to)
+{
+	size_t      c = 0;
+	const char *p;
+
+	while (from < to && (p = memchr(buf + from, '\n', to - from))) {
+		c++;
+		from = p - buf + 1;
+	}
+	return c;
+}
+
+/* emit the line starting at `*pos`, moving `*pos` to the next line */
+static int
+spnotes_grep_emit(spnotes_grep_result *res, spnotes_note *note,
+                  const char *buf, size_t len, size_t *pos, size_t line_no,
+                  int is_match)
+{
+	const char *eol = memchr(buf + *pos, '\n', len - *pos);
+	size_t      end = eol ? (size_t)(eol - buf) : len;
+
+	if (!spnotes_grep_push(res, note, line_no, buf + *pos, end - *pos,
+	                       is_match))
+		return 0;
+	*pos = end + 1;
+	return 1;
+}
+
+/*
+ * Keeps a copy of the note `parsed` by the search if lines were found in it,
+ * the first of them owning it.
+ *
+ * Returns 0 if the copy couldn't be allocated.
+ */
+static int
+spnotes_grep_own(spnotes_grep_result *res, spnotes_note *parsed)
+{
+	spnotes_note *note = NULL;
+	if (res->lines_c > 0)
+		note = malloc(sizeof(spnotes_note));
+	if (note == NULL) {
+		free(parsed->description);
+		free(parsed->tags);
+		return res->lines_c == 0;
+	}
+
+	*note = *parsed;
+	for (size_t k = 0; k < res->lines_c; k++)
+		res->lines[k].note = note;
+	res->lines[0].owns_note = 1;
+	return 1;
+}
+
+static void
+spnotes_grep_note(size_t i, void *job_ptr)
+{
+	spnotes_grep_job    *job  = job_ptr;
+	spnotes_grep_file   *file = &job->files[i];
+	spnotes_grep_result *res  = &job->results[i];
+	spnotes_note        *note = file->note, parsed;
+
+	/* most notes fit on the stack, sparing an allocation per file */
+	char        scratch[SPNOTES_GREP_SCRATCH];
+	size_t      len;
+	char       *buf;
+	const char *path   = NULL; /* of a note parsed, in `dir_fd` */
+	int         dir_fd = AT_FDCWD;
+	if (note == NULL) {
+		/* the header and the body in a single read of the file */
+		spnotes_categ *categ = &job->instance->categs[file->categ];
+		const char    *name  = job->names + file->name;
+
+		dir_fd = job->dir_fds[file->categ];
+		note   = &parsed;
+		memset(note, 0, sizeof(*note));
+		note->categ = categ;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		snprintf(note->path, PATH_MAX, "%s%s", categ->path, name);
+#pragma GCC diagnostic pop
+
+		path = dir_fd == AT_FDCWD ? note->path : name;
+		buf  = spnotes_file_read_at(dir_fd, path, scratch,
+		                            sizeof(scratch), &len);
+		SPNOTES_STATS_ADD(job->instance, files_opened, 1);
+		if (buf == NULL) {
+			res->err = SPNOTES_ERR_FILE_READ;
+			return;
+		}
+		SPNOTES_STATS_ADD(job->instance, bytes_read, len);
+		if (spnotes_note_parse_buf(note, buf, len, job->instance) < 1) {
+			SPNOTES_STATS_ADD(job->instance, parse_failures, 1);
+			if (buf != scratch)
+				free(buf);
+			return;
+		}
+		spnotes_note_name_time(name, &note->created);
+	} else {
+		buf = spnotes_file_read_at(AT_FDCWD, note->path, scratch,
+		                           sizeof(scratch), &len);
+		if (buf == NULL) {
+			res->err = SPNOTES_ERR_FILE_READ;
+			return;
+		}
+	}
+
+	size_t line_no, body = spnotes_body_offset(buf, len, &line_no);
+
+	size_t cnt_pos = body, cnt_line = line_no;   /* line counting cursor */
+	size_t emit_pos = body, emit_line = line_no; /* end of emitted lines */
+	size_t after_left = 0, ls, le, from = body;
+
+	while (from < len && spnotes_grep_next(job, buf, from, len, &ls, &le)) {
+		cnt_line += spnotes_lines_count(buf, cnt_pos, ls);
+		cnt_pos = ls;
+
+		/* remaining context after the previous match */
+		while (after_left > 0 && emit_pos < ls) {
+			if (!spnotes_grep_emit(res, note, buf, len, &emit_pos,
+			                       emit_line++, 0))
+				goto err_malloc;
+			after_left--;
+		}
+
+		/* context before the match */
+		size_t b = ls, k = 0;
+		while (k < job->context && b > emit_pos) {
+			b--;
+			while (b > emit_pos && buf[b - 1] != '\n')
+				b--;
+			k++;
+		}
+		emit_pos  = b;
+		emit_line = cnt_line - k;
+		while (emit_pos < ls)
+			if (!spnotes_grep_emit(res, note, buf, len, &emit_pos,
+			                       emit_line++, 0))
+				goto err_malloc;
+
+		if (!spnotes_grep_emit(res, note, buf, len, &emit_pos,
+		                       emit_line++, 1))
+			goto err_malloc;
+		after_left = job->context;
+		from       = emit_pos;
+	}
+	while (after_left-- > 0 && emit_pos < len)
+		if (!spnotes_grep_emit(res, note, buf, len, &emit_pos,
+		                       emit_line++, 0))
+			goto err_malloc;
+
+	/* only the notes with lines in them are stat'ed */
+	if (note == &parsed && res->lines_c > 0) {
+		struct stat st;
+		SPNOTES_STATS_ADD(job->instance, stat_calls, 1);
+		if (fstatat(dir_fd, path, &st, 0) == 0)
+			note->last_modified = st.st_mtim;
+	}
+	if (note == &parsed && !spnotes_grep_own(res, note))
+		res->err = SPNOTES_ERR_MALLOC;
+	if (buf != scratch)
+		free(buf);
+	return;
+
+err_malloc:
+	res->err = SPNOTES_ERR_MALLOC;
+	if (note == &parsed) {
+		free(parsed.description);
+		free(parsed.tags);
+	}
+	if (buf != scratch)
+		free(buf);
+}
+
+/* escapes the ERE special characters in `literal` */
+static char *
+spnotes_regex_escape(const char *literal)
+{
+	char *escaped = malloc(strlen(literal) * 2 + 1), *p = escaped;
+	if (escaped == NULL)
+		return NULL;
+
+	for (; *literal; literal++) {
+		if (strchr("\\^$.[]|()*+?{}", *literal))
+			*p++ = '\\';
+		*p++ = *literal;
+	}
+	*p = '\0';
+	return escaped;
+}
+
+/* frees `line`, and its note if it owns it */
+static void
+spnotes_grep_line_free(spnotes_grep_line *line)
+{
+	free(line->text);
+	if (line->owns_note) {
+		free(line->note->description);
+		free(line->note->tags);
+		free(line->note);
+	}
+}
+
+/* adds a file of the `categ`-th category to be searched */
+static int
+spnotes_grep_add(spnotes_grep_job *job, spnotes_note *note, size_t categ,
+                 size_t name)
+{
+	if (job->files_c == job->mfiles_c) {
+		size_t             more = job->mfiles_c ? job->mfiles_c : 128;
+		spnotes_grep_file *tmp;
+		tmp = realloc(job->files,
+		              (job->mfiles_c + more) * sizeof(*tmp));
+		if (tmp == NULL)
+			return 0;
+		job->files = tmp;
+		job->mfiles_c += more;
+	}
+
+	job->files[job->files_c].note  = note;
+	job->files[job->files_c].categ = categ;
+	job->files[job->files_c].name  = name;
+	job->files_c++;
+	return 1;
+}
+
+/*
+ * Lists the note files of the unfilled `categ`-th category to be parsed by the
+ * search, keeping the directory open to open them in ('AT_FDCWD' if it can't
+ * be).
+ *
+ * Returns 0 on error and sets the `spnotes_err`.
+ */
+static int
+spnotes_grep_list(spnotes_grep_job *job, size_t categ)
+{
+	DIR *dir = opendir(job->instance->categs[categ].path);
+	if (dir == NULL) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		return 0;
+	}
+	SPNOTES_STATS_ADD(job->instance, dirs_scanned, 1);
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (!spnotes_scan_is_note(dirent))
+			continue;
+
+		size_t name_len = strlen(dirent->d_name) + 1;
+		if (job->names_len + name_len > job->mnames_len) {
+			size_t mnames_len = (job->mnames_len + name_len) * 2;
+			char  *tmp        = realloc(job->names, mnames_len);
+			if (tmp == NULL) {
+				spnotes_err = SPNOTES_ERR_REALLOC;
+				closedir(dir);
+				return 0;
+			}
+			job->names      = tmp;
+			job->mnames_len = mnames_len;
+		}
+		memcpy(job->names + job->names_len, dirent->d_name, name_len);
+		if (!spnotes_grep_add(job, NULL, categ, job->names_len)) {
+			spnotes_err = SPNOTES_ERR_REALLOC;
+			closedir(dir);
+			return 0;
+		}
+		job->names_len += name_len;
+	}
+	if (errno != 0) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		closedir(dir);
+		return 0;
+	}
+
+	job->dir_fds[categ] = dup(dirfd(dir));
+	if (job->dir_fds[categ] == -1)
+		job->dir_fds[categ] = AT_FDCWD;
+	closedir(dir);
+	return 1;
+}
+
+/* frees everything of `job` but the results and the regex */
+static void
+spnotes_grep_job_free(spnotes_grep_job *job, size_t categs_c)
+{
+	for (size_t i = 0; i < categs_c; i++)
+		if (job->dir_fds[i] != -1 && job->dir_fds[i] != AT_FDCWD)
+			close(job->dir_fds[i]);
+	free(job->dir_fds);
+	free(job->files);
+	free(job->names);
+}
+
+SPNOTES_DEF int
+spnotes_grep(spnotes_t *instance, const char *pattern, int flags,
+             size_t context, spnotes_grep_line **lines, size_t *lines_c)
+{
+	if (instance == NULL || pattern == NULL || lines == NULL ||
+	    lines_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+
+	spnotes_grep_job job;
+	job.instance    = instance;
+	job.pattern     = pattern;
+	job.pattern_len = strlen(pattern);
+	job.context     = context;
+
+	/* literals are searched with memchr(); everything else with regexec() */
+	job.is_regex = (flags & (SPNOTES_GREP_REGEX | SPNOTES_GREP_ICASE)) != 0;
+	if (job.is_regex) {
+		char *re = (flags & SPNOTES_GREP_REGEX) ?
+		                   (char *)pattern :
+		                   spnotes_regex_escape(pattern);
+		if (re == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			return -1;
+		}
+		int cflags = REG_EXTENDED | REG_NOSUB;
+		if (flags & SPNOTES_GREP_ICASE)
+			cflags |= REG_ICASE;
+		int rc = regcomp(&job.regex, re, cflags);
+		if (re != pattern)
+			free(re);
+		if (rc != 0) {
+			spnotes_err = SPNOTES_ERR_REGEX;
+			return -1;
+		}
+	}
+
+	/* the files of the unfilled categories are parsed by the search */
+	job.files      = NULL;
+	job.files_c    = 0;
+	job.mfiles_c   = 0;
+	job.names      = NULL;
+	job.names_len  = 0;
+	job.mnames_len = 0;
+	job.results    = NULL;
+	job.dir_fds    = malloc((instance->categs_c + 1) * sizeof(int));
+	int ok         = job.dir_fds != NULL;
+	if (!ok)
+		spnotes_err = SPNOTES_ERR_MALLOC;
+	for (size_t i = 0; ok && i < instance->categs_c; i++)
+		job.dir_fds[i] = -1;
+	for (size_t i = 0; ok && i < instance->categs_c; i++) {
+		spnotes_categ *categ = &instance->categs[i];
+		if (categ->notes == NULL) {
+			ok = spnotes_grep_list(&job, i);
+			continue;
+		}
+		for (size_t j = 0; ok && j < categ->notes_c; j++)
+			if (!spnotes_grep_add(&job, categ->notes + j, i, 0)) {
+				spnotes_err = SPNOTES_ERR_REALLOC;
+				ok          = 0;
+			}
+	}
+	if (ok) {
+		job.results = calloc(job.files_c + 1,
+		                     sizeof(spnotes_grep_result));
+		if (job.results == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			ok          = 0;
+		}
+	}
+	if (!ok) {
+		if (job.dir_fds != NULL)
+			spnotes_grep_job_free(&job, instance->categs_c);
+		if (job.is_regex)
+			regfree(&job.regex);
+		return -1;
+	}
+
+	spnotes_parallel_for(job.files_c, spnotes_grep_note, &job);
+	spnotes_grep_job_free(&job, instance->categs_c);
+
+	/* merge the results in the order of notes */
+	size_t total_c = 0, matches_c = 0;
+	int    err     = SPNOTES_ERR_NONE;
+	for (size_t i = 0; i < job.files_c; i++) {
+		total_c += job.results[i].lines_c;
+		matches_c += job.results[i].matches_c;
+		if (job.results[i].err != SPNOTES_ERR_NONE)
+			err = job.results[i].err;
+	}
+
+	spnotes_grep_line *merged = NULL;
+	if (err == SPNOTES_ERR_NONE) {
+		merged = malloc((total_c + 1) * sizeof(spnotes_grep_line));
+		if (merged == NULL)
+			err = SPNOTES_ERR_MALLOC;
+	}
+	for (size_t i = 0, k = 0; i < job.files_c; i++) {
+		spnotes_grep_result *res = &job.results[i];
+		if (merged == NULL) {
+			for (size_t j = 0; j < res->lines_c; j++)
+				spnotes_grep_line_free(&res->lines[j]);
+		} else if (res->lines_c > 0) {
+			memcpy(merged + k, res->lines,
+			       res->lines_c * sizeof(spnotes_grep_line));
+			k += res->lines_c;
+		}
+		free(res->lines);
+	}
+
+	free(job.results);
+	if (job.is_regex)
+		regfree(&job.regex);
+
+	if (err != SPNOTES_ERR_NONE) {
+		spnotes_err = err;
+		return -1;
+	}
+
+	*lines   = merged;
+	*lines_c = total_c;
+	return matches_c;
+}
+
+SPNOTES_DEF void
+spnotes_grep_free(spnotes_grep_line *lines, size_t lines_c)
+{
+	if (lines == NULL)
+		return;
+
+	for (size_t i = 0; i < lines_c; i++)
+		spnotes_grep_line_free(&lines[i]);
+	free(lines);
+}
+
+/* = Recent = */
+
+/* a note to be picked by 'spnotes_notes_recent()' */
+typedef struct {
+	struct timespec mtime;
+	size_t          categ; /* index on the categories */
+	size_t          note;  /* index on the notes of a filled category */
+	char           *name;  /* OR file name on an unfilled one */
+} spnotes_recent_cand;
+
+/* min-heap of the `bound` most recently modified candidates */
+typedef struct {
+	spnotes_recent_cand *cands;
+	size_t               cands_c, mcands_c, bound;
+	size_t               seen_c; /* candidates pushed, kept or not */
+	int                  err;
+} spnotes_recent_heap;
+
+typedef struct {
+	spnotes_t           *instance;
+	spnotes_recent_heap *heaps; /* one per category */
+} spnotes_recent_job;
+
+/* whether `a` is older than `b`, ties broken by the category and the note */
+static int
+spnotes_recent_older(const spnotes_recent_cand *a,
+                     const spnotes_recent_cand *b)
+{
+	if (a->mtime.tv_sec != b->mtime.tv_sec)
+		return a->mtime.tv_sec < b->mtime.tv_sec;
+	if (a->mtime.tv_nsec != b->mtime.tv_nsec)
+		return a->mtime.tv_nsec < b->mtime.tv_nsec;
+	if (a->categ != b->categ)
+		return a->categ > b->categ;
+	if (a->name && b->name)
+		return strcmp(a->name, b->name) > 0;
+	return a->note > b->note;
+}
+
+static void
+spnotes_recent_sift_down(spnotes_recent_heap *heap, size_t i)
+{
+	spnotes_recent_cand *cands = heap->cands;
+
+	for (;;) {
+		size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+		if (l < heap->cands_c &&
+		    spnotes_recent_older(&cands[l], &cands[min]))
+			min = l;
+		if (r < heap->cands_c &&
+		    spnotes_recent_older(&cands[r], &cands[min]))
+			min = r;
+		if (min == i)
+			return;
+		spnotes_recent_cand tmp = cands[i];
+		cands[i]                = cands[min];
+		cands[min]              = tmp;
+		i                       = min;
+	}
+}
+
+/*
+ * Pushes `cand` if it's among the `bound` newest seen so far, evicting the
+ * oldest one. Its `name` is duplicated once kept if `to_dup`, else it's taken
+ * over (and freed if not kept).
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_recent_push(spnotes_recent_heap *heap, spnotes_recent_cand cand,
+                    int to_dup)
+{
+	heap->seen_c++;
+	if (heap->cands_c == heap->bound) {
+		if (heap->bound == 0 ||
+		    spnotes_recent_older(&cand, &heap->cands[0])) {
+			if (!to_dup)
+				free(cand.name);
+			return 1;
+		}
+		free(heap->cands[0].name);
+		heap->cands_c--;
+		heap->cands[0] = heap->cands[heap->cands_c];
+		spnotes_recent_sift_down(heap, 0);
+	}
+	if (heap->cands_c == heap->mcands_c) {
+		size_t mcands_c = heap->mcands_c ? heap->mcands_c * 2 : 16;
+		if (mcands_c > heap->bound)
+			mcands_c = heap->bound;
+		spnotes_recent_cand *cands = realloc(
+			heap->cands, mcands_c * sizeof(spnotes_recent_cand));
+		if (cands == NULL) {
+			if (!to_dup)
+				free(cand.name);
+			return 0;
+		}
+		heap->cands    = cands;
+		heap->mcands_c = mcands_c;
+	}
+	if (to_dup && cand.name && (cand.name = strdup(cand.name)) == NULL)
+		return 0;
+
+	/* sift up */
+	size_t i = heap->cands_c++;
+	while (i > 0 &&
+	       spnotes_recent_older(&cand, &heap->cands[(i - 1) / 2])) {
+		heap->cands[i] = heap->cands[(i - 1) / 2];
+		i              = (i - 1) / 2;
+	}
+	heap->cands[i] = cand;
+	return 1;
+}
+
+static void
+spnotes_recent_heap_free(spnotes_recent_heap *heap)
+{
+	for (size_t i = 0; i < heap->cands_c; i++)
+		free(heap->cands[i].name);
+	free(heap->cands);
+	heap->cands    = NULL;
+	heap->cands_c  = 0;
+	heap->mcands_c = 0;
+}
+
+/* candidates of the `i`th category: from memory if filled, else by stat */
+static void
+spnotes_recent_job_func(size_t i, void *arg)
+{
+	spnotes_recent_job  *job   = arg;
+	spnotes_recent_heap *heap  = &job->heaps[i];
+	spnotes_categ       *categ = &job->instance->categs[i];
+
+	if (categ->notes) {
+		for (size_t j = 0; j < categ->notes_c; j++) {
+			spnotes_recent_cand cand = {
+				categ->notes[j].last_modified, i, j, NULL
+			};
+			if (!spnotes_recent_push(heap, cand, 1)) {
+				heap->err = SPNOTES_ERR_MALLOC;
+				return;
+			}
+		}
+		return;
+	}
+
+	DIR *dir = opendir(categ->path);
+	if (dir == NULL) {
+		heap->err = SPNOTES_ERR_DIR_READ;
+		return;
+	}
+	SPNOTES_STATS_ADD(job->instance, dirs_scanned, 1);
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		/* the same files as 'spnotes_notes_fill()' */
+		if (dirent->d_name[0] == '.' || dirent->d_type == DT_DIR)
+			continue;
+		if (!strstr(dirent->d_name, ".md") &&
+		    !strstr(dirent->d_name, ".MD"))
+			continue;
+
+		struct stat st;
+		SPNOTES_STATS_ADD(job->instance, stat_calls, 1);
+		if (fstatat(dirfd(dir), dirent->d_name, &st, 0) != 0) {
+			heap->err = SPNOTES_ERR_FILE_STAT;
+			break;
+		}
+		spnotes_recent_cand cand = { st.st_mtim, i, SIZE_MAX,
+			                     dirent->d_name };
+		if (!spnotes_recent_push(heap, cand, 1)) {
+			heap->err = SPNOTES_ERR_MALLOC;
+			break;
+		}
+	}
+	if (heap->err == SPNOTES_ERR_NONE && errno != 0)
+		heap->err = SPNOTES_ERR_DIR_READ;
+	closedir(dir);
+}
+
+/* newest first */
+static int
+spnotes_recent_compare(const void *a, const void *b)
+{
+	if (spnotes_recent_older(a, b))
+		return 1;
+	if (spnotes_recent_older(b, a))
+		return -1;
+	return 0;
+}
+
+/* copies `src` to `dst` with its own strings, returning 0 on no memory */
+static int
+spnotes_note_copy(spnotes_note *dst, const spnotes_note *src)
+{
+	*dst             = *src;
+	dst->description = NULL;
+	dst->tags        = NULL;
+	if (src->has_description &&
+	    (dst->description = strdup(src->description)) == NULL)
+		return 0;
+	if (src->tags && (dst->tags = strdup(src->tags)) == NULL) {
+		free(dst->description);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Parses the file `name` of `categ` into `note`, as 'spnotes_notes_fill()'
+ * would (`id` isn't set), with the last modified time `mtime` if known.
+ *
+ * Returns 1 on success, 0 if it isn't a valid note.
+ */
+static int
+spnotes_note_read(spnotes_categ *categ, const char *name,
+                  const struct timespec *mtime, spnotes_note *note)
+{
+	char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	snprintf(path, PATH_MAX, "%s%s", categ->path, name);
+#pragma GCC diagnostic pop
+	if (spnotes_note_parse(note, path, categ->spnotes_instance) < 1) {
+		SPNOTES_STATS_ADD(categ->spnotes_instance, parse_failures, 1);
+		return 0;
+	}
+	strcpy(note->path, path);
+	note->categ = categ;
+	note->id    = 0;
+
+	int named = spnotes_note_name_time(name, &note->created);
+	if (mtime) {
+		note->last_modified = *mtime;
+	} else if (!spnotes_note_mtime(categ->spnotes_instance, path, named,
+	                               &note->last_modified)) {
+		free(note->description);
+		free(note->tags);
+		return 0; /* gone meanwhile */
+	}
+	return 1;
+}
+
+/* fills `note` from `cand`, returning 0 if it isn't a valid note */
+static int
+spnotes_recent_note(spnotes_t *instance, const spnotes_recent_cand *cand,
+                    spnotes_note *note)
+{
+	spnotes_categ *categ = &instance->categs[cand->categ];
+
+	if (cand->name == NULL)
+		return spnotes_note_copy(note, &categ->notes[cand->note]) ? 1 :
+		                                                            -1;
+	return spnotes_note_read(categ, cand->name, &cand->mtime, note);
+}
+
+/* frees the strings of the first `notes_c` of `notes` */
+static void
+spnotes_recent_free_strings(spnotes_note *notes, size_t notes_c)
+{
+	for (size_t i = 0; i < notes_c; i++) {
+		free(notes[i].description);
+		free(notes[i].tags);
+	}
+}
+
+/*
+ * Picks the `bound` newest candidates of all the categories and parses them
+ * newest first into `notes` (allocated here) until `k` are valid notes.
+ *
+ * Returns the number of notes filled OR -1 on error, and sets `exhausted` if
+ * all the candidates were kept (so that a larger bound can't find more).
+ */
+static int
+spnotes_recent_pick(spnotes_t *instance, size_t k, size_t bound,
+                    spnotes_note **notes, int *exhausted)
+{
+	size_t               categs_c = instance->categs_c;
+	spnotes_recent_heap *heaps    = calloc(categs_c + 1, sizeof(*heaps));
+	spnotes_recent_heap  all      = { 0 };
+	int                  notes_c  = 0;
+
+	if (heaps == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	all.bound = bound;
+	for (size_t i = 0; i < categs_c; i++)
+		heaps[i].bound = bound;
+
+	spnotes_recent_job job = { instance, heaps };
+	spnotes_parallel_for(categs_c, spnotes_recent_job_func, &job);
+
+	/* the newest of the newest of every category */
+	for (size_t i = 0; i < categs_c; i++) {
+		if (heaps[i].err != SPNOTES_ERR_NONE) {
+			spnotes_err = heaps[i].err;
+			notes_c     = -1;
+			goto end;
+		}
+		all.seen_c += heaps[i].seen_c - heaps[i].cands_c;
+		for (size_t j = 0; j < heaps[i].cands_c; j++) {
+			spnotes_recent_cand cand = heaps[i].cands[j];
+			heaps[i].cands[j].name   = NULL; /* taken over */
+			if (!spnotes_recent_push(&all, cand, 0)) {
+				spnotes_err = SPNOTES_ERR_MALLOC;
+				notes_c     = -1;
+				goto end;
+			}
+		}
+	}
+	*exhausted = all.seen_c == all.cands_c;
+
+	*notes = malloc((all.cands_c < k ? all.cands_c : k) *
+	                        sizeof(spnotes_note) +
+	                1);
+	if (*notes == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		notes_c     = -1;
+		goto end;
+	}
+	if (all.cands_c > 0)
+		qsort(all.cands, all.cands_c, sizeof(spnotes_recent_cand),
+		      spnotes_recent_compare);
+	for (size_t i = 0; i < all.cands_c && (size_t)notes_c < k; i++) {
+		int ret = spnotes_recent_note(instance, &all.cands[i],
+		                              &(*notes)[notes_c]);
+		if (ret < 0) {
+			spnotes_recent_free_strings(*notes, notes_c);
+			free(*notes);
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			notes_c     = -1;
+			goto end;
+		}
+		notes_c += ret;
+	}
+
+end:
+	for (size_t i = 0; i < categs_c; i++)
+		spnotes_recent_heap_free(&heaps[i]);
+	free(heaps);
+	spnotes_recent_heap_free(&all);
+	return notes_c;
+}
+
+SPNOTES_DEF int
+spnotes_notes_recent(spnotes_t *instance, size_t k, spnotes_note **notes,
+                     size_t *notes_c)
+{
+	if (instance == NULL || notes == NULL || notes_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+	*notes   = NULL;
+	*notes_c = 0;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_recent", NULL);
+	/*
+	 * The newest files might not all be notes (no valid header), so pick
+	 * again with a larger bound if some of those got in the way.
+	 */
+	spnotes_note *recent;
+	size_t        bound = k;
+	int           recent_c, exhausted = 0;
+	for (;;) {
+		recent_c = spnotes_recent_pick(instance, k, bound, &recent,
+		                               &exhausted);
+		if (recent_c < 0 || (size_t)recent_c == k || exhausted)
+			break;
+		spnotes_recent_free_strings(recent, recent_c);
+		free(recent);
+		bound *= 2;
+	}
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_recent", NULL);
+
+	if (recent_c < 0)
+		return -1;
+	*notes   = recent;
+	*notes_c = recent_c;
+	return recent_c;
+}
+
+SPNOTES_DEF void
+spnotes_notes_recent_free(spnotes_note *notes, size_t notes_c)
+{
+	if (notes == NULL)
+		return;
+
+	spnotes_recent_free_strings(notes, notes_c);
+	free(notes);
+}
+
+/* = Pages = */
+
+/* a note to be paged by 'spnotes_notes_page()' */
+typedef struct {
+	struct timespec mtime; /* OR created with 'SPNOTES_PAGE_CREATED' */
+	const char     *title; /* NULL if not read yet */
+	const char     *name;  /* file name, the tie breaker */
+	size_t          note;  /* index on the notes of a filled category */
+} spnotes_page_cand;
+
+/* newest first */
+static int
+spnotes_page_compare_last_modified(const void *a, const void *b)
+{
+	const spnotes_page_cand *ca = a, *cb = b;
+
+	if (ca->mtime.tv_sec != cb->mtime.tv_sec)
+		return ca->mtime.tv_sec > cb->mtime.tv_sec ? -1 : 1;
+	if (ca->mtime.tv_nsec != cb->mtime.tv_nsec)
+		return ca->mtime.tv_nsec > cb->mtime.tv_nsec ? -1 : 1;
+	return strcmp(ca->name, cb->name);
+}
+
+/* ascending title */
+static int
+spnotes_page_compare_alphabetically(const void *a, const void *b)
+{
+	const spnotes_page_cand *ca = a, *cb = b;
+
+	int cmp = strcmp(ca->title, cb->title);
+	return cmp ? cmp : strcmp(ca->name, cb->name);
+}
+
+static void
+spnotes_page_swap(spnotes_page_cand *a, spnotes_page_cand *b)
+{
+	spnotes_page_cand tmp = *a;
+	*a                    = *b;
+	*b                    = tmp;
+}
+
+/*
+ * Moves the first `k` of the `cands_c` candidates in the order of `compare`
+ * to the front, in no particular order (quickselect).
+ */
+static void
+spnotes_page_select(spnotes_page_cand *cands, size_t cands_c, size_t k,
+                    int (*compare)(const void *, const void *))
+{
+	size_t lo = 0, hi = cands_c;
+
+	while (lo < k && k < hi && hi - lo > 1) {
+		/* median of three as the pivot, moved to the end */
+		size_t mid = lo + (hi - lo) / 2, last = hi - 1;
+		if (compare(&cands[mid], &cands[lo]) < 0)
+			spnotes_page_swap(&cands[mid], &cands[lo]);
+		if (compare(&cands[last], &cands[lo]) < 0)
+			spnotes_page_swap(&cands[last], &cands[lo]);
+		if (compare(&cands[mid], &cands[last]) < 0)
+			spnotes_page_swap(&cands[mid], &cands[last]);
+
+		size_t store = lo;
+		for (size_t i = lo; i < last; i++)
+			if (compare(&cands[i], &cands[last]) < 0)
+				spnotes_page_swap(&cands[i], &cands[store++]);
+		spnotes_page_swap(&cands[store], &cands[last]);
+
+		if (store == k || store + 1 == k)
+			return;
+		if (k < store)
+			hi = store;
+		else
+			lo = store + 1;
+	}
+}
+
+static void
+spnotes_cursor_hex(char *dst, const char *src)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	for (; *src; src++) {
+		*dst++ = digits[(unsigned char)*src >> 4];
+		*dst++ = digits[(unsigned char)*src & 0xf];
+	}
+	*dst = '\0';
+}
+
+static int
+spnotes_cursor_hexval(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/*
+ * Decodes the hex of `src` up to `end` into `dst` of `dst_size` bytes.
+ *
+ * Returns 0 if it isn't valid.
+ */
+static int
+spnotes_cursor_unhex(char *dst, size_t dst_size, const char *src,
+                     const char *end)
+{
+	if ((end - src) % 2 || (size_t)(end - src) / 2 >= dst_size)
+		return 0;
+	for (; src < end; src += 2) {
+		int hi = spnotes_cursor_hexval(src[0]);
+		int lo = spnotes_cursor_hexval(src[1]);
+		if (hi < 0 || lo < 0 || (hi == 0 && lo == 0))
+			return 0;
+		*dst++ = (char)(hi << 4 | lo);
+	}
+	*dst = '\0';
+	return 1;
+}
+
+/* writes the cursor of `cand` into `cursor` */
+static void
+spnotes_cursor_encode(char *cursor, const spnotes_page_cand *cand, int flags)
+{
+	if (flags & SPNOTES_PAGE_ALPHABET) {
+		*cursor++ = 'a';
+		spnotes_cursor_hex(cursor, cand->title);
+		cursor += strlen(cursor);
+	} else {
+		cursor += sprintf(cursor, "%c%llx.%lx",
+		                  flags & SPNOTES_PAGE_CREATED ? 'c' : 'm',
+		                  (unsigned long long)cand->mtime.tv_sec,
+		                  (unsigned long)cand->mtime.tv_nsec);
+	}
+	*cursor++ = '.';
+	spnotes_cursor_hex(cursor, cand->name);
+}
+
+/*
+ * Decodes `cursor` into `cand`, pointing to `title` and `name` of NAME_MAX
+ * bytes each.
+ *
+ * Returns 0 if it isn't a valid cursor of the given `flags`.
+ */
+static int
+spnotes_cursor_decode(const char *cursor, int flags, spnotes_page_cand *cand,
+                      char *title, char *name)
+{
+	const char *dot = strrchr(cursor, '.');
+	if (dot == NULL || !spnotes_cursor_unhex(name, NAME_MAX, dot + 1,
+	                                         dot + strlen(dot)))
+		return 0;
+	cand->name = name;
+
+	if (flags & SPNOTES_PAGE_ALPHABET) {
+		cand->title = title;
+		return cursor[0] == 'a' &&
+		       spnotes_cursor_unhex(title, NAME_MAX, cursor + 1, dot);
+	}
+
+	unsigned long long sec;
+	unsigned long      nsec;
+	int                len;
+	if (cursor[0] != (flags & SPNOTES_PAGE_CREATED ? 'c' : 'm') ||
+	    sscanf(cursor + 1, "%llx.%lx%n", &sec, &nsec, &len) != 2 ||
+	    cursor + 1 + len != dot || nsec >= 1000000000UL)
+		return 0;
+	cand->mtime.tv_sec  = (time_t)sec;
+	cand->mtime.tv_nsec = (long)nsec;
+	return 1;
+}
+
+/*
+ * Fills up `cands` with the notes of the filled `categ`, else with the note
+ * files of it by a stat of each (their names being duplicated), or by their
+ * names alone with 'SPNOTES_PAGE_CREATED' in `flags`.
+ *
+ * Returns the number of candidates OR -1 on error.
+ */
+static int
+spnotes_page_cands(spnotes_categ *categ, int flags, spnotes_page_cand **cands)
+{
+	if (categ->notes) {
+		*cands = malloc(categ->notes_c * sizeof(spnotes_page_cand) + 1);
+		if (*cands == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			return -1;
+		}
+		for (size_t i = 0; i < categ->notes_c; i++) {
+			const spnotes_note *note  = &categ->notes[i];
+			const char         *slash = strrchr(note->path, '/');
+			(*cands)[i].mtime = flags & SPNOTES_PAGE_CREATED ?
+			                            note->created :
+			                            note->last_modified;
+			(*cands)[i].title = note->title;
+			(*cands)[i].name  = slash ? slash + 1 : note->path;
+			(*cands)[i].note  = i;
+		}
+		return categ->notes_c;
+	}
+
+	DIR *dir = opendir(categ->path);
+	if (dir == NULL) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		return -1;
+	}
+	SPNOTES_STATS_ADD(categ->spnotes_instance, dirs_scanned, 1);
+
+	int cands_c = 0, mcands_c = 128;
+	*cands      = malloc(mcands_c * sizeof(spnotes_page_cand));
+	if (*cands == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		closedir(dir);
+		return -1;
+	}
+
+	errno = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		/* the same files as 'spnotes_notes_fill()' */
+		if (dirent->d_name[0] == '.' || dirent->d_type == DT_DIR)
+			continue;
+		if (!strstr(dirent->d_name, ".md") &&
+		    !strstr(dirent->d_name, ".MD"))
+			continue;
+
+		if (cands_c == mcands_c) {
+			spnotes_page_cand *temp_cands = realloc(
+				*cands, mcands_c * 2 * sizeof(spnotes_page_cand));
+			if (temp_cands == NULL) {
+				spnotes_err = SPNOTES_ERR_REALLOC;
+				goto fail;
+			}
+			*cands = temp_cands;
+			mcands_c *= 2;
+		}
+
+		struct timespec when;
+		if (flags & SPNOTES_PAGE_CREATED) {
+			spnotes_note_name_time(dirent->d_name, &when);
+		} else {
+			struct stat st;
+			SPNOTES_STATS_ADD(categ->spnotes_instance, stat_calls,
+			                  1);
+			if (fstatat(dirfd(dir), dirent->d_name, &st, 0) != 0) {
+				spnotes_err = SPNOTES_ERR_FILE_STAT;
+				goto fail;
+			}
+			when = st.st_mtim;
+		}
+		char *name = strdup(dirent->d_name);
+		if (name == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			goto fail;
+		}
+		(*cands)[cands_c].mtime = when;
+		(*cands)[cands_c].title = NULL;
+		(*cands)[cands_c].name  = name;
+		(*cands)[cands_c].note  = SIZE_MAX;
+		cands_c++;
+	}
+	if (errno != 0) {
+		spnotes_err = SPNOTES_ERR_DIR_READ;
+		goto fail;
+	}
+	closedir(dir);
+	return cands_c;
+
+fail:
+	for (int i = 0; i < cands_c; i++)
+		free((char *)(*cands)[i].name);
+	free(*cands);
+	closedir(dir);
+	return -1;
+}
+
+SPNOTES_DEF int
+spnotes_notes_page(spnotes_categ *categ, int flags, const char *after,
+                   size_t limit, spnotes_note **notes, size_t *notes_c,
+                   char *next)
+{
+	if (categ == NULL || notes == NULL || notes_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	*notes   = NULL;
+	*notes_c = 0;
+	if (next)
+		next[0] = '\0';
+	if (limit == 0)
+		limit = SIZE_MAX;
+
+	spnotes_page_cand cursor;
+	char              cursor_title[NAME_MAX], cursor_name[NAME_MAX];
+	if (after && !spnotes_cursor_decode(after, flags, &cursor,
+	                                    cursor_title, cursor_name)) {
+		spnotes_err = SPNOTES_ERR_CURSOR;
+		return -1;
+	}
+
+	/* the order of titles needs every header */
+	if ((flags & SPNOTES_PAGE_ALPHABET) && categ->notes == NULL &&
+	    spnotes_notes_fill(categ) < 0)
+		return -1;
+	int (*compare)(const void *, const void *) =
+		flags & SPNOTES_PAGE_ALPHABET ?
+			spnotes_page_compare_alphabetically :
+			spnotes_page_compare_last_modified;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_page", categ->path);
+	int                ret = -1;
+	spnotes_page_cand *cands;
+	int                all_c = spnotes_page_cands(categ, flags, &cands);
+	if (all_c < 0)
+		goto end;
+	int owns_names = categ->notes == NULL;
+
+	/* drop the ones up to the cursor */
+	size_t cands_c = 0;
+	for (int i = 0; i < all_c; i++) {
+		if (after && compare(&cands[i], &cursor) <= 0) {
+			if (owns_names)
+				free((char *)cands[i].name);
+			continue;
+		}
+		cands[cands_c++] = cands[i];
+	}
+
+	*notes = malloc((cands_c < limit ? cands_c : limit) *
+	                        sizeof(spnotes_note) +
+	                1);
+	if (*notes == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto free_cands;
+	}
+
+	/*
+	 * Select and order just the next ones of the page, again if some of
+	 * those files weren't notes.
+	 */
+	size_t lo = 0;
+	while (*notes_c < limit && lo < cands_c) {
+		size_t hi = limit - *notes_c < cands_c - lo ?
+		                    lo + (limit - *notes_c) :
+		                    cands_c;
+		spnotes_page_select(cands + lo, cands_c - lo, hi - lo, compare);
+		qsort(cands + lo, hi - lo, sizeof(spnotes_page_cand), compare);
+
+		for (; lo < hi; lo++) {
+			spnotes_note *note = &(*notes)[*notes_c];
+			if (!owns_names) {
+				if (!spnotes_note_copy(
+					    note, &categ->notes[cands[lo].note])) {
+					spnotes_recent_free_strings(*notes,
+					                            *notes_c);
+					free(*notes);
+					*notes      = NULL;
+					*notes_c    = 0;
+					spnotes_err = SPNOTES_ERR_MALLOC;
+					goto free_cands;
+				}
+			} else if (!spnotes_note_read(
+					   categ, cands[lo].name,
+					   flags & SPNOTES_PAGE_CREATED ?
+						   NULL :
+						   &cands[lo].mtime,
+					   note)) {
+				continue;
+			}
+			(*notes_c)++;
+		}
+	}
+	/* the last one looked at, even if it wasn't a note */
+	if (next && lo < cands_c)
+		spnotes_cursor_encode(next, &cands[lo - 1], flags);
+	ret = *notes_c;
+
+free_cands:
+	if (owns_names)
+		for (size_t i = 0; i < cands_c; i++)
+			free((char *)cands[i].name);
+	free(cands);
+end:
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_page", categ->path);
+	return ret;
+}
+
+/* = Tags = */
+
+#define SPNOTES_BITMAP_WORDS     1024 /* 65536 bits */
+#define SPNOTES_BITMAP_ARRAY_MAX 4096
+
+static int
+spnotes_popcount(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(w);
+#else
+	int c = 0;
+	for (; w; c++)
+		w &= w - 1;
+	return c;
+#endif
+}
+
+static void
+spnotes_bitmap_free(spnotes_bitmap *bm)
+{
+	for (size_t i = 0; i < bm->conts_c; i++) {
+		free(bm->conts[i].array);
+		free(bm->conts[i].bitmap);
+	}
+	free(bm->conts);
+	bm->conts   = NULL;
+	bm->conts_c = bm->mconts_c = 0;
+}
+
+/* appends `cont` to `bm` taking the ownership of its memory */
+static int
+spnotes_bitmap_push(spnotes_bitmap *bm, spnotes_container cont)
+{
+	if (bm->conts_c == bm->mconts_c) {
+		size_t             mconts_c = bm->mconts_c ? bm->mconts_c * 2 : 4;
+		spnotes_container *tmp =
+			realloc(bm->conts, mconts_c * sizeof(spnotes_container));
+		if (tmp == NULL) {
+			free(cont.array);
+			free(cont.bitmap);
+			return 0;
+		}
+		bm->conts    = tmp;
+		bm->mconts_c = mconts_c;
+	}
+	bm->conts[bm->conts_c++] = cont;
+	return 1;
+}
+
+/* adds `id` to `bm`; ids have to be added in ascending order */
+static int
+spnotes_bitmap_add(spnotes_bitmap *bm, uint32_t id)
+{
+	uint16_t key = id >> 16, low = id & 0xFFFF;
+
+	if (bm->conts_c == 0 || bm->conts[bm->conts_c - 1].key != key) {
+		spnotes_container cont = { key, 0, NULL, NULL };
+		cont.array = malloc(4 * sizeof(uint16_t));
+		if (cont.array == NULL || !spnotes_bitmap_push(bm, cont))
+			return 0;
+	}
+
+	spnotes_container *cont = &bm->conts[bm->conts_c - 1];
+	if (cont->bitmap) {
+		cont->card += !(cont->bitmap[low >> 6] & (1ULL << (low & 63)));
+		cont->bitmap[low >> 6] |= 1ULL << (low & 63);
+		return 1;
+	}
+	if (cont->card > 0 && cont->array[cont->card - 1] == low)
+		return 1;
+
+	/* convert to a bitmap container once the array is full */
+	if (cont->card == SPNOTES_BITMAP_ARRAY_MAX) {
+		uint64_t *words = calloc(SPNOTES_BITMAP_WORDS, sizeof(uint64_t));
+		if (words == NULL)
+			return 0;
+		for (uint32_t i = 0; i < cont->card; i++)
+			words[cont->array[i] >> 6] |= 1ULL
+			                              << (cont->array[i] & 63);
+		words[low >> 6] |= 1ULL << (low & 63);
+		free(cont->array);
+		cont->array  = NULL;
+		cont->bitmap = words;
+		cont->card++;
+		return 1;
+	}
+
+	/* grow the array by doubling */
+	if ((cont->card & (cont->card - 1)) == 0 && cont->card >= 4) {
+		uint16_t *tmp =
+			realloc(cont->array, cont->card * 2 * sizeof(uint16_t));
+		if (tmp == NULL)
+			return 0;
+		cont->array = tmp;
+	}
+	cont->array[cont->card++] = low;
+	return 1;
+}
+
+static void
+spnotes_container_words(const spnotes_container *cont, uint64_t *words)
+{
+	if (cont->bitmap) {
+		memcpy(words, cont->bitmap, SPNOTES_BITMAP_WORDS * sizeof(uint64_t));
+		return;
+	}
+	memset(words, 0, SPNOTES_BITMAP_WORDS * sizeof(uint64_t));
+	for (uint32_t i = 0; i < cont->card; i++)
+		words[cont->array[i] >> 6] |= 1ULL << (cont->array[i] & 63);
+}
+
+/* appends a container made out of `words` to `bm` in its compact form */
+static int
+spnotes_bitmap_push_words(spnotes_bitmap *bm, uint16_t key,
+                          const uint64_t *words)
+{
+	spnotes_container cont = { key, 0, NULL, NULL };
+
+	for (size_t i = 0; i < SPNOTES_BITMAP_WORDS; i++)
+		cont.card += spnotes_popcount(words[i]);
+	if (cont.card == 0)
+		return 1;
+
+	if (cont.card > SPNOTES_BITMAP_ARRAY_MAX) {
+		cont.bitmap = malloc(SPNOTES_BITMAP_WORDS * sizeof(uint64_t));
+		if (cont.bitmap == NULL)
+			return 0;
+		memcpy(cont.bitmap, words, SPNOTES_BITMAP_WORDS * sizeof(uint64_t));
+		return spnotes_bitmap_push(bm, cont);
+	}
+
+	cont.array = malloc(cont.card * sizeof(uint16_t));
+	if (cont.array == NULL)
+		return 0;
+	for (size_t i = 0, k = 0; i < SPNOTES_BITMAP_WORDS; i++)
+		for (uint64_t w = words[i]; w; w &= w - 1)
+			cont.array[k++] = i * 64 + spnotes_popcount((w & -w) - 1);
+	return spnotes_bitmap_push(bm, cont);
+}
+
+static int
+spnotes_bitmap_push_copy(spnotes_bitmap *bm, const spnotes_container *cont)
+{
+	uint64_t words[SPNOTES_BITMAP_WORDS];
+
+	spnotes_container_words(cont, words);
+	return spnotes_bitmap_push_words(bm, cont->key, words);
+}
+
+#define SPNOTES_OP_AND    0
+#define SPNOTES_OP_OR     1
+#define SPNOTES_OP_ANDNOT 2
+
+/* `out` = `a` op `b`; containers are combined key by key */
+static int
+spnotes_bitmap_op(const spnotes_bitmap *a, const spnotes_bitmap *b, int op,
+                  spnotes_bitmap *out)
+{
+	uint64_t wa[SPNOTES_BITMAP_WORDS], wb[SPNOTES_BITMAP_WORDS];
+	size_t   i = 0, j = 0;
+
+	out->conts   = NULL;
+	out->conts_c = out->mconts_c = 0;
+
+	while (i < a->conts_c || j < b->conts_c) {
+		int ok = 1;
+
+		if (j == b->conts_c ||
+		    (i < a->conts_c && a->conts[i].key < b->conts[j].key)) {
+			if (op != SPNOTES_OP_AND)
+				ok = spnotes_bitmap_push_copy(out, &a->conts[i]);
+			i++;
+		} else if (i == a->conts_c || b->conts[j].key < a->conts[i].key) {
+			if (op == SPNOTES_OP_OR)
+				ok = spnotes_bitmap_push_copy(out, &b->conts[j]);
+			j++;
+		} else {
+			spnotes_container_words(&a->conts[i], wa);
+			spnotes_container_words(&b->conts[j], wb);
+			for (size_t k = 0; k < SPNOTES_BITMAP_WORDS; k++)
+				wa[k] = op == SPNOTES_OP_AND ? wa[k] & wb[k] :
+				        op == SPNOTES_OP_OR  ? wa[k] | wb[k] :
+				                               wa[k] & ~wb[k];
+			ok = spnotes_bitmap_push_words(out, a->conts[i].key, wa);
+			i++;
+			j++;
+		}
+
+		if (!ok) {
+			spnotes_bitmap_free(out);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void
+spnotes_tags_index_free(spnotes_t *instance)
+{
+	spnotes_tags *tags = instance->tags;
+	if (tags == NULL)
+		return;
+
+	for (size_t i = 0; i < tags->tags_c; i++) {
+		free(tags->names[i]);
+		spnotes_bitmap_free(&tags->bitmaps[i]);
+	}
+	free(tags->names);
+	free(tags->bitmaps);
+	free(tags->table);
+	free(tags);
+	instance->tags = NULL;
+}
+
+/*
+ * Assigns an id to every filled note of `instance` (filling up 'notes_by_id')
+ * unless they all still have the one they were given, freeing the indexes of
+ * the old ids. Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_notes_ids_assign(spnotes_t *instance)
+{
+	size_t notes_c = 0;
+	for (size_t i = 0; i < instance->categs_c; i++)
+		notes_c += instance->categs[i].notes_c;
+
+	if (instance->notes_by_id && instance->notes_by_id_c == notes_c) {
+		int same = 1;
+		for (size_t i = 0; i < instance->categs_c && same; i++)
+			for (size_t j = 0; j < instance->categs[i].notes_c; j++) {
+				spnotes_note *note = &instance->categs[i].notes[j];
+				if (note->id >= notes_c ||
+				    instance->notes_by_id[note->id] != note) {
+					same = 0;
+					break;
+				}
+			}
+		if (same)
+			return 1;
+	}
+
+	spnotes_indexes_free(instance);
+	instance->notes_by_id = malloc((notes_c + 1) * sizeof(spnotes_note *));
+	if (instance->notes_by_id == NULL)
+		return 0;
+	for (size_t i = 0, k = 0; i < instance->categs_c; i++)
+		for (size_t j = 0; j < instance->categs[i].notes_c; j++, k++) {
+			instance->categs[i].notes[j].id = k;
+			instance->notes_by_id[k] = instance->categs[i].notes + j;
+		}
+	instance->notes_by_id_c = notes_c;
+	return 1;
+}
+
+/*
+ * Returns the id of the tag `name` (of length `len`), interning it if `add` is
+ * non-zero. Returns -1 if not found or on allocation failure (when adding).
+ */
+static long
+spnotes_tags_intern(spnotes_tags *tags, const char *name, size_t len, int add)
+{
+	size_t mask = tags->table_c - 1;
+	size_t slot = spnotes_hash_str(name, len) & mask;
+
+	for (; tags->table[slot]; slot = (slot + 1) & mask) {
+		const char *found = tags->names[tags->table[slot] - 1];
+		if (!strncmp(found, name, len) && found[len] == '\0')
+			return tags->table[slot] - 1;
+	}
+	if (!add)
+		return -1;
+
+	/* keep the load factor under 1/2 */
+	if ((tags->tags_c + 1) * 2 > tags->table_c) {
+		size_t  table_c = tags->table_c * 2;
+		size_t *table   = calloc(table_c, sizeof(size_t));
+		if (table == NULL)
+			return -1;
+		for (size_t i = 0; i < tags->tags_c; i++) {
+			size_t s = spnotes_hash_str(tags->names[i],
+			                            strlen(tags->names[i])) &
+			           (table_c - 1);
+			while (table[s])
+				s = (s + 1) & (table_c - 1);
+			table[s] = i + 1;
+		}
+		free(tags->table);
+		tags->table   = table;
+		tags->table_c = table_c;
+
+		mask = table_c - 1;
+		slot = spnotes_hash_str(name, len) & mask;
+		while (tags->table[slot])
+			slot = (slot + 1) & mask;
+	}
+
+	if (tags->tags_c == tags->mtags_c) {
+		size_t mtags_c = tags->mtags_c ? tags->mtags_c * 2 : 16;
+		char **names   = realloc(tags->names, mtags_c * sizeof(char *));
+		if (names == NULL)
+			return -1;
+		tags->names = names;
+		spnotes_bitmap *bitmaps =
+			realloc(tags->bitmaps, mtags_c * sizeof(spnotes_bitmap));
+		if (bitmaps == NULL)
+			return -1;
+		tags->bitmaps = bitmaps;
+		tags->mtags_c = mtags_c;
+	}
+
+	char *dup = strndup(name, len);
+	if (dup == NULL)
+		return -1;
+	tags->names[tags->tags_c]            = dup;
+	tags->bitmaps[tags->tags_c].conts    = NULL;
+	tags->bitmaps[tags->tags_c].conts_c  = 0;
+	tags->bitmaps[tags->tags_c].mconts_c = 0;
+	tags->table[slot]                    = tags->tags_c + 1;
+
+	return tags->tags_c++;
+}
+
+SPNOTES_DEF int
+spnotes_tags_index_build(spnotes_t *instance)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+
+	spnotes_tags_index_free(instance);
+	if (!spnotes_notes_ids_assign(instance))
+		goto err_malloc;
+	instance->tags = calloc(1, sizeof(spnotes_tags));
+	if (instance->tags == NULL)
+		goto err_malloc;
+	size_t notes_c = instance->notes_by_id_c;
+
+	/* intern the tags and fill their bitmaps */
+	spnotes_tags *tags = instance->tags;
+	tags->table_c      = 64;
+	tags->table        = calloc(tags->table_c, sizeof(size_t));
+	if (tags->table == NULL)
+		goto err_malloc;
+
+	for (size_t id = 0; id < notes_c; id++) {
+		const char *p = instance->notes_by_id[id]->tags;
+
+		while (p && *p) {
+			size_t len = strcspn(p, ",");
+			long   tag = spnotes_tags_intern(tags, p, len, 1);
+			if (tag < 0 || !spnotes_bitmap_add(&tags->bitmaps[tag], id))
+				goto err_malloc;
+			p += len + (p[len] == ',');
+		}
+	}
+
+	return tags->tags_c;
+
+err_malloc:
+	spnotes_tags_index_free(instance);
+	spnotes_err = SPNOTES_ERR_MALLOC;
+	return -1;
+}
+
+typedef struct {
+	const char *p;
+	spnotes_t  *instance;
+	int         err;
+} spnotes_query;
+
+static int
+spnotes_query_or(spnotes_query *q, spnotes_bitmap *out);
+
+static void
+spnotes_query_skip_space(spnotes_query *q)
+{
+	while (*q->p == ' ' || *q->p == '\t')
+		q->p++;
+}
+
+/* factor := '!' factor | '(' or ')' | tag */
+static int
+spnotes_query_factor(spnotes_query *q, spnotes_bitmap *out)
+{
+	spnotes_query_skip_space(q);
+
+	if (*q->p == '!') {
+		q->p++;
+
+		spnotes_bitmap operand, all = { NULL, 0, 0 };
+		if (!spnotes_query_factor(q, &operand))
+			return 0;
+		for (size_t id = 0; id < q->instance->notes_by_id_c; id++)
+			if (!spnotes_bitmap_add(&all, id)) {
+				spnotes_bitmap_free(&all);
+				spnotes_bitmap_free(&operand);
+				q->err = SPNOTES_ERR_MALLOC;
+				return 0;
+			}
+		int ok = spnotes_bitmap_op(&all, &operand, SPNOTES_OP_ANDNOT, out);
+		spnotes_bitmap_free(&all);
+		spnotes_bitmap_free(&operand);
+		if (!ok)
+			q->err = SPNOTES_ERR_MALLOC;
+		return ok;
+	}
+
+	if (*q->p == '(') {
+		q->p++;
+		if (!spnotes_query_or(q, out))
+			return 0;
+		spnotes_query_skip_space(q);
+		if (*q->p != ')') {
+			spnotes_bitmap_free(out);
+			q->err = SPNOTES_ERR_QUERY;
+			return 0;
+		}
+		q->p++;
+		return 1;
+	}
+
+	size_t len = strcspn(q->p, "&|!() \t");
+	if (len == 0) {
+		q->err = SPNOTES_ERR_QUERY;
+		return 0;
+	}
+
+	spnotes_bitmap empty = { NULL, 0, 0 };
+	long           tag   = spnotes_tags_intern(q->instance->tags, q->p, len, 0);
+	q->p += len;
+
+	/* copy through an OR with an empty bitmap */
+	if (!spnotes_bitmap_op(tag < 0 ? &empty :
+	                                 &q->instance->tags->bitmaps[tag],
+	                       &empty, SPNOTES_OP_OR, out)) {
+		q->err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	return 1;
+}
+
+/* and := factor ('&' factor)* */
+static int
+spnotes_query_and(spnotes_query *q, spnotes_bitmap *out)
+{
+	if (!spnotes_query_factor(q, out))
+		return 0;
+
+	for (spnotes_query_skip_space(q); *q->p == '&';
+	     spnotes_query_skip_space(q)) {
+		q->p++;
+
+		spnotes_bitmap rhs, res;
+		if (!spnotes_query_factor(q, &rhs)) {
+			spnotes_bitmap_free(out);
+			return 0;
+		}
+		int ok = spnotes_bitmap_op(out, &rhs, SPNOTES_OP_AND, &res);
+		spnotes_bitmap_free(out);
+		spnotes_bitmap_free(&rhs);
+		if (!ok) {
+			q->err = SPNOTES_ERR_MALLOC;
+			return 0;
+		}
+		*out = res;
+	}
+	return 1;
+}
+
+/* or := and ('|' and)* */
+static int
+spnotes_query_or(spnotes_query *q, spnotes_bitmap *out)
+{
+	if (!spnotes_query_and(q, out))
+		return 0;
+
+	for (spnotes_query_skip_space(q); *q->p == '|';
+	     spnotes_query_skip_space(q)) {
+		q->p++;
+
+		spnotes_bitmap rhs, res;
+		if (!spnotes_query_and(q, &rhs)) {
+			spnotes_bitmap_free(out);
+			return 0;
+		}
+		int ok = spnotes_bitmap_op(out, &rhs, SPNOTES_OP_OR, &res);
+		spnotes_bitmap_free(out);
+		spnotes_bitmap_free(&rhs);
+		if (!ok) {
+			q->err = SPNOTES_ERR_MALLOC;
+			return 0;
+		}
+		*out = res;
+	}
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_tags_query(spnotes_t *instance, const char *query,
+                   spnotes_note ***notes, size_t *notes_c)
+{
+	if (instance == NULL || query == NULL || notes == NULL ||
+	    notes_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->tags == NULL && spnotes_tags_index_build(instance) < 0)
+		return -1;
+
+	spnotes_query  q = { query, instance, SPNOTES_ERR_NONE };
+	spnotes_bitmap result;
+	if (!spnotes_query_or(&q, &result)) {
+		spnotes_err = q.err;
+		return -1;
+	}
+	spnotes_query_skip_space(&q);
+	if (*q.p != '\0') {
+		spnotes_bitmap_free(&result);
+		spnotes_err = SPNOTES_ERR_QUERY;
+		return -1;
+	}
+
+	size_t found_c = 0;
+	for (size_t i = 0; i < result.conts_c; i++)
+		found_c += result.conts[i].card;
+
+	spnotes_note **found = malloc((found_c + 1) * sizeof(spnotes_note *));
+	if (found == NULL) {
+		spnotes_bitmap_free(&result);
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+
+	size_t k = 0;
+	for (size_t i = 0; i < result.conts_c; i++) {
+		spnotes_container *cont = &result.conts[i];
+		uint32_t           high = (uint32_t)cont->key << 16;
+
+		if (cont->array) {
+			for (uint32_t j = 0; j < cont->card; j++)
+				found[k++] = instance->notes_by_id[high |
+				                                   cont->array[j]];
+			continue;
+		}
+		for (size_t w = 0; w < SPNOTES_BITMAP_WORDS; w++)
+			for (uint64_t bits = cont->bitmap[w]; bits;
+			     bits &= bits - 1)
+				found[k++] = instance->notes_by_id
+					[high | (w * 64 +
+				                 spnotes_popcount((bits & -bits) - 1))];
+	}
+	spnotes_bitmap_free(&result);
+
+	*notes   = found;
+	*notes_c = found_c;
+	return found_c;
+}
+
+/* = Trigrams = */
+
+#define SPNOTES_GRAM(p)                                                \
+	((uint32_t)(unsigned char)(p)[0] << 16 |                       \
+	 (uint32_t)(unsigned char)(p)[1] << 8 | (unsigned char)(p)[2])
+
+/* scratch buffers for the trigrams of a note */
+typedef struct {
+	char     *fold; /* case folded description */
+	size_t    mfold;
+	uint32_t *grams;
+	size_t    grams_c, mgrams_c;
+} spnotes_grams_buf;
+
+/* a posting list of the index */
+typedef struct {
+	uint32_t first, count;
+} spnotes_postings;
+
+static size_t
+spnotes_gram_slot(uint32_t gram, size_t mask)
+{
+	return (size_t)((gram * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+}
+
+static int
+spnotes_postings_compare(const void *a, const void *b)
+{
+	uint32_t x = ((const spnotes_postings *)a)->count;
+	uint32_t y = ((const spnotes_postings *)b)->count;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Fills `buf->grams` with the trigrams of the case folded title and the
+ * description of `note` (repeated ones included), a trigram never spanning
+ * both of them.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_note_grams(const spnotes_note *note, spnotes_grams_buf *buf)
+{
+	size_t title_len = strlen(note->title_folded);
+	size_t desc_len  = note->has_description ? strlen(note->description) : 0;
+
+	if (desc_len + 1 > buf->mfold) {
+		char *fold = realloc(buf->fold, desc_len + 1);
+		if (fold == NULL)
+			return 0;
+		buf->fold  = fold;
+		buf->mfold = desc_len + 1;
+	}
+	if (title_len + desc_len > buf->mgrams_c) {
+		uint32_t *grams = realloc(buf->grams, (title_len + desc_len) *
+		                                              sizeof(uint32_t));
+		if (grams == NULL)
+			return 0;
+		buf->grams    = grams;
+		buf->mgrams_c = title_len + desc_len;
+	}
+
+	buf->fold[0] = '\0';
+	if (note->has_description)
+		spnotes_fold_n(buf->fold, desc_len + 1, note->description);
+	desc_len = strlen(buf->fold);
+
+	buf->grams_c = 0;
+	for (size_t i = 0; i + 2 < title_len; i++)
+		buf->grams[buf->grams_c++] = SPNOTES_GRAM(note->title_folded + i);
+	for (size_t i = 0; i + 2 < desc_len; i++)
+		buf->grams[buf->grams_c++] = SPNOTES_GRAM(buf->fold + i);
+	return 1;
+}
+
+/* index of `gram` in `tg` OR -1 if no note has it */
+static long
+spnotes_trigrams_find(const spnotes_trigrams *tg, uint32_t gram)
+{
+	size_t mask = tg->table_c - 1;
+
+	for (size_t slot = spnotes_gram_slot(gram, mask); tg->table[slot];
+	     slot        = (slot + 1) & mask)
+		if (tg->grams[tg->table[slot] - 1] == gram)
+			return tg->table[slot] - 1;
+	return -1;
+}
+
+/*
+ * Returns the index of `gram` in `tg` being built, adding it (with a count of
+ * 0 in 'offsets') if it's new, OR -1 if it couldn't allocate the memory.
+ */
+static long
+spnotes_trigrams_intern(spnotes_trigrams *tg, size_t *mgrams_c, uint32_t gram)
+{
+	long found = spnotes_trigrams_find(tg, gram);
+	if (found >= 0)
+		return found;
+
+	/* keep the load factor under 1/2 */
+	if ((tg->grams_c + 1) * 2 > tg->table_c) {
+		size_t    table_c = tg->table_c * 2;
+		uint32_t *table   = calloc(table_c, sizeof(uint32_t));
+		if (table == NULL)
+			return -1;
+		for (size_t i = 0; i < tg->grams_c; i++) {
+			size_t s = spnotes_gram_slot(tg->grams[i], table_c - 1);
+			while (table[s])
+				s = (s + 1) & (table_c - 1);
+			table[s] = i + 1;
+		}
+		free(tg->table);
+		tg->table   = table;
+		tg->table_c = table_c;
+	}
+
+	if (tg->grams_c == *mgrams_c) {
+		size_t    m     = *mgrams_c * 2;
+		uint32_t *grams = realloc(tg->grams, m * sizeof(uint32_t));
+		if (grams == NULL)
+			return -1;
+		tg->grams = grams;
+		uint32_t *offsets =
+			realloc(tg->offsets, (m + 1) * sizeof(uint32_t));
+		if (offsets == NULL)
+			return -1;
+		tg->offsets = offsets;
+		*mgrams_c   = m;
+	}
+
+	size_t slot = spnotes_gram_slot(gram, tg->table_c - 1);
+	while (tg->table[slot])
+		slot = (slot + 1) & (tg->table_c - 1);
+	tg->table[slot]            = tg->grams_c + 1;
+	tg->grams[tg->grams_c]     = gram;
+	tg->offsets[tg->grams_c++] = 0;
+	return tg->grams_c - 1;
+}
+
+static void
+spnotes_trigrams_destroy(spnotes_trigrams *tg)
+{
+	if (tg == NULL)
+		return;
+
+	free(tg->grams);
+	free(tg->offsets);
+	free(tg->postings);
+	free(tg->table);
+	free(tg);
+}
+
+/*
+ * Builds the trigram index of the `notes_c` `notes`, their ids being their
+ * indexes on `notes`.
+ *
+ * Returns NULL if it couldn't allocate the memory.
+ */
+static spnotes_trigrams *
+spnotes_trigrams_make(spnotes_note *const *notes, size_t notes_c)
+{
+	spnotes_trigrams *tg       = calloc(1, sizeof(spnotes_trigrams));
+	spnotes_grams_buf buf      = { 0 };
+	size_t            mgrams_c = 1024;
+	uint32_t         *ids      = NULL; /* the grams of every note, in order */
+	size_t            ids_c = 0, mids_c = 0;
+	size_t           *firsts = malloc((notes_c + 1) * sizeof(size_t));
+	uint32_t         *seen   = NULL; /* `k + 1` once the note `k` has it */
+	size_t            mseen_c = 0;
+
+	if (tg == NULL || firsts == NULL || notes_c > UINT32_MAX)
+		goto err;
+	tg->table_c = 2 * mgrams_c;
+	tg->table   = calloc(tg->table_c, sizeof(uint32_t));
+	tg->grams   = malloc(mgrams_c * sizeof(uint32_t));
+	tg->offsets = malloc((mgrams_c + 1) * sizeof(uint32_t));
+	if (tg->table == NULL || tg->grams == NULL || tg->offsets == NULL)
+		goto err;
+
+	/* intern the trigrams of every note and count their postings */
+	for (size_t k = 0; k < notes_c; k++) {
+		if (!spnotes_note_grams(notes[k], &buf))
+			goto err;
+		if (ids_c + buf.grams_c > mids_c) {
+			size_t m = mids_c ? mids_c * 2 : 4096;
+			while (m < ids_c + buf.grams_c)
+				m *= 2;
+			uint32_t *tmp = realloc(ids, m * sizeof(uint32_t));
+			if (tmp == NULL)
+				goto err;
+			ids    = tmp;
+			mids_c = m;
+		}
+		firsts[k] = ids_c;
+		for (size_t i = 0; i < buf.grams_c; i++) {
+			long gram = spnotes_trigrams_intern(tg, &mgrams_c,
+			                                    buf.grams[i]);
+			if (gram < 0)
+				goto err;
+			if (mseen_c < mgrams_c) {
+				uint32_t *tmp =
+					realloc(seen, mgrams_c * sizeof(uint32_t));
+				if (tmp == NULL)
+					goto err;
+				memset(tmp + mseen_c, 0,
+				       (mgrams_c - mseen_c) * sizeof(uint32_t));
+				seen    = tmp;
+				mseen_c = mgrams_c;
+			}
+			/* a posting per note, however many times it has it */
+			if (seen[gram] == k + 1)
+				continue;
+			seen[gram] = k + 1;
+			tg->offsets[gram]++;
+			ids[ids_c++] = gram;
+		}
+		if (ids_c > UINT32_MAX)
+			goto err;
+	}
+	firsts[notes_c] = ids_c;
+
+	/* the postings of a trigram follow those of the previous one */
+	uint32_t total = 0;
+	for (size_t i = 0; i < tg->grams_c; i++) {
+		uint32_t count  = tg->offsets[i];
+		tg->offsets[i]  = total;
+		total          += count;
+	}
+	tg->offsets[tg->grams_c] = total;
+	tg->postings_c           = total;
+
+	/* notes in the order of their ids so that every list is sorted */
+	tg->postings   = malloc((total + 1) * sizeof(uint32_t));
+	uint32_t *next = malloc((tg->grams_c + 1) * sizeof(uint32_t));
+	if (tg->postings == NULL || next == NULL) {
+		free(next);
+		goto err;
+	}
+	memcpy(next, tg->offsets, tg->grams_c * sizeof(uint32_t));
+	for (size_t k = 0; k < notes_c; k++)
+		for (size_t i = firsts[k]; i < firsts[k + 1]; i++)
+			tg->postings[next[ids[i]]++] = k;
+
+	free(next);
+	free(ids);
+	free(firsts);
+	free(seen);
+	free(buf.fold);
+	free(buf.grams);
+	return tg;
+
+err:
+	free(ids);
+	free(firsts);
+	free(seen);
+	free(buf.fold);
+	free(buf.grams);
+	spnotes_trigrams_destroy(tg);
+	return NULL;
+}
+
+static int
+spnotes_gram_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Returns the distinct trigrams of `note` in ascending order (see
+ * 'spnotes_note_grams()'), setting `grams_c`, OR NULL if it couldn't allocate
+ * the memory.
+ */
+static uint32_t *
+spnotes_note_grams_set(const spnotes_note *note, size_t *grams_c)
+{
+	spnotes_grams_buf buf = { 0 };
+
+	/* a title has a byte at least, so the grams get allocated */
+	if (!spnotes_note_grams(note, &buf) || buf.grams == NULL) {
+		free(buf.fold);
+		free(buf.grams);
+		return NULL;
+	}
+	qsort(buf.grams, buf.grams_c, sizeof(uint32_t), spnotes_gram_compare);
+	*grams_c = 0;
+	for (size_t i = 0; i < buf.grams_c; i++)
+		if (*grams_c == 0 || buf.grams[i] != buf.grams[*grams_c - 1])
+			buf.grams[(*grams_c)++] = buf.grams[i];
+	free(buf.fold);
+	return buf.grams;
+}
+
+/* a posting list losing (-1) or gaining (+1) the note being patched */
+typedef struct {
+	size_t gram; /* index on the grams */
+	int    delta;
+} spnotes_gram_change;
+
+static int
+spnotes_gram_change_compare(const void *a, const void *b)
+{
+	size_t x = ((const spnotes_gram_change *)a)->gram;
+	size_t y = ((const spnotes_gram_change *)b)->gram;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Patches the postings of `tg` for the note `id` whose distinct trigrams went
+ * from the `old_c` `old` ones to the `new_c` `new` ones (both ascending), in a
+ * single pass over the postings. New trigrams are interned at the end.
+ *
+ * Returns 0 if it couldn't allocate the memory, `tg` being left unusable.
+ */
+static int
+spnotes_trigrams_patch(spnotes_trigrams *tg, uint32_t id, const uint32_t *old,
+                       size_t old_c, const uint32_t *new, size_t new_c)
+{
+	spnotes_gram_change *changes =
+		malloc((old_c + new_c + 1) * sizeof(spnotes_gram_change));
+	uint32_t *postings = malloc((tg->postings_c + new_c + 1) *
+	                            sizeof(uint32_t));
+	if (changes == NULL || postings == NULL)
+		goto err;
+
+	/* room for the new trigrams, so that interning doesn't grow them */
+	size_t mgrams_c = tg->grams_c + new_c;
+	uint32_t *grams = realloc(tg->grams, (mgrams_c + 1) * sizeof(uint32_t));
+	if (grams == NULL)
+		goto err;
+	tg->grams = grams;
+	uint32_t *offsets =
+		realloc(tg->offsets, (mgrams_c + 1) * sizeof(uint32_t));
+	if (offsets == NULL)
+		goto err;
+	tg->offsets = offsets;
+
+	/* interning overwrites the offsets past the old trigrams */
+	size_t   old_grams_c = tg->grams_c;
+	uint32_t end         = tg->postings_c;
+	size_t   changes_c   = 0;
+	for (size_t i = 0, j = 0; i < old_c || j < new_c;) {
+		long gram;
+		if (j == new_c || (i < old_c && old[i] < new[j])) {
+			if ((gram = spnotes_trigrams_find(tg, old[i++])) >= 0)
+				changes[changes_c++] =
+					(spnotes_gram_change){ gram, -1 };
+		} else if (i == old_c || new[j] < old[i]) {
+			gram = spnotes_trigrams_intern(tg, &mgrams_c, new[j++]);
+			if (gram < 0)
+				goto err;
+			changes[changes_c++] = (spnotes_gram_change){ gram, 1 };
+		} else { /* kept */
+			i++;
+			j++;
+		}
+	}
+	qsort(changes, changes_c, sizeof(spnotes_gram_change),
+	      spnotes_gram_change_compare);
+
+	/* the lists stay sorted by note id */
+	size_t   pos = 0, k = 0;
+	uint32_t begin = 0;
+	for (size_t g = 0; g < tg->grams_c; g++) {
+		uint32_t last  = g + 1 < old_grams_c ? tg->offsets[g + 1] : end;
+		int      delta = 0;
+		if (k < changes_c && changes[k].gram == g)
+			delta = changes[k++].delta;
+
+		tg->offsets[g] = pos;
+		for (uint32_t p = begin; p < last; p++) {
+			if (delta > 0 && tg->postings[p] > id) {
+				postings[pos++] = id;
+				delta           = 0;
+			}
+			if (delta < 0 && tg->postings[p] == id)
+				continue;
+			postings[pos++] = tg->postings[p];
+		}
+		if (delta > 0)
+			postings[pos++] = id;
+		begin = last;
+	}
+	tg->offsets[tg->grams_c] = pos;
+	tg->postings_c           = pos;
+	free(tg->postings);
+	tg->postings = postings;
+	free(changes);
+	return 1;
+
+err:
+	free(changes);
+	free(postings);
+	return 0;
+}
+
+/*
+ * Brings the indexes of the instance of `note` up to date after its title
+ * (`is_title`) or description was set, `old_grams` of `old_grams_c` being its
+ * distinct trigrams before (NULL if unknown). The trigram index is patched,
+ * or freed if it can't be. The link index is freed on a new title, as wiki
+ * links resolve by title: it's rebuilt from the cache of the raw links.
+ */
+static void
+spnotes_note_reindex(spnotes_note *note, const uint32_t *old_grams,
+                     size_t old_grams_c, int is_title)
+{
+	spnotes_t *instance = note->categ ? note->categ->spnotes_instance :
+	                                    NULL;
+	if (instance == NULL)
+		return;
+
+	if (is_title) {
+		spnotes_links_destroy(instance->links);
+		instance->links = NULL;
+	}
+
+	if (instance->trigrams == NULL)
+		return;
+	size_t    new_grams_c = 0;
+	uint32_t *new_grams   = spnotes_note_grams_set(note, &new_grams_c);
+	if (old_grams == NULL || new_grams == NULL ||
+	    note->id >= instance->notes_by_id_c ||
+	    instance->notes_by_id[note->id] != note ||
+	    !spnotes_trigrams_patch(instance->trigrams, note->id, old_grams,
+	                            old_grams_c, new_grams, new_grams_c)) {
+		spnotes_trigrams_destroy(instance->trigrams);
+		instance->trigrams = NULL;
+	}
+	free(new_grams);
+}
+
+/* frees the link, trigram, tag and note id indexes of `instance` */
+static void
+spnotes_indexes_free(spnotes_t *instance)
+{
+	spnotes_tags_index_free(instance);
+	spnotes_trigrams_destroy(instance->trigrams);
+	instance->trigrams = NULL;
+	spnotes_links_destroy(instance->links);
+	instance->links = NULL;
+
+	free(instance->notes_by_id);
+	instance->notes_by_id   = NULL;
+	instance->notes_by_id_c = 0;
+}
+
+SPNOTES_DEF int
+spnotes_trigrams_build(spnotes_t *instance)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+
+	spnotes_trigrams_destroy(instance->trigrams);
+	instance->trigrams = NULL;
+	if (!spnotes_notes_ids_assign(instance)) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "trigrams_build", NULL);
+	instance->trigrams = spnotes_trigrams_make(instance->notes_by_id,
+	                                           instance->notes_by_id_c);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "trigrams_build", NULL);
+	if (instance->trigrams == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	return instance->trigrams->grams_c;
+}
+
+/*
+ * Keeps the `ids` (ascending) that are also in `list` of `list_c` ids, each
+ * looked up with a galloping search from where the previous one was.
+ *
+ * Returns the number of ids kept.
+ */
+static size_t
+spnotes_postings_intersect(uint32_t *ids, size_t ids_c, const uint32_t *list,
+                           size_t list_c)
+{
+	size_t k = 0, lo = 0;
+
+	for (size_t i = 0; i < ids_c && lo < list_c; i++) {
+		size_t hi = lo, step = 1;
+		while (hi < list_c && list[hi] < ids[i]) {
+			lo    = hi + 1;
+			hi   += step;
+			step *= 2;
+		}
+		if (hi > list_c)
+			hi = list_c;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (list[mid] < ids[i])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < list_c && list[lo] == ids[i])
+			ids[k++] = ids[i];
+	}
+	return k;
+}
+
+/*
+ * Whether the title or the description of `note` contains `substr`, OR
+ * `folded` (the case folded `substr`) if `icase`. Returns -1 if it couldn't
+ * allocate the memory.
+ */
+static int
+spnotes_note_contains(const spnotes_note *note, const char *substr,
+                      const char *folded, int icase, spnotes_grams_buf *buf)
+{
+	if (!icase)
+		return strstr(note->title, substr) ||
+		       (note->has_description &&
+		        strstr(note->description, substr));
+
+	if (strstr(note->title_folded, folded))
+		return 1;
+	if (!note->has_description)
+		return 0;
+	size_t len = strlen(note->description) + 1;
+	if (len > buf->mfold) {
+		char *fold = realloc(buf->fold, len);
+		if (fold == NULL)
+			return -1;
+		buf->fold  = fold;
+		buf->mfold = len;
+	}
+	spnotes_fold_n(buf->fold, len, note->description);
+	return strstr(buf->fold, folded) != NULL;
+}
+
+SPNOTES_DEF int
+spnotes_trigrams_query(spnotes_t *instance, const char *substr, int flags,
+                       spnotes_note ***notes, size_t *notes_c)
+{
+	if (instance == NULL || substr == NULL || notes == NULL ||
+	    notes_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+	if (instance->trigrams == NULL && spnotes_trigrams_build(instance) < 0)
+		return -1;
+
+	const spnotes_trigrams *tg     = instance->trigrams;
+	size_t                  len    = strlen(substr);
+	char                   *folded = malloc(len + 1);
+	uint32_t               *cands  = NULL;
+	spnotes_postings       *lists  = NULL;
+	spnotes_grams_buf       buf    = { 0 };
+	size_t                  cands_c = 0, found_c = 0;
+	int                     icase   = flags & SPNOTES_SEARCH_ICASE;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "trigrams_query", substr);
+	*notes = NULL;
+	if (folded == NULL)
+		goto err_malloc;
+	spnotes_fold_n(folded, len + 1, substr);
+	size_t folded_len = strlen(folded);
+
+	if (folded_len < 3) {
+		/* no trigram to look up, every note is a candidate */
+		cands = malloc((instance->notes_by_id_c + 1) * sizeof(uint32_t));
+		if (cands == NULL)
+			goto err_malloc;
+		for (; cands_c < instance->notes_by_id_c; cands_c++)
+			cands[cands_c] = cands_c;
+	} else {
+		/* intersect the posting lists, the shortest ones first */
+		size_t lists_c = folded_len - 2;
+		lists          = malloc(lists_c * sizeof(spnotes_postings));
+		if (lists == NULL)
+			goto err_malloc;
+		for (size_t i = 0; i < lists_c; i++) {
+			long gram = spnotes_trigrams_find(
+				tg, SPNOTES_GRAM(folded + i));
+			if (gram < 0) /* no note has it */
+				goto confirm;
+			lists[i].first = tg->offsets[gram];
+			lists[i].count = tg->offsets[gram + 1] - tg->offsets[gram];
+		}
+		qsort(lists, lists_c, sizeof(spnotes_postings),
+		      spnotes_postings_compare);
+
+		cands = malloc((lists[0].count + 1) * sizeof(uint32_t));
+		if (cands == NULL)
+			goto err_malloc;
+		cands_c = lists[0].count;
+		memcpy(cands, tg->postings + lists[0].first,
+		       cands_c * sizeof(uint32_t));
+		for (size_t i = 1; i < lists_c && cands_c > 0; i++)
+			if (lists[i].first != lists[i - 1].first)
+				cands_c = spnotes_postings_intersect(
+					cands, cands_c,
+					tg->postings + lists[i].first,
+					lists[i].count);
+	}
+
+confirm:
+	/* the trigrams might not be contiguous in the note */
+	*notes = malloc((cands_c + 1) * sizeof(spnotes_note *));
+	if (*notes == NULL)
+		goto err_malloc;
+	for (size_t i = 0; i < cands_c; i++) {
+		spnotes_note *note = instance->notes_by_id[cands[i]];
+		int           ret  = spnotes_note_contains(note, substr, folded,
+		                                           icase, &buf);
+		if (ret < 0)
+			goto err_malloc;
+		if (ret)
+			(*notes)[found_c++] = note;
+	}
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "trigrams_query", substr);
+
+	free(folded);
+	free(cands);
+	free(lists);
+	free(buf.fold);
+	*notes_c = found_c;
+	return found_c;
+
+err_malloc:
+	free(folded);
+	free(cands);
+	free(lists);
+	free(buf.fold);
+	free(*notes);
+	*notes = NULL;
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "trigrams_query", substr);
+	spnotes_err = SPNOTES_ERR_MALLOC;
+	return -1;
+}
+
+/* = Duplicates = */
+
+#define SPNOTES_XXH_P1 11400714785074694791ULL
+#define SPNOTES_XXH_P2 14029467366897019727ULL
+#define SPNOTES_XXH_P3 1609587929392839161ULL
+#define SPNOTES_XXH_P4 9650029242287828579ULL
+#define SPNOTES_XXH_P5 2870177450012600261ULL
+
+#define SPNOTES_HASHCACHE       ".spnotes-hashcache"
+#define SPNOTES_HASHCACHE_MAGIC "spnotes-hashcache 1\n"
+
+static uint64_t
+spnotes_rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/* little endian loads, a single load on most compilers */
+static uint64_t
+spnotes_load64(const unsigned char *p)
+{
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+	       (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 |
+	       (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 |
+	       (uint64_t)p[7] << 56;
+}
+
+static uint32_t
+spnotes_load32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+	       (uint32_t)p[3] << 24;
+}
+
+static uint64_t
+spnotes_xxh64_round(uint64_t acc, uint64_t input)
+{
+	acc += input * SPNOTES_XXH_P2;
+	return spnotes_rotl64(acc, 31) * SPNOTES_XXH_P1;
+}
+
+static uint64_t
+spnotes_xxh64_merge(uint64_t acc, uint64_t val)
+{
+	acc ^= spnotes_xxh64_round(0, val);
+	return acc * SPNOTES_XXH_P1 + SPNOTES_XXH_P4;
+}
+
+/* XXH64 of the `len` bytes of `data` */
+static uint64_t
+spnotes_xxh64(const void *data, size_t len, uint64_t seed)
+{
+	const unsigned char *p = data, *end = p + len;
+	uint64_t             h;
+
+	if (len >= 32) {
+		uint64_t v1 = seed + SPNOTES_XXH_P1 + SPNOTES_XXH_P2;
+		uint64_t v2 = seed + SPNOTES_XXH_P2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - SPNOTES_XXH_P1;
+		do {
+			v1 = spnotes_xxh64_round(v1, spnotes_load64(p));
+			v2 = spnotes_xxh64_round(v2, spnotes_load64(p + 8));
+			v3 = spnotes_xxh64_round(v3, spnotes_load64(p + 16));
+			v4 = spnotes_xxh64_round(v4, spnotes_load64(p + 24));
+			p += 32;
+		} while (end - p >= 32);
+		h = spnotes_rotl64(v1, 1) + spnotes_rotl64(v2, 7) +
+		    spnotes_rotl64(v3, 12) + spnotes_rotl64(v4, 18);
+		h = spnotes_xxh64_merge(h, v1);
+		h = spnotes_xxh64_merge(h, v2);
+		h = spnotes_xxh64_merge(h, v3);
+		h = spnotes_xxh64_merge(h, v4);
+	} else {
+		h = seed + SPNOTES_XXH_P5;
+	}
+	h += len;
+
+	for (; end - p >= 8; p += 8) {
+		h ^= spnotes_xxh64_round(0, spnotes_load64(p));
+		h = spnotes_rotl64(h, 27) * SPNOTES_XXH_P1 + SPNOTES_XXH_P4;
+	}
+	if (end - p >= 4) {
+		h ^= spnotes_load32(p) * SPNOTES_XXH_P1;
+		h = spnotes_rotl64(h, 23) * SPNOTES_XXH_P2 + SPNOTES_XXH_P3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= *p * SPNOTES_XXH_P5;
+		h = spnotes_rotl64(h, 11) * SPNOTES_XXH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= SPNOTES_XXH_P2;
+	h ^= h >> 29;
+	h *= SPNOTES_XXH_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+/* what is known of a note file, as cached in `.spnotes-hashcache` */
+typedef struct {
+	int64_t  size, mtime_sec, mtime_nsec;
+	uint64_t file_hash;
+	uint64_t body_hash, space_hash; /* 0 = empty body */
+} spnotes_dupes_sum;
+
+/* the hash cache loaded from the file */
+typedef struct {
+	char              *buf;   /* the file, the paths pointing in it */
+	spnotes_path_table paths; /* of every entry */
+	spnotes_dupes_sum *sums;
+} spnotes_hashcache;
+
+typedef struct {
+	spnotes_t         *instance;
+	spnotes_note     **notes;
+	spnotes_dupes_sum *sums;
+	char              *state; /* 0 = not to hash, 1 = to hash, 2 = hashed */
+	int               *errs;
+	spnotes_hashcache *cache;
+} spnotes_dupes_job;
+
+/* a group being collected: `members` are indexes on the notes of the job */
+typedef struct {
+	int     kind;
+	size_t *members, members_c;
+} spnotes_dupes_run;
+
+/* an entry to group the notes by */
+typedef struct {
+	uint64_t key, key2;
+	size_t   i;
+} spnotes_dupes_key;
+
+static void
+spnotes_hashcache_free(spnotes_hashcache *cache)
+{
+	free(cache->buf);
+	spnotes_path_table_free(&cache->paths);
+	free(cache->sums);
+}
+
+/*
+ * Loads the hash cache at `path` into `cache`, leaving it empty if there's no
+ * valid one.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_hashcache_load(spnotes_hashcache *cache, const char *path)
+{
+	memset(cache, 0, sizeof(*cache));
+
+	size_t len;
+	char  *buf = spnotes_file_read(path, &len);
+	if (buf == NULL)
+		return errno != ENOMEM;
+	size_t magic_len = strlen(SPNOTES_HASHCACHE_MAGIC);
+	if (len < magic_len ||
+	    memcmp(buf, SPNOTES_HASHCACHE_MAGIC, magic_len) != 0) {
+		free(buf);
+		return 1;
+	}
+
+	size_t lines_c = spnotes_lines_count(buf, magic_len, len);
+	cache->buf     = buf;
+	cache->sums    = malloc((lines_c + 1) * sizeof(spnotes_dupes_sum));
+	if (cache->sums == NULL ||
+	    !spnotes_path_table_init(&cache->paths, lines_c)) {
+		spnotes_hashcache_free(cache);
+		memset(cache, 0, sizeof(*cache));
+		return 0;
+	}
+
+	/* "size mtime_sec mtime_nsec file_hash body_hash space_hash path" */
+	char *line = buf + magic_len, *eol;
+	while ((eol = memchr(line, '\n', len - (line - buf)))) {
+		spnotes_dupes_sum *sum = &cache->sums[cache->paths.paths_c];
+		char              *p   = line;
+		*eol                   = '\0';
+
+		sum->size       = strtoll(p, &p, 10);
+		sum->mtime_sec  = strtoll(p, &p, 10);
+		sum->mtime_nsec = strtoll(p, &p, 10);
+		sum->file_hash  = strtoull(p, &p, 16);
+		sum->body_hash  = strtoull(p, &p, 16);
+		sum->space_hash = strtoull(p, &p, 16);
+		line            = eol + 1;
+		if (*p++ != ' ' || *p != '/')
+			continue; /* not written by us, skip it */
+		spnotes_path_table_add(&cache->paths, p);
+	}
+	return 1;
+}
+
+/*
+ * Writes the sums of the hashed notes of `job` to a temporary file next to
+ * `path` and renames it over it.
+ */
+static void
+spnotes_hashcache_save(const spnotes_dupes_job *job, size_t notes_c,
+                       const char *path)
+{
+	char  tmp_path[PATH_MAX];
+	FILE *fp = spnotes_cache_open(path, tmp_path);
+	if (fp == NULL)
+		return;
+
+	fputs(SPNOTES_HASHCACHE_MAGIC, fp);
+	for (size_t i = 0; i < notes_c; i++) {
+		const spnotes_dupes_sum *sum = &job->sums[i];
+		if (job->state[i] != 2 || strchr(job->notes[i]->path, '\n'))
+			continue;
+		fprintf(fp, "%lld %lld %lld %llx %llx %llx %s\n",
+		        (long long)sum->size, (long long)sum->mtime_sec,
+		        (long long)sum->mtime_nsec,
+		        (unsigned long long)sum->file_hash,
+		        (unsigned long long)sum->body_hash,
+		        (unsigned long long)sum->space_hash,
+		        job->notes[i]->path);
+	}
+	spnotes_cache_commit(fp, tmp_path, path);
+}
+
+/* stat of the `i`th note, taking its hashes from the cache if unchanged */
+static void
+spnotes_dupes_stat(size_t i, void *arg)
+{
+	spnotes_dupes_job *job = arg;
+	spnotes_dupes_sum *sum = &job->sums[i];
+	struct stat        st;
+
+	SPNOTES_STATS_ADD(job->instance, stat_calls, 1);
+	if (stat(job->notes[i]->path, &st) != 0) {
+		job->errs[i] = SPNOTES_ERR_FILE_STAT;
+		return;
+	}
+	sum->size       = st.st_size;
+	sum->mtime_sec  = st.st_mtim.tv_sec;
+	sum->mtime_nsec = st.st_mtim.tv_nsec;
+	job->state[i]   = 1;
+
+	long entry = spnotes_path_table_find(&job->cache->paths,
+	                                     job->notes[i]->path);
+	const spnotes_dupes_sum *cached =
+		entry < 0 ? NULL : &job->cache->sums[entry];
+	if (cached && cached->size == sum->size &&
+	    cached->mtime_sec == sum->mtime_sec &&
+	    cached->mtime_nsec == sum->mtime_nsec) {
+		*sum          = *cached;
+		job->state[i] = 2;
+	}
+}
+
+/*
+ * Collapses the runs of whitespace of the `len` bytes of `buf` in place to a
+ * single space, dropping them at both ends.
+ *
+ * Returns the new length.
+ */
+static size_t
+spnotes_space_collapse(char *buf, size_t len)
+{
+	size_t out = 0;
+	int    in_space = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		char c = buf[i];
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' ||
+		    c == '\v' || c == '\f') {
+			in_space = 1;
+			continue;
+		}
+		if (in_space && out > 0)
+			buf[out++] = ' ';
+		in_space   = 0;
+		buf[out++] = buf[i];
+	}
+	return out;
+}
+
+/* hashes of the `i`th note if it's to be hashed and wasn't cached */
+static void
+spnotes_dupes_hash(size_t i, void *arg)
+{
+	spnotes_dupes_job *job = arg;
+	spnotes_dupes_sum *sum = &job->sums[i];
+
+	if (job->state[i] != 1)
+		return;
+
+	size_t len;
+	char  *buf = spnotes_file_read(job->notes[i]->path, &len);
+	if (buf == NULL) {
+		job->errs[i] = errno == ENOMEM ? SPNOTES_ERR_MALLOC :
+		                                 SPNOTES_ERR_FILE_READ;
+		return;
+	}
+	SPNOTES_STATS_ADD(job->instance, files_opened, 1);
+	SPNOTES_STATS_ADD(job->instance, bytes_read, len);
+
+	size_t line_no, body = spnotes_body_offset(buf, len, &line_no);
+	sum->file_hash  = spnotes_xxh64(buf, len, 0);
+	sum->body_hash  = spnotes_xxh64(buf + body, len - body, 0) | 1;
+	sum->space_hash = 0;
+
+	/* the body is collapsed last, in place */
+	size_t space_len = spnotes_space_collapse(buf + body, len - body);
+	if (space_len > 0)
+		sum->space_hash = spnotes_xxh64(buf + body, space_len, 0) | 1;
+	else
+		sum->body_hash = 0;
+	job->state[i] = 2;
+	free(buf);
+}
+
+static int
+spnotes_dupes_key_compare(const void *a, const void *b)
+{
+	const spnotes_dupes_key *x = a, *y = b;
+
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	if (x->key2 != y->key2)
+		return x->key2 < y->key2 ? -1 : 1;
+	return (x->i > y->i) - (x->i < y->i);
+}
+
+/* by kind, then in the order of their first notes */
+static int
+spnotes_dupes_run_compare(const void *a, const void *b)
+{
+	const spnotes_dupes_run *x = a, *y = b;
+
+	if (x->kind != y->kind)
+		return x->kind - y->kind;
+	return (x->members[0] > y->members[0]) -
+	       (x->members[0] < y->members[0]);
+}
+
+/* fills `key` to group a note of `sum` by, returning 0 if it has none */
+static int
+spnotes_dupes_key_of(const spnotes_dupes_sum *sum, int kind,
+                     spnotes_dupes_key *key)
+{
+	key->key2 = 0;
+	switch (kind) {
+	case SPNOTES_DUPE_EXACT:
+		key->key  = sum->size;
+		key->key2 = sum->file_hash;
+		return 1;
+	case SPNOTES_DUPE_BODY:
+		key->key = sum->body_hash;
+		return sum->body_hash != 0;
+	default:
+		key->key = sum->space_hash;
+		return sum->space_hash != 0;
+	}
+}
+
+/* whether the notes of `keys` aren't all duplicates of a stronger kind */
+static int
+spnotes_dupes_is_new(const spnotes_dupes_sum *sums, int kind,
+                     const spnotes_dupes_key *keys, size_t keys_c)
+{
+	const spnotes_dupes_sum *first = &sums[keys[0].i];
+
+	if (kind == SPNOTES_DUPE_EXACT)
+		return 1;
+	for (size_t k = 1; k < keys_c; k++) {
+		const spnotes_dupes_sum *sum = &sums[keys[k].i];
+		if (kind == SPNOTES_DUPE_BODY ?
+		            sum->size != first->size ||
+		                    sum->file_hash != first->file_hash :
+		            sum->body_hash != first->body_hash)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Appends the groups of duplicates of `kind` among the hashed notes of `job`
+ * to `runs`, using `keys` of `notes_c` entries as scratch.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_dupes_group_kind(const spnotes_dupes_job *job, size_t notes_c,
+                         int kind, spnotes_dupes_key *keys,
+                         spnotes_dupes_run **runs, size_t *runs_c,
+                         size_t *mruns_c)
+{
+	size_t keys_c = 0;
+	for (size_t i = 0; i < notes_c; i++)
+		if (job->state[i] == 2 &&
+		    spnotes_dupes_key_of(&job->sums[i], kind, &keys[keys_c]))
+			keys[keys_c++].i = i;
+	qsort(keys, keys_c, sizeof(spnotes_dupes_key),
+	      spnotes_dupes_key_compare);
+
+	for (size_t from = 0, to; from < keys_c; from = to) {
+		for (to = from + 1; to < keys_c; to++)
+			if (keys[to].key != keys[from].key ||
+			    keys[to].key2 != keys[from].key2)
+				break;
+		if (to - from < 2 || !spnotes_dupes_is_new(job->sums, kind,
+		                                           keys + from,
+		                                           to - from))
+			continue;
+
+		if (*runs_c == *mruns_c) {
+			size_t             mc  = *mruns_c ? *mruns_c * 2 : 16;
+			spnotes_dupes_run *tmp = realloc(
+				*runs, mc * sizeof(spnotes_dupes_run));
+			if (tmp == NULL)
+				return 0;
+			*runs    = tmp;
+			*mruns_c = mc;
+		}
+		spnotes_dupes_run *run = &(*runs)[*runs_c];
+		run->members           = malloc((to - from) * sizeof(size_t));
+		if (run->members == NULL)
+			return 0;
+		run->kind      = kind;
+		run->members_c = to - from;
+		for (size_t k = 0; k < to - from; k++)
+			run->members[k] = keys[from + k].i;
+		(*runs_c)++;
+	}
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_notes_dupes(spnotes_t *instance, int flags,
+                    spnotes_dupes_group **groups, size_t *groups_c)
+{
+	if (instance == NULL || groups == NULL || groups_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+	*groups   = NULL;
+	*groups_c = 0;
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "notes_dupes", NULL);
+	size_t notes_c = 0;
+	for (size_t i = 0; i < instance->categs_c; i++)
+		notes_c += instance->categs[i].notes_c;
+
+	spnotes_hashcache  cache  = { 0 };
+	spnotes_dupes_key *keys   = NULL;
+	spnotes_dupes_run *runs   = NULL;
+	size_t             runs_c = 0, mruns_c = 0;
+	int                err    = SPNOTES_ERR_NONE;
+
+	spnotes_dupes_job job = { instance, NULL, NULL, NULL, NULL, &cache };
+
+	char cache_path[PATH_MAX];
+	snprintf(cache_path, PATH_MAX, "%s" SPNOTES_HASHCACHE,
+	         instance->root_location);
+	if (!(flags & SPNOTES_DUPES_NO_CACHE) &&
+	    !spnotes_hashcache_load(&cache, cache_path)) {
+		err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+
+	job.notes = malloc((notes_c + 1) * sizeof(spnotes_note *));
+	job.sums  = calloc(notes_c + 1, sizeof(spnotes_dupes_sum));
+	job.state = calloc(notes_c + 1, 1);
+	job.errs  = calloc(notes_c + 1, sizeof(int));
+	keys      = malloc((notes_c + 1) * sizeof(spnotes_dupes_key));
+	if (job.notes == NULL || job.sums == NULL || job.state == NULL ||
+	    job.errs == NULL || keys == NULL) {
+		err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+	for (size_t i = 0, k = 0; i < instance->categs_c; i++)
+		for (size_t j = 0; j < instance->categs[i].notes_c; j++)
+			job.notes[k++] = instance->categs[i].notes + j;
+
+	spnotes_parallel_for(notes_c, spnotes_dupes_stat, &job);
+	for (size_t i = 0; i < notes_c && err == SPNOTES_ERR_NONE; i++)
+		err = job.errs[i];
+	if (err != SPNOTES_ERR_NONE)
+		goto end;
+
+	/* exact duplicates have the same size, the others needn't be read */
+	if (!(flags & SPNOTES_DUPES_NEAR)) {
+		for (size_t i = 0; i < notes_c; i++) {
+			keys[i].key  = job.sums[i].size;
+			keys[i].key2 = 0;
+			keys[i].i    = i;
+		}
+		qsort(keys, notes_c, sizeof(spnotes_dupes_key),
+		      spnotes_dupes_key_compare);
+		for (size_t i = 0; i < notes_c; i++) {
+			int is_alone =
+				(i == 0 || keys[i - 1].key != keys[i].key) &&
+				(i + 1 == notes_c || keys[i + 1].key != keys[i].key);
+			if (is_alone && job.state[keys[i].i] == 1)
+				job.state[keys[i].i] = 0;
+		}
+	}
+
+	size_t cached_c = 0, to_hash_c = 0;
+	for (size_t i = 0; i < notes_c; i++) {
+		cached_c += job.state[i] == 2;
+		to_hash_c += job.state[i] == 1;
+	}
+	spnotes_parallel_for(notes_c, spnotes_dupes_hash, &job);
+	for (size_t i = 0; i < notes_c && err == SPNOTES_ERR_NONE; i++)
+		err = job.errs[i];
+	if (err != SPNOTES_ERR_NONE)
+		goto end;
+
+	/* only rewritten if some files changed, came or went */
+	if (!(flags & SPNOTES_DUPES_NO_CACHE) &&
+	    (to_hash_c > 0 || cached_c != cache.paths.paths_c))
+		spnotes_hashcache_save(&job, notes_c, cache_path);
+
+	int last_kind = (flags & SPNOTES_DUPES_NEAR) ? SPNOTES_DUPE_SPACE :
+	                                              SPNOTES_DUPE_EXACT;
+	for (int kind = SPNOTES_DUPE_EXACT; kind <= last_kind; kind++) {
+		if (!spnotes_dupes_group_kind(&job, notes_c, kind, keys, &runs,
+		                              &runs_c, &mruns_c)) {
+			err = SPNOTES_ERR_MALLOC;
+			goto end;
+		}
+	}
+	qsort(runs, runs_c, sizeof(spnotes_dupes_run),
+	      spnotes_dupes_run_compare);
+
+	spnotes_dupes_group *found = calloc(runs_c + 1, sizeof(*found));
+	if (found == NULL) {
+		err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+	for (size_t r = 0; r < runs_c; r++) {
+		found[r].kind    = runs[r].kind;
+		found[r].notes_c = runs[r].members_c;
+		found[r].notes =
+			malloc(runs[r].members_c * sizeof(spnotes_note *));
+		if (found[r].notes == NULL) {
+			spnotes_dupes_free(found, r);
+			err = SPNOTES_ERR_MALLOC;
+			goto end;
+		}
+		for (size_t k = 0; k < runs[r].members_c; k++)
+			found[r].notes[k] = job.notes[runs[r].members[k]];
+	}
+	*groups   = found;
+	*groups_c = runs_c;
+
+end:
+	for (size_t r = 0; r < runs_c; r++)
+		free(runs[r].members);
+	free(runs);
+	free(keys);
+	free(job.notes);
+	free(job.sums);
+	free(job.state);
+	free(job.errs);
+	spnotes_hashcache_free(&cache);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "notes_dupes", NULL);
+
+	if (err != SPNOTES_ERR_NONE) {
+		spnotes_err = err;
+		return -1;
+	}
+	return runs_c;
+}
+
+SPNOTES_DEF void
+spnotes_dupes_free(spnotes_dupes_group *groups, size_t groups_c)
+{
+	if (groups == NULL)
+		return;
+
+	for (size_t i = 0; i < groups_c; i++)
+		free(groups[i].notes);
+	free(groups);
+}
+
+/* = Links = */
+
+#define SPNOTES_LINKS_CACHE       ".spnotes-links"
+#define SPNOTES_LINKS_CACHE_MAGIC "spnotes-links 1\n"
+
+/*
+ * The targets of the links of a note as found in its body: a line of
+ * "<kind> <target>" for each, the kind being 'u' (a URL), 't' (the title of a
+ * note) or 'p' (the path of a note file, relative to the note).
+ */
+typedef struct {
+	char  *raw;
+	size_t raw_len, mraw_len;
+	int    is_owned; /* else it points into the cache */
+	int    err;
+} spnotes_links_raw;
+
+typedef struct {
+	int64_t     mtime_sec, mtime_nsec;
+	const char *raw;
+	size_t      raw_len;
+} spnotes_links_entry;
+
+/* the links cache loaded from the file */
+typedef struct {
+	char                *buf;   /* the file, the entries pointing in it */
+	spnotes_path_table   paths; /* of every entry */
+	spnotes_links_entry *entries;
+} spnotes_links_cache;
+
+typedef struct {
+	spnotes_t           *instance;
+	spnotes_links_raw   *raws; /* by note id */
+	spnotes_links_cache *cache;
+} spnotes_links_job;
+
+/* the notes by their case folded title and by their path */
+typedef struct {
+	spnotes_note **notes; /* by id */
+	size_t         notes_c;
+	uint32_t      *titles; /* open addressing tables of `id + 1` */
+	uint32_t      *paths;
+	uint64_t      *path_hashes; /* of the normalized path of every note */
+	size_t         table_c;
+} spnotes_links_lookup;
+
+/* a URL of a note being indexed */
+typedef struct {
+	const char *str;
+	size_t      len;
+} spnotes_links_url;
+
+static void
+spnotes_links_destroy(spnotes_links *links)
+{
+	if (links == NULL)
+		return;
+
+	free(links->out_offsets);
+	free(links->out);
+	free(links->in_offsets);
+	free(links->in);
+	free(links->url_offsets);
+	free(links->urls);
+	free(links->strings);
+	free(links);
+}
+
+/* Returns 0 if it couldn't allocate the memory. */
+static int
+spnotes_links_push(spnotes_links_raw *raw, char kind, const char *target,
+                   size_t len)
+{
+	if (len == 0)
+		return 1;
+	if (raw->raw_len + len + 3 > raw->mraw_len) {
+		size_t mraw_len = raw->mraw_len ? raw->mraw_len * 2 : 256;
+		while (mraw_len < raw->raw_len + len + 3)
+			mraw_len *= 2;
+		char *tmp = realloc(raw->raw, mraw_len);
+		if (tmp == NULL)
+			return 0;
+		raw->raw      = tmp;
+		raw->mraw_len = mraw_len;
+	}
+
+	raw->raw[raw->raw_len++] = kind;
+	raw->raw[raw->raw_len++] = ' ';
+	memcpy(raw->raw + raw->raw_len, target, len);
+	raw->raw_len += len;
+	raw->raw[raw->raw_len++] = '\n';
+	return 1;
+}
+
+/* whether `target` starts with a URL scheme such as 'https://' */
+static int
+spnotes_link_is_url(const char *target, size_t len)
+{
+	size_t i = 0;
+	while (i < len && ((target[i] >= 'a' && target[i] <= 'z') ||
+	                   (target[i] >= 'A' && target[i] <= 'Z')))
+		i++;
+	return (i > 0 && len - i > 3 && !memcmp(target + i, "://", 3)) ||
+	       (len > 7 && !memcmp(target, "mailto:", 7));
+}
+
+/* adds the target of a Markdown link, if it's a URL or a note file */
+static int
+spnotes_links_target(spnotes_links_raw *raw, const char *target, size_t len)
+{
+	if (spnotes_link_is_url(target, len))
+		return spnotes_links_push(raw, 'u', target, len);
+
+	const char *frag = memchr(target, '#', len);
+	if (frag)
+		len = frag - target;
+	if (len > 3 && (!memcmp(target + len - 3, ".md", 3) ||
+	                !memcmp(target + len - 3, ".MD", 3)))
+		return spnotes_links_push(raw, 'p', target, len);
+	return 1;
+}
+
+/*
+ * Adds the links of the `len` bytes of `line` to `raw`.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_links_line(const char *line, size_t len, spnotes_links_raw *raw)
+{
+	for (size_t i = 0; i < len; i++) {
+		const char *rest     = line + i;
+		size_t      rest_len = len - i;
+
+		/* inline code */
+		if (*rest == '`') {
+			const char *end = memchr(rest + 1, '`', rest_len - 1);
+			if (end == NULL)
+				return 1;
+			i = end - line;
+			continue;
+		}
+
+		/* '[[title]]' or '[[title|text]]' */
+		if (rest_len > 4 && !memcmp(rest, "[[", 2)) {
+			const char *title = rest + 2;
+			const char *end   = spnotes_memfind(title, rest_len - 2,
+			                                    "]]", 2);
+			if (end) {
+				const char *bar = memchr(title, '|',
+				                         end - title);
+				size_t len = (bar ? bar : end) - title;
+				if (!spnotes_links_push(raw, 't', title, len))
+					return 0;
+				i = end + 1 - line;
+				continue;
+			}
+		}
+
+		/* '[text](target "title")' or '[text](<target>)' */
+		if (rest_len > 2 && !memcmp(rest, "](", 2)) {
+			size_t from = 2 + (rest[2] == '<'), to = from;
+			while (to < rest_len && rest[to] != ')' &&
+			       rest[to] != ' ' && rest[to] != '>')
+				to++;
+			if (to < rest_len) {
+				if (!spnotes_links_target(raw, rest + from,
+				                          to - from))
+					return 0;
+				i += to;
+				continue;
+			}
+		}
+
+		/* bare URLs and '<URL>' autolinks */
+		if ((rest_len > 7 && !memcmp(rest, "http://", 7)) ||
+		    (rest_len > 8 && !memcmp(rest, "https://", 8))) {
+			size_t to = 0;
+			while (to < rest_len &&
+			       !strchr(" \t<>\"'`)]", rest[to]))
+				to++;
+			while (rest[to - 1] && strchr(".,;:!?", rest[to - 1]))
+				to--; /* punctuation of the sentence */
+			if (!spnotes_links_push(raw, 'u', rest, to))
+				return 0;
+			i += to - 1;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Adds the links of the body of the note in `buf` to `raw`, skipping fenced
+ * code blocks.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_links_extract(const char *buf, size_t len, spnotes_links_raw *raw)
+{
+	size_t line_no, pos = spnotes_body_offset(buf, len, &line_no);
+	int    in_fence = 0;
+
+	while (pos < len) {
+		const char *eol  = memchr(buf + pos, '\n', len - pos);
+		size_t      end  = eol ? (size_t)(eol - buf) : len;
+		const char *line = buf + pos;
+		size_t      indent = 0;
+
+		while (indent < 3 && pos + indent < end && line[indent] == ' ')
+			indent++;
+		if (end - pos - indent >= 3 &&
+		    (!memcmp(line + indent, "```", 3) ||
+		     !memcmp(line + indent, "~~~", 3)))
+			in_fence = !in_fence;
+		else if (!in_fence &&
+		         !spnotes_links_line(line, end - pos, raw))
+			return 0;
+		pos = end + 1;
+	}
+	return 1;
+}
+
+static void
+spnotes_links_cache_free(spnotes_links_cache *cache)
+{
+	free(cache->buf);
+	spnotes_path_table_free(&cache->paths);
+	free(cache->entries);
+}
+
+/*
+ * Loads the links cache at `path` into `cache`, leaving it empty if there's
+ * no valid one.
+ *
+ * Returns 0 if it couldn't allocate the memory.
+ */
+static int
+spnotes_links_cache_load(spnotes_links_cache *cache, const char *path)
+{
+	memset(cache, 0, sizeof(*cache));
+
+	size_t len;
+	char  *buf = spnotes_file_read(path, &len);
+	if (buf == NULL)
+		return errno != ENOMEM;
+	size_t magic_len = strlen(SPNOTES_LINKS_CACHE_MAGIC);
+	if (len < magic_len ||
+	    memcmp(buf, SPNOTES_LINKS_CACHE_MAGIC, magic_len) != 0) {
+		free(buf);
+		return 1;
+	}
+
+	size_t lines_c = spnotes_lines_count(buf, magic_len, len);
+	cache->buf     = buf;
+	cache->entries = malloc((lines_c + 1) * sizeof(spnotes_links_entry));
+	if (cache->entries == NULL ||
+	    !spnotes_path_table_init(&cache->paths, lines_c)) {
+		spnotes_links_cache_free(cache);
+		memset(cache, 0, sizeof(*cache));
+		return 0;
+	}
+
+	/* "mtime_sec mtime_nsec raw_len path" followed by the raw links */
+	char *line = buf + magic_len, *end = buf + len, *eol;
+	while ((eol = memchr(line, '\n', end - line))) {
+		spnotes_links_entry *entry =
+			&cache->entries[cache->paths.paths_c];
+		char *p = line;
+		*eol    = '\0';
+
+		entry->mtime_sec          = strtoll(p, &p, 10);
+		entry->mtime_nsec         = strtoll(p, &p, 10);
+		unsigned long long raw_len = strtoull(p, &p, 10);
+		if (*p++ != ' ' || *p != '/' ||
+		    raw_len > (unsigned long long)(end - (eol + 1)))
+			break; /* not written by us or cut short */
+		entry->raw     = eol + 1;
+		entry->raw_len = raw_len;
+		spnotes_path_table_add(&cache->paths, p);
+		line = eol + 1 + raw_len;
+	}
+	return 1;
+}
+
+/* writes the links of all the notes of `job` to the cache at `path` */
+static void
+spnotes_links_cache_save(const spnotes_links_job *job, const char *path)
+{
+	char  tmp_path[PATH_MAX];
+	FILE *fp = spnotes_cache_open(path, tmp_path);
+	if (fp == NULL)
+		return;
+
+	fputs(SPNOTES_LINKS_CACHE_MAGIC, fp);
+	for (size_t id = 0; id < job->instance->notes_by_id_c; id++) {
+		const spnotes_note      *note = job->instance->notes_by_id[id];
+		const spnotes_links_raw *raw  = &job->raws[id];
+		if (strchr(note->path, '\n'))
+			continue;
+		fprintf(fp, "%lld %lld %zu %s\n",
+		        (long long)note->last_modified.tv_sec,
+		        (long long)note->last_modified.tv_nsec, raw->raw_len,
+		        note->path);
+		if (raw->raw_len)
+			fwrite(raw->raw, 1, raw->raw_len, fp);
+	}
+	spnotes_cache_commit(fp, tmp_path, path);
+}
+
+/* links of the note `i` from the cache if unchanged, else from its file */
+static void
+spnotes_links_job_func(size_t i, void *arg)
+{
+	spnotes_links_job *job  = arg;
+	spnotes_note      *note = job->instance->notes_by_id[i];
+	spnotes_links_raw *raw  = &job->raws[i];
+
+	/* not stat'ed by the fill with 'no_stat', the cache needs it */
+	struct stat st;
+	if (note->last_modified.tv_sec == 0 &&
+	    note->last_modified.tv_nsec == 0) {
+		SPNOTES_STATS_ADD(job->instance, stat_calls, 1);
+		if (stat(note->path, &st) == 0)
+			note->last_modified = st.st_mtim;
+	}
+
+	long entry = spnotes_path_table_find(&job->cache->paths, note->path);
+	if (entry >= 0 && job->cache->entries[entry].mtime_sec ==
+	                          note->last_modified.tv_sec &&
+	    job->cache->entries[entry].mtime_nsec ==
+	            note->last_modified.tv_nsec) {
+		raw->raw     = (char *)job->cache->entries[entry].raw;
+		raw->raw_len = job->cache->entries[entry].raw_len;
+		return;
+	}
+
+	size_t len;
+	char  *buf = spnotes_file_read(note->path, &len);
+	if (buf == NULL) {
+		raw->err = errno == ENOMEM ? SPNOTES_ERR_MALLOC :
+		                             SPNOTES_ERR_FILE_READ;
+		return;
+	}
+	SPNOTES_STATS_ADD(job->instance, files_opened, 1);
+	SPNOTES_STATS_ADD(job->instance, bytes_read, len);
+
+	raw->is_owned = 1;
+	if (!spnotes_links_extract(buf, len, raw))
+		raw->err = SPNOTES_ERR_MALLOC;
+	free(buf);
+}
+
+/*
+ * Normalizes the `len` bytes of `path` into `out` of 'PATH_MAX' bytes, without
+ * empty and '.' components and with the '..' ones resolved where possible.
+ *
+ * Returns 0 if it doesn't fit.
+ */
+static int
+spnotes_path_normalize(char *out, const char *path, size_t len)
+{
+	size_t o = 0, depth = 0; /* components other than '..' */
+
+	if (len > 0 && path[0] == '/')
+		out[o++] = '/';
+	size_t base = o;
+
+	for (size_t i = 0; i < len;) {
+		const char *comp = path + i;
+		size_t      n    = 0;
+		while (i + n < len && comp[n] != '/')
+			n++;
+		i += n + 1;
+
+		if (n == 0 || (n == 1 && comp[0] == '.'))
+			continue;
+		if (n == 2 && comp[0] == '.' && comp[1] == '.') {
+			if (depth > 0) {
+				while (o > base && out[o - 1] != '/')
+					o--;
+				if (o > base)
+					o--;
+				depth--;
+				continue;
+			}
+			if (base > 0)
+				continue; /* '/..' is '/' */
+		} else {
+			depth++;
+		}
+
+		if (o + 1 + n + 1 > PATH_MAX)
+			return 0;
+		if (o > base)
+			out[o++] = '/';
+		memcpy(out + o, comp, n);
+		o += n;
+	}
+	out[o] = '\0';
+	return 1;
+}
+
+static void
+spnotes_links_lookup_free(spnotes_links_lookup *lk)
+{
+	free(lk->titles);
+	free(lk->paths);
+	free(lk->path_hashes);
+}
+
+/* Returns 0 if it couldn't allocate the memory. */
+static int
+spnotes_links_lookup_init(spnotes_links_lookup *lk, spnotes_note **notes,
+                          size_t notes_c)
+{
+	lk->notes   = notes;
+	lk->notes_c = notes_c;
+	lk->table_c = 16;
+	while (lk->table_c < notes_c * 2)
+		lk->table_c *= 2;
+	lk->titles      = calloc(lk->table_c, sizeof(uint32_t));
+	lk->paths       = calloc(lk->table_c, sizeof(uint32_t));
+	lk->path_hashes = malloc((notes_c + 1) * sizeof(uint64_t));
+	if (lk->titles == NULL || lk->paths == NULL ||
+	    lk->path_hashes == NULL) {
+		spnotes_links_lookup_free(lk);
+		return 0;
+	}
+
+	size_t mask = lk->table_c - 1;
+	for (size_t id = 0; id < notes_c; id++) {
+		const char *title = notes[id]->title_folded;
+		size_t      slot  = spnotes_hash_str(title, strlen(title));
+		slot &= mask;
+		while (lk->titles[slot])
+			slot = (slot + 1) & mask;
+		lk->titles[slot] = id + 1;
+
+		char path[PATH_MAX];
+		if (!spnotes_path_normalize(path, notes[id]->path,
+		                            strlen(notes[id]->path)))
+			path[0] = '\0';
+		lk->path_hashes[id] = spnotes_hash_str(path, strlen(path));
+		slot                = lk->path_hashes[id] & mask;
+		while (lk->paths[slot])
+			slot = (slot + 1) & mask;
+		lk->paths[slot] = id + 1;
+	}
+	return 1;
+}
+
+/*
+ * Returns the id of the note with the case folded `title` OR -1 if there's
+ * none, limited to the category with the case folded `categ` if not NULL, else
+ * preferring the notes of `prefer` over those of other categories.
+ */
+static long
+spnotes_links_by_title(const spnotes_links_lookup *lk, const char *title,
+                       const char *categ, const spnotes_categ *prefer)
+{
+	size_t mask  = lk->table_c - 1;
+	size_t slot  = spnotes_hash_str(title, strlen(title)) & mask;
+	long   found = -1;
+
+	for (; lk->titles[slot]; slot = (slot + 1) & mask) {
+		long          id   = lk->titles[slot] - 1;
+		spnotes_note *note = lk->notes[id];
+		if (strcmp(note->title_folded, title) ||
+		    (categ && strcmp(note->categ->title_folded, categ)))
+			continue;
+		if (note->categ == prefer)
+			return id;
+		if (found < 0 || id < found)
+			found = id;
+	}
+	return found;
+}
+
+/* Returns the id of the note file at `target` from `from` OR -1. */
+static long
+spnotes_links_by_path(const spnotes_links_lookup *lk,
+                      const spnotes_note *from, const char *target,
+                      size_t len)
+{
+	char        joined[2 * PATH_MAX], path[PATH_MAX], other[PATH_MAX];
+	const char *slash   = strrchr(from->path, '/');
+	size_t      dir_len = slash && target[0] != '/' ?
+	                              (size_t)(slash + 1 - from->path) :
+	                              0;
+
+	if (dir_len + len > sizeof(joined))
+		return -1;
+	memcpy(joined, from->path, dir_len);
+	memcpy(joined + dir_len, target, len);
+	if (!spnotes_path_normalize(path, joined, dir_len + len))
+		return -1;
+
+	uint64_t hash = spnotes_hash_str(path, strlen(path));
+	size_t   mask = lk->table_c - 1;
+	for (size_t slot = hash & mask; lk->paths[slot];
+	     slot        = (slot + 1) & mask) {
+		long id = lk->paths[slot] - 1;
+		if (lk->path_hashes[id] == hash &&
+		    spnotes_path_normalize(other, lk->notes[id]->path,
+		                           strlen(lk->notes[id]->path)) &&
+		    !strcmp(other, path))
+			return id;
+	}
+	return -1;
+}
+
+/*
+ * Returns the id of the note of the wiki link `target` from `from` OR -1: by
+ * its title, else by the title of its category and its own after the last
+ * '/', else by its file name in the category of `from`.
+ */
+static long
+spnotes_links_by_wiki(const spnotes_links_lookup *lk,
+                      const spnotes_note *from, const char *target,
+                      size_t len)
+{
+	char title[NAME_MAX], folded[NAME_MAX], categ[NAME_MAX];
+
+	while (len > 0 && *target == ' ') {
+		target++;
+		len--;
+	}
+	while (len > 0 && target[len - 1] == ' ')
+		len--;
+	if (len == 0 || len + 4 > NAME_MAX)
+		return -1;
+	memcpy(title, target, len);
+	title[len] = '\0';
+
+	spnotes_fold(folded, title);
+	long id = spnotes_links_by_title(lk, folded, NULL, from->categ);
+	if (id >= 0)
+		return id;
+
+	char *slash = strrchr(title, '/');
+	if (slash) {
+		*slash = '\0';
+		spnotes_fold(categ, title);
+		spnotes_fold(folded, slash + 1);
+		*slash = '/';
+		if ((id = spnotes_links_by_title(lk, folded, categ, NULL)) >= 0)
+			return id;
+	}
+
+	/* '[[1648362649]]' */
+	memcpy(title + len, ".md", 4);
+	return spnotes_links_by_path(lk, from, title, len + 3);
+}
+
+static int
+spnotes_links_id_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static int
+spnotes_links_url_compare(const void *a, const void *b)
+{
+	const spnotes_links_url *x = a, *y = b;
+	size_t len = x->len < y->len ? x->len : y->len;
+	int    cmp = memcmp(x->str, y->str, len);
+	return cmp ? cmp : (x->len > y->len) - (x->len < y->len);
+}
+
+/* Returns 0 if it couldn't grow `*arr` of `*cap` elements to `need`. */
+static int
+spnotes_links_reserve(void **arr, size_t *cap, size_t need, size_t size)
+{
+	if (need <= *cap)
+		return 1;
+	size_t new_cap = *cap ? *cap * 2 : 64;
+	while (new_cap < need)
+		new_cap *= 2;
+	void *tmp = realloc(*arr, new_cap * size);
+	if (tmp == NULL)
+		return 0;
+	*arr = tmp;
+	*cap = new_cap;
+	return 1;
+}
+
+/*
+ * Resolves the `raws` of the notes of `lk` into a links index.
+ *
+ * Returns NULL if it couldn't allocate the memory.
+ */
+static spnotes_links *
+spnotes_links_make(const spnotes_links_lookup *lk,
+                   const spnotes_links_raw *raws)
+{
+	size_t             notes_c = lk->notes_c;
+	spnotes_links     *links   = calloc(1, sizeof(spnotes_links));
+	spnotes_links_url *urls    = NULL; /* of the note being resolved */
+	size_t             urls_c = 0, murls_c = 0, mout_c = 0, mstrings = 0;
+	uint32_t          *url_starts = NULL, *cursors = NULL;
+	size_t             murl_starts = 0;
+
+	if (links == NULL)
+		return NULL;
+	links->notes_c     = notes_c;
+	links->out_offsets = malloc((notes_c + 1) * sizeof(uint32_t));
+	links->url_offsets = malloc((notes_c + 1) * sizeof(uint32_t));
+	links->in_offsets  = calloc(notes_c + 1, sizeof(uint32_t));
+	cursors            = malloc((notes_c + 1) * sizeof(uint32_t));
+	if (links->out_offsets == NULL || links->url_offsets == NULL ||
+	    links->in_offsets == NULL || cursors == NULL)
+		goto err;
+
+	for (size_t id = 0; id < notes_c; id++) {
+		const char *p = raws[id].raw, *end = p + raws[id].raw_len;
+		size_t      first = links->out_c;
+
+		links->out_offsets[id] = links->out_c;
+		links->url_offsets[id] = links->urls_c;
+		urls_c                 = 0;
+		for (const char *eol; p < end; p = eol + 1) {
+			if ((eol = memchr(p, '\n', end - p)) == NULL)
+				break;
+			if (eol - p < 2)
+				continue;
+
+			const char *target = p + 2;
+			size_t      len    = eol - target;
+			if (*p == 'u') {
+				if (!spnotes_links_reserve((void **)&urls,
+				                           &murls_c, urls_c + 1,
+				                           sizeof(*urls)))
+					goto err;
+				urls[urls_c].str   = target;
+				urls[urls_c++].len = len;
+				continue;
+			}
+
+			const spnotes_note *from = lk->notes[id];
+			long                to   = -1;
+			if (*p == 't')
+				to = spnotes_links_by_wiki(lk, from, target,
+				                           len);
+			else if (*p == 'p')
+				to = spnotes_links_by_path(lk, from, target,
+				                           len);
+			if (to < 0 || (size_t)to == id)
+				continue;
+			if (!spnotes_links_reserve((void **)&links->out,
+			                           &mout_c, links->out_c + 1,
+			                           sizeof(uint32_t)))
+				goto err;
+			links->out[links->out_c++] = to;
+		}
+
+		/* each target once, in order */
+		if (links->out_c - first > 1) {
+			qsort(links->out + first, links->out_c - first,
+			      sizeof(uint32_t), spnotes_links_id_compare);
+			size_t k = first + 1;
+			for (size_t j = first + 1; j < links->out_c; j++)
+				if (links->out[j] != links->out[k - 1])
+					links->out[k++] = links->out[j];
+			links->out_c = k;
+		}
+
+		if (urls_c > 1)
+			qsort(urls, urls_c, sizeof(*urls),
+			      spnotes_links_url_compare);
+		for (size_t j = 0; j < urls_c; j++) {
+			if (j > 0 && !spnotes_links_url_compare(&urls[j],
+			                                        &urls[j - 1]))
+				continue;
+			if (!spnotes_links_reserve((void **)&links->strings,
+			                           &mstrings,
+			                           links->strings_size +
+			                                   urls[j].len + 1,
+			                           1) ||
+			    !spnotes_links_reserve((void **)&url_starts,
+			                           &murl_starts,
+			                           links->urls_c + 1,
+			                           sizeof(uint32_t)))
+				goto err;
+			url_starts[links->urls_c++] = links->strings_size;
+			memcpy(links->strings + links->strings_size,
+			       urls[j].str, urls[j].len);
+			links->strings_size += urls[j].len;
+			links->strings[links->strings_size++] = '\0';
+		}
+	}
+	links->out_offsets[notes_c] = links->out_c;
+	links->url_offsets[notes_c] = links->urls_c;
+
+	/* the URLs once 'strings' doesn't move anymore */
+	links->urls = malloc((links->urls_c + 1) * sizeof(char *));
+	if (links->urls == NULL)
+		goto err;
+	for (size_t j = 0; j < links->urls_c; j++)
+		links->urls[j] = links->strings + url_starts[j];
+
+	/* backlinks, in the order of their ids as the links are walked */
+	links->in = malloc((links->out_c + 1) * sizeof(uint32_t));
+	if (links->in == NULL)
+		goto err;
+	for (size_t j = 0; j < links->out_c; j++)
+		links->in_offsets[links->out[j] + 1]++;
+	for (size_t id = 0; id < notes_c; id++) {
+		links->in_offsets[id + 1] += links->in_offsets[id];
+		cursors[id] = links->in_offsets[id];
+	}
+	for (size_t id = 0; id < notes_c; id++)
+		for (size_t j = links->out_offsets[id];
+		     j < links->out_offsets[id + 1]; j++)
+			links->in[cursors[links->out[j]]++] = id;
+
+	free(urls);
+	free(url_starts);
+	free(cursors);
+	return links;
+
+err:
+	free(urls);
+	free(url_starts);
+	free(cursors);
+	spnotes_links_destroy(links);
+	return NULL;
+}
+
+SPNOTES_DEF int
+spnotes_links_build(spnotes_t *instance, int flags)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return -1;
+	}
+
+	spnotes_links_destroy(instance->links);
+	instance->links = NULL;
+	if (!spnotes_notes_ids_assign(instance)) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "links_build", NULL);
+	size_t               notes_c = instance->notes_by_id_c;
+	spnotes_links_cache  cache   = { 0 };
+	spnotes_links_job    job     = { instance, NULL, &cache };
+	spnotes_links_lookup lk      = { 0 };
+	int                  err     = SPNOTES_ERR_NONE;
+
+	char cache_path[PATH_MAX];
+	snprintf(cache_path, PATH_MAX, "%s" SPNOTES_LINKS_CACHE,
+	         instance->root_location);
+	if (!(flags & SPNOTES_LINKS_NO_CACHE) &&
+	    !spnotes_links_cache_load(&cache, cache_path)) {
+		err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+	job.raws = calloc(notes_c + 1, sizeof(spnotes_links_raw));
+	if (job.raws == NULL) {
+		err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+
+	spnotes_parallel_for(notes_c, spnotes_links_job_func, &job);
+	size_t read_c = 0;
+	for (size_t i = 0; i < notes_c; i++) {
+		if (job.raws[i].err != SPNOTES_ERR_NONE)
+			err = job.raws[i].err;
+		read_c += job.raws[i].is_owned;
+	}
+	if (err != SPNOTES_ERR_NONE)
+		goto end;
+
+	/* only rewritten if some notes changed, came or went */
+	if (!(flags & SPNOTES_LINKS_NO_CACHE) &&
+	    (read_c > 0 || notes_c != cache.paths.paths_c))
+		spnotes_links_cache_save(&job, cache_path);
+
+	if (!spnotes_links_lookup_init(&lk, instance->notes_by_id, notes_c) ||
+	    (instance->links = spnotes_links_make(&lk, job.raws)) == NULL)
+		err = SPNOTES_ERR_MALLOC;
+
+end:
+	for (size_t i = 0; job.raws && i < notes_c; i++)
+		if (job.raws[i].is_owned)
+			free(job.raws[i].raw);
+	free(job.raws);
+	spnotes_links_lookup_free(&lk);
+	spnotes_links_cache_free(&cache);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "links_build", NULL);
+
+	if (err != SPNOTES_ERR_NONE) {
+		spnotes_err = err;
+		return -1;
+	}
+	return instance->links->out_c;
+}
+
+/*
+ * Fills `ids` with the ids of the note `note` of `instance` from 'offsets' and
+ * 'ids' of its index, building it if needed.
+ *
+ * Returns 0 on error.
+ */
+static int
+spnotes_links_get(spnotes_t *instance, const spnotes_note *note, int is_back,
+                  const uint32_t **ids, size_t *ids_c)
+{
+	if (instance == NULL || note == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return 0;
+	}
+	if (instance->links == NULL && spnotes_links_build(instance, 0) < 0)
+		return 0;
+	if (note->id >= instance->notes_by_id_c ||
+	    instance->notes_by_id[note->id] != note) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return 0;
+	}
+
+	const spnotes_links *links   = instance->links;
+	const uint32_t      *offsets = is_back ? links->in_offsets :
+	                                         links->out_offsets;
+	*ids   = (is_back ? links->in : links->out) + offsets[note->id];
+	*ids_c = offsets[note->id + 1] - offsets[note->id];
+	return 1;
+}
+
+static int
+spnotes_links_notes(spnotes_t *instance, const spnotes_note *note,
+                    int is_back, spnotes_note ***notes, size_t *notes_c)
+{
+	const uint32_t *ids;
+	size_t          ids_c;
+
+	if (notes == NULL || notes_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	if (!spnotes_links_get(instance, note, is_back, &ids, &ids_c))
+		return -1;
+
+	*notes = malloc((ids_c + 1) * sizeof(spnotes_note *));
+	if (*notes == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return -1;
+	}
+	for (size_t i = 0; i < ids_c; i++)
+		(*notes)[i] = instance->notes_by_id[ids[i]];
+	*notes_c = ids_c;
+	return ids_c;
+}
+
+SPNOTES_DEF int
+spnotes_note_links(spnotes_t *instance, const spnotes_note *note,
+                   spnotes_note ***notes, size_t *notes_c)
+{
+	return spnotes_links_notes(instance, note, 0, notes, notes_c);
+}
+
+SPNOTES_DEF int
+spnotes_note_backlinks(spnotes_t *instance, const spnotes_note *note,
+                       spnotes_note ***notes, size_t *notes_c)
+{
+	return spnotes_links_notes(instance, note, 1, notes, notes_c);
+}
+
+SPNOTES_DEF int
+spnotes_note_urls(spnotes_t *instance, const spnotes_note *note,
+                  char *const **urls, size_t *urls_c)
+{
+	if (urls == NULL || urls_c == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+	const uint32_t *ids;
+	size_t          ids_c;
+	if (!spnotes_links_get(instance, note, 0, &ids, &ids_c))
+		return -1;
+
+	const spnotes_links *links = instance->links;
+	*urls   = links->urls + links->url_offsets[note->id];
+	*urls_c = links->url_offsets[note->id + 1] -
+	          links->url_offsets[note->id];
+	return *urls_c;
+}
+
+/* = Snapshots = */
+
+/* a category of the snapshots along with the number of them sharing it */
+typedef struct {
+	spnotes_categ categ; /* first, so that it's the 'spnotes_categ *' */
+	size_t        refs;
+} spnotes_snapshot_categ;
+
+typedef struct {
+	spnotes_catalog *catalog;
+	spnotes_categ  **prev; /* of the previous snapshot, by path */
+	size_t           prev_c;
+	spnotes_categ  **categs; /* of the next snapshot, by category */
+	int             *errs;   /* error of each failed category */
+	size_t           read_c; /* atomic */
+} spnotes_refresh_job;
+
+static void
+spnotes_refs_inc(size_t *refs)
+{
+#ifdef SPNOTES_NO_THREADS
+	++*refs;
+#else
+	__atomic_add_fetch(refs, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/* Returns the references left. */
+static size_t
+spnotes_refs_dec(size_t *refs)
+{
+#ifdef SPNOTES_NO_THREADS
+	return --*refs;
+#else
+	return __atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static void
+spnotes_snapshot_categ_release(spnotes_categ *categ)
+{
+	spnotes_snapshot_categ *shared = (spnotes_snapshot_categ *)categ;
+
+	if (spnotes_refs_dec(&shared->refs) > 0)
+		return;
+	for (size_t i = 0; i < categ->notes_c; i++) {
+		if (categ->notes[i].has_description)
+			free(categ->notes[i].description);
+		free(categ->notes[i].tags);
+	}
+	free(categ->notes);
+	free(shared);
+}
+
+static void
+spnotes_snapshot_release(spnotes_snapshot *snapshot)
+{
+	if (spnotes_refs_dec(&snapshot->refs) > 0)
+		return;
+	for (size_t i = 0; i < snapshot->categs_c; i++)
+		spnotes_snapshot_categ_release(snapshot->categs[i]);
+	free(snapshot->categs);
+	free(snapshot);
+}
+
+static int
+spnotes_snapshot_compare_path(const void *a, const void *b)
+{
+	return strcmp((*(spnotes_categ *const *)a)->path,
+	              (*(spnotes_categ *const *)b)->path);
+}
+
+static int
+spnotes_snapshot_compare_last_modified(const void *a, const void *b)
+{
+	return spnotes_categs_compare_last_modified(*(spnotes_categ *const *)a,
+	                                            *(spnotes_categ *const *)b);
+}
+
+static int
+spnotes_snapshot_compare_alphabetically(const void *a, const void *b)
+{
+	return spnotes_categs_compare_alphabetically(
+		*(spnotes_categ *const *)a, *(spnotes_categ *const *)b);
+}
+
+/* whether `prev` still has the notes on the disk of the listed `categ` */
+static int
+spnotes_snapshot_categ_unchanged(const spnotes_categ *prev,
+                                 const spnotes_categ *categ,
+                                 spnotes_t           *instance)
+{
+	if (prev->last_modified.tv_sec != categ->last_modified.tv_sec ||
+	    prev->last_modified.tv_nsec != categ->last_modified.tv_nsec ||
+	    prev->root != categ->root || strcmp(prev->title, categ->title))
+		return 0;
+
+	/* edits in place don't change the directory */
+	for (size_t i = 0; i < prev->notes_c; i++) {
+		const spnotes_note *note = &prev->notes[i];
+		struct stat         st;
+		SPNOTES_STATS_ADD(instance, stat_calls, 1);
+		if (stat(note->path, &st) != 0 ||
+		    st.st_mtim.tv_sec != note->last_modified.tv_sec ||
+		    st.st_mtim.tv_nsec != note->last_modified.tv_nsec)
+			return 0;
+	}
+	return 1;
+}
+
+/* the `i`th category of the next snapshot: shared if unchanged, else read */
+static void
+spnotes_refresh_job_func(size_t i, void *arg)
+{
+	spnotes_refresh_job *job      = arg;
+	spnotes_t           *instance = &job->catalog->instance;
+	spnotes_categ       *categ    = &instance->categs[i];
+
+	spnotes_categ **prev =
+		job->prev_c ? bsearch(&categ, job->prev, job->prev_c,
+		                      sizeof(spnotes_categ *),
+		                      spnotes_snapshot_compare_path) :
+		              NULL;
+	if (prev && spnotes_snapshot_categ_unchanged(*prev, categ, instance)) {
+		spnotes_refs_inc(&((spnotes_snapshot_categ *)*prev)->refs);
+		job->categs[i] = *prev;
+		return;
+	}
+
+	spnotes_snapshot_categ *shared = malloc(sizeof(spnotes_snapshot_categ));
+	if (shared == NULL) {
+		job->errs[i] = SPNOTES_ERR_MALLOC;
+		return;
+	}
+	if (spnotes_notes_fill_err(categ, &job->errs[i]) < 0) {
+		free(shared);
+		return;
+	}
+
+	/* the notes are taken over from the instance */
+	shared->categ   = *categ;
+	shared->refs    = 1;
+	categ->notes    = NULL;
+	categ->notes_c  = 0;
+	categ->mnotes_c = 0;
+	for (size_t j = 0; j < shared->categ.notes_c; j++)
+		shared->categ.notes[j].categ = &shared->categ;
+	qsort(shared->categ.notes, shared->categ.notes_c, sizeof(spnotes_note),
+	      job->catalog->flags & SPNOTES_CATALOG_ALPHABETICAL ?
+	              spnotes_notes_compare_alphabetically :
+	              spnotes_notes_compare_last_modified);
+	job->categs[i] = &shared->categ;
+#ifdef SPNOTES_NO_THREADS
+	job->read_c++;
+#else
+	__atomic_fetch_add(&job->read_c, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/*
+ * Waits for the readers that might have loaded the snapshot replaced as the
+ * current one of `catalog` to have pinned it.
+ */
+static void
+spnotes_catalog_synchronize(spnotes_catalog *catalog)
+{
+#ifdef SPNOTES_NO_THREADS
+	(void)catalog;
+#else
+	/* twice, for the readers that got the epoch before the previous flip */
+	for (int i = 0; i < 2; i++) {
+		size_t epoch = __atomic_fetch_add(&catalog->epoch, 1,
+		                                  __ATOMIC_SEQ_CST);
+		while (__atomic_load_n(&catalog->pinning[epoch & 1],
+		                       __ATOMIC_SEQ_CST))
+			sched_yield();
+	}
+#endif
+}
+
+SPNOTES_DEF int
+spnotes_catalog_init(spnotes_catalog *catalog, const char *roots, int flags)
+{
+	if (catalog == NULL || roots == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+
+	memset(catalog, 0, sizeof(*catalog));
+	catalog->flags   = flags;
+	catalog->current = calloc(1, sizeof(spnotes_snapshot));
+	if (catalog->current == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	catalog->current->refs = 1;
+	if (!spnotes_init_roots(&catalog->instance, roots)) {
+		spnotes_free(&catalog->instance);
+		free(catalog->current);
+		catalog->current = NULL;
+		return 0;
+	}
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_init(&catalog->writer, NULL);
+#endif
+
+	return 1;
+}
+
+SPNOTES_DEF int
+spnotes_catalog_refresh(spnotes_catalog *catalog)
+{
+	if (catalog == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return -1;
+	}
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_lock(&catalog->writer);
+#endif
+	SPNOTES_TRACE(SPNOTES_TRACE_BEGIN, "catalog_refresh", NULL);
+	spnotes_t          *instance = &catalog->instance;
+	spnotes_snapshot   *prev     = catalog->current; /* only we change it */
+	spnotes_snapshot   *next     = NULL;
+	spnotes_refresh_job job      = { catalog, NULL, prev->categs_c,
+		                         NULL, NULL, 0 };
+	int                 read_c   = -1;
+
+	/* the notes read last time belong to the snapshots now */
+	spnotes_free_categs(instance);
+	if (spnotes_categs_fill(instance) < 0)
+		goto end;
+	size_t categs_c = instance->categs_c;
+
+	next       = calloc(1, sizeof(spnotes_snapshot));
+	job.prev   = malloc((prev->categs_c + 1) * sizeof(spnotes_categ *));
+	job.categs = calloc(categs_c + 1, sizeof(spnotes_categ *));
+	job.errs   = calloc(categs_c + 1, sizeof(int));
+	if (next == NULL || job.prev == NULL || job.categs == NULL ||
+	    job.errs == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		goto end;
+	}
+	for (size_t i = 0; i < prev->categs_c; i++)
+		job.prev[i] = prev->categs[i];
+	qsort(job.prev, prev->categs_c, sizeof(spnotes_categ *),
+	      spnotes_snapshot_compare_path);
+
+	spnotes_parallel_for(categs_c, spnotes_refresh_job_func, &job);
+	for (size_t i = 0; i < categs_c; i++) {
+		if (job.errs[i] == SPNOTES_ERR_NONE)
+			continue;
+		spnotes_err = job.errs[i];
+		for (size_t j = 0; j < categs_c; j++)
+			if (job.categs[j])
+				spnotes_snapshot_categ_release(job.categs[j]);
+		goto end;
+	}
+	qsort(job.categs, categs_c, sizeof(spnotes_categ *),
+	      catalog->flags & SPNOTES_CATALOG_ALPHABETICAL ?
+	              spnotes_snapshot_compare_alphabetically :
+	              spnotes_snapshot_compare_last_modified);
+
+	next->categs   = job.categs;
+	next->categs_c = categs_c;
+	next->version  = prev->version + 1;
+	next->refs     = 1; /* the catalog's */
+	job.categs     = NULL;
+
+	/* publish it, then drop the catalog's pin of the previous one */
+#ifdef SPNOTES_NO_THREADS
+	catalog->current = next;
+#else
+	__atomic_store_n(&catalog->current, next, __ATOMIC_SEQ_CST);
+#endif
+	next = NULL;
+	spnotes_catalog_synchronize(catalog);
+	spnotes_snapshot_release(prev);
+	read_c = job.read_c;
+
+end:
+	free(next);
+	free(job.prev);
+	free(job.categs);
+	free(job.errs);
+	SPNOTES_TRACE(SPNOTES_TRACE_END, "catalog_refresh", NULL);
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_unlock(&catalog->writer);
+#endif
+	return read_c;
+}
+
+SPNOTES_DEF spnotes_snapshot *
+spnotes_catalog_pin(spnotes_catalog *catalog)
 {
-	return spnotes_categs_fill_filter(instance, NULL, NULL);
+#ifdef SPNOTES_NO_THREADS
+	catalog->current->refs++;
+	return catalog->current;
+#else
+	/*
+	 * Counted as pinning while between loading the snapshot and taking a
+	 * reference to it, so that the writer doesn't free it in the meantime.
+	 */
+	size_t *pinning = &catalog->pinning[__atomic_load_n(
+		&catalog->epoch, __ATOMIC_SEQ_CST) & 1];
+	__atomic_add_fetch(pinning, 1, __ATOMIC_SEQ_CST);
+	spnotes_snapshot *snapshot =
+		__atomic_load_n(&catalog->current, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(pinning, 1, __ATOMIC_RELEASE);
+	return snapshot;
+#endif
 }
 
-SPNOTES_DEF int
-spnotes_categs_fill_filter(spnotes_t *instance, char *filter,
-                           int (*filter_func)(const char *, const char *))
+SPNOTES_DEF void
+spnotes_snapshot_unpin(spnotes_snapshot *snapshot)
 {
-	DIR *dir = opendir(instance->root_location);
-	if (dir == NULL) {
-		spnotes_err = SPNOTES_ERR_INVALID_LOC;
-		return -1;
+	if (snapshot == NULL)
+		return;
+
+	spnotes_snapshot_release(snapshot);
+}
+
+SPNOTES_DEF void
+spnotes_catalog_free(spnotes_catalog *catalog)
+{
+	if (catalog == NULL || catalog->current == NULL)
+		return;
+
+	spnotes_snapshot_release(catalog->current);
+	catalog->current = NULL;
+	spnotes_free(&catalog->instance);
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_destroy(&catalog->writer);
+#endif
+}
+
+/* = Shared memory = */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SPNOTES_LOAD_ACQ(ptr)     __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define SPNOTES_STORE_REL(ptr, v) __atomic_store_n(ptr, v, __ATOMIC_RELEASE)
+#define SPNOTES_FENCE()           __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define SPNOTES_LOAD_ACQ(ptr)     (*(ptr))
+#define SPNOTES_STORE_REL(ptr, v) (*(ptr) = (v))
+#define SPNOTES_FENCE()
+#endif
+
+SPNOTES_DEF void
+spnotes_shm_name(const spnotes_t *instance, char *name, size_t name_size)
+{
+	snprintf(name, name_size, "/spnotes-%016llx",
+	         (unsigned long long)spnotes_hash_str(
+			 instance->root_location,
+			 strlen(instance->root_location)));
+}
+
+/* appends `str` to the string pool of the segment being built */
+static uint64_t
+spnotes_shm_put(unsigned char *base, uint64_t *pos, const char *str)
+{
+	uint64_t off = *pos;
+	size_t   len = strlen(str) + 1;
+
+	memcpy(base + off, str, len);
+	*pos += len;
+	return off;
+}
+
+static int
+spnotes_shm_categ_compare(const void *a, const void *b)
+{
+	return strcmp((*(spnotes_categ *const *)a)->title,
+	              (*(spnotes_categ *const *)b)->title);
+}
+
+static int
+spnotes_shm_note_compare(const void *a, const void *b)
+{
+	return strcmp((*(spnotes_note *const *)a)->title,
+	              (*(spnotes_note *const *)b)->title);
+}
+
+/*
+ * Returns the order of the titles of the catalog (see 'spnotes_shm_header') of
+ * the `notes_c` notes of `instance` OR NULL if it couldn't allocate the memory.
+ */
+static uint32_t *
+spnotes_shm_order(const spnotes_t *instance, size_t notes_c)
+{
+	size_t max_c = 0;
+	for (size_t i = 0; i < instance->categs_c; i++)
+		if (instance->categs[i].notes_c > max_c)
+			max_c = instance->categs[i].notes_c;
+
+	uint32_t *order = malloc((instance->categs_c + notes_c + 1) *
+	                         sizeof(uint32_t));
+	spnotes_categ **categs =
+		malloc((instance->categs_c + 1) * sizeof(spnotes_categ *));
+	spnotes_note **notes = malloc((max_c + 1) * sizeof(spnotes_note *));
+	if (order == NULL || categs == NULL || notes == NULL) {
+		free(order);
+		order = NULL;
+		goto end;
 	}
 
-	int            categs_c = 0, mcategs_c = 128;
-	spnotes_categ *categs = malloc(mcategs_c * sizeof(spnotes_categ));
-	if (categs == NULL) {
-		spnotes_err = SPNOTES_ERR_MALLOC;
-		return -1;
+	for (size_t i = 0; i < instance->categs_c; i++)
+		categs[i] = &instance->categs[i];
+	qsort(categs, instance->categs_c, sizeof(spnotes_categ *),
+	      spnotes_shm_categ_compare);
+	for (size_t i = 0; i < instance->categs_c; i++)
+		order[i] = categs[i] - instance->categs;
+
+	for (size_t i = 0, k = instance->categs_c, first = 0;
+	     i < instance->categs_c; i++) {
+		spnotes_categ *categ = &instance->categs[i];
+		for (size_t j = 0; j < categ->notes_c; j++)
+			notes[j] = &categ->notes[j];
+		qsort(notes, categ->notes_c, sizeof(spnotes_note *),
+		      spnotes_shm_note_compare);
+		for (size_t j = 0; j < categ->notes_c; j++)
+			order[k++] = first + (notes[j] - categ->notes);
+		first += categ->notes_c;
 	}
 
-	/* start reading the directory */
-	errno = 0;
-	struct dirent *dirent;
-	while ((dirent = readdir(dir))) {
-		/* filter out files starting with "." */
-		if (dirent->d_name[0] == '.')
-			continue;
-		/* filter out non-dir */
-		if (dirent->d_type != DT_DIR)
-			continue;
-		/* filter with the `filter_func()` (if eligible) */
-		if (filter != NULL && filter_func != NULL &&
-		    filter_func(dirent->d_name, filter) <= 0)
-			continue;
+end:
+	free(categs);
+	free(notes);
+	return order;
+}
 
-		/* check if the size of dynamic array has to be increased */
-		if (categs_c == mcategs_c - 1) {
-			spnotes_categ *temp_categs = realloc(
-				categs, mcategs_c * 2 * sizeof(spnotes_categ));
-			if (temp_categs == NULL) {
-				instance->categs   = categs;
-				instance->categs_c = categs_c;
+/* whether the note ids of `instance` are in the order of the catalog */
+static int
+spnotes_shm_in_order(const spnotes_t *instance)
+{
+	for (size_t i = 0, k = 0; i < instance->categs_c; i++)
+		for (size_t j = 0; j < instance->categs[i].notes_c; j++, k++)
+			if (instance->notes_by_id[k] !=
+			    &instance->categs[i].notes[j])
+				return 0;
+	return 1;
+}
 
-				spnotes_err = SPNOTES_ERR_REALLOC;
-				closedir(dir);
-				return -1;
-			}
-			categs = temp_categs;
-			mcategs_c *= 2;
+SPNOTES_DEF int
+spnotes_shm_publish(const spnotes_t *instance, const char *name)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (instance->categs == NULL) {
+		spnotes_err = SPNOTES_ERR_NOT_FILLED;
+		return 0;
+	}
+	/* the catalog is checked for staleness against a single root */
+	if (instance->roots_c > 1) {
+		spnotes_err = SPNOTES_ERR_MULTI_ROOT;
+		return 0;
+	}
+
+	char default_name[64];
+	if (name == NULL) {
+		spnotes_shm_name(instance, default_name, sizeof(default_name));
+		name = default_name;
+	}
+
+	/* size of the catalog */
+	size_t notes_c = 0, strings_size = strlen(instance->root_location) + 1;
+	for (size_t i = 0; i < instance->categs_c; i++) {
+		spnotes_categ *categ = &instance->categs[i];
+		if (categ->notes == NULL) {
+			spnotes_err = SPNOTES_ERR_NOT_FILLED;
+			return 0;
 		}
-		strcpy(categs[categs_c].title, dirent->d_name);
-		categs[categs_c].notes            = NULL;
-		categs[categs_c].notes_c          = 0;
-		categs[categs_c].spnotes_instance = instance;
+		strings_size += strlen(categ->title) + strlen(categ->path) + 2;
+		for (size_t j = 0; j < categ->notes_c; j++) {
+			spnotes_note *note = &categ->notes[j];
+			strings_size += strlen(note->title) + strlen(note->path) + 2;
+			if (note->has_description)
+				strings_size += strlen(note->description) + 1;
+			if (note->tags)
+				strings_size += strlen(note->tags) + 1;
+		}
+		notes_c += categ->notes_c;
+	}
 
-		char path[PATH_MAX];
-		snprintf(path, PATH_MAX, "%s%s/", instance->root_location,
-		         dirent->d_name);
+	/* the trigram index with the notes in the order they are published */
+	const spnotes_trigrams *tg  = instance->trigrams;
+	spnotes_trigrams       *own = NULL;
+	if (tg == NULL || instance->notes_by_id_c != notes_c ||
+	    !spnotes_shm_in_order(instance)) {
+		spnotes_note **order = malloc((notes_c + 1) * sizeof(*order));
+		if (order == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			return 0;
+		}
+		for (size_t i = 0, k = 0; i < instance->categs_c; i++)
+			for (size_t j = 0; j < instance->categs[i].notes_c; j++)
+				order[k++] = &instance->categs[i].notes[j];
+		tg = own = spnotes_trigrams_make(order, notes_c);
+		free(order);
+		if (own == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			return 0;
+		}
+	}
+	size_t trigrams_size = (2 * tg->grams_c + 1 + tg->table_c +
+	                        tg->postings_c) *
+	                       sizeof(uint32_t);
+
+	/* the titles in order for 'spnotes_shm_complete()' */
+	uint32_t *order = spnotes_shm_order(instance, notes_c);
+	if (order == NULL) {
+		spnotes_trigrams_destroy(own);
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
+	}
+	size_t order_size = (instance->categs_c + notes_c) * sizeof(uint32_t);
 
-		strcpy(categs[categs_c].path, path);
+	size_t size = sizeof(spnotes_shm_header) +
+	              instance->categs_c * sizeof(spnotes_shm_categ) +
+	              notes_c * sizeof(spnotes_shm_note) + trigrams_size +
+	              order_size + strings_size;
 
-		/* get the last modified date */
-		struct stat categ_stat;
-		if (stat(path, &categ_stat) != 0) {
-			instance->categs   = categs;
-			instance->categs_c = categs_c;
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+	if (fd == -1) {
+		spnotes_trigrams_destroy(own);
+		free(order);
+		spnotes_err = SPNOTES_ERR_SHM;
+		return 0;
+	}
 
-			spnotes_err = SPNOTES_ERR_FILE_STAT;
-			closedir(dir);
-			return -1;
-		}
-		categs[categs_c].last_modified = categ_stat.st_mtim;
+	/* one publisher at a time */
+	struct flock lock = { 0 };
+	lock.l_type       = F_WRLCK;
+	lock.l_whence     = SEEK_SET;
+	while (fcntl(fd, F_SETLKW, &lock) == -1)
+		if (errno != EINTR)
+			goto err_close;
+
+	/* the segment only ever grows so that readers never fault */
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		goto err_close;
+	size_t capacity = st.st_size;
+	if (capacity < size) {
+		capacity = size + size / 4;
+		if (ftruncate(fd, capacity) != 0)
+			goto err_close;
+	}
 
-		categs_c++;
+	unsigned char *base =
+		mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED)
+		goto err_close;
+	spnotes_shm_header *header = (spnotes_shm_header *)base;
+
+	/* new segment */
+	if (st.st_size == 0 || header->magic != SPNOTES_SHM_MAGIC ||
+	    header->version != SPNOTES_SHM_VERSION) {
+		header->seq        = 0;
+		header->generation = 0;
 	}
-	if (errno != 0) {
-		instance->categs   = categs;
-		instance->categs_c = categs_c;
 
-		spnotes_err = SPNOTES_ERR_DIR_READ;
-		closedir(dir);
-		return -1;
+	/* seqlock: odd while the catalog is being rewritten */
+	uint32_t seq = header->seq;
+	SPNOTES_STORE_REL(&header->seq, seq | 1);
+	SPNOTES_FENCE();
+
+	header->magic        = SPNOTES_SHM_MAGIC;
+	header->version      = SPNOTES_SHM_VERSION;
+	header->size         = size;
+	header->categs_off   = sizeof(spnotes_shm_header);
+	header->categs_c     = instance->categs_c;
+	header->notes_off    = header->categs_off +
+	                       instance->categs_c * sizeof(spnotes_shm_categ);
+	header->notes_c      = notes_c;
+	header->trigrams_off = header->notes_off +
+	                       notes_c * sizeof(spnotes_shm_note);
+	header->grams_c      = tg->grams_c;
+	header->postings_c   = tg->postings_c;
+	header->table_c      = tg->table_c;
+	header->order_off    = header->trigrams_off + trigrams_size;
+	header->strings_off  = header->order_off + order_size;
+
+	uint32_t *words = (uint32_t *)(base + header->trigrams_off);
+	memcpy(words, tg->grams, tg->grams_c * sizeof(uint32_t));
+	words += tg->grams_c;
+	memcpy(words, tg->offsets, (tg->grams_c + 1) * sizeof(uint32_t));
+	words += tg->grams_c + 1;
+	memcpy(words, tg->table, tg->table_c * sizeof(uint32_t));
+	words += tg->table_c;
+	memcpy(words, tg->postings, tg->postings_c * sizeof(uint32_t));
+	memcpy(base + header->order_off, order, order_size);
+
+	uint64_t pos = header->strings_off;
+	header->root_off = spnotes_shm_put(base, &pos, instance->root_location);
+
+	struct stat root_stat;
+	if (stat(instance->root_location, &root_stat) == 0) {
+		header->root_mtime_sec  = root_stat.st_mtim.tv_sec;
+		header->root_mtime_nsec = root_stat.st_mtim.tv_nsec;
 	}
 
-	closedir(dir);
+	spnotes_shm_categ *categs =
+		(spnotes_shm_categ *)(base + header->categs_off);
+	spnotes_shm_note *notes = (spnotes_shm_note *)(base + header->notes_off);
+	for (size_t i = 0, k = 0; i < instance->categs_c; i++) {
+		spnotes_categ *categ = &instance->categs[i];
+
+		categs[i].title_off  = spnotes_shm_put(base, &pos, categ->title);
+		categs[i].path_off   = spnotes_shm_put(base, &pos, categ->path);
+		categs[i].mtime_sec  = categ->last_modified.tv_sec;
+		categs[i].mtime_nsec = categ->last_modified.tv_nsec;
+		categs[i].notes_first = k;
+		categs[i].notes_c     = categ->notes_c;
+
+		for (size_t j = 0; j < categ->notes_c; j++, k++) {
+			spnotes_note *note = &categ->notes[j];
+
+			notes[k].title_off = spnotes_shm_put(base, &pos, note->title);
+			notes[k].path_off  = spnotes_shm_put(base, &pos, note->path);
+			notes[k].desc_off =
+				note->has_description ?
+					spnotes_shm_put(base, &pos,
+				                        note->description) :
+					0;
+			notes[k].tags_off =
+				note->tags ? spnotes_shm_put(base, &pos, note->tags) :
+				             0;
+			notes[k].mtime_sec  = note->last_modified.tv_sec;
+			notes[k].mtime_nsec = note->last_modified.tv_nsec;
+			notes[k].categ      = i;
+		}
+	}
+	header->generation++;
 
-	instance->categs   = categs;
-	instance->categs_c = categs_c;
-	return categs_c;
+	SPNOTES_FENCE();
+	SPNOTES_STORE_REL(&header->seq, (seq | 1) + 1);
+
+	munmap(base, capacity);
+	close(fd); /* releases the lock */
+	spnotes_trigrams_destroy(own);
+	free(order);
+	return 1;
+
+err_close:
+	close(fd);
+	spnotes_trigrams_destroy(own);
+	free(order);
+	spnotes_err = SPNOTES_ERR_SHM;
+	return 0;
 }
 
-SPNOTES_DEF int
-spnotes_categs_compare_last_modified(const void *categ1, const void *categ2)
+/*
+ * Copies the string at `off` of the segment into `dst` of `dst_size` bytes.
+ * Everything read from a segment is bound checked as a torn read (see
+ * 'spnotes_shm_validate()') can see garbage.
+ */
+static void
+spnotes_shm_strcpy(char *dst, size_t dst_size, const unsigned char *base,
+                   size_t size, uint64_t off)
 {
-	struct timespec *tm1_ts = &(((spnotes_categ *)categ1)->last_modified);
-	struct timespec *tm2_ts = &(((spnotes_categ *)categ2)->last_modified);
+	size_t i = 0;
 
-	if (tm1_ts->tv_sec == tm2_ts->tv_sec) {
-		if (tm1_ts->tv_nsec > tm2_ts->tv_nsec)
-			return -1;
-		else
+	for (; off + i < size && i < dst_size - 1 && base[off + i]; i++)
+		dst[i] = base[off + i];
+	dst[i] = '\0';
+}
+
+static char *
+spnotes_shm_strdup(const unsigned char *base, size_t size, uint64_t off)
+{
+	return strndup((const char *)base + off, size - off);
+}
+
+/*
+ * Takes the arrays of the catalog mapped in `view` once checked: of the
+ * current layout, published for the root location of `instance` and within
+ * the mapping. Every field of the header is read once, a publisher possibly
+ * rewriting it meanwhile.
+ *
+ * Returns 0 if they aren't.
+ */
+static int
+spnotes_shm_layout(const spnotes_t *instance, spnotes_shm_view *view)
+{
+	const spnotes_shm_header *header     = view->header;
+	size_t                    size       = view->size;
+	uint64_t                  root_off   = header->root_off;
+	uint64_t                  categs_off = header->categs_off;
+	uint64_t                  categs_c   = header->categs_c;
+	uint64_t                  notes_off  = header->notes_off;
+	uint64_t                  notes_c    = header->notes_c;
+	uint64_t                  order_off  = header->order_off;
+
+	if (header->magic != SPNOTES_SHM_MAGIC ||
+	    header->version != SPNOTES_SHM_VERSION || root_off >= size ||
+	    strncmp((const char *)view->base + root_off,
+	            instance->root_location, size - root_off))
+		return 0;
+	if (categs_off > size || categs_off % sizeof(uint64_t) ||
+	    (size - categs_off) / sizeof(spnotes_shm_categ) < categs_c ||
+	    notes_off > size || notes_off % sizeof(uint64_t) ||
+	    (size - notes_off) / sizeof(spnotes_shm_note) < notes_c ||
+	    order_off > size || order_off % sizeof(uint32_t) ||
+	    (size - order_off) / sizeof(uint32_t) < categs_c + notes_c)
+		return 0;
+
+	view->categs   = (const spnotes_shm_categ *)(view->base + categs_off);
+	view->categs_c = categs_c;
+	view->notes    = (const spnotes_shm_note *)(view->base + notes_off);
+	view->notes_c  = notes_c;
+	view->order    = (const uint32_t *)(view->base + order_off);
+	return 1;
+}
+
+/*
+ * Maps the segment `name` (the default one of `instance` if NULL) read only
+ * into `view` once no publisher is writing it, see 'spnotes_shm_layout()'.
+ * Its freshness isn't checked.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ */
+static int
+spnotes_shm_map(const spnotes_t *instance, const char *name,
+                spnotes_shm_view *view)
+{
+	char default_name[64];
+	if (name == NULL) {
+		spnotes_shm_name(instance, default_name, sizeof(default_name));
+		name = default_name;
+	}
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1) {
+		spnotes_err = SPNOTES_ERR_STALE;
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 ||
+	    (size_t)st.st_size < sizeof(spnotes_shm_header)) {
+		close(fd);
+		spnotes_err = SPNOTES_ERR_STALE;
+		return 0;
+	}
+	void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		spnotes_err = SPNOTES_ERR_SHM;
+		return 0;
+	}
+	memset(view, 0, sizeof(spnotes_shm_view));
+	view->base   = base;
+	view->size   = st.st_size;
+	view->header = base;
+
+	/* seqlock: wait for a publisher writing meanwhile */
+	for (int tries = 0; tries < 100; tries++) {
+		uint32_t seq = SPNOTES_LOAD_ACQ(&view->header->seq);
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		view->seq = seq;
+		if (spnotes_shm_layout(instance, view))
 			return 1;
+		if (spnotes_shm_validate(view))
+			break; /* not a torn read */
 	}
 
-	if (tm1_ts->tv_sec > tm2_ts->tv_sec)
-		return -1;
-	return 1;
+	spnotes_shm_detach(view);
+	spnotes_err = SPNOTES_ERR_STALE;
+	return 0;
 }
 
-SPNOTES_DEF int
-spnotes_categs_compare_alphabetically(const void *categ1, const void *categ2)
+/*
+ * Whether the catalog of `view` is still the one on the disk: neither the root
+ * directory nor the directories of the categories changed since it was
+ * published, so no category or note was added, deleted or renamed. That's a
+ * stat of each category, not of each note: the notes edited in place with
+ * 'spnotes_note_set_title()' or 'spnotes_note_set_description()' outdated the
+ * segment already.
+ */
+static int
+spnotes_shm_is_fresh(const spnotes_shm_view *view)
 {
-	char *categ1_title = ((spnotes_categ *)categ1)->title;
-	char *categ2_title = ((spnotes_categ *)categ2)->title;
+	const spnotes_shm_header *header = view->header;
+	char                      path[PATH_MAX];
+	struct stat               st;
+
+	spnotes_shm_strcpy(path, PATH_MAX, view->base, view->size,
+	                   header->root_off);
+	if (stat(path, &st) != 0 ||
+	    st.st_mtim.tv_sec != header->root_mtime_sec ||
+	    st.st_mtim.tv_nsec != header->root_mtime_nsec)
+		return 0;
 
-	return strcmp(categ1_title, categ2_title);
+	for (size_t i = 0; i < view->categs_c; i++) {
+		const spnotes_shm_categ *sc = &view->categs[i];
+
+		spnotes_shm_strcpy(path, PATH_MAX, view->base, view->size,
+		                   sc->path_off);
+		if (stat(path, &st) != 0 ||
+		    st.st_mtim.tv_sec != sc->mtime_sec ||
+		    st.st_mtim.tv_nsec != sc->mtime_nsec)
+			return 0;
+	}
+	return 1;
 }
 
-SPNOTES_DEF void
-spnotes_categs_sort_last_modified(spnotes_t *instance)
+/*
+ * Outdates the default segment of `instance`, if any, for a note edited in
+ * place: the directories didn't change, so readers would take the catalog as
+ * fresh otherwise. The root modification time of the catalog is made one no
+ * directory has, under the lock of the publishers and the seqlock.
+ */
+static void
+spnotes_shm_outdate(const spnotes_t *instance)
 {
-	if (instance == NULL || instance->categs == NULL)
+	if (instance == NULL || instance->roots_c > 1)
 		return;
 
-	qsort(instance->categs, instance->categs_c, sizeof(spnotes_categ),
-	      spnotes_categs_compare_last_modified);
+	char name[64];
+	spnotes_shm_name(instance, name, sizeof(name));
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1)
+		return;
+
+	struct flock lock = { 0 };
+	lock.l_type       = F_WRLCK;
+	lock.l_whence     = SEEK_SET;
+	while (fcntl(fd, F_SETLKW, &lock) == -1)
+		if (errno != EINTR)
+			goto end;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 ||
+	    (size_t)st.st_size < sizeof(spnotes_shm_header))
+		goto end;
+	spnotes_shm_header *header = mmap(NULL, sizeof(spnotes_shm_header),
+	                                  PROT_READ | PROT_WRITE, MAP_SHARED,
+	                                  fd, 0);
+	if (header == MAP_FAILED)
+		goto end;
+
+	if (header->magic == SPNOTES_SHM_MAGIC &&
+	    header->version == SPNOTES_SHM_VERSION) {
+		uint32_t seq = header->seq;
+		SPNOTES_STORE_REL(&header->seq, seq | 1);
+		SPNOTES_FENCE();
+		header->root_mtime_nsec = -1;
+		header->generation++;
+		SPNOTES_FENCE();
+		SPNOTES_STORE_REL(&header->seq, (seq | 1) + 1);
+	}
+	munmap(header, sizeof(spnotes_shm_header));
+
+end:
+	close(fd); /* releases the lock */
 }
 
-SPNOTES_DEF void
-spnotes_categs_sort_alphabetically(spnotes_t *instance)
+/*
+ * Copies the trigram index of the catalog of `view` into the filled
+ * `instance`, its notes getting the ids they have in the catalog.
+ *
+ * Returns 0 on error and sets the `spnotes_err` with the error.
+ */
+static int
+spnotes_shm_trigrams(spnotes_t *instance, const spnotes_shm_view *view)
 {
-	if (instance == NULL || instance->categs == NULL)
-		return;
+	const spnotes_shm_header *header       = view->header;
+	size_t                    size         = view->size;
+	size_t                    words_c      = size / sizeof(uint32_t);
+	uint64_t                  trigrams_off = header->trigrams_off;
+	uint64_t                  grams_c      = header->grams_c;
+	uint64_t                  postings_c   = header->postings_c;
+	uint64_t                  table_c      = header->table_c;
+	spnotes_trigrams         *tg           = NULL;
+
+	if (trigrams_off == 0)
+		return 1;
+	if (trigrams_off > size || trigrams_off % sizeof(uint32_t) ||
+	    grams_c >= words_c || table_c >= words_c || postings_c >= words_c ||
+	    (size - trigrams_off) / sizeof(uint32_t) <
+	            2 * grams_c + 1 + table_c + postings_c ||
+	    table_c == 0 || (table_c & (table_c - 1)))
+		goto err_stale;
+
+	if (!spnotes_notes_ids_assign(instance))
+		goto err_malloc;
+	tg = calloc(1, sizeof(spnotes_trigrams));
+	if (tg == NULL)
+		goto err_malloc;
+	tg->grams_c    = grams_c;
+	tg->postings_c = postings_c;
+	tg->table_c    = table_c;
+	tg->grams      = malloc((tg->grams_c + 1) * sizeof(uint32_t));
+	tg->offsets    = malloc((tg->grams_c + 1) * sizeof(uint32_t));
+	tg->table      = malloc(tg->table_c * sizeof(uint32_t));
+	tg->postings   = malloc((tg->postings_c + 1) * sizeof(uint32_t));
+	if (tg->grams == NULL || tg->offsets == NULL || tg->table == NULL ||
+	    tg->postings == NULL)
+		goto err_malloc;
+
+	const uint32_t *words = (const uint32_t *)(view->base + trigrams_off);
+	memcpy(tg->grams, words, tg->grams_c * sizeof(uint32_t));
+	words += tg->grams_c;
+	memcpy(tg->offsets, words, (tg->grams_c + 1) * sizeof(uint32_t));
+	words += tg->grams_c + 1;
+	memcpy(tg->table, words, tg->table_c * sizeof(uint32_t));
+	words += tg->table_c;
+	memcpy(tg->postings, words, tg->postings_c * sizeof(uint32_t));
+
+	/* a torn read must not send a lookup out of the arrays */
+	if (tg->offsets[0] != 0 || tg->offsets[tg->grams_c] != tg->postings_c)
+		goto err_stale;
+	for (size_t i = 0; i < tg->grams_c; i++)
+		if (tg->offsets[i] > tg->offsets[i + 1])
+			goto err_stale;
+	size_t empty_c = 0;
+	for (size_t i = 0; i < tg->table_c; i++) {
+		if (tg->table[i] > tg->grams_c)
+			goto err_stale;
+		empty_c += tg->table[i] == 0;
+	}
+	if (empty_c == 0)
+		goto err_stale;
+	for (size_t i = 0; i < tg->postings_c; i++)
+		if (tg->postings[i] >= instance->notes_by_id_c)
+			goto err_stale;
 
-	qsort(instance->categs, instance->categs_c, sizeof(spnotes_categ),
-	      spnotes_categs_compare_alphabetically);
+	instance->trigrams = tg;
+	return 1;
+
+err_stale:
+	spnotes_trigrams_destroy(tg);
+	spnotes_err = SPNOTES_ERR_STALE;
+	return 0;
+err_malloc:
+	spnotes_trigrams_destroy(tg);
+	spnotes_err = SPNOTES_ERR_MALLOC;
+	return 0;
 }
 
-SPNOTES_DEF spnotes_categ *
-spnotes_categs_search(spnotes_t instance, const char *title)
+/* copies the catalog of `view` into `instance` */
+static int
+spnotes_shm_copy(spnotes_t *instance, const spnotes_shm_view *view)
 {
-	if (!(instance.categs)) {
-		spnotes_err = SPNOTES_ERR_NOT_FILLED;
-		return NULL;
+	const unsigned char *base     = view->base;
+	size_t               size     = view->size;
+	size_t               categs_c = view->categs_c;
+
+	if (!spnotes_memory_charge(instance,
+	                           (categs_c + 1) * sizeof(spnotes_categ))) {
+		spnotes_err = SPNOTES_ERR_MEMORY_CAP;
+		return 0;
+	}
+	spnotes_categ *categs = malloc((categs_c + 1) * sizeof(spnotes_categ));
+	if (categs == NULL) {
+		spnotes_err = SPNOTES_ERR_MALLOC;
+		return 0;
 	}
 
-	for (size_t i = 0; i < instance.categs_c; i++) {
-		if (!strcmp(instance.categs[i].title, title))
-			return (instance.categs + i);
+	size_t i;
+	for (i = 0; i < categs_c; i++) {
+		const spnotes_shm_categ *sc      = &view->categs[i];
+		spnotes_categ           *categ   = &categs[i];
+		uint64_t                 first   = sc->notes_first;
+		uint64_t                 notes_c = sc->notes_c;
+
+		if (first > view->notes_c || notes_c > view->notes_c - first ||
+		    sc->title_off >= size || sc->path_off >= size) {
+			spnotes_err = SPNOTES_ERR_STALE;
+			goto err;
+		}
+		spnotes_shm_strcpy(categ->title, NAME_MAX, base, size,
+		                   sc->title_off);
+		spnotes_fold(categ->title_folded, categ->title);
+		spnotes_shm_strcpy(categ->path, PATH_MAX, base, size,
+		                   sc->path_off);
+		categ->last_modified.tv_sec  = sc->mtime_sec;
+		categ->last_modified.tv_nsec = sc->mtime_nsec;
+		categ->spnotes_instance      = instance;
+		categ->root                  = instance->root_location;
+		categ->notes_c               = notes_c;
+		categ->mnotes_c              = notes_c + 1;
+		categ->notes                 = NULL;
+		if (!spnotes_memory_charge(instance, categ->mnotes_c *
+		                                             sizeof(spnotes_note))) {
+			spnotes_err = SPNOTES_ERR_MEMORY_CAP;
+			goto err;
+		}
+		categ->notes = malloc(categ->mnotes_c * sizeof(spnotes_note));
+		if (categ->notes == NULL) {
+			spnotes_err = SPNOTES_ERR_MALLOC;
+			goto err;
+		}
+
+		for (size_t j = 0; j < notes_c; j++) {
+			const spnotes_shm_note *sn   = &view->notes[first + j];
+			spnotes_note           *note = &categ->notes[j];
+
+			/* read once, being checked */
+			uint64_t desc = sn->desc_off, tags = sn->tags_off;
+
+			note->description = note->tags = NULL;
+			if (sn->title_off >= size || sn->path_off >= size ||
+			    desc >= size || tags >= size) {
+				categ->notes_c = j;
+				spnotes_err    = SPNOTES_ERR_STALE;
+				goto err_categ;
+			}
+			spnotes_shm_strcpy(note->title, NAME_MAX, base, size,
+			                   sn->title_off);
+			spnotes_fold(note->title_folded, note->title);
+			spnotes_shm_strcpy(note->path, PATH_MAX, base, size,
+			                   sn->path_off);
+			const char *slash = strrchr(note->path, '/');
+			spnotes_note_name_time(slash ? slash + 1 : note->path,
+			                       &note->created);
+			note->has_description = desc != 0;
+			if (desc)
+				note->description =
+					spnotes_shm_strdup(base, size, desc);
+			if (tags)
+				note->tags =
+					spnotes_shm_strdup(base, size, tags);
+			if (!spnotes_memory_charge(
+				    instance, spnotes_note_strings_size(note))) {
+				free(note->description);
+				free(note->tags);
+				categ->notes_c = j;
+				spnotes_err    = SPNOTES_ERR_MEMORY_CAP;
+				goto err_categ;
+			}
+			note->id                    = 0;
+			note->last_modified.tv_sec  = sn->mtime_sec;
+			note->last_modified.tv_nsec = sn->mtime_nsec;
+			note->categ                 = categ;
+		}
+	}
+
+	instance->categs    = categs;
+	instance->categs_c  = categs_c;
+	instance->mcategs_c = categs_c + 1;
+	if (!spnotes_shm_trigrams(instance, view)) {
+		spnotes_free_categs(instance);
+		return 0;
+	}
+	return 1;
+
+err_categ:
+	i++; /* free the partially copied category too */
+err:
+	instance->categs   = categs;
+	instance->categs_c = i;
+	spnotes_free_categs(instance);
+	return 0;
+}
+
+SPNOTES_DEF int
+spnotes_shm_load(spnotes_t *instance, const char *name)
+{
+	if (instance == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
+		return 0;
+	}
+	if (instance->categs != NULL) {
+		spnotes_err = SPNOTES_ERR_REDECLARE;
+		return 0;
+	}
+
+	/* seqlock: copy again if a publisher was writing meanwhile */
+	spnotes_shm_view view;
+	for (int tries = 0; tries < 100; tries++) {
+		if (!spnotes_shm_attach(instance, name, &view))
+			return 0;
+
+		int copied = spnotes_shm_copy(instance, &view);
+		int err    = spnotes_err;
+		if (spnotes_shm_validate(&view)) {
+			spnotes_shm_detach(&view);
+			spnotes_err = err;
+			return copied;
+		}
+		if (copied)
+			spnotes_free_categs(instance);
+		spnotes_shm_detach(&view);
 	}
-	return NULL;
+
+	spnotes_err = SPNOTES_ERR_STALE;
+	return 0;
 }
 
 SPNOTES_DEF int
-spnotes_categs_add(spnotes_t instance, const char *title, char *new_loc)
+spnotes_shm_attach(const spnotes_t *instance, const char *name,
+                   spnotes_shm_view *view)
 {
-	if (spnotes_categs_search(instance, title)) {
-		spnotes_err = SPNOTES_ERR_REDECLARE;
+	if (instance == NULL || view == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
 		return 0;
 	}
-
-	char path[PATH_MAX];
-	snprintf(path, PATH_MAX, "%s%s", instance.root_location, title);
-
-	if (mkdir(path, 0777) != 0) {
-		spnotes_err = SPNOTES_ERR_MKDIR;
+	/* the catalog is checked for staleness against a single root */
+	if (instance->roots_c > 1) {
+		spnotes_err = SPNOTES_ERR_MULTI_ROOT;
 		return 0;
 	}
 
-	if (new_loc)
-		strcpy(new_loc, path);
-
-	return 1;
-}
+	for (int tries = 0; tries < 100; tries++) {
+		if (!spnotes_shm_map(instance, name, view))
+			return 0;
 
-/* directory unlink function (for 'rmrf()') */
-int
-unlink_cb(const char *fpath, const struct stat *sb, int typeflag,
-          struct FTW *ftwbuf)
-{
-	(void)sb;
-	(void)typeflag;
-	(void)ftwbuf;
+		int is_fresh = spnotes_shm_is_fresh(view);
+		if (spnotes_shm_validate(view)) {
+			if (is_fresh)
+				return 1;
+			break;
+		}
+		spnotes_shm_detach(view); /* torn read, map it again */
+	}
 
-	return remove(fpath);
+	spnotes_shm_detach(view);
+	spnotes_err = SPNOTES_ERR_STALE;
+	return 0;
 }
 
-/* recursive directory deletion (for 'spnotes_categs_remove()') */
-int
-rmrf(const char *path)
+SPNOTES_DEF const char *
+spnotes_shm_str(const spnotes_shm_view *view, uint64_t off)
 {
-	return nftw(path, unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
+	if (view == NULL || off == 0 || off >= view->size)
+		return "";
+
+	const char *str = (const char *)view->base + off;
+	return memchr(str, '\0', view->size - off) ? str : "";
 }
 
 SPNOTES_DEF int
-spnotes_categs_remove(spnotes_categ categ)
+spnotes_shm_validate(const spnotes_shm_view *view)
 {
-	if (rmrf(categ.path) == -1) {
-		spnotes_err = SPNOTES_ERR_DELETE;
-		return 0;
-	}
-	return 1;
+	SPNOTES_FENCE();
+	return SPNOTES_LOAD_ACQ(&view->header->seq) == view->seq;
 }
 
-/* = Note = */
-
-SPNOTES_DEF int
-spnotes_note_fill_title_desc(spnotes_note *note, char *md_loc)
+SPNOTES_DEF void
+spnotes_shm_detach(spnotes_shm_view *view)
 {
-	int ret = 0;
+	if (view == NULL || view->base == NULL)
+		return;
 
-	FILE *fp = fopen(md_loc, "r");
-	if (fp == NULL)
-		return ret;
+	munmap((void *)view->base, view->size);
+	view->base = NULL;
+}
 
-	errno = 0;
+/* 'strncmp()' of the string at `off` of the segment with `str`, bound checked */
+static int
+spnotes_shm_strncmp(const spnotes_shm_view *view, uint64_t off,
+                    const char *str, size_t n)
+{
+	return strncmp((const char *)view->base + off, str,
+	               n < view->size - off ? n : view->size - off);
+}
 
-	/* main logic */
-	char buffer[4098], *tmp_ptr;
-	fgets(buffer, sizeof(buffer), fp);
+/*
+ * Offset of the title of the category or note at the index `i` of the order
+ * of the titles in the catalog, 0 if out of bounds (being a torn read).
+ */
+static uint64_t
+spnotes_shm_order_title(const spnotes_shm_view *view, size_t i)
+{
+	uint32_t k   = view->order[i];
+	uint64_t off = 0;
+
+	if (i < view->categs_c && k < view->categs_c)
+		off = view->categs[k].title_off;
+	else if (i >= view->categs_c && k < view->notes_c)
+		off = view->notes[k].title_off;
+	return off < view->size ? off : 0;
+}
 
-	/* continue only if the first line is a starting yaml header */
-	if (strcmp(buffer, "---\n")) {
-		fclose(fp);
-		return ret;
+/* the first of the `count` titles from the `first` one not less than `str` */
+static size_t
+spnotes_shm_lower_bound(const spnotes_shm_view *view, size_t first,
+                        size_t count, const char *str)
+{
+	size_t lo = first, hi = first + count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (spnotes_shm_strncmp(view,
+		                        spnotes_shm_order_title(view, mid), str,
+		                        SIZE_MAX) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	return lo;
+}
 
-	while ((fgets(buffer, sizeof(buffer), fp)) != NULL) {
-		/* stop when we encounter the ending yaml header */
-		if (!strcmp(buffer, "---\n"))
-			break;
-
-		/* parse title */
-		if ((strstr(buffer, "title:")) == buffer) { /* if ^title: */
-			tmp_ptr = strchr(buffer, ':') + 1;
-
-			while (*tmp_ptr == ' ') /* point to the 1st nonspace */
-				tmp_ptr++;
-
-			if (strcmp(tmp_ptr, "\n")) {
-				strncpy(note->title, tmp_ptr,
-				        strchr(tmp_ptr, '\n') - tmp_ptr);
-				ret = 1;
-			}
-			continue;
-		}
-
-		/* parse description (only if title was found before) */
-		if (ret != 1)
-			continue;
-
-		if ((strstr(buffer, "description:")) == buffer) {
-			tmp_ptr = strchr(buffer, ':') + 1;
-
-			while (*tmp_ptr == ' ') /* point to the 1st nonspace */
-				tmp_ptr++;
+/*
+ * Finds the titles of the catalog of `view` starting with `prefix`, see
+ * 'spnotes_shm_complete()'.
+ *
+ * Returns their number OR -1 on error and sets the `spnotes_err`.
+ */
+static int
+spnotes_shm_titles(const spnotes_t *instance, const spnotes_shm_view *view,
+                   const char *categ, const char *prefix, size_t max,
+                   char ***titles)
+{
+	const spnotes_shm_header *header = view->header;
+	struct stat               st;
+
+	/* categories added, deleted or renamed */
+	if (stat(instance->root_location, &st) != 0 ||
+	    st.st_mtim.tv_sec != header->root_mtime_sec ||
+	    st.st_mtim.tv_nsec != header->root_mtime_nsec)
+		goto err_stale;
+
+	/* the titles of the categories OR the notes of `categ` in the order */
+	size_t first = 0, count = view->categs_c;
+	if (categ) {
+		size_t c = spnotes_shm_lower_bound(view, 0, view->categs_c,
+		                                   categ);
+		if (c == view->categs_c ||
+		    spnotes_shm_strncmp(view, spnotes_shm_order_title(view, c),
+		                        categ, SIZE_MAX) != 0)
+			return 0;
+
+		const spnotes_shm_categ *sc = &view->categs[view->order[c]];
+		uint64_t                 notes_first = sc->notes_first;
+		uint64_t                 notes_c     = sc->notes_c;
+		if (notes_first > view->notes_c ||
+		    notes_c > view->notes_c - notes_first)
+			goto err_stale;
+
+		/* notes added, deleted or renamed */
+		char path[PATH_MAX];
+		spnotes_shm_strcpy(path, PATH_MAX, view->base, view->size,
+		                   sc->path_off);
+		if (stat(path, &st) != 0 || st.st_mtim.tv_sec != sc->mtime_sec ||
+		    st.st_mtim.tv_nsec != sc->mtime_nsec)
+			goto err_stale;
+		first = view->categs_c + notes_first;
+		count = notes_c;
+	}
 
-			if (strcmp(tmp_ptr, "\n")) {
-				note->description =
-					strndup(tmp_ptr, strchr(tmp_ptr, '\n') -
-				                                 tmp_ptr);
-				ret = 2;
-			}
+	size_t prefix_len = strlen(prefix);
+	size_t from       = spnotes_shm_lower_bound(view, first, count, prefix);
+	size_t to         = from;
+	while (to < first + count && (max == 0 || to - from < max) &&
+	       spnotes_shm_strncmp(view, spnotes_shm_order_title(view, to),
+	                           prefix, prefix_len) == 0)
+		to++;
+
+	*titles = malloc((to - from + 1) * sizeof(char *));
+	if (*titles == NULL)
+		goto err_malloc;
+	for (size_t i = from; i < to; i++) {
+		uint64_t off        = spnotes_shm_order_title(view, i);
+		(*titles)[i - from] =
+			spnotes_shm_strdup(view->base, view->size, off);
+		if ((*titles)[i - from] == NULL) {
+			spnotes_shm_complete_free(*titles, i - from);
+			*titles = NULL;
+			goto err_malloc;
 		}
 	}
-	if (errno != 0) { /* fgets return NULL on error too */
-		spnotes_err = SPNOTES_ERR_FILE_READ;
-		fclose(fp);
-		return -1;
-	}
-
-	note->has_description = (ret == 2);
-
-	fclose(fp);
-	return ret;
-}
-
-SPNOTES_DEF int
-spnotes_notes_fill(spnotes_categ *categ)
-{
-	return spnotes_notes_fill_filter(categ, NULL, NULL);
+	return to - from;
+
+err_stale:
+	spnotes_err = SPNOTES_ERR_STALE;
+	return -1;
+err_malloc:
+	spnotes_err = SPNOTES_ERR_MALLOC;
+	return -1;
 }
 
 SPNOTES_DEF int
-spnotes_notes_fill_filter(spnotes_categ *categ, char *filter,
-                          int (*filter_func)(const char *, const char *))
+spnotes_shm_complete(const spnotes_t *instance, const char *name,
+                     const char *categ, const char *prefix, size_t max,
+                     char ***titles)
 {
-	DIR *dir = opendir(categ->path);
-	if (dir == NULL) {
-		spnotes_err = SPNOTES_ERR_INVALID_LOC;
+	if (instance == NULL || prefix == NULL || titles == NULL) {
+		spnotes_err = SPNOTES_ERR_NULL_PTR;
 		return -1;
 	}
-
-	int           notes_c = 0, mnotes_c = 128;
-	spnotes_note *notes = malloc(mnotes_c * sizeof(spnotes_note));
-	if (notes == NULL) {
-		spnotes_err = SPNOTES_ERR_MALLOC;
+	if (instance->roots_c > 1) {
+		spnotes_err = SPNOTES_ERR_MULTI_ROOT;
 		return -1;
 	}
+	*titles = NULL;
 
-	/* start reading the directory */
-	errno = 0;
-	struct dirent *dirent;
-	while ((dirent = readdir(dir))) {
-		/* filter out files starting with "." */
-		if (dirent->d_name[0] == '.')
-			continue;
-		/* filter out dir */
-		if (dirent->d_type == DT_DIR)
-			continue;
-		/* filter out non-md files */
-		if (!strstr(dirent->d_name, ".md") &&
-		    !strstr(dirent->d_name, ".MD"))
-			continue;
-
-		/* check if the size of dynamic array has to be increased */
-		if (notes_c == mnotes_c - 1) {
-			spnotes_note *temp_notes = realloc(
-				notes, mnotes_c * 2 * sizeof(spnotes_note));
-			if (temp_notes == NULL) {
-				categ->notes   = notes;
-				categ->notes_c = notes_c;
+	/* seqlock: look up again if a publisher was writing meanwhile */
+	spnotes_shm_view view;
+	for (int tries = 0; tries < 100; tries++) {
+		if (!spnotes_shm_map(instance, name, &view))
+			return -1;
 
-				spnotes_err = SPNOTES_ERR_REALLOC;
-				closedir(dir);
-				return -1;
-			}
-			notes = temp_notes;
-			mnotes_c *= 2;
+		int ret = spnotes_shm_titles(instance, &view, categ, prefix,
+		                             max, titles);
+		int err = spnotes_err;
+		if (spnotes_shm_validate(&view)) {
+			spnotes_shm_detach(&view);
+			spnotes_err = err;
+			return ret;
 		}
+		spnotes_shm_complete_free(*titles, ret > 0 ? ret : 0);
+		*titles = NULL;
+		spnotes_shm_detach(&view);
+	}
 
-		/* fill title and description */
-		char path[PATH_MAX];
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpragmas"
-#pragma GCC diagnostic ignored "-Wunknown-warning-option"
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-		snprintf(path, PATH_MAX, "%s%s", categ->path,
-		         dirent->d_name);
-#pragma GCC diagnostic pop
-		/* filter out md files not having title */
-		if (spnotes_note_fill_title_desc(&notes[notes_c], path) <
-		    1)
-			continue;
-
-		/* filter with the `filter_func()` (if eligible) */
-		if (filter != NULL && filter_func != NULL &&
-		    filter_func(notes[notes_c].title, filter) <= 0) {
-			free(notes[notes_c].description);
-			continue;
-		}
+	spnotes_err = SPNOTES_ERR_STALE;
+	return -1;
+}
 
-		strcpy(notes[notes_c].path, path);
-		notes[notes_c].categ = categ;
+SPNOTES_DEF void
+spnotes_shm_complete_free(char **titles, size_t titles_c)
+{
+	if (titles == NULL)
+		return;
 
-		/* get the last modified date */
-		struct stat note_stat;
-		if (stat(path, &note_stat) != 0) {
-			categ->notes   = notes;
-			categ->notes_c = notes_c;
+	for (size_t i = 0; i < titles_c; i++)
+		free(titles[i]);
+	free(titles);
+}
 
-			spnotes_err = SPNOTES_ERR_FILE_STAT;
-			closedir(dir);
-			return -1;
-		}
-		notes[notes_c].last_modified = note_stat.st_mtim;
 
-		notes_c++;
-	}
-	if (errno != 0) {
-		spnotes_err = SPNOTES_ERR_DIR_READ;
-		closedir(dir);
-		return -1;
-	}
+/* = Memory = */
 
-	closedir(dir);
+/* bytes of `bm` assuming the arrays grown by doubling are at full capacity */
+static size_t
+spnotes_bitmap_size(const spnotes_bitmap *bm)
+{
+	size_t size = bm->mconts_c * sizeof(spnotes_container);
 
-	categ->notes   = notes;
-	categ->notes_c = notes_c;
-	return notes_c;
+	for (size_t i = 0; i < bm->conts_c; i++) {
+		if (bm->conts[i].bitmap) {
+			size += SPNOTES_BITMAP_WORDS * sizeof(uint64_t);
+			continue;
+		}
+		size_t cap = 4;
+		while (cap < bm->conts[i].card)
+			cap *= 2;
+		size += cap * sizeof(uint16_t);
+	}
+	return size;
 }
 
-SPNOTES_DEF int
-spnotes_notes_compare_last_modified(const void *note1, const void *note2)
+SPNOTES_DEF void
+spnotes_memory_usage(const spnotes_t *instance, spnotes_memory *usage)
 {
-	struct timespec *tm1_ts = &(((spnotes_note *)note1)->last_modified);
-	struct timespec *tm2_ts = &(((spnotes_note *)note2)->last_modified);
+	memset(usage, 0, sizeof(*usage));
+	if (instance == NULL)
+		return;
 
-	if (tm1_ts->tv_sec == tm2_ts->tv_sec) {
-		if (tm1_ts->tv_nsec > tm2_ts->tv_nsec)
-			return -1;
-		else
-			return 1;
-	}
+	for (size_t i = 0; i < instance->roots_c; i++)
+		usage->strings += strlen(instance->roots[i]) + 1;
 
-	if (tm1_ts->tv_sec > tm2_ts->tv_sec)
-		return -1;
-	return 1;
-}
+	if (instance->categs) {
+		usage->categs = instance->categs_c * sizeof(spnotes_categ);
+		usage->slack  = (instance->mcategs_c - instance->categs_c) *
+		               sizeof(spnotes_categ);
+	}
+	for (size_t i = 0; i < instance->categs_c; i++) {
+		const spnotes_categ *categ = &instance->categs[i];
+		if (categ->notes == NULL)
+			continue;
 
-SPNOTES_DEF int
-spnotes_notes_compare_alphabetically(const void *note1, const void *note2)
-{
-	char *note1_title = ((spnotes_note *)note1)->title;
-	char *note2_title = ((spnotes_note *)note2)->title;
+		usage->notes += categ->notes_c * sizeof(spnotes_note);
+		usage->slack +=
+			(categ->mnotes_c - categ->notes_c) * sizeof(spnotes_note);
+		for (size_t j = 0; j < categ->notes_c; j++)
+			usage->strings +=
+				spnotes_note_strings_size(&categ->notes[j]);
+	}
 
-	return strcmp(note1_title, note2_title);
+	if (instance->notes_by_id)
+		usage->indexes +=
+			(instance->notes_by_id_c + 1) * sizeof(spnotes_note *);
+	const spnotes_tags *tags = instance->tags;
+	if (tags) {
+		usage->indexes += sizeof(spnotes_tags) +
+		                  tags->mtags_c * (sizeof(char *) +
+		                                   sizeof(spnotes_bitmap)) +
+		                  tags->table_c * sizeof(size_t);
+		for (size_t i = 0; i < tags->tags_c; i++)
+			usage->indexes += strlen(tags->names[i]) + 1 +
+			                  spnotes_bitmap_size(&tags->bitmaps[i]);
+	}
+	const spnotes_trigrams *tg = instance->trigrams;
+	if (tg)
+		usage->indexes += sizeof(spnotes_trigrams) +
+		                  (2 * tg->grams_c + 1 + tg->table_c +
+		                   tg->postings_c) *
+		                          sizeof(uint32_t);
+	const spnotes_links *links = instance->links;
+	if (links)
+		usage->indexes += sizeof(spnotes_links) +
+		                  (3 * (links->notes_c + 1) +
+		                   2 * links->out_c) * sizeof(uint32_t) +
+		                  (links->urls_c + 1) * sizeof(char *) +
+		                  links->strings_size;
+
+	usage->total = usage->categs + usage->notes + usage->strings +
+	               usage->slack + usage->indexes;
 }
 
+/* = Trace = */
+
 SPNOTES_DEF void
-spnotes_notes_sort_last_modified(spnotes_categ *categ)
+spnotes_trace_set(spnotes_trace_func func, void *user)
 {
-	if (categ == NULL || categ->notes == NULL)
-		return;
-
-	qsort(categ->notes, categ->notes_c, sizeof(spnotes_note),
-	      spnotes_notes_compare_last_modified);
+	spnotes_trace_user = user;
+	spnotes_trace_hook = func;
 }
 
 SPNOTES_DEF void
-spnotes_notes_sort_alphabetically(spnotes_categ *categ)
+spnotes_trace_emit(int phase, const char *name, const char *arg)
 {
-	if (categ == NULL || categ->notes == NULL)
-		return;
-
-	qsort(categ->notes, categ->notes_c, sizeof(spnotes_note),
-	      spnotes_notes_compare_alphabetically);
+	SPNOTES_TRACE(phase, name, arg);
 }
 
-SPNOTES_DEF spnotes_note *
-spnotes_notes_search(spnotes_categ categ, const char *title)
+static FILE    *spnotes_trace_json_fp;
+static uint64_t spnotes_trace_json_start; /* ns of the first event */
+static int      spnotes_trace_json_events_c;
+#ifndef SPNOTES_NO_THREADS
+static pthread_mutex_t spnotes_trace_json_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* writes `str` as a JSON string */
+static void
+spnotes_trace_json_str(FILE *fp, const char *str)
 {
-	if (!(categ.notes)) {
-		spnotes_err = SPNOTES_ERR_NOT_FILLED;
-		return NULL;
+	fputc('"', fp);
+	for (; *str; str++) {
+		unsigned char c = *str;
+		if (c == '"' || c == '\\')
+			fprintf(fp, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(fp, "\\u%04x", c);
+		else
+			fputc(c, fp);
 	}
+	fputc('"', fp);
+}
 
-	for (size_t i = 0; i < categ.notes_c; i++) {
-		if (!strcmp(categ.notes[i].title, title))
-			return (categ.notes + i);
+static void
+spnotes_trace_json_hook(int phase, const char *name, const char *arg,
+                        void *user)
+{
+	uint64_t      now = spnotes_clock_ns();
+	unsigned long tid = 0;
+	(void)user;
+#if defined(__linux__) && defined(SYS_gettid)
+	tid = syscall(SYS_gettid);
+#endif
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_lock(&spnotes_trace_json_lock);
+#endif
+	FILE *fp = spnotes_trace_json_fp;
+	if (fp != NULL) {
+		fprintf(fp, "%s\n{\"name\":",
+		        spnotes_trace_json_events_c++ ? "," : "");
+		spnotes_trace_json_str(fp, name);
+		fprintf(fp, ",\"cat\":\"spnotes\",\"ph\":\"%c\",\"ts\":%.3f,"
+		            "\"pid\":%ld,\"tid\":%lu",
+		        phase, (now - spnotes_trace_json_start) / 1e3,
+		        (long)getpid(), tid);
+		if (arg != NULL) {
+			fputs(",\"args\":{\"arg\":", fp);
+			spnotes_trace_json_str(fp, arg);
+			fputc('}', fp);
+		}
+		fputc('}', fp);
 	}
-	return NULL;
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_unlock(&spnotes_trace_json_lock);
+#endif
 }
 
 SPNOTES_DEF int
-spnotes_notes_add(spnotes_categ categ, char *new_loc)
+spnotes_trace_json_open(const char *path)
 {
-	char path[PATH_MAX];
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpragmas"
-#pragma GCC diagnostic ignored "-Wunknown-warning-option"
-#pragma GCC diagnostic ignored "-Wformat-truncation"
-	snprintf(path, PATH_MAX, "%s%ld.md", categ.path,
-	         (unsigned long)time(NULL));
-#pragma GCC diagnostic pop
-
-	int fd = open(path, O_WRONLY | O_CREAT, DEFFILEMODE);
-	if (fd == -1) {
-		spnotes_err = SPNOTES_ERR_OPEN;
-		return 0;
-	}
-	if (close(fd) == -1) {
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL) {
 		spnotes_err = SPNOTES_ERR_OPEN;
 		return 0;
 	}
+	fputs("{\"traceEvents\":[", fp);
 
-	if (new_loc)
-		strcpy(new_loc, path);
-
+	spnotes_trace_json_close(); /* any earlier one */
+	spnotes_trace_json_start    = spnotes_clock_ns();
+	spnotes_trace_json_events_c = 0;
+	spnotes_trace_json_fp       = fp;
+	spnotes_trace_set(spnotes_trace_json_hook, NULL);
 	return 1;
 }
 
-SPNOTES_DEF int
-spnotes_notes_remove(spnotes_note note)
+SPNOTES_DEF void
+spnotes_trace_json_close(void)
 {
-	if (remove(note.path) == -1) {
-		spnotes_err = SPNOTES_ERR_DELETE;
-		return 0;
-	}
-	return 1;
+	if (spnotes_trace_json_fp == NULL)
+		return;
+	spnotes_trace_set(NULL, NULL);
+
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_lock(&spnotes_trace_json_lock);
+#endif
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", spnotes_trace_json_fp);
+	fclose(spnotes_trace_json_fp);
+	spnotes_trace_json_fp = NULL;
+#ifndef SPNOTES_NO_THREADS
+	pthread_mutex_unlock(&spnotes_trace_json_lock);
+#endif
 }
 
 /* = Errors = */
@@ -1030,11 +12332,41 @@ spnotes_errorstr(void)
 		return "Cannot open the file";
 	case SPNOTES_ERR_DELETE:
 		return "Cannot delete the file";
+	case SPNOTES_ERR_REGEX:
+		return "Invalid regular expression";
+	case SPNOTES_ERR_QUERY:
+		return "Invalid query";
+	case SPNOTES_ERR_WRITE:
+		return "Cannot write to the file";
+	case SPNOTES_ERR_PARSE:
+		return "Invalid input format";
+	case SPNOTES_ERR_SHM:
+		return "Cannot map the shared memory";
+	case SPNOTES_ERR_STALE:
+		return "Shared catalog is missing or stale";
+	case SPNOTES_ERR_EXISTS:
+		return "File already exists";
+	case SPNOTES_ERR_MEMORY_CAP:
+		return "Memory cap exceeded";
+	case SPNOTES_ERR_MULTI_ROOT:
+		return "Not supported with several roots";
+	case SPNOTES_ERR_CURSOR:
+		return "Invalid page cursor";
+	case SPNOTES_ERR_VALUE:
+		return "Invalid title or description";
+	case SPNOTES_ERR_RENAME:
+		return "Cannot move the file";
 	}
 
 	return "No error";
 }
 
+SPNOTES_DEF int
+spnotes_error(void)
+{
+	return spnotes_err;
+}
+
 #endif /* SPNOTES_IMPL */
 
 /*
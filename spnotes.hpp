@@ -0,0 +1,418 @@
+/*
+ ===============================================================================
+ |                                 spnotes.hpp                                 |
+ |                   https://github.com/mrsafalpiya/spnotes                    |
+ |                                                                             |
+ |                      C++20 binding of the spnotes.h API                     |
+ |                                                                             |
+ |                  No warranty implied; Use at your own risk                  |
+ |                  See spnotes.h for license information.                     |
+ ===============================================================================
+ */
+
+/*
+ ===============================================================================
+ |                                    Usage                                    |
+ ===============================================================================
+ *
+ * The implementation of spnotes.h is C only, so compile it in a C file of its
+ * own:
+ *
+ *         // spnotes.c
+ *         #define _POSIX_C_SOURCE 200809L
+ *         #define _DEFAULT_SOURCE
+ *         #include <stdio.h>
+ *         #define SPNOTES_IMPL
+ *         #include "spnotes.h"
+ *
+ * and include this file from C++ (C++20 or later):
+ *
+ *         spnotes::Notebook nb("/home/me/notes:/mnt/archive/notes");
+ *         nb.fill();
+ *         for (spnotes::Category categ : nb.categories())
+ *                 for (spnotes::Note note : categ.notes())
+ *                         std::cout << categ.title() << '/' << note.title();
+ *
+ * 'Category' and 'Note' are views of the C structs owned by the 'Notebook',
+ * holding just a pointer: they never copy the strings and are valid until the
+ * notebook is refilled, sorted or destroyed. Errors are thrown as
+ * 'spnotes::Error' carrying the `SPNOTES_ERR_*` code.
+ */
+
+#ifndef SPNOTES_HPP
+#define SPNOTES_HPP
+
+#include <cstdio> /* FILE of spnotes.h */
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include "spnotes.h"
+
+namespace spnotes
+{
+
+/*
+ ===============================================================================
+ |                                   Errors                                    |
+ ===============================================================================
+ */
+
+/* An error of the C API, 'code()' being one of the `SPNOTES_ERR_*`. */
+class Error : public std::runtime_error {
+    public:
+	explicit Error(int code)
+		: std::runtime_error(spnotes_errorstr()), code_(code)
+	{
+	}
+
+	int
+	code() const noexcept
+	{
+		return code_;
+	}
+
+    private:
+	int code_;
+};
+
+/* throws the error of the last call to the C API if `failed` */
+inline void
+check(bool failed)
+{
+	if (failed)
+		throw Error(spnotes_error());
+}
+
+/*
+ ===============================================================================
+ |                                   Ranges                                    |
+ ===============================================================================
+ */
+
+/*
+ * Random access range over a C array of `T`s yielding `View`s of its elements
+ * by value, so that it works with <algorithm> and <ranges> without copying
+ * any of the elements.
+ */
+template <typename View, typename T> class ArrayRange {
+    public:
+	class iterator {
+	    public:
+		using iterator_concept  = std::random_access_iterator_tag;
+		using iterator_category = std::input_iterator_tag;
+		using value_type        = View;
+		using reference         = View;
+		using difference_type   = std::ptrdiff_t;
+
+		iterator() = default;
+		explicit iterator(T *ptr) : ptr_(ptr) {}
+
+		View operator*() const { return View(ptr_); }
+		View operator[](difference_type n) const { return View(ptr_ + n); }
+
+		iterator &operator++() { ++ptr_; return *this; }
+		iterator operator++(int) { return iterator(ptr_++); }
+		iterator &operator--() { --ptr_; return *this; }
+		iterator operator--(int) { return iterator(ptr_--); }
+		iterator &operator+=(difference_type n) { ptr_ += n; return *this; }
+		iterator &operator-=(difference_type n) { ptr_ -= n; return *this; }
+
+		friend iterator
+		operator+(iterator it, difference_type n)
+		{
+			return iterator(it.ptr_ + n);
+		}
+		friend iterator
+		operator+(difference_type n, iterator it)
+		{
+			return iterator(it.ptr_ + n);
+		}
+		friend iterator
+		operator-(iterator it, difference_type n)
+		{
+			return iterator(it.ptr_ - n);
+		}
+		friend difference_type
+		operator-(iterator a, iterator b)
+		{
+			return a.ptr_ - b.ptr_;
+		}
+		friend auto operator<=>(iterator, iterator) = default;
+
+	    private:
+		T *ptr_ = nullptr;
+	};
+
+	ArrayRange() = default;
+	ArrayRange(T *data, std::size_t size) : data_(data), size_(size) {}
+
+	iterator begin() const noexcept { return iterator(data_); }
+	iterator end() const noexcept { return iterator(data_ + size_); }
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+	View operator[](std::size_t i) const { return View(data_ + i); }
+
+	/* the C structs themselves */
+	std::span<T> span() const noexcept { return { data_, size_ }; }
+
+    private:
+	T          *data_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+/*
+ ===============================================================================
+ |                                    Views                                    |
+ ===============================================================================
+ */
+
+class Category;
+
+/* View of a note. */
+class Note {
+    public:
+	explicit Note(spnotes_note *note) noexcept : note_(note) {}
+
+	std::string_view title() const noexcept { return note_->title; }
+	std::string_view path() const noexcept { return note_->path; }
+
+	/* empty if the note has none */
+	std::string_view
+	description() const noexcept
+	{
+		return note_->has_description ? note_->description : "";
+	}
+
+	bool has_description() const noexcept { return note_->has_description; }
+
+	/* comma separated, empty if the note has none */
+	std::string_view
+	tags() const noexcept
+	{
+		return note_->tags ? note_->tags : "";
+	}
+
+	const struct timespec &
+	last_modified() const noexcept
+	{
+		return note_->last_modified;
+	}
+
+	/* from the file name, 0 if it isn't named by time */
+	const struct timespec &
+	created() const noexcept
+	{
+		return note_->created;
+	}
+
+	inline Category categ() const noexcept;
+
+	/* edits the header of the note file, see 'spnotes_note_set_title()' */
+	void
+	set_title(const char *title) const
+	{
+		check(!spnotes_note_set_title(note_, title));
+	}
+
+	/* nullptr removes it */
+	void
+	set_description(const char *description) const
+	{
+		check(!spnotes_note_set_description(note_, description));
+	}
+
+	spnotes_note *c_ptr() const noexcept { return note_; }
+
+    private:
+	spnotes_note *note_;
+};
+
+using Notes = ArrayRange<Note, spnotes_note>;
+static_assert(std::ranges::random_access_range<Notes>);
+
+/* View of a category. */
+class Category {
+    public:
+	explicit Category(spnotes_categ *categ) noexcept : categ_(categ) {}
+
+	std::string_view title() const noexcept { return categ_->title; }
+	std::string_view path() const noexcept { return categ_->path; }
+
+	/* the root of the notebook the category is in */
+	std::string_view
+	root() const noexcept
+	{
+		return categ_->root ? categ_->root :
+		                      categ_->spnotes_instance->root_location;
+	}
+
+	const struct timespec &
+	last_modified() const noexcept
+	{
+		return categ_->last_modified;
+	}
+
+	bool filled() const noexcept { return categ_->notes != nullptr; }
+
+	Notes
+	notes() const noexcept
+	{
+		return Notes(categ_->notes, categ_->notes_c);
+	}
+
+	/* fills the notes of the category */
+	void
+	fill() const
+	{
+		check(spnotes_notes_fill(categ_) < 0);
+	}
+
+	std::optional<Note>
+	find(std::string_view title) const
+	{
+		for (Note note : notes())
+			if (note.title() == title)
+				return note;
+		return std::nullopt;
+	}
+
+	void
+	sort_alphabetically() const noexcept
+	{
+		spnotes_notes_sort_alphabetically(categ_);
+	}
+
+	void
+	sort_last_modified() const noexcept
+	{
+		spnotes_notes_sort_last_modified(categ_);
+	}
+
+	void
+	sort_created() const noexcept
+	{
+		spnotes_notes_sort_created(categ_);
+	}
+
+	spnotes_categ *c_ptr() const noexcept { return categ_; }
+
+    private:
+	spnotes_categ *categ_;
+};
+
+inline Category
+Note::categ() const noexcept
+{
+	return Category(note_->categ);
+}
+
+using Categories = ArrayRange<Category, spnotes_categ>;
+static_assert(std::ranges::random_access_range<Categories>);
+
+/*
+ ===============================================================================
+ |                                  Notebook                                   |
+ ===============================================================================
+ */
+
+/*
+ * Owner of a 'spnotes_t' instance. Move only: the categories point back to
+ * the instance, which is therefore kept at a fixed place on the heap. A moved
+ * from notebook can only be assigned to or destroyed.
+ */
+class Notebook {
+    public:
+	/* `roots` as in 'spnotes_init_roots()' */
+	explicit Notebook(const char *roots) : instance_(new spnotes_t())
+	{
+		check(!spnotes_init_roots(instance_.get(), roots));
+	}
+
+	Notebook(Notebook &&) noexcept            = default;
+	Notebook &operator=(Notebook &&) noexcept = default;
+	Notebook(const Notebook &)                = delete;
+	Notebook &operator=(const Notebook &)     = delete;
+
+	/* fills the categories and all of their notes */
+	void
+	fill()
+	{
+		check(spnotes_categs_fill(instance_.get()) < 0);
+		for (Category categ : categories())
+			categ.fill();
+	}
+
+	/* fills the nested categories and all of their notes */
+	void
+	fill_nested()
+	{
+		check(spnotes_categs_fill_nested(instance_.get(),
+		                                 SPNOTES_FILL_NOTES) < 0);
+	}
+
+	Categories
+	categories() const noexcept
+	{
+		return Categories(instance_->categs, instance_->categs_c);
+	}
+
+	std::optional<Category>
+	find(std::string_view title) const
+	{
+		for (Category categ : categories())
+			if (categ.title() == title)
+				return categ;
+		return std::nullopt;
+	}
+
+	/* all the notes of all the categories */
+	auto
+	notes() const
+	{
+		return categories() |
+		       std::views::transform([](Category categ) {
+			       return categ.notes();
+		       }) |
+		       std::views::join;
+	}
+
+	void
+	sort_alphabetically() noexcept
+	{
+		spnotes_categs_sort_alphabetically(instance_.get());
+		for (Category categ : categories())
+			categ.sort_alphabetically();
+	}
+
+	void
+	sort_last_modified() noexcept
+	{
+		spnotes_categs_sort_last_modified(instance_.get());
+		for (Category categ : categories())
+			categ.sort_last_modified();
+	}
+
+	spnotes_t *c_ptr() const noexcept { return instance_.get(); }
+
+    private:
+	struct Free {
+		void
+		operator()(spnotes_t *instance) const noexcept
+		{
+			spnotes_free(instance);
+			delete instance;
+		}
+	};
+
+	std::unique_ptr<spnotes_t, Free> instance_;
+};
+
+} /* namespace spnotes */
+
+#endif /* SPNOTES_HPP */